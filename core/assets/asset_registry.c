@@ -0,0 +1,397 @@
+/**
+ * @file asset_registry.c
+ * @brief Implementation of the shared asset cache
+ */
+
+#include "asset_registry.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dynamic_array.h"
+#include "logger.h"
+
+#define INITIAL_SLOT_COUNT 64
+#define NO_ENTRY (-1)
+
+static const char* const asset_class_names[ASSET_CLASS_COUNT] = {
+    "texture", "font", "sound"};
+
+static uint64_t hash_key(asset_class_t asset_class, const char* path,
+                         int point_size) {
+  uint64_t hash = 1469598103934665603ull;
+  for (const char* c = path; *c; c++) {
+    hash = (hash ^ (uint8_t)*c) * 1099511628211ull;
+  }
+  hash = (hash ^ (uint64_t)asset_class) * 1099511628211ull;
+  return (hash ^ (uint64_t)(uint32_t)point_size) * 1099511628211ull;
+}
+
+static bool rebuild_slots(asset_registry_ptr registry, int slot_count) {
+  int* slots = malloc(sizeof(int) * (size_t)slot_count);
+  if (!slots) {
+    return false;
+  }
+  for (int i = 0; i < slot_count; i++) {
+    slots[i] = NO_ENTRY;
+  }
+  for (int i = 0; i < registry->entry_count; i++) {
+    int slot = (int)(registry->entries[i]->hash & (uint64_t)(slot_count - 1));
+    while (slots[slot] != NO_ENTRY) {
+      slot = (slot + 1) & (slot_count - 1);
+    }
+    slots[slot] = i;
+  }
+  free(registry->slots);
+  registry->slots = slots;
+  registry->slot_count = slot_count;
+  return true;
+}
+
+static int find_entry(const asset_registry_ptr registry, uint64_t hash,
+                      asset_class_t asset_class, const char* path,
+                      int point_size) {
+  int mask = registry->slot_count - 1;
+  for (int slot = (int)(hash & (uint64_t)mask);
+       registry->slots[slot] != NO_ENTRY; slot = (slot + 1) & mask) {
+    const asset_entry_t* entry = registry->entries[registry->slots[slot]];
+    if (entry->hash == hash && entry->asset_class == asset_class &&
+        entry->point_size == point_size && !strcmp(entry->path, path)) {
+      return registry->slots[slot];
+    }
+  }
+  return NO_ENTRY;
+}
+
+static int add_entry(asset_registry_ptr registry, uint64_t hash,
+                     asset_class_t asset_class, const char* path,
+                     int point_size) {
+  // Keep the table at most half full
+  if ((registry->entry_count + 1) * 2 > registry->slot_count &&
+      !rebuild_slots(registry, registry->slot_count * 2)) {
+    return NO_ENTRY;
+  }
+
+  asset_entry_t** entries =
+      grow_array(registry->entries, &registry->entry_capacity,
+                 registry->entry_count + 1, sizeof(asset_entry_t*));
+  if (!entries) {
+    return NO_ENTRY;
+  }
+  registry->entries = entries;
+
+  asset_entry_t* entry = calloc(1, sizeof(asset_entry_t));
+  char* path_copy = malloc(strlen(path) + 1);
+  if (!entry || !path_copy) {
+    free(entry);
+    free(path_copy);
+    return NO_ENTRY;
+  }
+  strcpy(path_copy, path);
+
+  int index = registry->entry_count++;
+  registry->entries[index] = entry;
+  entry->path = path_copy;
+  entry->point_size = point_size;
+  entry->asset_class = asset_class;
+  entry->hash = hash;
+  entry->lru_prev = NO_ENTRY;
+  entry->lru_next = NO_ENTRY;
+
+  int mask = registry->slot_count - 1;
+  int slot = (int)(hash & (uint64_t)mask);
+  while (registry->slots[slot] != NO_ENTRY) {
+    slot = (slot + 1) & mask;
+  }
+  registry->slots[slot] = index;
+  return index;
+}
+
+static void lru_unlink(asset_registry_ptr registry, int index) {
+  asset_entry_t* entry = registry->entries[index];
+  if (entry->lru_prev != NO_ENTRY) {
+    registry->entries[entry->lru_prev]->lru_next = entry->lru_next;
+  } else {
+    registry->lru_head = entry->lru_next;
+  }
+  if (entry->lru_next != NO_ENTRY) {
+    registry->entries[entry->lru_next]->lru_prev = entry->lru_prev;
+  } else {
+    registry->lru_tail = entry->lru_prev;
+  }
+  entry->lru_prev = NO_ENTRY;
+  entry->lru_next = NO_ENTRY;
+}
+
+static void lru_append(asset_registry_ptr registry, int index) {
+  asset_entry_t* entry = registry->entries[index];
+  entry->lru_prev = registry->lru_tail;
+  entry->lru_next = NO_ENTRY;
+  if (registry->lru_tail != NO_ENTRY) {
+    registry->entries[registry->lru_tail]->lru_next = index;
+  } else {
+    registry->lru_head = index;
+  }
+  registry->lru_tail = index;
+}
+
+static size_t file_size(const char* path) {
+  SDL_RWops* file = SDL_RWFromFile(path, "rb");
+  if (!file) {
+    return 0;
+  }
+  Sint64 size = SDL_RWsize(file);
+  SDL_RWclose(file);
+  return size > 0 ? (size_t)size : 0;
+}
+
+static bool load_entry(asset_registry_ptr registry, int index) {
+  asset_entry_t* entry = registry->entries[index];
+  switch (entry->asset_class) {
+    case ASSET_TEXTURE:
+      entry->texture =
+          load_texture(registry->graphics_context->renderer, entry->path);
+      if (!entry->texture.texture) {
+        return false;
+      }
+      // GPU copy plus the CPU backend's surface, if any
+      entry->bytes = (size_t)entry->texture.width * entry->texture.height *
+                     (entry->texture.surface ? 8 : 4);
+      break;
+    case ASSET_FONT:
+      entry->font = load_ttf_font(entry->path, entry->point_size);
+      if (!entry->font) {
+        return false;
+      }
+      // SDL_ttf keeps the face in memory; its file size is a fair estimate
+      entry->bytes = file_size(entry->path);
+      break;
+    case ASSET_SOUND:
+      entry->chunk = Mix_LoadWAV(entry->path);
+      if (!entry->chunk) {
+        LOG_MIX_ERROR(entry->path);
+        return false;
+      }
+      entry->bytes = entry->chunk->alen;
+      break;
+    case ASSET_CLASS_COUNT:
+      return false;
+  }
+
+  entry->loaded = true;
+  // Not handed out yet, so not drawn this frame either
+  entry->last_frame = registry->graphics_context->frame_count - 1;
+  registry->total_bytes += entry->bytes;
+  registry->stats.bytes[entry->asset_class] += entry->bytes;
+  registry->stats.loaded[entry->asset_class]++;
+  registry->stats.loads++;
+  return true;
+}
+
+static void unload_entry(asset_registry_ptr registry, int index) {
+  asset_entry_t* entry = registry->entries[index];
+  if (!entry->loaded) {
+    return;
+  }
+
+  switch (entry->asset_class) {
+    case ASSET_TEXTURE:
+      free_texture(&entry->texture);
+      break;
+    case ASSET_FONT:
+      free_ttf_font(entry->font);
+      entry->font = NULL;
+      break;
+    case ASSET_SOUND:
+      Mix_FreeChunk(entry->chunk);
+      entry->chunk = NULL;
+      break;
+    case ASSET_CLASS_COUNT:
+      break;
+  }
+
+  entry->loaded = false;
+  registry->total_bytes -= entry->bytes;
+  registry->stats.bytes[entry->asset_class] -= entry->bytes;
+  registry->stats.loaded[entry->asset_class]--;
+  entry->bytes = 0;
+}
+
+// Unload unreferenced assets, oldest first, until the budget is met. `keep`
+// is an asset just handed out that must survive this call. Textures handed
+// out this frame may still be drawn by deferred commands and are kept.
+static void enforce_budget(asset_registry_ptr registry, int keep) {
+  unsigned frame = registry->graphics_context->frame_count;
+  int index = registry->lru_head;
+  while (registry->budget > 0 && registry->total_bytes > registry->budget &&
+         index != NO_ENTRY) {
+    int next = registry->entries[index]->lru_next;
+    bool drawn = registry->entries[index]->asset_class == ASSET_TEXTURE &&
+                 registry->entries[index]->last_frame == frame;
+    if (index != keep && !drawn) {
+      const asset_entry_t* entry = registry->entries[index];
+      LOG_INFO_FMT("Evicting %s %s (%zu bytes)",
+                   asset_class_names[entry->asset_class], entry->path,
+                   entry->bytes);
+      lru_unlink(registry, index);
+      unload_entry(registry, index);
+      registry->stats.evictions++;
+    }
+    index = next;
+  }
+}
+
+asset_registry_ptr create_asset_registry(
+    const graphics_context_ptr graphics_context, size_t budget_bytes) {
+  if (!graphics_context) {
+    return NULL;
+  }
+  asset_registry_ptr registry = calloc(1, sizeof(asset_registry_t));
+  if (!registry) {
+    LOG_ERROR("Failed to allocate asset registry");
+    return NULL;
+  }
+  registry->graphics_context = graphics_context;
+  registry->budget = budget_bytes;
+  registry->lru_head = NO_ENTRY;
+  registry->lru_tail = NO_ENTRY;
+  if (!rebuild_slots(registry, INITIAL_SLOT_COUNT)) {
+    LOG_ERROR("Failed to allocate asset registry");
+    free(registry);
+    return NULL;
+  }
+  return registry;
+}
+
+void destroy_asset_registry(asset_registry_ptr registry) {
+  if (!registry) {
+    return;
+  }
+  for (int i = 0; i < registry->entry_count; i++) {
+    unload_entry(registry, i);
+    free(registry->entries[i]->path);
+    free(registry->entries[i]);
+  }
+  free(registry->entries);
+  free(registry->slots);
+  free(registry);
+}
+
+void set_asset_budget(asset_registry_ptr registry, size_t budget_bytes) {
+  if (!registry) {
+    return;
+  }
+  registry->budget = budget_bytes;
+  enforce_budget(registry, NO_ENTRY);
+}
+
+static asset_id_t acquire_asset(asset_registry_ptr registry,
+                                asset_class_t asset_class, const char* path,
+                                int point_size) {
+  if (!registry || !path) {
+    return INVALID_ASSET_ID;
+  }
+
+  uint64_t hash = hash_key(asset_class, path, point_size);
+  int index = find_entry(registry, hash, asset_class, path, point_size);
+  if (index == NO_ENTRY) {
+    index = add_entry(registry, hash, asset_class, path, point_size);
+    if (index == NO_ENTRY) {
+      LOG_ERROR("Failed to grow asset registry");
+      return INVALID_ASSET_ID;
+    }
+  }
+
+  asset_entry_t* entry = registry->entries[index];
+  if (entry->loaded) {
+    registry->stats.hits++;
+    if (entry->refcount == 0) {
+      lru_unlink(registry, index);
+    }
+  } else if (!load_entry(registry, index)) {
+    return INVALID_ASSET_ID;
+  }
+
+  registry->entries[index]->refcount++;
+  enforce_budget(registry, NO_ENTRY);
+  return index;
+}
+
+asset_id_t acquire_texture(asset_registry_ptr registry, const char* path) {
+  return acquire_asset(registry, ASSET_TEXTURE, path, 0);
+}
+
+asset_id_t acquire_font(asset_registry_ptr registry, const char* path,
+                        int point_size) {
+  return acquire_asset(registry, ASSET_FONT, path, point_size);
+}
+
+asset_id_t acquire_sound(asset_registry_ptr registry, const char* path) {
+  return acquire_asset(registry, ASSET_SOUND, path, 0);
+}
+
+void release_asset(asset_registry_ptr registry, asset_id_t id) {
+  if (!registry || id < 0 || id >= registry->entry_count) {
+    return;
+  }
+
+  asset_entry_t* entry = registry->entries[id];
+  if (entry->refcount <= 0) {
+    LOG_WARN_FMT("Releasing unreferenced asset %s", entry->path);
+    return;
+  }
+  if (--entry->refcount == 0 && entry->loaded) {
+    lru_append(registry, id);
+    enforce_budget(registry, NO_ENTRY);
+  }
+}
+
+// Return a loaded entry of the given class, reloading it after eviction
+static asset_entry_t* use_entry(asset_registry_ptr registry, asset_id_t id,
+                                asset_class_t asset_class) {
+  if (!registry || id < 0 || id >= registry->entry_count ||
+      registry->entries[id]->asset_class != asset_class) {
+    return NULL;
+  }
+
+  asset_entry_t* entry = registry->entries[id];
+  if (!entry->loaded) {
+    if (!load_entry(registry, id)) {
+      return NULL;
+    }
+    if (entry->refcount == 0) {
+      lru_append(registry, id);
+    }
+    enforce_budget(registry, id);
+  } else if (entry->refcount == 0) {
+    // Move to the most recently used end
+    lru_unlink(registry, id);
+    lru_append(registry, id);
+  }
+  return entry;
+}
+
+texture_ptr get_texture_asset(asset_registry_ptr registry, asset_id_t id) {
+  asset_entry_t* entry = use_entry(registry, id, ASSET_TEXTURE);
+  if (!entry) {
+    return NULL;
+  }
+  entry->last_frame = registry->graphics_context->frame_count;
+  return &entry->texture;
+}
+
+ttf_font_t get_font_asset(asset_registry_ptr registry, asset_id_t id) {
+  asset_entry_t* entry = use_entry(registry, id, ASSET_FONT);
+  return entry ? entry->font : NULL;
+}
+
+Mix_Chunk* get_sound_asset(asset_registry_ptr registry, asset_id_t id) {
+  asset_entry_t* entry = use_entry(registry, id, ASSET_SOUND);
+  return entry ? entry->chunk : NULL;
+}
+
+asset_registry_stats_t get_asset_registry_stats(
+    const asset_registry_ptr registry) {
+  asset_registry_stats_t empty = {0};
+  return registry ? registry->stats : empty;
+}
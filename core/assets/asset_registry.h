@@ -0,0 +1,173 @@
+/**
+ * @file asset_registry.h
+ * @brief Shared, refcounted asset cache with a memory budget
+ *
+ * Textures, TTF fonts and sound chunks are keyed by path (and point size for
+ * fonts), so loading the same file twice returns the same asset. Each
+ * acquire_* call adds a reference that release_asset() drops. Assets
+ * without references stay cached until the registry exceeds its memory
+ * budget; they are then unloaded least recently used first. Their ids stay
+ * valid: the next get_* or acquire_* call reloads them from disk.
+ *
+ * Pointers returned by get_* are valid while the asset holds a reference,
+ * or until the next registry call otherwise. Textures handed out since the
+ * last present_frame() are never evicted, because the render queue and the
+ * CPU backend draw them only when the frame is flushed; the budget may be
+ * exceeded by the textures of a single frame.
+ */
+
+#ifndef CORE_ASSETS_ASSET_REGISTRY_H_
+#define CORE_ASSETS_ASSET_REGISTRY_H_
+
+#include <SDL.h>
+#include <SDL_mixer.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "graphics_context.h"
+#include "texture.h"
+#include "ttf_text.h"
+
+// Asset ids are indices into the registry; never reused while it lives
+typedef int asset_id_t;
+
+#define INVALID_ASSET_ID (-1)
+
+typedef enum {
+  ASSET_TEXTURE,
+  ASSET_FONT,
+  ASSET_SOUND,
+  ASSET_CLASS_COUNT
+} asset_class_t;
+
+typedef struct {
+  char* path;
+  int point_size;  // Fonts only
+  asset_class_t asset_class;
+  uint64_t hash;
+  bool loaded;
+  texture_t texture;
+  ttf_font_t font;
+  Mix_Chunk* chunk;
+  size_t bytes;  // Estimated memory held while loaded
+  int refcount;
+  unsigned last_frame;  // graphics_context_t.frame_count when last handed out
+  int lru_prev;  // Neighbours in the list of loaded, unreferenced assets
+  int lru_next;
+} asset_entry_t;
+
+typedef struct {
+  size_t bytes[ASSET_CLASS_COUNT];   // Memory held by loaded assets
+  int loaded[ASSET_CLASS_COUNT];     // Loaded assets per class
+  uint64_t hits;                     // Requests served from the cache
+  uint64_t loads;                    // Loads from disk, reloads included
+  uint64_t evictions;
+} asset_registry_stats_t;
+
+typedef struct asset_registry {
+  graphics_context_ptr graphics_context;
+  asset_entry_t** entries;  // Individually allocated, so pointers stay put
+  int entry_count;
+  int entry_capacity;
+  int* slots;  // Open-addressing table of entry indices, -1 when empty
+  int slot_count;
+  int lru_head;  // Least recently used evictable asset
+  int lru_tail;
+  size_t budget;  // 0 means unlimited
+  size_t total_bytes;
+  asset_registry_stats_t stats;
+} asset_registry_t, *asset_registry_ptr;
+
+/**
+ * @brief Create an empty registry
+ * @param graphics_context Graphics context whose renderer creates textures
+ *        and whose presented frames bound texture lifetimes
+ * @param budget_bytes Memory budget for loaded assets, 0 for unlimited
+ * @return Registry, or NULL on failure
+ */
+asset_registry_ptr create_asset_registry(
+    const graphics_context_ptr graphics_context, size_t budget_bytes);
+
+/**
+ * @brief Unload every asset and free the registry
+ * @param registry Registry to destroy (may be NULL)
+ */
+void destroy_asset_registry(asset_registry_ptr registry);
+
+/**
+ * @brief Change the memory budget, evicting assets if needed
+ * @param registry Registry
+ * @param budget_bytes New budget, 0 for unlimited
+ */
+void set_asset_budget(asset_registry_ptr registry, size_t budget_bytes);
+
+/**
+ * @brief Get a shared texture, loading it like load_texture() if needed
+ * @param registry Registry
+ * @param path Image path
+ * @return Asset id holding one reference, or INVALID_ASSET_ID
+ */
+asset_id_t acquire_texture(asset_registry_ptr registry, const char* path);
+
+/**
+ * @brief Get a shared TTF font, loading it if needed
+ *
+ * The SDL_ttf subsystem must be initialized (see init_ttf_system()).
+ *
+ * @param registry Registry
+ * @param path Font path
+ * @param point_size Font size in points; each size is a separate asset
+ * @return Asset id holding one reference, or INVALID_ASSET_ID
+ */
+asset_id_t acquire_font(asset_registry_ptr registry, const char* path,
+                        int point_size);
+
+/**
+ * @brief Get a shared sound chunk, loading it if needed
+ * @param registry Registry
+ * @param path Sound file path
+ * @return Asset id holding one reference, or INVALID_ASSET_ID
+ */
+asset_id_t acquire_sound(asset_registry_ptr registry, const char* path);
+
+/**
+ * @brief Drop a reference; unreferenced assets become evictable
+ * @param registry Registry
+ * @param id Asset to release
+ */
+void release_asset(asset_registry_ptr registry, asset_id_t id);
+
+/**
+ * @brief Get the texture of an asset, reloading it if it was evicted
+ * @param registry Registry
+ * @param id Texture asset
+ * @return Texture, or NULL if the id is invalid or loading failed
+ */
+texture_ptr get_texture_asset(asset_registry_ptr registry, asset_id_t id);
+
+/**
+ * @brief Get the font of an asset, reloading it if it was evicted
+ * @param registry Registry
+ * @param id Font asset
+ * @return Font, or NULL if the id is invalid or loading failed
+ */
+ttf_font_t get_font_asset(asset_registry_ptr registry, asset_id_t id);
+
+/**
+ * @brief Get the sound chunk of an asset, reloading it if it was evicted
+ * @param registry Registry
+ * @param id Sound asset
+ * @return Chunk, or NULL if the id is invalid or loading failed
+ */
+Mix_Chunk* get_sound_asset(asset_registry_ptr registry, asset_id_t id);
+
+/**
+ * @brief Get memory use and cache counters
+ * @param registry Registry
+ * @return Statistics since creation
+ */
+asset_registry_stats_t get_asset_registry_stats(
+    const asset_registry_ptr registry);
+
+#endif  // CORE_ASSETS_ASSET_REGISTRY_H_
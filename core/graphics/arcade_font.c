@@ -28,6 +28,24 @@ arcade_font_t load_arcade_font(const graphics_context_ptr graphics_context) {
   return arcade_font;
 }
 
+arcade_font_t load_tinted_arcade_font(
+    const graphics_context_ptr graphics_context) {
+  arcade_font_t arcade_font = {0};
+
+  arcade_font.bitmap_font = load_tinted_bitmap_font(
+      graphics_context, ARCADE_FONT_PATH, ARCADE_FONT_CHAR_WIDTH,
+      ARCADE_FONT_CHAR_HEIGHT, ARCADE_FONT_ROW_SPACING,
+      ARCADE_FONT_COLOR_OFFSET);
+
+  if (!arcade_font.bitmap_font.texture.texture) {
+    LOG_ERROR("Failed to load tinted arcade font");
+  } else {
+    LOG_INFO("Tinted arcade font loaded successfully");
+  }
+
+  return arcade_font;
+}
+
 void render_arcade_text(const arcade_font_ptr font,
                         const graphics_context_ptr graphics_context,
                         const char* text, int x, int y, font_color_t color) {
@@ -50,6 +68,14 @@ void render_arcade_text_scaled_alpha(const arcade_font_ptr font,
                                   color, scale, alpha);
 }
 
+void render_arcade_text_colored(const arcade_font_ptr font,
+                                const graphics_context_ptr graphics_context,
+                                const char* text, int x, int y,
+                                SDL_Color color, int scale) {
+  render_bitmap_text_colored(&font->bitmap_font, graphics_context, text, x, y,
+                             color, scale);
+}
+
 int get_arcade_text_width(const arcade_font_ptr font, const char* text) {
   return get_bitmap_text_width(&font->bitmap_font, text);
 }
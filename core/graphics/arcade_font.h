@@ -27,6 +27,18 @@ typedef struct {
  */
 arcade_font_t load_arcade_font(const graphics_context_ptr graphics_context);
 
+/**
+ * Load the arcade font as a tinted single-row font
+ *
+ * Keeps only the white row of the sprite sheet and colors text per vertex,
+ * so it takes an eighth of the texture memory and can draw any color.
+ *
+ * @param graphics_context Graphics context for texture creation
+ * @return Initialized arcade font structure
+ */
+arcade_font_t load_tinted_arcade_font(
+    const graphics_context_ptr graphics_context);
+
 /**
  * Render arcade text at the specified position
  *
@@ -74,6 +86,22 @@ void render_arcade_text_scaled_alpha(const arcade_font_ptr font,
                                      const char* text, int x, int y,
                                      font_color_t color, int scale, int alpha);
 
+/**
+ * Render scaled arcade text in any color
+ *
+ * @param font Arcade font from load_tinted_arcade_font()
+ * @param graphics_context Graphics context for rendering
+ * @param text Text string to render (supports A-Z, 0-9, !, /, -, space)
+ * @param x X position to render at
+ * @param y Y position to render at
+ * @param color Text color and alpha
+ * @param scale Scale factor (1 = normal size, 2 = double size, etc.)
+ */
+void render_arcade_text_colored(const arcade_font_ptr font,
+                                const graphics_context_ptr graphics_context,
+                                const char* text, int x, int y,
+                                SDL_Color color, int scale);
+
 /**
  * Get the width in pixels of rendered arcade text
  *
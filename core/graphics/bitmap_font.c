@@ -1,60 +1,90 @@
 #include "bitmap_font.h"
 
-#include <ctype.h>
+#include <SDL_image.h>
 #include <string.h>
 
+#include "cpu_renderer.h"
 #include "logger.h"
+#include "primitive_batch.h"
+#include "render_queue.h"
 #include "texture.h"
 
-// Get the sprite coordinates for a character
-static bool get_char_sprite_rect(char c, int* out_x, int* out_y, int char_width,
-                                 int char_height, int row_spacing) {
-  (void)char_height;  // Suppress unused parameter warning
-  c = toupper(c);
+static void set_glyph(bitmap_font_ptr font, char c, int column, int row) {
+  rect_t rect = {column * font->char_width, row * font->row_spacing,
+                 font->char_width, font->char_height};
+  font->glyphs[(unsigned char)c] = rect;
+  if (c >= 'A' && c <= 'Z') {
+    font->glyphs[(unsigned char)(c - 'A' + 'a')] = rect;
+  }
+}
+
+// Map the sprite sheet layout into the glyph table; lowercase letters share
+// the uppercase glyphs and every other byte stays blank
+static void build_glyph_table(bitmap_font_ptr font) {
+  memset(font->glyphs, 0, sizeof(font->glyphs));
 
   // Row 1: A-O (0-14)
-  if (c >= 'A' && c <= 'O') {
-    *out_x = (c - 'A') * char_width;
-    *out_y = 0;
-    return true;
+  for (char c = 'A'; c <= 'O'; c++) {
+    set_glyph(font, c, c - 'A', 0);
   }
 
   // Row 2: P-Z and ! (0-11)
-  if (c >= 'P' && c <= 'Z') {
-    *out_x = (c - 'P') * char_width;
-    *out_y = row_spacing;
-    return true;
-  }
-  if (c == '!') {
-    *out_x = 11 * char_width;
-    *out_y = row_spacing;
-    return true;
+  for (char c = 'P'; c <= 'Z'; c++) {
+    set_glyph(font, c, c - 'P', 1);
   }
+  set_glyph(font, '!', 11, 1);
 
   // Row 3: 0-9, /, - (0-11)
-  if (c >= '0' && c <= '9') {
-    *out_x = (c - '0') * char_width;
-    *out_y = row_spacing * 2;
-    return true;
-  }
-  if (c == '/') {
-    *out_x = 10 * char_width;
-    *out_y = row_spacing * 2;
-    return true;
-  }
-  if (c == '-') {
-    *out_x = 11 * char_width;
-    *out_y = row_spacing * 2;
-    return true;
+  for (char c = '0'; c <= '9'; c++) {
+    set_glyph(font, c, c - '0', 2);
   }
+  set_glyph(font, '/', 10, 2);
+  set_glyph(font, '-', 11, 2);
+}
 
-  // Space character - no sprite to render
-  if (c == ' ') {
-    return false;
+// Blank out glyphs that reach past the sheet, so a short or narrow sheet
+// is reported here rather than while drawing
+static int drop_missing_glyphs(bitmap_font_ptr font) {
+  int dropped = 0;
+  for (int i = 0; i < BITMAP_FONT_GLYPH_COUNT; i++) {
+    rect_t* glyph = &font->glyphs[i];
+    if (glyph->w > 0 && (glyph->x + glyph->w > font->texture.width ||
+                         glyph->y + glyph->h > font->texture.height)) {
+      glyph->w = 0;
+      glyph->h = 0;
+      dropped++;
+    }
   }
+  return dropped;
+}
+
+// Colors of the arcade font sheet rows, so tinted fonts draw font_color_t
+// text exactly like the full sheet
+static const SDL_Color default_palette[FONT_COLOR_COUNT] = {
+    {224, 221, 255, 255}, {255, 0, 0, 255},     {252, 181, 255, 255},
+    {0, 255, 255, 255},   {248, 187, 85, 255},  {250, 185, 176, 255},
+    {255, 255, 0, 255},   {0, 200, 0, 255}};
+
+static void init_font(bitmap_font_ptr font, int char_width, int char_height,
+                      int row_spacing, int color_offset) {
+  font->char_width = char_width;
+  font->char_height = char_height;
+  font->row_spacing = row_spacing;
+  font->color_offset = color_offset;
+  memcpy(font->palette, default_palette, sizeof(font->palette));
+  build_glyph_table(font);
+}
 
-  LOG_WARN_FMT("Unsupported character in bitmap font: '%c'", c);
-  return false;
+static void report_loaded_font(bitmap_font_ptr font,
+                               const char* sprite_sheet_path) {
+  int dropped = drop_missing_glyphs(font);
+  if (dropped > 0) {
+    LOG_WARN_FMT("Bitmap font %s lacks %d glyphs, drawn as blanks",
+                 sprite_sheet_path, dropped);
+  }
+  LOG_INFO_FMT("Loaded %sbitmap font: %s (A-Z, 0-9, !, /, -; other "
+               "characters are drawn as blanks)",
+               font->tinted ? "tinted " : "", sprite_sheet_path);
 }
 
 bitmap_font_t load_bitmap_font(const graphics_context_ptr graphics_context,
@@ -64,54 +94,174 @@ bitmap_font_t load_bitmap_font(const graphics_context_ptr graphics_context,
   bitmap_font_t font = {0};
 
   font.texture = load_texture(graphics_context->renderer, sprite_sheet_path);
-  font.char_width = char_width;
-  font.char_height = char_height;
-  font.row_spacing = row_spacing;
-  font.color_offset = color_offset;
+  init_font(&font, char_width, char_height, row_spacing, color_offset);
 
   if (!font.texture.texture) {
     LOG_ERROR_FMT("Failed to load bitmap font sprite sheet: %s",
                   sprite_sheet_path);
-  } else {
-    LOG_INFO_FMT("Loaded bitmap font: %s", sprite_sheet_path);
+    return font;
   }
 
+  report_loaded_font(&font, sprite_sheet_path);
   return font;
 }
 
-void render_bitmap_text(const bitmap_font_ptr font,
-                        const graphics_context_ptr graphics_context,
-                        const char* text, int x, int y, font_color_t color) {
-  if (!font || !font->texture.texture || !text || !graphics_context) {
-    return;
+// First color row of a sheet in white, with the brightest channel as
+// coverage so the black background becomes transparent
+static SDL_Surface* load_white_row(const char* sprite_sheet_path,
+                                   int row_height) {
+  SDL_Surface* image = IMG_Load(sprite_sheet_path);
+  if (!image) {
+    LOG_ERROR_FMT("Failed to load image %s: %s", sprite_sheet_path,
+                  IMG_GetError());
+    return NULL;
+  }
+  SDL_Surface* sheet =
+      SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_ARGB8888, 0);
+  SDL_FreeSurface(image);
+  if (!sheet) {
+    LOG_SDL_ERROR("SDL_ConvertSurfaceFormat");
+    return NULL;
   }
 
-  int cursor_x = x;
-  int color_y_offset = color * font->color_offset;
+  int height = row_height > 0 && row_height < sheet->h ? row_height : sheet->h;
+  SDL_Surface* row = SDL_CreateRGBSurfaceWithFormat(0, sheet->w, height, 32,
+                                                    SDL_PIXELFORMAT_ARGB8888);
+  if (!row) {
+    LOG_SDL_ERROR("SDL_CreateRGBSurfaceWithFormat");
+    SDL_FreeSurface(sheet);
+    return NULL;
+  }
+  for (int y = 0; y < height; y++) {
+    const Uint32* src =
+        (const Uint32*)((const Uint8*)sheet->pixels + (size_t)y * sheet->pitch);
+    Uint32* dst = (Uint32*)((Uint8*)row->pixels + (size_t)y * row->pitch);
+    for (int x = 0; x < sheet->w; x++) {
+      Uint32 r = (src[x] >> 16) & 0xFF;
+      Uint32 g = (src[x] >> 8) & 0xFF;
+      Uint32 b = src[x] & 0xFF;
+      Uint32 brightest = r > g ? (r > b ? r : b) : (g > b ? g : b);
+      Uint32 coverage = (brightest * (src[x] >> 24) + 127) / 255;
+      dst[x] = (coverage << 24) | 0xFFFFFFu;
+    }
+  }
+  SDL_FreeSurface(sheet);
+  return row;
+}
+
+bitmap_font_t load_tinted_bitmap_font(
+    const graphics_context_ptr graphics_context,
+    const char* sprite_sheet_path, int char_width, int char_height,
+    int row_spacing, int color_offset) {
+  bitmap_font_t font = {0};
+  init_font(&font, char_width, char_height, row_spacing, color_offset);
+  font.tinted = true;
+
+  SDL_Surface* row = load_white_row(sprite_sheet_path, color_offset);
+  if (row) {
+    font.texture.texture =
+        SDL_CreateTextureFromSurface(graphics_context->renderer, row);
+    if (font.texture.texture) {
+      SDL_SetTextureBlendMode(font.texture.texture, SDL_BLENDMODE_BLEND);
+      font.texture.width = row->w;
+      font.texture.height = row->h;
+      if (cpu_rendering_active()) {
+        font.texture.surface = create_cpu_surface(row);
+      }
+    } else {
+      LOG_SDL_ERROR("SDL_CreateTextureFromSurface");
+    }
+    SDL_FreeSurface(row);
+  }
+
+  if (!font.texture.texture) {
+    LOG_ERROR_FMT("Failed to load bitmap font sprite sheet: %s",
+                  sprite_sheet_path);
+    return font;
+  }
+
+  report_loaded_font(&font, sprite_sheet_path);
+  return font;
+}
 
-  for (size_t i = 0; i < strlen(text); i++) {
-    char c = text[i];
+// Draw a string from the glyph table, sampling the sheet at row_y and
+// multiplying it by `tint`. Its glyphs are queued as quads of the sheet,
+// which the primitive batch submits in one SDL_RenderGeometry call. Copies
+// that cannot be batched use the sheet's own color mod unless
+// `explicit_tint` is set.
+static void draw_bitmap_string(const bitmap_font_ptr font,
+                               const graphics_context_ptr graphics_context,
+                               const char* text, int x, int y, int row_y,
+                               SDL_Color tint, bool explicit_tint,
+                               int scale) {
+  texture_ptr sheet = &font->texture;
+  int scaled_char_width = font->char_width * scale;
+  // The render queue and the CPU backend order and blit copies themselves
+  bool batched = !graphics_context->cpu_renderer &&
+                 !render_queue_recording(graphics_context);
 
-    // Handle space character
-    if (c == ' ') {
-      cursor_x += font->char_width;
+  int cursor_x = x;
+  for (const unsigned char* c = (const unsigned char*)text; *c;
+       c++, cursor_x += scaled_char_width) {
+    const rect_t* glyph = &font->glyphs[*c];
+    SDL_Rect src = {glyph->x, glyph->y + row_y, glyph->w, glyph->h};
+    if (glyph->w == 0 || src.y + src.h > sheet->height) {
       continue;
     }
 
-    int char_x, char_y;
-    if (get_char_sprite_rect(c, &char_x, &char_y, font->char_width,
-                             font->char_height, font->row_spacing)) {
-      SDL_Rect src_rect = {char_x, char_y + color_y_offset, font->char_width,
-                           font->char_height};
-
-      SDL_Rect dest_rect = {cursor_x, y, font->char_width, font->char_height};
+    SDL_FRect dst = {(float)cursor_x, (float)y, (float)(glyph->w * scale),
+                     (float)(glyph->h * scale)};
+    if (batched && batch_textured_quad(graphics_context, sheet->texture,
+                                       sheet->width, sheet->height, &src,
+                                       &dst, tint)) {
+      continue;
+    }
 
-      SDL_RenderCopy(graphics_context->renderer, font->texture.texture,
-                     &src_rect, &dest_rect);
+    rect_t src_rect = {src.x, src.y, src.w, src.h};
+    if (explicit_tint) {
+      frect_t dst_rect = {dst.x, dst.y, dst.w, dst.h};
+      render_sprite_tinted(graphics_context, sheet, &src_rect, &dst_rect,
+                           tint);
+    } else if (tint.a == 255) {
+      render_sprite_scaled(graphics_context, sheet, &src_rect, cursor_x, y,
+                           scale);
+    } else {
+      render_sprite_scaled_alpha(graphics_context, sheet, &src_rect, cursor_x,
+                                 y, scale, tint.a);
     }
+  }
+}
+
+// Draw font_color_t text: a color row of the full sheet, or the palette
+// color of a tinted font
+static void draw_palette_string(const bitmap_font_ptr font,
+                                const graphics_context_ptr graphics_context,
+                                const char* text, int x, int y,
+                                font_color_t color, int scale, Uint8 alpha) {
+  if (font->tinted) {
+    SDL_Color tint = font->palette[(unsigned)color < FONT_COLOR_COUNT
+                                       ? color
+                                       : FONT_COLOR_WHITE];
+    tint.a = (Uint8)((tint.a * alpha + 127) / 255);
+    draw_bitmap_string(font, graphics_context, text, x, y, 0, tint, true,
+                       scale);
+    return;
+  }
+
+  SDL_Color tint = {255, 255, 255, alpha};
+  SDL_GetTextureColorMod(font->texture.texture, &tint.r, &tint.g, &tint.b);
+  draw_bitmap_string(font, graphics_context, text, x, y,
+                     color * font->color_offset, tint, false, scale);
+}
 
-    cursor_x += font->char_width;
+void render_bitmap_text(const bitmap_font_ptr font,
+                        const graphics_context_ptr graphics_context,
+                        const char* text, int x, int y, font_color_t color) {
+  if (!font || !font->texture.texture || !text || !graphics_context) {
+    return;
   }
+
+  draw_palette_string(font, graphics_context, text, x, y, color, 1, 255);
 }
 
 void render_bitmap_text_scaled(const bitmap_font_ptr font,
@@ -123,31 +273,7 @@ void render_bitmap_text_scaled(const bitmap_font_ptr font,
     return;
   }
 
-  int cursor_x = x;
-  int color_y_offset = color * font->color_offset;
-  int scaled_char_width = font->char_width * scale;
-
-  for (size_t i = 0; i < strlen(text); i++) {
-    char c = text[i];
-
-    // Handle space character
-    if (c == ' ') {
-      cursor_x += scaled_char_width;
-      continue;
-    }
-
-    int char_x, char_y;
-    if (get_char_sprite_rect(c, &char_x, &char_y, font->char_width,
-                             font->char_height, font->row_spacing)) {
-      rect_t src_rect = make_rect(char_x, char_y + color_y_offset,
-                                  font->char_width, font->char_height);
-
-      render_sprite_scaled(graphics_context, &font->texture, &src_rect,
-                           cursor_x, y, scale);
-    }
-
-    cursor_x += scaled_char_width;
-  }
+  draw_palette_string(font, graphics_context, text, x, y, color, scale, 255);
 }
 
 void render_bitmap_text_scaled_alpha(const bitmap_font_ptr font,
@@ -159,31 +285,23 @@ void render_bitmap_text_scaled_alpha(const bitmap_font_ptr font,
     return;
   }
 
-  int cursor_x = x;
-  int color_y_offset = color * font->color_offset;
-  int scaled_char_width = font->char_width * scale;
-
-  for (size_t i = 0; i < strlen(text); i++) {
-    char c = text[i];
-
-    // Handle space character
-    if (c == ' ') {
-      cursor_x += scaled_char_width;
-      continue;
-    }
-
-    int char_x, char_y;
-    if (get_char_sprite_rect(c, &char_x, &char_y, font->char_width,
-                             font->char_height, font->row_spacing)) {
-      rect_t src_rect = make_rect(char_x, char_y + color_y_offset,
-                                  font->char_width, font->char_height);
-
-      render_sprite_scaled_alpha(graphics_context, &font->texture, &src_rect,
-                                 cursor_x, y, scale, alpha);
-    }
+  // Clamp desired alpha to 0-255 range
+  Uint8 target_alpha = (alpha < 0) ? 0 : ((alpha > 255) ? 255 : (Uint8)alpha);
+  draw_palette_string(font, graphics_context, text, x, y, color, scale,
+                      target_alpha);
+}
 
-    cursor_x += scaled_char_width;
+void render_bitmap_text_colored(const bitmap_font_ptr font,
+                                const graphics_context_ptr graphics_context,
+                                const char* text, int x, int y,
+                                SDL_Color color, int scale) {
+  if (!font || !font->texture.texture || !text || !graphics_context ||
+      scale <= 0) {
+    return;
   }
+
+  draw_bitmap_string(font, graphics_context, text, x, y, 0, color, true,
+                     scale);
 }
 
 int get_bitmap_text_width(const bitmap_font_ptr font, const char* text) {
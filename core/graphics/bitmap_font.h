@@ -4,6 +4,18 @@
  *
  * Provides functions for rendering text using bitmap font sprite sheets.
  * Supports multiple colors by using different rows in the sprite sheet.
+ *
+ * load_bitmap_font() maps every byte to its source rectangle once, so
+ * drawing a string is one table lookup per character. The glyphs of a
+ * string are queued as quads of the sprite sheet and drawn with a single
+ * geometry submission. Characters the sheet does not provide are drawn as
+ * blanks without warnings.
+ *
+ * A tinted font, from load_tinted_bitmap_font(), keeps only the first color
+ * row of the sheet, turned white, and applies every color per vertex: an
+ * eighth of the texture memory, and any RGB color through
+ * render_bitmap_text_colored(). font_color_t colors map to a palette that
+ * matches the arcade sheet.
  */
 
 #ifndef CORE_GRAPHICS_BITMAP_FONT_H_
@@ -27,9 +39,12 @@ typedef enum {
   FONT_COLOR_GOLD = 4,
   FONT_COLOR_PEACH = 5,
   FONT_COLOR_YELLOW = 6,
-  FONT_COLOR_GREEN = 7
+  FONT_COLOR_GREEN = 7,
+  FONT_COLOR_COUNT
 } font_color_t;
 
+#define BITMAP_FONT_GLYPH_COUNT 256
+
 /**
  * Bitmap font structure
  */
@@ -39,6 +54,10 @@ typedef struct {
   int char_height;   // Height of each character in pixels
   int row_spacing;   // Vertical spacing between character rows
   int color_offset;  // Vertical offset between color variations
+  // Source rectangle of each byte in the white row, empty for blanks
+  rect_t glyphs[BITMAP_FONT_GLYPH_COUNT];
+  bool tinted;  // Single white row colored per vertex
+  SDL_Color palette[FONT_COLOR_COUNT];  // font_color_t colors when tinted
 } bitmap_font_t, *bitmap_font_ptr;
 
 /**
@@ -57,6 +76,25 @@ bitmap_font_t load_bitmap_font(const graphics_context_ptr graphics_context,
                                int char_height, int row_spacing,
                                int color_offset);
 
+/**
+ * Load a bitmap font keeping only the first color row of the sprite sheet
+ *
+ * The row is stored in white, with its brightness as coverage, and colored
+ * when drawn.
+ *
+ * @param graphics_context Graphics context for texture creation
+ * @param sprite_sheet_path Path to the sprite sheet image
+ * @param char_width Width of each character in pixels
+ * @param char_height Height of each character in pixels
+ * @param row_spacing Vertical spacing between character rows
+ * @param color_offset Height of the first color row (0 for the whole sheet)
+ * @return Initialized bitmap font structure
+ */
+bitmap_font_t load_tinted_bitmap_font(
+    const graphics_context_ptr graphics_context,
+    const char* sprite_sheet_path, int char_width, int char_height,
+    int row_spacing, int color_offset);
+
 /**
  * Render text at the specified position using the bitmap font
  *
@@ -90,6 +128,9 @@ void render_bitmap_text_scaled(const bitmap_font_ptr font,
 /**
  * Render scaled text with alpha transparency at the specified position
  *
+ * The glyphs are queued as vertex-colored quads, so consecutive faded text
+ * from one font is drawn with a single geometry submission.
+ *
  * @param font Bitmap font to use
  * @param graphics_context Graphics context for rendering
  * @param text Text string to render (supports A-Z, 0-9, !, /, -, space)
@@ -104,6 +145,25 @@ void render_bitmap_text_scaled_alpha(const bitmap_font_ptr font,
                                      const char* text, int x, int y,
                                      font_color_t color, int scale, int alpha);
 
+/**
+ * Render scaled text in any color
+ *
+ * Draws the first color row multiplied by the color, so tinted fonts give
+ * the exact color.
+ *
+ * @param font Bitmap font to use
+ * @param graphics_context Graphics context for rendering
+ * @param text Text string to render (supports A-Z, 0-9, !, /, -, space)
+ * @param x X position to render at
+ * @param y Y position to render at
+ * @param color Text color and alpha
+ * @param scale Scale factor (1 = normal size, 2 = double size, etc.)
+ */
+void render_bitmap_text_colored(const bitmap_font_ptr font,
+                                const graphics_context_ptr graphics_context,
+                                const char* text, int x, int y,
+                                SDL_Color color, int scale);
+
 /**
  * Get the width in pixels of the rendered text
  *
@@ -0,0 +1,1502 @@
+/**
+ * @file cpu_renderer.c
+ * @brief Implementation of the vectorized CPU rasterizer
+ */
+
+#include "cpu_renderer.h"
+
+#include <SDL.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "dynamic_array.h"
+#include "logger.h"
+#include "worker_pool.h"
+
+#define ALPHA_MASK 0xFF000000u
+#define DEGREES_TO_RADIANS 0.017453292519943295
+
+static int active_cpu_renderers = 0;
+
+// Marker stored in SDL_Surface.userdata for surfaces needing blending
+static char translucent_surface_marker;
+
+// Exact x / 255 with rounding, for x <= 255 * 255
+static inline uint32_t div255(uint32_t x) {
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+static inline uint32_t blend_pixel(uint32_t dst, uint32_t src,
+                                   uint32_t alpha) {
+  uint32_t inverse = 255 - alpha;
+  uint32_t r = div255(((src >> 16) & 0xFF) * alpha + ((dst >> 16) & 0xFF) *
+                                                         inverse);
+  uint32_t g =
+      div255(((src >> 8) & 0xFF) * alpha + ((dst >> 8) & 0xFF) * inverse);
+  uint32_t b = div255((src & 0xFF) * alpha + (dst & 0xFF) * inverse);
+  return ALPHA_MASK | (r << 16) | (g << 8) | b;
+}
+
+// Multiply the color channels by a 0xRRGGBB tint, keeping the alpha
+static inline uint32_t modulate_pixel(uint32_t pixel, uint32_t rgb) {
+  return (pixel & ALPHA_MASK) |
+         (div255(((pixel >> 16) & 0xFF) * ((rgb >> 16) & 0xFF)) << 16) |
+         (div255(((pixel >> 8) & 0xFF) * ((rgb >> 8) & 0xFF)) << 8) |
+         div255((pixel & 0xFF) * (rgb & 0xFF));
+}
+
+#if defined(__SSE2__)
+static inline __m128i div255_epu16(__m128i x) {
+  x = _mm_add_epi16(x, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+#endif
+
+#if defined(__AVX2__)
+static inline __m256i div255_epu16_256(__m256i x) {
+  x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+#endif
+
+static void fill_span(uint32_t* dst, int count, uint32_t argb) {
+  int i = 0;
+#if defined(__AVX2__)
+  __m256i color8 = _mm256_set1_epi32((int)argb);
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_si256((__m256i*)(dst + i), color8);
+  }
+#endif
+#if defined(__SSE2__)
+  __m128i color4 = _mm_set1_epi32((int)argb);
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_si128((__m128i*)(dst + i), color4);
+  }
+#endif
+  for (; i < count; i++) {
+    dst[i] = argb;
+  }
+}
+
+// Blend one color over a span: dst = (src * a + dst * (255 - a)) / 255
+static void blend_span(uint32_t* dst, int count, uint32_t argb,
+                       uint32_t alpha) {
+  int i = 0;
+#if defined(__AVX2__)
+  {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i src16 = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)argb), zero);
+    __m256i src_term = _mm256_mullo_epi16(src16, _mm256_set1_epi16((short)alpha));
+    __m256i inverse = _mm256_set1_epi16((short)(255 - alpha));
+    __m256i opaque = _mm256_set1_epi32((int)ALPHA_MASK);
+    for (; i + 8 <= count; i += 8) {
+      __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+      __m256i lo = _mm256_unpacklo_epi8(d, zero);
+      __m256i hi = _mm256_unpackhi_epi8(d, zero);
+      lo = div255_epu16_256(
+          _mm256_add_epi16(_mm256_mullo_epi16(lo, inverse), src_term));
+      hi = div255_epu16_256(
+          _mm256_add_epi16(_mm256_mullo_epi16(hi, inverse), src_term));
+      _mm256_storeu_si256((__m256i*)(dst + i),
+                          _mm256_or_si256(_mm256_packus_epi16(lo, hi), opaque));
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    __m128i zero = _mm_setzero_si128();
+    __m128i src16 = _mm_unpacklo_epi8(_mm_set1_epi32((int)argb), zero);
+    __m128i src_term = _mm_mullo_epi16(src16, _mm_set1_epi16((short)alpha));
+    __m128i inverse = _mm_set1_epi16((short)(255 - alpha));
+    __m128i opaque = _mm_set1_epi32((int)ALPHA_MASK);
+    for (; i + 4 <= count; i += 4) {
+      __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+      __m128i lo = _mm_unpacklo_epi8(d, zero);
+      __m128i hi = _mm_unpackhi_epi8(d, zero);
+      lo = div255_epu16(_mm_add_epi16(_mm_mullo_epi16(lo, inverse), src_term));
+      hi = div255_epu16(_mm_add_epi16(_mm_mullo_epi16(hi, inverse), src_term));
+      _mm_storeu_si128((__m128i*)(dst + i),
+                       _mm_or_si128(_mm_packus_epi16(lo, hi), opaque));
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    dst[i] = blend_pixel(dst[i], argb, alpha);
+  }
+}
+
+// Add light to a span with per-channel saturation. `light` is the particle
+// color premultiplied by its alpha, with a zero alpha byte so the
+// framebuffer stays opaque.
+static void add_span(uint32_t* dst, int count, uint32_t light) {
+  int i = 0;
+#if defined(__AVX2__)
+  __m256i light8 = _mm256_set1_epi32((int)light);
+  for (; i + 8 <= count; i += 8) {
+    __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+    _mm256_storeu_si256((__m256i*)(dst + i), _mm256_adds_epu8(d, light8));
+  }
+#endif
+#if defined(__SSE2__)
+  __m128i light4 = _mm_set1_epi32((int)light);
+  for (; i + 4 <= count; i += 4) {
+    __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_adds_epu8(d, light4));
+  }
+#endif
+  uint32_t lr = (light >> 16) & 0xFF, lg = (light >> 8) & 0xFF,
+           lb = light & 0xFF;
+  for (; i < count; i++) {
+    uint32_t r = ((dst[i] >> 16) & 0xFF) + lr;
+    uint32_t g = ((dst[i] >> 8) & 0xFF) + lg;
+    uint32_t b = (dst[i] & 0xFF) + lb;
+    dst[i] = (dst[i] & ALPHA_MASK) | ((r > 255 ? 255 : r) << 16) |
+             ((g > 255 ? 255 : g) << 8) | (b > 255 ? 255 : b);
+  }
+}
+
+// Colorkeyed copy: source pixels with alpha 0 leave the destination as is
+static void copy_keyed_span(uint32_t* dst, const uint32_t* src, int count) {
+  int i = 0;
+#if defined(__AVX2__)
+  {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i alpha_mask = _mm256_set1_epi32((int)ALPHA_MASK);
+    for (; i + 8 <= count; i += 8) {
+      __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+      __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+      __m256i keyed =
+          _mm256_cmpeq_epi32(_mm256_and_si256(s, alpha_mask), zero);
+      _mm256_storeu_si256((__m256i*)(dst + i),
+                          _mm256_blendv_epi8(s, d, keyed));
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    __m128i zero = _mm_setzero_si128();
+    __m128i alpha_mask = _mm_set1_epi32((int)ALPHA_MASK);
+    for (; i + 4 <= count; i += 4) {
+      __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+      __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+      __m128i keyed = _mm_cmpeq_epi32(_mm_and_si128(s, alpha_mask), zero);
+      _mm_storeu_si128(
+          (__m128i*)(dst + i),
+          _mm_or_si128(_mm_andnot_si128(keyed, s), _mm_and_si128(keyed, d)));
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    if (src[i] & ALPHA_MASK) {
+      dst[i] = src[i];
+    }
+  }
+}
+
+// Per-pixel alpha blend of a span, scaled by a global alpha
+static void blend_pixels_span(uint32_t* dst, const uint32_t* src, int count,
+                              uint32_t global_alpha) {
+  int i = 0;
+#if defined(__AVX2__)
+  {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i full = _mm256_set1_epi16(255);
+    __m256i global = _mm256_set1_epi16((short)global_alpha);
+    __m256i opaque = _mm256_set1_epi32((int)ALPHA_MASK);
+    for (; i + 8 <= count; i += 8) {
+      __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+      __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+      __m256i halves[2];
+      for (int h = 0; h < 2; h++) {
+        __m256i s16 = h ? _mm256_unpackhi_epi8(s, zero)
+                        : _mm256_unpacklo_epi8(s, zero);
+        __m256i d16 = h ? _mm256_unpackhi_epi8(d, zero)
+                        : _mm256_unpacklo_epi8(d, zero);
+        __m256i a16 = _mm256_shufflehi_epi16(
+            _mm256_shufflelo_epi16(s16, 0xFF), 0xFF);
+        a16 = div255_epu16_256(_mm256_mullo_epi16(a16, global));
+        halves[h] = div255_epu16_256(_mm256_add_epi16(
+            _mm256_mullo_epi16(s16, a16),
+            _mm256_mullo_epi16(d16, _mm256_sub_epi16(full, a16))));
+      }
+      _mm256_storeu_si256(
+          (__m256i*)(dst + i),
+          _mm256_or_si256(_mm256_packus_epi16(halves[0], halves[1]), opaque));
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    __m128i zero = _mm_setzero_si128();
+    __m128i full = _mm_set1_epi16(255);
+    __m128i global = _mm_set1_epi16((short)global_alpha);
+    __m128i opaque = _mm_set1_epi32((int)ALPHA_MASK);
+    for (; i + 4 <= count; i += 4) {
+      __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+      __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+      __m128i halves[2];
+      for (int h = 0; h < 2; h++) {
+        __m128i s16 = h ? _mm_unpackhi_epi8(s, zero) : _mm_unpacklo_epi8(s, zero);
+        __m128i d16 = h ? _mm_unpackhi_epi8(d, zero) : _mm_unpacklo_epi8(d, zero);
+        // Broadcast each pixel's alpha (lane 3) to its four channels
+        __m128i a16 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s16, 0xFF), 0xFF);
+        a16 = div255_epu16(_mm_mullo_epi16(a16, global));
+        halves[h] = div255_epu16(
+            _mm_add_epi16(_mm_mullo_epi16(s16, a16),
+                          _mm_mullo_epi16(d16, _mm_sub_epi16(full, a16))));
+      }
+      _mm_storeu_si128((__m128i*)(dst + i),
+                       _mm_or_si128(_mm_packus_epi16(halves[0], halves[1]),
+                                    opaque));
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    uint32_t alpha = div255((src[i] >> 24) * global_alpha);
+    dst[i] = blend_pixel(dst[i], src[i], alpha);
+  }
+}
+
+
+// Intersect a rectangle with a clip rectangle as half-open bounds
+static bool clip_to(const SDL_Rect* clip, const SDL_Rect* rect, int* x0,
+                    int* y0, int* x1, int* y1) {
+  *x0 = rect->x > clip->x ? rect->x : clip->x;
+  *y0 = rect->y > clip->y ? rect->y : clip->y;
+  *x1 = rect->x + rect->w < clip->x + clip->w ? rect->x + rect->w
+                                              : clip->x + clip->w;
+  *y1 = rect->y + rect->h < clip->y + clip->h ? rect->y + rect->h
+                                              : clip->y + clip->h;
+  return *x0 < *x1 && *y0 < *y1;
+}
+
+static inline bool in_clip(const SDL_Rect* clip, int x, int y) {
+  return x >= clip->x && x < clip->x + clip->w && y >= clip->y &&
+         y < clip->y + clip->h;
+}
+
+static inline uint32_t* pixel_at(const cpu_renderer_ptr cpu, int x, int y) {
+  return cpu->pixels + (size_t)y * cpu->pitch + x;
+}
+
+static void raster_rect(cpu_renderer_ptr cpu, const SDL_Rect* clip,
+                        const SDL_Rect* rect, uint32_t argb, bool blend) {
+  int x0, y0, x1, y1;
+  if (!clip_to(clip, rect, &x0, &y0, &x1, &y1)) {
+    return;
+  }
+  uint32_t alpha = argb >> 24;
+  for (int y = y0; y < y1; y++) {
+    if (blend) {
+      blend_span(pixel_at(cpu, x0, y), x1 - x0, argb, alpha);
+    } else {
+      fill_span(pixel_at(cpu, x0, y), x1 - x0, argb);
+    }
+  }
+}
+
+// Line pixels are computed in closed form from the step index rather than
+// by Bresenham's running error, so a tile only visits the steps whose major
+// coordinate lies inside it. Both endpoints are included.
+static void raster_line(cpu_renderer_ptr cpu, const SDL_Rect* clip, int x0,
+                        int y0, int x1, int y1, uint32_t argb) {
+  if (y0 == y1) {
+    SDL_Rect span = {x0 < x1 ? x0 : x1, y0, abs(x1 - x0) + 1, 1};
+    raster_rect(cpu, clip, &span, argb, false);
+    return;
+  }
+
+  int dx = abs(x1 - x0);
+  int dy = abs(y1 - y0);
+  int step_x = x0 < x1 ? 1 : -1;
+  int step_y = y0 < y1 ? 1 : -1;
+  bool x_major = dx >= dy;
+  int length = x_major ? dx : dy;
+  int minor = x_major ? dy : dx;
+  int start = x_major ? x0 : y0;
+  int step = x_major ? step_x : step_y;
+  int low = x_major ? clip->x : clip->y;
+  int high = (x_major ? clip->x + clip->w : clip->y + clip->h) - 1;
+
+  int first = step > 0 ? low - start : start - high;
+  int last = step > 0 ? high - start : start - low;
+  first = first < 0 ? 0 : first;
+  last = last > length ? length : last;
+
+  for (int k = first; k <= last; k++) {
+    int offset =
+        (int)(((int64_t)2 * k * minor + length) / ((int64_t)2 * length));
+    int x = x_major ? x0 + step_x * k : x0 + step_x * offset;
+    int y = x_major ? y0 + step_y * offset : y0 + step_y * k;
+    if (in_clip(clip, x, y)) {
+      *pixel_at(cpu, x, y) = argb;
+    }
+  }
+}
+
+static inline float edge_function(SDL_FPoint a, SDL_FPoint b, float x,
+                                   float y) {
+  return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+}
+
+// Per-pixel color of a triangle whose vertex colors differ: each channel is
+// interpolated with the barycentric weights of the pixel center. Weights are
+// computed per pixel, so a span split across tiles shades identically.
+static void shade_span(uint32_t* row, int x0, int x1, float py,
+                       const SDL_FPoint* triangle, const uint32_t* argb) {
+  float area = edge_function(triangle[0], triangle[1], triangle[2].x,
+                             triangle[2].y);
+  if (area == 0.0f) {
+    return;
+  }
+
+  for (int x = x0; x < x1; x++) {
+    float px = (float)x + 0.5f;
+    float channels[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 3; i++) {
+      float weight = edge_function(triangle[(i + 1) % 3],
+                                   triangle[(i + 2) % 3], px, py) /
+                     area;
+      for (int c = 0; c < 4; c++) {
+        channels[c] += weight * (float)((argb[i] >> (c * 8)) & 0xFF);
+      }
+    }
+
+    uint32_t color = 0;
+    for (int c = 0; c < 4; c++) {
+      float value = channels[c] + 0.5f;
+      uint32_t channel = value <= 0.0f    ? 0
+                         : value >= 255.0f ? 255
+                                           : (uint32_t)value;
+      color |= channel << (c * 8);
+    }
+
+    uint32_t alpha = color >> 24;
+    if (alpha == 255) {
+      row[x] = color;
+    } else if (alpha > 0) {
+      row[x] = blend_pixel(row[x], color, alpha);
+    }
+  }
+}
+
+static void raster_triangle(cpu_renderer_ptr cpu, const SDL_Rect* clip,
+                            const SDL_FPoint* triangle,
+                            const uint32_t* vertex_argb) {
+  SDL_FPoint a = triangle[0];
+  SDL_FPoint b = triangle[1];
+  SDL_FPoint c = triangle[2];
+  SDL_FPoint swap;
+  if (b.y < a.y) {
+    swap = a;
+    a = b;
+    b = swap;
+  }
+  if (c.y < a.y) {
+    swap = a;
+    a = c;
+    c = swap;
+  }
+  if (c.y < b.y) {
+    swap = b;
+    b = c;
+    c = swap;
+  }
+  if (c.y <= a.y) {
+    return;
+  }
+
+  bool flat = vertex_argb[0] == vertex_argb[1] &&
+              vertex_argb[0] == vertex_argb[2];
+  uint32_t argb = vertex_argb[0];
+  uint32_t alpha = argb >> 24;
+  int y_start = (int)ceilf(a.y - 0.5f);
+  int y_end = (int)ceilf(c.y - 0.5f);
+  y_start = y_start < clip->y ? clip->y : y_start;
+  y_end = y_end > clip->y + clip->h ? clip->y + clip->h : y_end;
+
+  // Sample pixel centers; spans are half-open so shared edges meet exactly
+  for (int y = y_start; y < y_end; y++) {
+    float py = (float)y + 0.5f;
+    float x_long = a.x + (c.x - a.x) * (py - a.y) / (c.y - a.y);
+    float x_short = py < b.y
+                        ? a.x + (b.x - a.x) * (py - a.y) / (b.y - a.y)
+                        : b.x + (c.x - b.x) * (py - b.y) / (c.y - b.y);
+    float left = x_long < x_short ? x_long : x_short;
+    float right = x_long < x_short ? x_short : x_long;
+    int x0 = (int)ceilf(left - 0.5f);
+    int x1 = (int)ceilf(right - 0.5f);
+    x0 = x0 < clip->x ? clip->x : x0;
+    x1 = x1 > clip->x + clip->w ? clip->x + clip->w : x1;
+    if (x0 >= x1) {
+      continue;
+    }
+
+    if (!flat) {
+      shade_span(pixel_at(cpu, 0, y), x0, x1, py, triangle, vertex_argb);
+    } else if (alpha == 255) {
+      fill_span(pixel_at(cpu, x0, y), x1 - x0, argb);
+    } else {
+      blend_span(pixel_at(cpu, x0, y), x1 - x0, argb, alpha);
+    }
+  }
+}
+
+static inline const uint32_t* surface_row(const SDL_Surface* surface, int y) {
+  return (const uint32_t*)((const uint8_t*)surface->pixels +
+                           (size_t)y * surface->pitch);
+}
+
+static void raster_blit_rotated(cpu_renderer_ptr cpu, const SDL_Rect* clip,
+                                const cpu_command_t* command) {
+  const SDL_Rect* src = &command->rect;
+  const SDL_FRect* dst = &command->dst;
+  float half_w = dst->w * 0.5f;
+  float half_h = dst->h * 0.5f;
+  float cx = dst->x + half_w;
+  float cy = dst->y + half_h;
+  float cos_a = (float)cos(command->angle * DEGREES_TO_RADIANS);
+  float sin_a = (float)sin(command->angle * DEGREES_TO_RADIANS);
+  bool tinted = (command->argb & ~ALPHA_MASK) != ~ALPHA_MASK;
+
+  int x0, y0, x1, y1;
+  if (!clip_to(clip, &command->bounds, &x0, &y0, &x1, &y1)) {
+    return;
+  }
+
+  for (int y = y0; y < y1; y++) {
+    uint32_t* row = pixel_at(cpu, 0, y);
+    float ry = (float)y + 0.5f - cy;
+    for (int x = x0; x < x1; x++) {
+      float rx = (float)x + 0.5f - cx;
+      // Undo the clockwise rotation to find the sprite-local position
+      float lx = rx * cos_a + ry * sin_a + half_w;
+      float ly = -rx * sin_a + ry * cos_a + half_h;
+      if (lx < 0.0f || ly < 0.0f || lx >= dst->w || ly >= dst->h) {
+        continue;
+      }
+      // Rounding can land exactly on the far edge of the source
+      int u = (int)(lx * src->w / dst->w);
+      int v = (int)(ly * src->h / dst->h);
+      u = u < src->w ? u : src->w - 1;
+      v = v < src->h ? v : src->h - 1;
+      if (command->flip & SDL_FLIP_HORIZONTAL) {
+        u = src->w - 1 - u;
+      }
+      if (command->flip & SDL_FLIP_VERTICAL) {
+        v = src->h - 1 - v;
+      }
+      uint32_t pixel = surface_row(command->surface, src->y + v)[src->x + u];
+      if (tinted) {
+        pixel = modulate_pixel(pixel, command->argb);
+      }
+      uint32_t alpha = div255((pixel >> 24) * command->alpha);
+      if (alpha == 255) {
+        row[x] = pixel;
+      } else if (alpha > 0) {
+        row[x] = blend_pixel(row[x], pixel, alpha);
+      }
+    }
+  }
+}
+
+static void raster_blit(cpu_renderer_ptr cpu, const SDL_Rect* clip,
+                        cpu_scratch_t* scratch, const cpu_command_t* command) {
+  if (command->angle != 0.0f) {
+    raster_blit_rotated(cpu, clip, command);
+    return;
+  }
+
+  // The source mapping uses the whole destination, not the clipped bounds
+  const SDL_Rect* src = &command->rect;
+  const SDL_FRect* exact = &command->dst;
+  SDL_Rect rounded = {(int)lroundf(exact->x), (int)lroundf(exact->y),
+                      (int)lroundf(exact->w), (int)lroundf(exact->h)};
+  const SDL_Rect* dst = &rounded;
+  int x0, y0, x1, y1;
+  if (!clip_to(clip, dst, &x0, &y0, &x1, &y1)) {
+    return;
+  }
+
+  int count = x1 - x0;
+  bool flip_x = (command->flip & SDL_FLIP_HORIZONTAL) != 0;
+  bool flip_y = (command->flip & SDL_FLIP_VERTICAL) != 0;
+  bool direct = dst->w == src->w && !flip_x;
+  bool tinted = (command->argb & ~ALPHA_MASK) != ~ALPHA_MASK;
+  bool translucent =
+      command->surface->userdata != NULL || command->alpha < 255;
+
+  if (!direct || tinted) {
+    uint32_t* row = grow_array(scratch->row, &scratch->row_capacity, count,
+                               sizeof(uint32_t));
+    if (!row) {
+      return;
+    }
+    scratch->row = row;
+  }
+  if (!direct) {
+    int* columns = grow_array(scratch->columns, &scratch->column_capacity,
+                              count, sizeof(int));
+    if (!columns) {
+      return;
+    }
+    scratch->columns = columns;
+
+    // Nearest source column for each destination pixel center
+    for (int x = x0; x < x1; x++) {
+      int u = (int)(((int64_t)(2 * (x - dst->x) + 1) * src->w) / (2 * dst->w));
+      scratch->columns[x - x0] = src->x + (flip_x ? src->w - 1 - u : u);
+    }
+  }
+
+  for (int y = y0; y < y1; y++) {
+    int v = (int)(((int64_t)(2 * (y - dst->y) + 1) * src->h) / (2 * dst->h));
+    const uint32_t* src_row =
+        surface_row(command->surface, src->y + (flip_y ? src->h - 1 - v : v));
+
+    const uint32_t* span;
+    if (direct) {
+      span = src_row + src->x + (x0 - dst->x);
+    } else {
+      for (int i = 0; i < count; i++) {
+        scratch->row[i] = src_row[scratch->columns[i]];
+      }
+      span = scratch->row;
+    }
+    if (tinted) {
+      for (int i = 0; i < count; i++) {
+        scratch->row[i] = modulate_pixel(span[i], command->argb);
+      }
+      span = scratch->row;
+    }
+
+    if (translucent) {
+      blend_pixels_span(pixel_at(cpu, x0, y), span, count, command->alpha);
+    } else {
+      copy_keyed_span(pixel_at(cpu, x0, y), span, count);
+    }
+  }
+}
+
+static void raster_particles(cpu_renderer_ptr cpu, const SDL_Rect* clip,
+                            const cpu_particle_t* particles, int count,
+                            int size) {
+  for (int i = 0; i < count; i++) {
+    SDL_Rect rect = {particles[i].x, particles[i].y, size, size};
+    int x0, y0, x1, y1;
+    if (!clip_to(clip, &rect, &x0, &y0, &x1, &y1)) {
+      continue;
+    }
+    uint32_t argb = particles[i].argb;
+    uint32_t alpha = argb >> 24;
+    uint32_t light = (div255(((argb >> 16) & 0xFF) * alpha) << 16) |
+                     (div255(((argb >> 8) & 0xFF) * alpha) << 8) |
+                     div255((argb & 0xFF) * alpha);
+    if (light == 0) {
+      continue;
+    }
+    for (int y = y0; y < y1; y++) {
+      add_span(pixel_at(cpu, x0, y), x1 - x0, light);
+    }
+  }
+}
+
+static void raster_command(cpu_renderer_ptr cpu, const SDL_Rect* clip,
+                           cpu_scratch_t* scratch,
+                           const cpu_command_t* command) {
+  const SDL_Point* points = cpu->points + command->first;
+  switch (command->kind) {
+    case CPU_COMMAND_CLEAR:
+    case CPU_COMMAND_FILL_RECT:
+      raster_rect(cpu, clip, &command->rect, command->argb, false);
+      break;
+    case CPU_COMMAND_BLEND_RECT:
+      raster_rect(cpu, clip, &command->rect, command->argb, true);
+      break;
+    case CPU_COMMAND_LINES:
+      for (int i = 0; i + 1 < command->count; i++) {
+        raster_line(cpu, clip, points[i].x, points[i].y, points[i + 1].x,
+                    points[i + 1].y, command->argb);
+      }
+      break;
+    case CPU_COMMAND_POINTS:
+      for (int i = 0; i < command->count; i++) {
+        if (in_clip(clip, points[i].x, points[i].y)) {
+          *pixel_at(cpu, points[i].x, points[i].y) = command->argb;
+        }
+      }
+      break;
+    case CPU_COMMAND_TRIANGLE:
+      raster_triangle(cpu, clip, command->triangle, command->triangle_argb);
+      break;
+    case CPU_COMMAND_BLIT:
+      raster_blit(cpu, clip, scratch, command);
+      break;
+    case CPU_COMMAND_PARTICLES:
+      raster_particles(cpu, clip, cpu->particles + command->first,
+                       command->count, command->rect.w);
+      break;
+  }
+}
+
+static void rasterize_tile(void* data, int index, int worker) {
+  cpu_renderer_ptr cpu = data;
+  cpu_tile_t* tile = &cpu->tiles[index];
+  int column = index % cpu->tile_columns;
+  int row = index / cpu->tile_columns;
+  SDL_Rect framebuffer = {0, 0, cpu->width, cpu->height};
+  SDL_Rect tile_rect = {column * CPU_RENDERER_TILE_SIZE,
+                        row * CPU_RENDERER_TILE_SIZE, CPU_RENDERER_TILE_SIZE,
+                        CPU_RENDERER_TILE_SIZE};
+  SDL_Rect clip;
+  int x0, y0, x1, y1;
+  clip_to(&framebuffer, &tile_rect, &x0, &y0, &x1, &y1);
+  clip = (SDL_Rect){x0, y0, x1 - x0, y1 - y0};
+
+  for (int i = 0; i < tile->count; i++) {
+    raster_command(cpu, &clip, &cpu->scratch[worker],
+                   &cpu->commands[tile->commands[i]]);
+  }
+  tile->count = 0;
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size) {
+  const uint8_t* bytes = data;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+// Same hash folding eight bytes per step, for runs large enough that the
+// byte loop would show up in the frame time
+static uint64_t hash_words(uint64_t hash, const void* data, size_t size) {
+  const uint8_t* bytes = data;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    memcpy(&word, bytes + i, sizeof(word));
+    hash = (hash ^ word) * 1099511628211ull;
+  }
+  return hash_bytes(hash, bytes + i, size - i);
+}
+
+// Identifies what a command draws, independent of its position in the
+// command and point buffers. Commands are zeroed when recorded, so the
+// struct padding hashes consistently.
+static uint64_t hash_command(const cpu_renderer_ptr cpu,
+                             const cpu_command_t* command) {
+  cpu_command_t key;
+  memcpy(&key, command, sizeof(key));
+  key.first = 0;
+  uint64_t hash = hash_bytes(1469598103934665603ull, &key, sizeof(key));
+  if (command->kind == CPU_COMMAND_LINES ||
+      command->kind == CPU_COMMAND_POINTS) {
+    hash = hash_bytes(hash, cpu->points + command->first,
+                      sizeof(SDL_Point) * (size_t)command->count);
+  } else if (command->kind == CPU_COMMAND_PARTICLES) {
+    hash = hash_words(hash, cpu->particles + command->first,
+                      sizeof(cpu_particle_t) * (size_t)command->count);
+  }
+  return hash;
+}
+
+// Add every command to the tiles its bounds overlap and, with dirty tracking,
+// fold it into their signatures. A clear covers whole tiles, so it drops
+// whatever was binned into them before and restarts their signatures.
+static void bin_commands(cpu_renderer_ptr cpu) {
+  bool hashed = cpu->dirty_tracking;
+  for (int i = 0; i < cpu->command_count; i++) {
+    const cpu_command_t* command = &cpu->commands[i];
+    const SDL_Rect* bounds = &command->bounds;
+    uint64_t hash = hashed ? hash_command(cpu, command) : 0;
+    int column0 = bounds->x / CPU_RENDERER_TILE_SIZE;
+    int row0 = bounds->y / CPU_RENDERER_TILE_SIZE;
+    int column1 = (bounds->x + bounds->w - 1) / CPU_RENDERER_TILE_SIZE;
+    int row1 = (bounds->y + bounds->h - 1) / CPU_RENDERER_TILE_SIZE;
+
+    for (int row = row0; row <= row1; row++) {
+      for (int column = column0; column <= column1; column++) {
+        cpu_tile_t* tile = &cpu->tiles[row * cpu->tile_columns + column];
+        if (command->kind == CPU_COMMAND_CLEAR) {
+          tile->count = 0;
+          tile->signature = 0;
+        }
+        if (hashed) {
+          tile->signature = (tile->signature ^ hash) * 1099511628211ull + 1;
+        }
+        int* commands = grow_array(tile->commands, &tile->capacity,
+                                   tile->count + 1, sizeof(int));
+        if (!commands) {
+          continue;
+        }
+        tile->commands = commands;
+        tile->commands[tile->count++] = i;
+      }
+    }
+  }
+}
+
+static bool ensure_workers(cpu_renderer_ptr cpu) {
+  if (cpu->scratch) {
+    return true;
+  }
+
+  int thread_count =
+      cpu->thread_count >= 1 ? cpu->thread_count : SDL_GetCPUCount();
+  cpu->scratch = calloc((size_t)thread_count, sizeof(cpu_scratch_t));
+  if (!cpu->scratch) {
+    LOG_ERROR("Failed to allocate CPU renderer scratch buffers");
+    return false;
+  }
+  cpu->scratch_count = thread_count;
+  // Without a pool the tiles are simply rasterized on the calling thread
+  cpu->pool = thread_count > 1 ? create_worker_pool(thread_count) : NULL;
+  return true;
+}
+
+static void release_workers(cpu_renderer_ptr cpu) {
+  destroy_worker_pool(cpu->pool);
+  cpu->pool = NULL;
+  for (int i = 0; i < cpu->scratch_count; i++) {
+    free(cpu->scratch[i].row);
+    free(cpu->scratch[i].columns);
+  }
+  free(cpu->scratch);
+  cpu->scratch = NULL;
+  cpu->scratch_count = 0;
+}
+
+static void free_tiles(cpu_renderer_ptr cpu) {
+  for (int i = 0; cpu->tiles && i < cpu->tile_columns * cpu->tile_rows; i++) {
+    free(cpu->tiles[i].commands);
+  }
+  free(cpu->tiles);
+  cpu->tiles = NULL;
+  cpu->tile_columns = 0;
+  cpu->tile_rows = 0;
+}
+
+static bool allocate_framebuffer(cpu_renderer_ptr cpu, int width,
+                                 int height) {
+  int pitch = (width + CPU_RENDERER_ROW_ALIGNMENT - 1) &
+              ~(CPU_RENDERER_ROW_ALIGNMENT - 1);
+  size_t bytes = sizeof(uint32_t) * (size_t)pitch * (size_t)height;
+  int tile_columns = (width + CPU_RENDERER_TILE_SIZE - 1) /
+                     CPU_RENDERER_TILE_SIZE;
+  int tile_rows = (height + CPU_RENDERER_TILE_SIZE - 1) /
+                  CPU_RENDERER_TILE_SIZE;
+  void* allocation = malloc(bytes + 31);
+  cpu_tile_t* tiles =
+      calloc((size_t)tile_columns * (size_t)tile_rows, sizeof(cpu_tile_t));
+  if (!allocation || !tiles) {
+    LOG_ERROR("Failed to allocate CPU framebuffer");
+    free(allocation);
+    free(tiles);
+    return false;
+  }
+
+  SDL_Texture* texture =
+      SDL_CreateTexture(cpu->renderer, SDL_PIXELFORMAT_ARGB8888,
+                        SDL_TEXTUREACCESS_STREAMING, width, height);
+  if (!texture) {
+    LOG_ERROR_FMT("Failed to create CPU framebuffer texture: %s",
+                  SDL_GetError());
+    free(allocation);
+    free(tiles);
+    return false;
+  }
+
+  if (cpu->texture) {
+    SDL_DestroyTexture(cpu->texture);
+  }
+  free(cpu->allocation);
+  free_tiles(cpu);
+  cpu->texture = texture;
+  cpu->allocation = allocation;
+  cpu->pixels = (uint32_t*)(((uintptr_t)allocation + 31) & ~(uintptr_t)31);
+  cpu->width = width;
+  cpu->height = height;
+  cpu->pitch = pitch;
+  cpu->tiles = tiles;
+  cpu->tile_columns = tile_columns;
+  cpu->tile_rows = tile_rows;
+  cpu->history_valid = false;
+  fill_span(cpu->pixels, pitch * height, ALPHA_MASK);
+  return true;
+}
+
+cpu_renderer_ptr create_cpu_renderer(SDL_Renderer* renderer, int width,
+                                     int height) {
+  if (!renderer || width <= 0 || height <= 0) {
+    return NULL;
+  }
+
+  cpu_renderer_ptr cpu = calloc(1, sizeof(cpu_renderer_t));
+  if (!cpu) {
+    LOG_ERROR("Failed to allocate CPU renderer");
+    return NULL;
+  }
+  cpu->renderer = renderer;
+
+  if (!allocate_framebuffer(cpu, width, height)) {
+    free(cpu);
+    return NULL;
+  }
+
+  active_cpu_renderers++;
+#if defined(__AVX2__)
+  LOG_INFO_FMT("CPU renderer: %dx%d framebuffer, AVX2 kernels", width, height);
+#elif defined(__SSE2__)
+  LOG_INFO_FMT("CPU renderer: %dx%d framebuffer, SSE2 kernels", width, height);
+#else
+  LOG_INFO_FMT("CPU renderer: %dx%d framebuffer, scalar kernels", width,
+               height);
+#endif
+  return cpu;
+}
+
+void destroy_cpu_renderer(cpu_renderer_ptr cpu) {
+  if (!cpu) {
+    return;
+  }
+
+  release_workers(cpu);
+  free_tiles(cpu);
+  if (cpu->texture) {
+    SDL_DestroyTexture(cpu->texture);
+  }
+  free(cpu->allocation);
+  free(cpu->commands);
+  free(cpu->points);
+  free(cpu->particles);
+  free(cpu->tile_offsets);
+  free(cpu->dirty_rects);
+  free(cpu);
+  active_cpu_renderers--;
+}
+
+bool resize_cpu_renderer(cpu_renderer_ptr cpu, int width, int height) {
+  if (!cpu || width <= 0 || height <= 0) {
+    return false;
+  }
+  if (width == cpu->width && height == cpu->height) {
+    return true;
+  }
+  flush_cpu_renderer(cpu);
+  return allocate_framebuffer(cpu, width, height);
+}
+
+void set_cpu_renderer_threads(cpu_renderer_ptr cpu, int thread_count) {
+  if (!cpu) {
+    return;
+  }
+  flush_cpu_renderer(cpu);
+  release_workers(cpu);
+  cpu->thread_count = thread_count;
+}
+
+// Rasterize the recorded commands. With skip_clean, tiles whose signature
+// matches the previous frame keep their pixels and are dropped.
+static void rasterize_commands(cpu_renderer_ptr cpu, bool skip_clean) {
+  if (!ensure_workers(cpu)) {
+    return;
+  }
+
+  bin_commands(cpu);
+  int tile_count = cpu->tile_columns * cpu->tile_rows;
+  for (int i = 0; skip_clean && i < tile_count; i++) {
+    if (cpu->tiles[i].signature == cpu->tiles[i].previous_signature) {
+      cpu->tiles[i].count = 0;
+    }
+  }
+  run_parallel_for(cpu->pool, tile_count, rasterize_tile, cpu);
+  cpu->command_count = 0;
+  cpu->point_count = 0;
+  cpu->particle_count = 0;
+}
+
+void flush_cpu_renderer(cpu_renderer_ptr cpu) {
+  if (!cpu || cpu->command_count == 0) {
+    return;
+  }
+  // Part of the frame is now drawn, so it can no longer skip clean tiles
+  cpu->partial_frame = true;
+  rasterize_commands(cpu, false);
+}
+
+void set_cpu_dirty_tracking(cpu_renderer_ptr cpu, bool enabled) {
+  if (!cpu) {
+    return;
+  }
+  cpu->dirty_tracking = enabled;
+  cpu->history_valid = false;
+}
+
+void set_cpu_dirty_debug_view(cpu_renderer_ptr cpu, bool enabled) {
+  if (cpu) {
+    cpu->dirty_debug_view = enabled;
+  }
+}
+
+void invalidate_cpu_frame(cpu_renderer_ptr cpu) {
+  if (cpu) {
+    cpu->history_valid = false;
+  }
+}
+
+bool cpu_rendering_active(void) { return active_cpu_renderers > 0; }
+
+SDL_Surface* create_cpu_surface(SDL_Surface* source) {
+  if (!source) {
+    return NULL;
+  }
+
+  Uint32 key;
+  bool keyed = SDL_GetColorKey(source, &key) == 0;
+  Uint8 key_r = 0, key_g = 0, key_b = 0;
+  if (keyed) {
+    SDL_GetRGB(key, source->format, &key_r, &key_g, &key_b);
+  }
+
+  SDL_Surface* surface =
+      SDL_ConvertSurfaceFormat(source, SDL_PIXELFORMAT_ARGB8888, 0);
+  if (!surface) {
+    LOG_ERROR_FMT("Failed to convert surface for CPU rendering: %s",
+                  SDL_GetError());
+    return NULL;
+  }
+  SDL_SetColorKey(surface, SDL_FALSE, 0);
+
+  uint32_t key_rgb = ((uint32_t)key_r << 16) | ((uint32_t)key_g << 8) | key_b;
+  bool translucent = false;
+  for (int y = 0; y < surface->h; y++) {
+    uint32_t* row =
+        (uint32_t*)((uint8_t*)surface->pixels + (size_t)y * surface->pitch);
+    for (int x = 0; x < surface->w; x++) {
+      if (keyed && (row[x] & ~ALPHA_MASK) == key_rgb) {
+        row[x] = 0;
+        continue;
+      }
+      uint32_t alpha = row[x] >> 24;
+      translucent = translucent || (alpha != 0 && alpha != 255);
+    }
+  }
+  surface->userdata = translucent ? &translucent_surface_marker : NULL;
+  return surface;
+}
+
+// Append a command whose bounds are clipped to the framebuffer; NULL when
+// it cannot touch any pixel
+static cpu_command_t* push_command(cpu_renderer_ptr cpu,
+                                   cpu_command_kind_t kind, uint32_t argb,
+                                   const SDL_Rect* bounds) {
+  SDL_Rect framebuffer = {0, 0, cpu->width, cpu->height};
+  int x0, y0, x1, y1;
+  if (!clip_to(&framebuffer, bounds, &x0, &y0, &x1, &y1)) {
+    return NULL;
+  }
+
+  cpu_command_t* commands =
+      grow_array(cpu->commands, &cpu->command_capacity, cpu->command_count + 1,
+                 sizeof(cpu_command_t));
+  if (!commands) {
+    LOG_ERROR("Failed to record CPU draw command");
+    return NULL;
+  }
+  cpu->commands = commands;
+
+  cpu_command_t* command = &cpu->commands[cpu->command_count++];
+  memset(command, 0, sizeof(*command));
+  command->kind = kind;
+  command->argb = argb;
+  command->bounds = (SDL_Rect){x0, y0, x1 - x0, y1 - y0};
+  return command;
+}
+
+static bool push_point_run(cpu_renderer_ptr cpu, cpu_command_kind_t kind,
+                           const SDL_Point* points, int count,
+                           uint32_t argb) {
+  if (count <= 0) {
+    return false;
+  }
+
+  int min_x = points[0].x, max_x = points[0].x;
+  int min_y = points[0].y, max_y = points[0].y;
+  for (int i = 1; i < count; i++) {
+    min_x = points[i].x < min_x ? points[i].x : min_x;
+    max_x = points[i].x > max_x ? points[i].x : max_x;
+    min_y = points[i].y < min_y ? points[i].y : min_y;
+    max_y = points[i].y > max_y ? points[i].y : max_y;
+  }
+
+  SDL_Point* grown = grow_array(cpu->points, &cpu->point_capacity,
+                                cpu->point_count + count, sizeof(SDL_Point));
+  if (!grown) {
+    return false;
+  }
+  cpu->points = grown;
+
+  SDL_Rect bounds = {min_x, min_y, max_x - min_x + 1, max_y - min_y + 1};
+  cpu_command_t* command = push_command(cpu, kind, argb, &bounds);
+  if (!command) {
+    return false;
+  }
+  command->first = cpu->point_count;
+  command->count = count;
+  memcpy(cpu->points + cpu->point_count, points,
+         sizeof(SDL_Point) * (size_t)count);
+  cpu->point_count += count;
+  return true;
+}
+
+void cpu_clear(cpu_renderer_ptr cpu, uint32_t argb) {
+  SDL_Rect all = {0, 0, cpu->width, cpu->height};
+  cpu_command_t* command = push_command(cpu, CPU_COMMAND_CLEAR, argb, &all);
+  if (command) {
+    command->rect = all;
+  }
+}
+
+void cpu_fill_rects(cpu_renderer_ptr cpu, const SDL_Rect* rects, int count,
+                    uint32_t argb) {
+  for (int i = 0; i < count; i++) {
+    cpu_command_t* command =
+        push_command(cpu, CPU_COMMAND_FILL_RECT, argb, &rects[i]);
+    if (command) {
+      command->rect = rects[i];
+    }
+  }
+}
+
+void cpu_blend_rect(cpu_renderer_ptr cpu, const SDL_Rect* rect,
+                    uint32_t argb) {
+  uint32_t alpha = argb >> 24;
+  if (alpha == 0) {
+    return;
+  }
+  cpu_command_t* command =
+      push_command(cpu, alpha == 255 ? CPU_COMMAND_FILL_RECT
+                                     : CPU_COMMAND_BLEND_RECT,
+                   argb, rect);
+  if (command) {
+    command->rect = *rect;
+  }
+}
+
+void cpu_draw_lines(cpu_renderer_ptr cpu, const SDL_Point* points, int count,
+                    uint32_t argb) {
+  if (count >= 2) {
+    push_point_run(cpu, CPU_COMMAND_LINES, points, count, argb);
+  }
+}
+
+// Tile holding a point, or -1 if it is off screen
+static inline int point_tile(const cpu_renderer_ptr cpu,
+                             const SDL_Point* point) {
+  if (point->x < 0 || point->y < 0 || point->x >= cpu->width ||
+      point->y >= cpu->height) {
+    return -1;
+  }
+  return (point->y / CPU_RENDERER_TILE_SIZE) * cpu->tile_columns +
+         point->x / CPU_RENDERER_TILE_SIZE;
+}
+
+// Counting sort into one run per tile, as for particles, so each tile only
+// scans the points inside it
+void cpu_draw_points(cpu_renderer_ptr cpu, const SDL_Point* points, int count,
+                     uint32_t argb) {
+  if (!cpu || !points || count <= 0) {
+    return;
+  }
+
+  int tile_count = cpu->tile_columns * cpu->tile_rows;
+  int* offsets = grow_array(cpu->tile_offsets, &cpu->tile_offset_capacity,
+                            tile_count + 1, sizeof(int));
+  if (!offsets) {
+    LOG_ERROR("Failed to bin CPU points");
+    return;
+  }
+  cpu->tile_offsets = offsets;
+  memset(offsets, 0, sizeof(int) * (size_t)(tile_count + 1));
+
+  for (int i = 0; i < count; i++) {
+    int tile = point_tile(cpu, &points[i]);
+    if (tile >= 0) {
+      offsets[tile + 1]++;
+    }
+  }
+  // offsets[t] becomes the start of tile t's run
+  for (int t = 1; t <= tile_count; t++) {
+    offsets[t] += offsets[t - 1];
+  }
+  int total = offsets[tile_count];
+  if (total == 0) {
+    return;
+  }
+
+  SDL_Point* grown = grow_array(cpu->points, &cpu->point_capacity,
+                                cpu->point_count + total, sizeof(SDL_Point));
+  if (!grown) {
+    LOG_ERROR("Failed to record CPU points");
+    return;
+  }
+  cpu->points = grown;
+
+  // Scattering advances offsets[t] to the end of tile t's run
+  SDL_Point* runs = cpu->points + cpu->point_count;
+  for (int i = 0; i < count; i++) {
+    int tile = point_tile(cpu, &points[i]);
+    if (tile >= 0) {
+      runs[offsets[tile]++] = points[i];
+    }
+  }
+
+  for (int t = 0; t < tile_count; t++) {
+    int start = t > 0 ? offsets[t - 1] : 0;
+    if (offsets[t] == start) {
+      continue;
+    }
+    SDL_Rect tile_rect = {(t % cpu->tile_columns) * CPU_RENDERER_TILE_SIZE,
+                          (t / cpu->tile_columns) * CPU_RENDERER_TILE_SIZE,
+                          CPU_RENDERER_TILE_SIZE, CPU_RENDERER_TILE_SIZE};
+    cpu_command_t* command =
+        push_command(cpu, CPU_COMMAND_POINTS, argb, &tile_rect);
+    if (command) {
+      command->first = cpu->point_count + start;
+      command->count = offsets[t] - start;
+    }
+  }
+  cpu->point_count += total;
+}
+
+static inline uint32_t vertex_argb(const SDL_Vertex* vertex) {
+  return ((uint32_t)vertex->color.a << 24) |
+         ((uint32_t)vertex->color.r << 16) |
+         ((uint32_t)vertex->color.g << 8) | vertex->color.b;
+}
+
+void cpu_draw_geometry(cpu_renderer_ptr cpu, const SDL_Vertex* vertices,
+                       int vertex_count, const int* indices, int index_count) {
+  for (int i = 0; i + 2 < index_count; i += 3) {
+    if (indices[i] >= vertex_count || indices[i + 1] >= vertex_count ||
+        indices[i + 2] >= vertex_count) {
+      continue;
+    }
+    const SDL_Vertex* a = &vertices[indices[i]];
+    const SDL_Vertex* b = &vertices[indices[i + 1]];
+    const SDL_Vertex* c = &vertices[indices[i + 2]];
+    if (a->color.a == 0 && b->color.a == 0 && c->color.a == 0) {
+      continue;
+    }
+
+    float min_x = fminf(a->position.x, fminf(b->position.x, c->position.x));
+    float max_x = fmaxf(a->position.x, fmaxf(b->position.x, c->position.x));
+    float min_y = fminf(a->position.y, fminf(b->position.y, c->position.y));
+    float max_y = fmaxf(a->position.y, fmaxf(b->position.y, c->position.y));
+    SDL_Rect bounds = {(int)floorf(min_x), (int)floorf(min_y),
+                       (int)ceilf(max_x) - (int)floorf(min_x) + 1,
+                       (int)ceilf(max_y) - (int)floorf(min_y) + 1};
+
+    const SDL_Vertex* corners[3] = {a, b, c};
+    cpu_command_t* command =
+        push_command(cpu, CPU_COMMAND_TRIANGLE, vertex_argb(a), &bounds);
+    if (command) {
+      for (int k = 0; k < 3; k++) {
+        command->triangle[k] = corners[k]->position;
+        command->triangle_argb[k] = vertex_argb(corners[k]);
+      }
+    }
+  }
+}
+
+// Shrink a destination to the part showing `clipped`, the visible part of
+// `src`, the way SDL_RenderCopyEx does instead of stretching the remaining
+// texels. A rotated destination keeps its rotation around the old center.
+static SDL_FRect clip_blit_destination(const SDL_Rect* src,
+                                       const SDL_Rect* clipped,
+                                       const SDL_FRect* dst, double angle,
+                                       SDL_RendererFlip flip) {
+  float scale_x = dst->w / (float)src->w;
+  float scale_y = dst->h / (float)src->h;
+  int left = clipped->x - src->x;
+  int top = clipped->y - src->y;
+  int right = src->x + src->w - clipped->x - clipped->w;
+  int bottom = src->y + src->h - clipped->y - clipped->h;
+  float offset_x = (float)((flip & SDL_FLIP_HORIZONTAL) ? right : left);
+  float offset_y = (float)((flip & SDL_FLIP_VERTICAL) ? bottom : top);
+  SDL_FRect result = {dst->x + offset_x * scale_x, dst->y + offset_y * scale_y,
+                      (float)clipped->w * scale_x,
+                      (float)clipped->h * scale_y};
+  if (angle != 0.0) {
+    // Rotate the offset between the two centers around the old center
+    float dx = result.x + result.w * 0.5f - (dst->x + dst->w * 0.5f);
+    float dy = result.y + result.h * 0.5f - (dst->y + dst->h * 0.5f);
+    float cos_a = (float)cos(angle * DEGREES_TO_RADIANS);
+    float sin_a = (float)sin(angle * DEGREES_TO_RADIANS);
+    result.x += dx * cos_a - dy * sin_a - dx;
+    result.y += dx * sin_a + dy * cos_a - dy;
+  }
+  return result;
+}
+
+void cpu_blit(cpu_renderer_ptr cpu, const SDL_Surface* surface,
+              const SDL_Rect* src, const SDL_FRect* dst, double angle,
+              SDL_RendererFlip flip, SDL_Color tint) {
+  if (!cpu || !surface || tint.a == 0) {
+    return;
+  }
+
+  SDL_Rect surface_bounds = {0, 0, surface->w, surface->h};
+  SDL_Rect clipped_src;
+  if (!SDL_IntersectRect(src, &surface_bounds, &clipped_src)) {
+    return;
+  }
+  SDL_FRect clipped_dst;
+  if (clipped_src.x != src->x || clipped_src.y != src->y ||
+      clipped_src.w != src->w || clipped_src.h != src->h) {
+    clipped_dst = clip_blit_destination(src, &clipped_src, dst, angle, flip);
+    dst = &clipped_dst;
+  }
+
+  SDL_Rect bounds;
+  if (angle != 0.0) {
+    float half_w = dst->w * 0.5f;
+    float half_h = dst->h * 0.5f;
+    float radius = sqrtf(half_w * half_w + half_h * half_h);
+    int x0 = (int)floorf(dst->x + half_w - radius);
+    int y0 = (int)floorf(dst->y + half_h - radius);
+    bounds = (SDL_Rect){x0, y0, (int)ceilf(dst->x + half_w + radius) - x0,
+                        (int)ceilf(dst->y + half_h + radius) - y0};
+  } else {
+    bounds = (SDL_Rect){(int)lroundf(dst->x), (int)lroundf(dst->y),
+                        (int)lroundf(dst->w), (int)lroundf(dst->h)};
+    if (bounds.w <= 0 || bounds.h <= 0) {
+      return;
+    }
+  }
+
+  uint32_t rgb = ((uint32_t)tint.r << 16) | ((uint32_t)tint.g << 8) | tint.b;
+  cpu_command_t* command = push_command(cpu, CPU_COMMAND_BLIT, rgb, &bounds);
+  if (!command) {
+    return;
+  }
+  command->surface = surface;
+  command->rect = clipped_src;
+  command->dst = *dst;
+  command->angle = (float)angle;
+  command->flip = flip;
+  command->alpha = tint.a;
+}
+
+// Range of tiles a particle overlaps; false if it is off screen
+static bool particle_tiles(const cpu_renderer_ptr cpu,
+                           const cpu_particle_t* particle, int size,
+                           int* column0, int* row0, int* column1, int* row1) {
+  SDL_Rect framebuffer = {0, 0, cpu->width, cpu->height};
+  SDL_Rect rect = {particle->x, particle->y, size, size};
+  int x0, y0, x1, y1;
+  if (!clip_to(&framebuffer, &rect, &x0, &y0, &x1, &y1)) {
+    return false;
+  }
+  *column0 = x0 / CPU_RENDERER_TILE_SIZE;
+  *row0 = y0 / CPU_RENDERER_TILE_SIZE;
+  *column1 = (x1 - 1) / CPU_RENDERER_TILE_SIZE;
+  *row1 = (y1 - 1) / CPU_RENDERER_TILE_SIZE;
+  return true;
+}
+
+// Counting sort into one run per tile, then one command per non-empty run.
+// A particle straddling a tile edge is copied into each tile it touches.
+void cpu_draw_particles(cpu_renderer_ptr cpu, const cpu_particle_t* particles,
+                        int count, int size) {
+  if (!cpu || !particles || count <= 0 || size <= 0) {
+    return;
+  }
+
+  int tile_count = cpu->tile_columns * cpu->tile_rows;
+  int* offsets = grow_array(cpu->tile_offsets, &cpu->tile_offset_capacity,
+                            tile_count + 1, sizeof(int));
+  if (!offsets) {
+    LOG_ERROR("Failed to bin CPU particles");
+    return;
+  }
+  cpu->tile_offsets = offsets;
+  memset(offsets, 0, sizeof(int) * (size_t)(tile_count + 1));
+
+  int column0, row0, column1, row1;
+  for (int i = 0; i < count; i++) {
+    if (!particle_tiles(cpu, &particles[i], size, &column0, &row0, &column1,
+                        &row1)) {
+      continue;
+    }
+    for (int row = row0; row <= row1; row++) {
+      for (int column = column0; column <= column1; column++) {
+        offsets[row * cpu->tile_columns + column + 1]++;
+      }
+    }
+  }
+  // offsets[t] becomes the start of tile t's run
+  for (int t = 1; t <= tile_count; t++) {
+    offsets[t] += offsets[t - 1];
+  }
+  int total = offsets[tile_count];
+  if (total == 0) {
+    return;
+  }
+
+  cpu_particle_t* grown =
+      grow_array(cpu->particles, &cpu->particle_capacity,
+                 cpu->particle_count + total, sizeof(cpu_particle_t));
+  if (!grown) {
+    LOG_ERROR("Failed to record CPU particles");
+    return;
+  }
+  cpu->particles = grown;
+
+  // Scattering advances offsets[t] to the end of tile t's run
+  cpu_particle_t* runs = cpu->particles + cpu->particle_count;
+  for (int i = 0; i < count; i++) {
+    if (!particle_tiles(cpu, &particles[i], size, &column0, &row0, &column1,
+                        &row1)) {
+      continue;
+    }
+    for (int row = row0; row <= row1; row++) {
+      for (int column = column0; column <= column1; column++) {
+        runs[offsets[row * cpu->tile_columns + column]++] = particles[i];
+      }
+    }
+  }
+
+  for (int t = 0; t < tile_count; t++) {
+    int start = t > 0 ? offsets[t - 1] : 0;
+    if (offsets[t] == start) {
+      continue;
+    }
+    SDL_Rect tile_rect = {(t % cpu->tile_columns) * CPU_RENDERER_TILE_SIZE,
+                          (t / cpu->tile_columns) * CPU_RENDERER_TILE_SIZE,
+                          CPU_RENDERER_TILE_SIZE, CPU_RENDERER_TILE_SIZE};
+    cpu_command_t* command =
+        push_command(cpu, CPU_COMMAND_PARTICLES, 0, &tile_rect);
+    if (command) {
+      command->rect.w = size;
+      command->first = cpu->particle_count + start;
+      command->count = offsets[t] - start;
+    }
+  }
+  cpu->particle_count += total;
+}
+
+static bool push_dirty_rect(cpu_renderer_ptr cpu, SDL_Rect rect) {
+  SDL_Rect* rects =
+      grow_array(cpu->dirty_rects, &cpu->dirty_rect_capacity,
+                 cpu->dirty_rect_count + 1, sizeof(SDL_Rect));
+  if (!rects) {
+    return false;
+  }
+  cpu->dirty_rects = rects;
+  cpu->dirty_rects[cpu->dirty_rect_count++] = rect;
+  return true;
+}
+
+// Merge the changed tiles into rectangles: runs of dirty tiles within a
+// tile row, each extending the run directly above it when they line up
+static void collect_dirty_rects(cpu_renderer_ptr cpu) {
+  cpu->dirty_rect_count = 0;
+  for (int row = 0; row < cpu->tile_rows; row++) {
+    int row_start = cpu->dirty_rect_count;
+    int y = row * CPU_RENDERER_TILE_SIZE;
+    int h = cpu->height - y < CPU_RENDERER_TILE_SIZE ? cpu->height - y
+                                                     : CPU_RENDERER_TILE_SIZE;
+    int column = 0;
+    while (column < cpu->tile_columns) {
+      const cpu_tile_t* tile = &cpu->tiles[row * cpu->tile_columns + column];
+      if (tile->signature == tile->previous_signature) {
+        column++;
+        continue;
+      }
+      int first = column;
+      while (column < cpu->tile_columns &&
+             tile->signature != tile->previous_signature) {
+        column++;
+        tile++;
+      }
+      int x = first * CPU_RENDERER_TILE_SIZE;
+      int right = column * CPU_RENDERER_TILE_SIZE;
+      SDL_Rect rect = {x, y, (right < cpu->width ? right : cpu->width) - x, h};
+
+      bool merged = false;
+      for (int i = 0; i < row_start && !merged; i++) {
+        SDL_Rect* above = &cpu->dirty_rects[i];
+        if (above->x == rect.x && above->w == rect.w &&
+            above->y + above->h == rect.y) {
+          above->h += rect.h;
+          merged = true;
+        }
+      }
+      if (!merged && !push_dirty_rect(cpu, rect)) {
+        // Out of memory: fall back to one full-frame rectangle
+        cpu->dirty_rect_count = 0;
+        push_dirty_rect(cpu, (SDL_Rect){0, 0, cpu->width, cpu->height});
+        return;
+      }
+    }
+  }
+}
+
+static void draw_dirty_outlines(cpu_renderer_ptr cpu) {
+  Uint8 r, g, b, a;
+  SDL_GetRenderDrawColor(cpu->renderer, &r, &g, &b, &a);
+  SDL_SetRenderDrawColor(cpu->renderer, 255, 0, 255, 255);
+  SDL_RenderDrawRects(cpu->renderer, cpu->dirty_rects,
+                      cpu->dirty_rect_count);
+  SDL_SetRenderDrawColor(cpu->renderer, r, g, b, a);
+}
+
+void cpu_present(cpu_renderer_ptr cpu) {
+  if (!cpu) {
+    return;
+  }
+
+  bool incremental =
+      cpu->dirty_tracking && cpu->history_valid && !cpu->partial_frame;
+  rasterize_commands(cpu, incremental);
+
+  int pitch = cpu->pitch * (int)sizeof(uint32_t);
+  if (cpu->dirty_tracking) {
+    if (!incremental) {
+      // Everything was drawn: mark every tile as changed for the rect list
+      for (int i = 0; i < cpu->tile_columns * cpu->tile_rows; i++) {
+        cpu->tiles[i].previous_signature = ~cpu->tiles[i].signature;
+      }
+    }
+    collect_dirty_rects(cpu);
+    for (int i = 0; i < cpu->dirty_rect_count; i++) {
+      const SDL_Rect* rect = &cpu->dirty_rects[i];
+      SDL_UpdateTexture(cpu->texture, rect,
+                        pixel_at(cpu, rect->x, rect->y), pitch);
+    }
+  } else {
+    SDL_UpdateTexture(cpu->texture, NULL, cpu->pixels, pitch);
+  }
+  SDL_RenderCopy(cpu->renderer, cpu->texture, NULL, NULL);
+  if (cpu->dirty_tracking && cpu->dirty_debug_view) {
+    draw_dirty_outlines(cpu);
+  }
+
+  for (int i = 0; i < cpu->tile_columns * cpu->tile_rows; i++) {
+    cpu->tiles[i].previous_signature = cpu->tiles[i].signature;
+    cpu->tiles[i].signature = 0;
+  }
+  cpu->history_valid = cpu->dirty_tracking;
+  cpu->partial_frame = false;
+}
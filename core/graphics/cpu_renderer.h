@@ -0,0 +1,325 @@
+/**
+ * @file cpu_renderer.h
+ * @brief Vectorized CPU rasterizer backend
+ *
+ * Rasterizes lines, spans, rects, untextured triangles, sprite blits and
+ * additive particles into an aligned ARGB8888 framebuffer and uploads it once
+ * per frame through a streaming SDL_Texture. Draw calls are recorded,
+ * binned into 64x64 screen tiles and rasterized tile by tile on a worker
+ * pool. Every command is clipped to the tile being drawn and each pixel only
+ * depends on the commands covering it, so the output is identical for any
+ * thread count. Intended for machines without a GPU, where SDL's own
+ * software renderer goes through generic per-call code. Span fills, alpha
+ * blending, additive particles and colorkeyed blits use AVX2 kernels when
+ * compiled with -mavx2, SSE2 kernels on any other x86-64 build and scalar
+ * code elsewhere.
+ *
+ * The backend is selected with initialize_graphics_context_with_backend()
+ * and sits behind the drawing_primitives.h and texture.h API: primitives
+ * are rasterized when the primitive batch flushes, sprites are blitted from
+ * an ARGB8888 copy of the texture kept while the backend is active.
+ * Textures drawn with raw SDL calls are not composited into the frame, and
+ * surfaces passed to cpu_blit() must stay alive until the frame is flushed.
+ */
+
+#ifndef CORE_GRAPHICS_CPU_RENDERER_H_
+#define CORE_GRAPHICS_CPU_RENDERER_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Framebuffer rows are padded to this many pixels (32 bytes, one AVX2 store)
+#define CPU_RENDERER_ROW_ALIGNMENT 8
+
+// Framebuffer pixel from an engine color_t and an alpha
+#define CPU_COLOR(color, alpha) \
+  (((uint32_t)(alpha) << 24) | ((uint32_t)(color) & 0xFFFFFF))
+
+// Side of the square screen tiles rasterized independently by the workers
+#define CPU_RENDERER_TILE_SIZE 64
+
+struct worker_pool;
+
+typedef enum {
+  CPU_COMMAND_CLEAR,
+  CPU_COMMAND_FILL_RECT,
+  CPU_COMMAND_BLEND_RECT,
+  CPU_COMMAND_LINES,     // Polyline of `count` points
+  CPU_COMMAND_POINTS,    // `count` points
+  CPU_COMMAND_TRIANGLE,
+  CPU_COMMAND_BLIT,
+  CPU_COMMAND_PARTICLES  // `count` additive squares of side rect.w
+} cpu_command_kind_t;
+
+// Square particle added onto the framebuffer
+typedef struct {
+  int x;  // Top-left corner
+  int y;
+  uint32_t argb;  // Color as 0xAARRGGBB; alpha scales the added light
+} cpu_particle_t;
+
+// Draw call recorded until the frame is rasterized
+typedef struct {
+  cpu_command_kind_t kind;
+  uint32_t argb;    // Fill color, or blit color tint as 0xRRGGBB
+  SDL_Rect bounds;  // Framebuffer pixels it may touch, used for binning
+  SDL_Rect rect;    // Filled rect, or blit source rect
+  SDL_FRect dst;    // Blit destination
+  SDL_FPoint triangle[3];
+  uint32_t triangle_argb[3];  // Vertex colors, interpolated when they differ
+  int first;  // First point or particle of a run
+  int count;
+  const SDL_Surface* surface;
+  float angle;
+  SDL_RendererFlip flip;
+  Uint8 alpha;
+} cpu_command_t;
+
+// Indices of the commands overlapping one tile, in submission order
+typedef struct {
+  int* commands;
+  int count;
+  int capacity;
+  uint64_t signature;           // Hash of this frame's commands in the tile
+  uint64_t previous_signature;  // Signature of the last presented frame
+} cpu_tile_t;
+
+// Per-thread buffers for scaled and flipped blits
+typedef struct {
+  uint32_t* row;
+  int row_capacity;
+  int* columns;
+  int column_capacity;
+} cpu_scratch_t;
+
+typedef struct cpu_renderer {
+  SDL_Renderer* renderer;
+  SDL_Texture* texture;  // Streaming texture the frame is uploaded to
+  void* allocation;      // Unaligned block holding the framebuffer
+  uint32_t* pixels;      // ARGB8888, rows aligned to 32 bytes
+  int width;
+  int height;
+  int pitch;  // Row length in pixels
+
+  cpu_command_t* commands;
+  int command_count;
+  int command_capacity;
+  SDL_Point* points;  // Line and point runs
+  int point_count;
+  int point_capacity;
+  cpu_particle_t* particles;  // Particle runs, grouped by tile
+  int particle_count;
+  int particle_capacity;
+  int* tile_offsets;  // Per-tile counts while binning particles and points
+  int tile_offset_capacity;
+
+  cpu_tile_t* tiles;
+  int tile_columns;
+  int tile_rows;
+
+  struct worker_pool* pool;  // Created on the first flush
+  cpu_scratch_t* scratch;    // One per thread
+  int scratch_count;
+  int thread_count;  // Requested threads, below 1 for one per core
+
+  bool dirty_tracking;
+  bool dirty_debug_view;
+  bool history_valid;  // Tile signatures describe the framebuffer contents
+  bool partial_frame;  // Flushed before cpu_present() this frame
+  SDL_Rect* dirty_rects;  // Regions redrawn by the last cpu_present()
+  int dirty_rect_count;
+  int dirty_rect_capacity;
+} cpu_renderer_t, *cpu_renderer_ptr;
+
+/**
+ * @brief Create a CPU framebuffer and its streaming upload texture
+ * @param renderer Renderer presenting the frame
+ * @param width Framebuffer width
+ * @param height Framebuffer height
+ * @return Backend, or NULL on failure
+ */
+cpu_renderer_ptr create_cpu_renderer(SDL_Renderer* renderer, int width,
+                                     int height);
+
+/**
+ * @brief Release a CPU backend
+ * @param cpu Backend to destroy (may be NULL)
+ */
+void destroy_cpu_renderer(cpu_renderer_ptr cpu);
+
+/**
+ * @brief Resize the framebuffer, e.g. when the logical size changes
+ * @param cpu Backend to resize
+ * @param width New width
+ * @param height New height
+ * @return true on success; the old framebuffer is kept on failure
+ */
+bool resize_cpu_renderer(cpu_renderer_ptr cpu, int width, int height);
+
+/**
+ * @brief Set the number of rasterizer threads
+ * @param cpu Backend
+ * @param thread_count Threads including the caller; below 1 means one per
+ *        CPU core (the default)
+ */
+void set_cpu_renderer_threads(cpu_renderer_ptr cpu, int thread_count);
+
+/**
+ * @brief Rasterize all recorded commands into the framebuffer
+ * @param cpu Backend
+ */
+void flush_cpu_renderer(cpu_renderer_ptr cpu);
+
+/**
+ * @brief Only redraw and upload the tiles that changed since the last frame
+ *
+ * A tile is clean when the commands binned into it hash the same as in the
+ * previous frame; it then keeps its pixels and is neither cleared,
+ * rasterized nor uploaded. Sprites are compared by surface pointer, so call
+ * invalidate_cpu_frame() after changing a surface's pixels in place.
+ *
+ * @param cpu Backend
+ * @param enabled true to track dirty tiles, false to redraw every frame
+ */
+void set_cpu_dirty_tracking(cpu_renderer_ptr cpu, bool enabled);
+
+/**
+ * @brief Outline the regions redrawn by each frame on screen
+ * @param cpu Backend
+ * @param enabled true to draw the outlines after the frame is copied
+ */
+void set_cpu_dirty_debug_view(cpu_renderer_ptr cpu, bool enabled);
+
+/**
+ * @brief Force the next frame to be redrawn completely
+ * @param cpu Backend
+ */
+void invalidate_cpu_frame(cpu_renderer_ptr cpu);
+
+/**
+ * @brief Check whether any CPU backend exists
+ *
+ * Texture loading keeps an ARGB8888 copy of each image while this is true.
+ *
+ * @return true if a CPU backend has been created and not destroyed
+ */
+bool cpu_rendering_active(void);
+
+/**
+ * @brief Convert an image to a blittable ARGB8888 surface
+ *
+ * The source color key, if any, becomes alpha 0. The returned surface's
+ * userdata is non-NULL when it has partially transparent pixels, which
+ * need blending instead of the colorkey fast path.
+ *
+ * @param source Image to convert
+ * @return New surface (free with SDL_FreeSurface), or NULL on failure
+ */
+SDL_Surface* create_cpu_surface(SDL_Surface* source);
+
+/**
+ * @brief Fill the whole framebuffer with one color
+ * @param cpu Backend
+ * @param argb Color as 0xAARRGGBB
+ */
+void cpu_clear(cpu_renderer_ptr cpu, uint32_t argb);
+
+/**
+ * @brief Fill rectangles with an opaque color
+ * @param cpu Backend
+ * @param rects Rectangles, clipped to the framebuffer
+ * @param count Number of rectangles
+ * @param argb Color as 0xAARRGGBB
+ */
+void cpu_fill_rects(cpu_renderer_ptr cpu, const SDL_Rect* rects, int count,
+                    uint32_t argb);
+
+/**
+ * @brief Alpha-blend a rectangle
+ * @param cpu Backend
+ * @param rect Rectangle, clipped to the framebuffer
+ * @param argb Color as 0xAARRGGBB; the alpha byte is the opacity
+ */
+void cpu_blend_rect(cpu_renderer_ptr cpu, const SDL_Rect* rect, uint32_t argb);
+
+/**
+ * @brief Draw a connected polyline, endpoints included
+ * @param cpu Backend
+ * @param points Polyline vertices
+ * @param count Number of vertices
+ * @param argb Color as 0xAARRGGBB
+ */
+void cpu_draw_lines(cpu_renderer_ptr cpu, const SDL_Point* points, int count,
+                    uint32_t argb);
+
+/**
+ * @brief Plot points
+ * @param cpu Backend
+ * @param points Points to plot
+ * @param count Number of points
+ * @param argb Color as 0xAARRGGBB
+ */
+void cpu_draw_points(cpu_renderer_ptr cpu, const SDL_Point* points, int count,
+                     uint32_t argb);
+
+/**
+ * @brief Rasterize indexed untextured triangles
+ *
+ * Vertex colors are interpolated across each triangle and blended where
+ * they are translucent; triangles of one color are filled span by span.
+ * Pixel centers are sampled with a half-open rule, so triangles sharing an
+ * edge never cover a pixel twice.
+ *
+ * @param cpu Backend
+ * @param vertices Triangle vertices
+ * @param vertex_count Number of vertices
+ * @param indices Three indices per triangle
+ * @param index_count Number of indices
+ */
+void cpu_draw_geometry(cpu_renderer_ptr cpu, const SDL_Vertex* vertices,
+                       int vertex_count, const int* indices, int index_count);
+
+/**
+ * @brief Blit part of a surface with nearest-neighbour scaling
+ * @param cpu Backend
+ * @param surface Surface created by create_cpu_surface()
+ * @param src Source rectangle in surface pixels
+ * @param dst Destination rectangle in framebuffer pixels
+ * @param angle Clockwise rotation around the destination center, in degrees
+ * @param flip Flip flags
+ * @param tint Color and alpha multiplier (all 255 = unchanged)
+ */
+void cpu_blit(cpu_renderer_ptr cpu, const SDL_Surface* surface,
+              const SDL_Rect* src, const SDL_FRect* dst, double angle,
+              SDL_RendererFlip flip, SDL_Color tint);
+
+/**
+ * @brief Add square particles onto the framebuffer
+ *
+ * Each particle adds its color, scaled by its alpha, with saturation, so
+ * overlapping particles brighten instead of covering each other and the
+ * result does not depend on their order. Particles are sorted into one run
+ * per screen tile here, which keeps the work per tile proportional to the
+ * particles actually inside it.
+ *
+ * @param cpu Backend
+ * @param particles Particles to draw
+ * @param count Number of particles
+ * @param size Side of every particle in pixels
+ */
+void cpu_draw_particles(cpu_renderer_ptr cpu, const cpu_particle_t* particles,
+                        int count, int size);
+
+/**
+ * @brief Rasterize, upload the framebuffer and copy it to the renderer
+ *
+ * Call before SDL_RenderPresent(). With dirty tracking only the changed
+ * tiles are rasterized and uploaded; they are merged into the rectangles
+ * left in cpu->dirty_rects.
+ *
+ * @param cpu Backend
+ */
+void cpu_present(cpu_renderer_ptr cpu);
+
+#endif  // CORE_GRAPHICS_CPU_RENDERER_H_
@@ -70,6 +70,10 @@ void print_graphics_info(void) {
 }
 
 void toggle_fullscreen(const graphics_context_ptr graphics_context) {
+  if (!graphics_context->window) {
+    return;  // Headless contexts have no window
+  }
+
   // Get current fullscreen state
   Uint32 flags = SDL_GetWindowFlags(graphics_context->window);
   bool is_fullscreen = (flags & SDL_WINDOW_FULLSCREEN) ||
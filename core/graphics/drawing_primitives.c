@@ -9,45 +9,286 @@
 #include <math.h>
 #include <stdbool.h>
 
+#include "cpu_renderer.h"
+#include "dynamic_array.h"
 #include "graphics.h"
 #include "inline.h"
+#include "polygon_mesh.h"
+#include "primitive_batch.h"
+#include "render_state.h"
 
-// Pre-calculated sin/cos lookup table for circle drawing optimization
-#define CIRCLE_POINTS 360
-static double circle_cos[CIRCLE_POINTS];
-static double circle_sin[CIRCLE_POINTS];
-static bool circle_lookup_initialized = false;
+// Circles are tessellated so no chord strays more than CIRCLE_TOLERANCE
+// pixels from the true circle. Segment counts are rounded up to a multiple
+// of CIRCLE_SEGMENT_STEP, and the unit circle for each count is cached.
+#define CIRCLE_TOLERANCE 0.25
+#define CIRCLE_SEGMENT_STEP 8
+#define CIRCLE_MAX_SEGMENTS 512
+#define CIRCLE_TABLE_COUNT (CIRCLE_MAX_SEGMENTS / CIRCLE_SEGMENT_STEP)
+// Sum of CIRCLE_SEGMENT_STEP * k for k = 1..CIRCLE_TABLE_COUNT
+#define CIRCLE_TABLE_POINTS \
+  (CIRCLE_SEGMENT_STEP * CIRCLE_TABLE_COUNT * (CIRCLE_TABLE_COUNT + 1) / 2)
+static SDL_FPoint circle_unit_points[CIRCLE_TABLE_POINTS];
+static bool circle_table_ready[CIRCLE_TABLE_COUNT];
 
-void init_circle_lookup(void) {
-  if (!circle_lookup_initialized) {
-    for (int i = 0; i < CIRCLE_POINTS; i++) {
-      double angle = i * M_PI / 180.0;
-      circle_cos[i] = cos(angle);
-      circle_sin[i] = sin(angle);
+// Width of draw_thick_line, matching the old one-pixel offset brush
+#define THICK_LINE_WIDTH 3.0f
+// Longest miter allowed, in half widths, before a join is beveled
+#define POLYLINE_MITER_LIMIT 4.0f
+
+// Vertex, index and point buffers reused by every generated shape
+static SDL_Vertex* geometry_vertices = NULL;
+static int geometry_vertex_capacity = 0;
+static int* geometry_indices = NULL;
+static int geometry_index_capacity = 0;
+static SDL_FPoint* polygon_points = NULL;
+static int polygon_point_capacity = 0;
+
+// Unit circle with `segments` points, computed on first use
+static const SDL_FPoint* circle_table(int segments) {
+  int table = segments / CIRCLE_SEGMENT_STEP - 1;
+  // Tables for 8, 16, 24... points are stored back to back
+  const SDL_FPoint* unit =
+      &circle_unit_points[CIRCLE_SEGMENT_STEP * table * (table + 1) / 2];
+
+  if (!circle_table_ready[table]) {
+    SDL_FPoint* points = (SDL_FPoint*)unit;
+    for (int i = 0; i < segments; i++) {
+      double angle = i * 2.0 * M_PI / segments;
+      points[i].x = (float)cos(angle);
+      points[i].y = (float)sin(angle);
     }
-    circle_lookup_initialized = true;
+    circle_table_ready[table] = true;
+  }
+  return unit;
+}
+
+// Fewest segments keeping every chord within CIRCLE_TOLERANCE of the circle
+static int circle_segments(float radius) {
+  int segments = CIRCLE_SEGMENT_STEP;
+  if (radius > CIRCLE_TOLERANCE) {
+    double step = acos(1.0 - CIRCLE_TOLERANCE / radius);
+    segments = (int)ceil(M_PI / step);
+  }
+  segments = (segments + CIRCLE_SEGMENT_STEP - 1) / CIRCLE_SEGMENT_STEP *
+             CIRCLE_SEGMENT_STEP;
+  if (segments < CIRCLE_SEGMENT_STEP) {
+    segments = CIRCLE_SEGMENT_STEP;
+  }
+  return segments > CIRCLE_MAX_SEGMENTS ? CIRCLE_MAX_SEGMENTS : segments;
+}
+
+void init_circle_lookup(void) {
+  for (int segments = CIRCLE_SEGMENT_STEP; segments <= CIRCLE_MAX_SEGMENTS;
+       segments += CIRCLE_SEGMENT_STEP) {
+    circle_table(segments);
   }
 }
 
 ALWAYS_INLINE void draw_line(const graphics_context_ptr graphics_context,
                              int x1, int y1, int x2, int y2, color_t color) {
-  SDL_SetRenderDrawColor(graphics_context->renderer, R(color), G(color),
-                         B(color), 255);
+  if (batch_line(graphics_context, x1, y1, x2, y2, color)) {
+    return;
+  }
+  apply_draw_color(graphics_context, R(color), G(color), B(color), 255);
   SDL_RenderDrawLine(graphics_context->renderer, x1, y1, x2, y2);
 }
 
 ALWAYS_INLINE void draw_thick_line(const graphics_context_ptr graphics_context,
                                    int x1, int y1, int x2, int y2,
                                    color_t color) {
-  SDL_SetRenderDrawColor(graphics_context->renderer, R(color), G(color),
-                         B(color), 255);
-  // Draw main line
-  SDL_RenderDrawLine(graphics_context->renderer, x1, y1, x2, y2);
-  // Draw parallel lines to create thickness
-  SDL_RenderDrawLine(graphics_context->renderer, x1 + 1, y1, x2 + 1, y2);
-  SDL_RenderDrawLine(graphics_context->renderer, x1, y1 + 1, x2, y2 + 1);
-  SDL_RenderDrawLine(graphics_context->renderer, x1 - 1, y1, x2 - 1, y2);
-  SDL_RenderDrawLine(graphics_context->renderer, x1, y1 - 1, x2, y2 - 1);
+  // Through pixel centers, like the one-pixel lines SDL draws
+  SDL_FPoint points[2] = {{(float)x1 + 0.5f, (float)y1 + 0.5f},
+                          {(float)x2 + 0.5f, (float)y2 + 0.5f}};
+  draw_thick_polyline(graphics_context, points, 2, THICK_LINE_WIDTH, false,
+                      color);
+}
+
+// Reserve room in the reused vertex/index buffers. A zero count leaves its
+// buffer alone: grow_array() hands back NULL for a buffer never allocated.
+static bool reserve_geometry_buffers(int vertex_count, int index_count) {
+  if (vertex_count > 0) {
+    SDL_Vertex* vertices =
+        grow_array(geometry_vertices, &geometry_vertex_capacity, vertex_count,
+                   sizeof(SDL_Vertex));
+    if (!vertices) {
+      return false;
+    }
+    geometry_vertices = vertices;
+  }
+
+  if (index_count > 0) {
+    int* indices = grow_array(geometry_indices, &geometry_index_capacity,
+                              index_count, sizeof(int));
+    if (!indices) {
+      return false;
+    }
+    geometry_indices = indices;
+  }
+  return true;
+}
+
+// Queue generated triangles in the primitive batch, or draw them right away
+// when batching is off
+static void submit_geometry(const graphics_context_ptr graphics_context,
+                            int vertex_count, const int* indices,
+                            int index_count) {
+  if (!batch_geometry(graphics_context, geometry_vertices, vertex_count,
+                      indices, index_count)) {
+    SDL_RenderGeometry(graphics_context->renderer, NULL, geometry_vertices,
+                       vertex_count, indices, index_count);
+  }
+}
+
+static ALWAYS_INLINE int push_vertex(int* vertex_count, float x, float y,
+                                     SDL_Color color) {
+  SDL_Vertex* vertex = &geometry_vertices[*vertex_count];
+  vertex->position.x = x;
+  vertex->position.y = y;
+  vertex->color = color;
+  vertex->tex_coord.x = 0.0f;
+  vertex->tex_coord.y = 0.0f;
+  return (*vertex_count)++;
+}
+
+static ALWAYS_INLINE void push_triangle(int* index_count, int a, int b,
+                                        int c) {
+  geometry_indices[(*index_count)++] = a;
+  geometry_indices[(*index_count)++] = b;
+  geometry_indices[(*index_count)++] = c;
+}
+
+// Fill the outer wedge left between two segment quads meeting at `corner`.
+// Uses a miter when it stays within POLYLINE_MITER_LIMIT half widths,
+// otherwise falls back to a bevel.
+static void push_join(int* vertex_count, int* index_count, SDL_FPoint corner,
+                      SDL_FPoint d0, SDL_FPoint d1, float half_width,
+                      SDL_Color color) {
+  float cross = d0.x * d1.y - d0.y * d1.x;
+  if (fabsf(cross) < 1e-6f) {
+    return;  // Collinear segments leave no gap
+  }
+
+  // The outer side is opposite to the direction the polyline turns
+  float side = cross > 0.0f ? -1.0f : 1.0f;
+  SDL_FPoint n0 = {-d0.y * side, d0.x * side};
+  SDL_FPoint n1 = {-d1.y * side, d1.x * side};
+
+  int center = push_vertex(vertex_count, corner.x, corner.y, color);
+  int a = push_vertex(vertex_count, corner.x + n0.x * half_width,
+                      corner.y + n0.y * half_width, color);
+  int b = push_vertex(vertex_count, corner.x + n1.x * half_width,
+                      corner.y + n1.y * half_width, color);
+
+  SDL_FPoint miter = {n0.x + n1.x, n0.y + n1.y};
+  float miter_length = sqrtf(miter.x * miter.x + miter.y * miter.y);
+  float cos_half_angle = miter_length * 0.5f;
+  if (cos_half_angle > 1.0f / POLYLINE_MITER_LIMIT) {
+    float scale = half_width / (cos_half_angle * miter_length);
+    int tip = push_vertex(vertex_count, corner.x + miter.x * scale,
+                          corner.y + miter.y * scale, color);
+    push_triangle(index_count, center, a, tip);
+    push_triangle(index_count, center, tip, b);
+  } else {
+    push_triangle(index_count, center, a, b);
+  }
+}
+
+void draw_polyline(const graphics_context_ptr graphics_context,
+                   const SDL_FPoint* points, int num_points, bool closed,
+                   color_t color) {
+  if (num_points < 2) {
+    return;
+  }
+
+  // Consecutive segments share endpoints, so the batch keeps them in one run
+  for (int i = 0; i < num_points - 1; i++) {
+    draw_line(graphics_context, (int)points[i].x, (int)points[i].y,
+              (int)points[i + 1].x, (int)points[i + 1].y, color);
+  }
+  if (closed) {
+    draw_line(graphics_context, (int)points[num_points - 1].x,
+              (int)points[num_points - 1].y, (int)points[0].x,
+              (int)points[0].y, color);
+  }
+}
+
+void draw_thick_polyline(const graphics_context_ptr graphics_context,
+                         const SDL_FPoint* points, int num_points,
+                         float thickness, bool closed, color_t color) {
+  if (num_points < 2 || thickness <= 0.0f) {
+    return;
+  }
+
+  int segment_count = closed ? num_points : num_points - 1;
+  // Each segment is a quad plus, at most, a four-vertex mitered join
+  if (!reserve_geometry_buffers(segment_count * 8, segment_count * 12)) {
+    return;
+  }
+
+  SDL_Color vertex_color = {R(color), G(color), B(color), 255};
+  float half_width = thickness * 0.5f;
+  int vertex_count = 0;
+  int index_count = 0;
+  bool has_previous = false;
+  SDL_FPoint previous_direction = {0.0f, 0.0f};
+  SDL_FPoint first_direction = {0.0f, 0.0f};
+
+  for (int i = 0; i < segment_count; i++) {
+    SDL_FPoint p0 = points[i];
+    SDL_FPoint p1 = points[(i + 1) % num_points];
+    float dx = p1.x - p0.x;
+    float dy = p1.y - p0.y;
+    float length = sqrtf(dx * dx + dy * dy);
+    if (length < 1e-6f) {
+      continue;  // Skip degenerate segments
+    }
+
+    SDL_FPoint direction = {dx / length, dy / length};
+    SDL_FPoint normal = {-direction.y * half_width, direction.x * half_width};
+
+    // Square caps on the open ends keep the old brush footprint
+    if (!closed && i == 0) {
+      p0.x -= direction.x * half_width;
+      p0.y -= direction.y * half_width;
+    }
+    if (!closed && i == segment_count - 1) {
+      p1.x += direction.x * half_width;
+      p1.y += direction.y * half_width;
+    }
+
+    if (has_previous) {
+      push_join(&vertex_count, &index_count, points[i], previous_direction,
+                direction, half_width, vertex_color);
+    } else {
+      first_direction = direction;
+    }
+
+    int a = push_vertex(&vertex_count, p0.x + normal.x, p0.y + normal.y,
+                        vertex_color);
+    int b = push_vertex(&vertex_count, p1.x + normal.x, p1.y + normal.y,
+                        vertex_color);
+    int c = push_vertex(&vertex_count, p1.x - normal.x, p1.y - normal.y,
+                        vertex_color);
+    int d = push_vertex(&vertex_count, p0.x - normal.x, p0.y - normal.y,
+                        vertex_color);
+    push_triangle(&index_count, a, b, c);
+    push_triangle(&index_count, a, c, d);
+
+    previous_direction = direction;
+    has_previous = true;
+  }
+
+  if (closed && has_previous) {
+    push_join(&vertex_count, &index_count, points[0], previous_direction,
+              first_direction, half_width, vertex_color);
+  }
+
+  if (index_count == 0) {
+    return;
+  }
+
+  submit_geometry(graphics_context, vertex_count, geometry_indices,
+                  index_count);
 }
 
 ALWAYS_INLINE void draw_line_between_points(
@@ -58,8 +299,10 @@ ALWAYS_INLINE void draw_line_between_points(
 
 ALWAYS_INLINE void draw_pixel(const graphics_context_ptr graphics_context,
                               int x, int y, color_t color) {
-  SDL_SetRenderDrawColor(graphics_context->renderer, R(color), G(color),
-                         B(color), 255);
+  if (batch_point(graphics_context, x, y, color)) {
+    return;
+  }
+  apply_draw_color(graphics_context, R(color), G(color), B(color), 255);
   SDL_RenderDrawPoint(graphics_context->renderer, x, y);
 }
 
@@ -70,8 +313,12 @@ ALWAYS_INLINE void draw_point(const graphics_context_ptr graphics_context,
 
 ALWAYS_INLINE void draw_fat_pixel(const graphics_context_ptr graphics_context,
                                   const point_ptr p, color_t color) {
-  SDL_SetRenderDrawColor(graphics_context->renderer, R(color), G(color),
-                         B(color), 255);
+  // A 5x5 square is a single filled rect in the batch
+  if (batch_filled_rect(graphics_context, (int)(p->x - 2), (int)(p->y - 2), 5,
+                        5, color)) {
+    return;
+  }
+  apply_draw_color(graphics_context, R(color), G(color), B(color), 255);
   // Draw a 5x5 square for thicker bullets
   for (int dy = -2; dy <= 2; dy++) {
     SDL_RenderDrawLine(graphics_context->renderer, p->x - 2, p->y + dy,
@@ -81,19 +328,145 @@ ALWAYS_INLINE void draw_fat_pixel(const graphics_context_ptr graphics_context,
 
 void draw_circle(const graphics_context_ptr graphics_context, int32_t centreX,
                  int32_t centreY, int32_t radius, color_t color) {
-  // Pre-allocate points array for batched rendering
-  SDL_Point points[CIRCLE_POINTS];
+  int segments = circle_segments((float)radius);
+  const SDL_FPoint* unit = circle_table(segments);
 
-  // Calculate all circle points using pre-calculated lookup table
-  for (int i = 0; i < CIRCLE_POINTS; i++) {
-    points[i].x = centreX + (int)(radius * circle_cos[i]);
-    points[i].y = centreY + (int)(radius * circle_sin[i]);
+  // Closed line loop: the first point is repeated at the end
+  SDL_Point points[CIRCLE_MAX_SEGMENTS + 1];
+  for (int i = 0; i < segments; i++) {
+    points[i].x = centreX + (int)lroundf(radius * unit[i].x);
+    points[i].y = centreY + (int)lroundf(radius * unit[i].y);
   }
+  points[segments] = points[0];
 
-  // Render all points in a single batched call (720 calls -> 2 calls)
-  SDL_SetRenderDrawColor(graphics_context->renderer, R(color), G(color),
-                         B(color), 255);
-  SDL_RenderDrawPoints(graphics_context->renderer, points, CIRCLE_POINTS);
+  if (batch_polyline(graphics_context, points, segments + 1, color)) {
+    return;
+  }
+  apply_draw_color(graphics_context, R(color), G(color), B(color), 255);
+  SDL_RenderDrawLines(graphics_context->renderer, points, segments + 1);
+}
+
+void draw_filled_circle(const graphics_context_ptr graphics_context,
+                        float centre_x, float centre_y, float radius,
+                        color_t color) {
+  if (radius <= 0.0f) {
+    return;
+  }
+
+  int segments = circle_segments(radius);
+  const SDL_FPoint* unit = circle_table(segments);
+  if (!reserve_geometry_buffers(segments + 1, segments * 3)) {
+    return;
+  }
+
+  SDL_Color vertex_color = {R(color), G(color), B(color), 255};
+  int vertex_count = 0;
+  int index_count = 0;
+  int centre = push_vertex(&vertex_count, centre_x, centre_y, vertex_color);
+  for (int i = 0; i < segments; i++) {
+    push_vertex(&vertex_count, centre_x + radius * unit[i].x,
+                centre_y + radius * unit[i].y, vertex_color);
+  }
+  for (int i = 0; i < segments; i++) {
+    push_triangle(&index_count, centre, 1 + i, 1 + (i + 1) % segments);
+  }
+
+  submit_geometry(graphics_context, vertex_count, geometry_indices,
+                  index_count);
+}
+
+void draw_ring(const graphics_context_ptr graphics_context, float centre_x,
+               float centre_y, float inner_radius, float outer_radius,
+               color_t color) {
+  if (outer_radius <= 0.0f || inner_radius >= outer_radius) {
+    return;
+  }
+  if (inner_radius < 0.0f) {
+    inner_radius = 0.0f;
+  }
+
+  int segments = circle_segments(outer_radius);
+  const SDL_FPoint* unit = circle_table(segments);
+  if (!reserve_geometry_buffers(segments * 2, segments * 6)) {
+    return;
+  }
+
+  // Outer and inner rims interleaved: vertex 2i is outer, 2i + 1 inner
+  SDL_Color vertex_color = {R(color), G(color), B(color), 255};
+  int vertex_count = 0;
+  int index_count = 0;
+  for (int i = 0; i < segments; i++) {
+    push_vertex(&vertex_count, centre_x + outer_radius * unit[i].x,
+                centre_y + outer_radius * unit[i].y, vertex_color);
+    push_vertex(&vertex_count, centre_x + inner_radius * unit[i].x,
+                centre_y + inner_radius * unit[i].y, vertex_color);
+  }
+  for (int i = 0; i < segments; i++) {
+    int next = (i + 1) % segments;
+    push_triangle(&index_count, 2 * i, 2 * next, 2 * next + 1);
+    push_triangle(&index_count, 2 * i, 2 * next + 1, 2 * i + 1);
+  }
+
+  submit_geometry(graphics_context, vertex_count, geometry_indices,
+                  index_count);
+}
+
+void draw_arc(const graphics_context_ptr graphics_context, float centre_x,
+              float centre_y, float radius, float start_angle, float end_angle,
+              float thickness, color_t color) {
+  float sweep = end_angle - start_angle;
+  if (radius <= 0.0f || thickness <= 0.0f || sweep == 0.0f) {
+    return;
+  }
+  if (fabsf(sweep) > 2.0f * (float)M_PI) {
+    sweep = sweep > 0.0f ? 2.0f * (float)M_PI : -2.0f * (float)M_PI;
+  }
+
+  float outer_radius = radius + thickness * 0.5f;
+  float inner_radius = radius - thickness * 0.5f;
+  if (inner_radius < 0.0f) {
+    inner_radius = 0.0f;
+  }
+
+  // Same chord length as the full circle, at least one segment
+  int steps = (int)ceilf(circle_segments(outer_radius) * fabsf(sweep) /
+                         (2.0f * (float)M_PI));
+  if (steps < 1) {
+    steps = 1;
+  }
+  if (!reserve_geometry_buffers((steps + 1) * 2, steps * 6)) {
+    return;
+  }
+
+  SDL_Color vertex_color = {R(color), G(color), B(color), 255};
+  int vertex_count = 0;
+  int index_count = 0;
+  for (int i = 0; i <= steps; i++) {
+    float angle = start_angle + sweep * i / steps;
+    float c = cosf(angle);
+    float s = sinf(angle);
+    push_vertex(&vertex_count, centre_x + outer_radius * c,
+                centre_y + outer_radius * s, vertex_color);
+    push_vertex(&vertex_count, centre_x + inner_radius * c,
+                centre_y + inner_radius * s, vertex_color);
+  }
+  for (int i = 0; i < steps; i++) {
+    push_triangle(&index_count, 2 * i, 2 * i + 2, 2 * i + 3);
+    push_triangle(&index_count, 2 * i, 2 * i + 3, 2 * i + 1);
+  }
+
+  submit_geometry(graphics_context, vertex_count, geometry_indices,
+                  index_count);
+}
+
+// Fill the vertex buffer with one solid-colored vertex per polygon corner
+static void push_polygon_vertices(const SDL_FPoint* points, int num_points,
+                                  color_t color) {
+  SDL_Color vertex_color = {R(color), G(color), B(color), 255};
+  int vertex_count = 0;
+  for (int i = 0; i < num_points; i++) {
+    push_vertex(&vertex_count, points[i].x, points[i].y, vertex_color);
+  }
 }
 
 void draw_filled_polygon(const graphics_context_ptr graphics_context,
@@ -101,39 +474,55 @@ void draw_filled_polygon(const graphics_context_ptr graphics_context,
                          color_t fill_color) {
   if (num_points < 3) return;  // Need at least 3 points for a polygon
 
-  // Calculate center point for triangle fan
-  int center_x = 0, center_y = 0;
-  for (int i = 0; i < num_points; i++) {
-    center_x += points[i].x;
-    center_y += points[i].y;
+  if (!reserve_geometry_buffers(num_points, 0)) {
+    return;
   }
-  center_x /= num_points;
-  center_y /= num_points;
+  SDL_FPoint* grown = grow_array(polygon_points, &polygon_point_capacity,
+                                 num_points, sizeof(SDL_FPoint));
+  if (!grown) {
+    return;
+  }
+  polygon_points = grown;
 
-  // Draw triangle fan from center to each edge with solid fill color
   for (int i = 0; i < num_points; i++) {
-    int next = (i + 1) % num_points;
+    polygon_points[i].x = (float)points[i].x;
+    polygon_points[i].y = (float)points[i].y;
+  }
+
+  // Ear clipping handles concave shapes; the result is cached per shape
+  int index_count;
+  const int* indices =
+      cached_polygon_triangulation(polygon_points, num_points, &index_count);
+  if (!indices) {
+    return;
+  }
+
+  push_polygon_vertices(polygon_points, num_points, fill_color);
+  submit_geometry(graphics_context, num_points, indices, index_count);
+}
 
-    // Create triangle vertices with solid fill color
-    SDL_Vertex vertices[3] = {
-        {{center_x, center_y},
-         {R(fill_color), G(fill_color), B(fill_color), 255},
-         {0, 0}},
-        {{points[i].x, points[i].y},
-         {R(fill_color), G(fill_color), B(fill_color), 255},
-         {0, 0}},
-        {{points[next].x, points[next].y},
-         {R(fill_color), G(fill_color), B(fill_color), 255},
-         {0, 0}}};
+void draw_polygon_mesh(const graphics_context_ptr graphics_context,
+                       const polygon_mesh_ptr mesh, const SDL_FPoint* points,
+                       color_t fill_color) {
+  if (!mesh || !mesh->indices || mesh->index_count == 0) {
+    return;
+  }
 
-    SDL_RenderGeometry(graphics_context->renderer, NULL, vertices, 3, NULL, 0);
+  if (!reserve_geometry_buffers(mesh->vertex_count, 0)) {
+    return;
   }
+
+  push_polygon_vertices(points, mesh->vertex_count, fill_color);
+  submit_geometry(graphics_context, mesh->vertex_count, mesh->indices,
+                  mesh->index_count);
 }
 
 void draw_filled_rect(const graphics_context_ptr graphics_context,
                       int x, int y, int width, int height, color_t color) {
-  SDL_SetRenderDrawColor(graphics_context->renderer, R(color), G(color),
-                         B(color), 255);
+  if (batch_filled_rect(graphics_context, x, y, width, height, color)) {
+    return;
+  }
+  apply_draw_color(graphics_context, R(color), G(color), B(color), 255);
   SDL_Rect rect = {x, y, width, height};
   SDL_RenderFillRect(graphics_context->renderer, &rect);
 }
@@ -141,26 +530,41 @@ void draw_filled_rect(const graphics_context_ptr graphics_context,
 void draw_filled_rect_alpha(const graphics_context_ptr graphics_context,
                             int x, int y, int width, int height,
                             color_t color, uint8_t alpha) {
-  SDL_SetRenderDrawBlendMode(graphics_context->renderer, SDL_BLENDMODE_BLEND);
-  SDL_SetRenderDrawColor(graphics_context->renderer, R(color), G(color),
-                         B(color), alpha);
+  flush_primitive_batch(graphics_context);
+  if (graphics_context->cpu_renderer) {
+    SDL_Rect rect = {x, y, width, height};
+    cpu_blend_rect(graphics_context->cpu_renderer, &rect,
+                   CPU_COLOR(color, alpha));
+    return;
+  }
+
+  // Blending stays on afterwards: every other primitive is drawn opaque, so
+  // it does not change their output and runs of alpha rects skip the toggle
+  apply_draw_blend_mode(graphics_context, SDL_BLENDMODE_BLEND);
+  apply_draw_color(graphics_context, R(color), G(color), B(color), alpha);
   SDL_Rect rect = {x, y, width, height};
   SDL_RenderFillRect(graphics_context->renderer, &rect);
-  SDL_SetRenderDrawBlendMode(graphics_context->renderer, SDL_BLENDMODE_NONE);
 }
 
 void set_render_draw_color_alpha(const graphics_context_ptr graphics_context,
                                  color_t color, uint8_t alpha) {
-  SDL_SetRenderDrawColor(graphics_context->renderer, R(color), G(color),
-                         B(color), alpha);
+  flush_primitive_batch(graphics_context);
+  apply_draw_color(graphics_context, R(color), G(color), B(color), alpha);
 }
 
 void clear_screen(const graphics_context_ptr graphics_context, color_t color) {
-  SDL_SetRenderDrawColor(graphics_context->renderer, R(color), G(color),
-                         B(color), 255);
+  flush_primitive_batch(graphics_context);
+  if (graphics_context->cpu_renderer) {
+    cpu_clear(graphics_context->cpu_renderer, CPU_COLOR(color, 255));
+    return;
+  }
+  apply_draw_color(graphics_context, R(color), G(color), B(color), 255);
   SDL_RenderClear(graphics_context->renderer);
 }
 
 void present_frame(const graphics_context_ptr graphics_context) {
+  flush_primitive_batch(graphics_context);
+  cpu_present(graphics_context->cpu_renderer);
   SDL_RenderPresent(graphics_context->renderer);
+  graphics_context->frame_count++;
 }
@@ -11,11 +11,13 @@
 #define CORE_GRAPHICS_DRAWING_PRIMITIVES_H_
 
 #include <SDL.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "color.h"
 #include "geometry.h"
 #include "graphics_context.h"
+#include "polygon_mesh.h"
 
 /**
  * @brief Draw a line between two coordinate points
@@ -30,7 +32,7 @@ void draw_line(const graphics_context_ptr graphics_context, int x1, int y1,
                int x2, int y2, color_t color);
 
 /**
- * @brief Draw a thick line with enhanced visibility
+ * @brief Draw a three pixel wide line as a single quad
  * @param graphics_context Graphics context containing renderer
  * @param x1 Starting x coordinate
  * @param y1 Starting y coordinate
@@ -41,6 +43,36 @@ void draw_line(const graphics_context_ptr graphics_context, int x1, int y1,
 void draw_thick_line(const graphics_context_ptr graphics_context, int x1,
                      int y1, int x2, int y2, color_t color);
 
+/**
+ * @brief Draw one-pixel lines through a list of points
+ * @param graphics_context Graphics context containing renderer
+ * @param points Polyline vertices
+ * @param num_points Number of vertices
+ * @param closed Connect the last vertex back to the first
+ * @param color Line color
+ */
+void draw_polyline(const graphics_context_ptr graphics_context,
+                   const SDL_FPoint* points, int num_points, bool closed,
+                   color_t color);
+
+/**
+ * @brief Draw a polyline of arbitrary width as one triangle strip
+ *
+ * Segments are expanded into quads on the CPU, joined with miters (beveled
+ * when too sharp) and capped square at open ends, then submitted together
+ * in one SDL_RenderGeometry call.
+ *
+ * @param graphics_context Graphics context containing renderer
+ * @param points Polyline vertices
+ * @param num_points Number of vertices
+ * @param thickness Line width in pixels
+ * @param closed Connect the last vertex back to the first
+ * @param color Line color
+ */
+void draw_thick_polyline(const graphics_context_ptr graphics_context,
+                         const SDL_FPoint* points, int num_points,
+                         float thickness, bool closed, color_t color);
+
 /**
  * @brief Draw a line between two point structures
  * @param graphics_context Graphics context containing renderer
@@ -81,7 +113,11 @@ void draw_fat_pixel(const graphics_context_ptr graphics_context,
                     const point_ptr p, color_t color);
 
 /**
- * @brief Draw a circle using optimized point rendering
+ * @brief Draw a circle outline as a connected line loop
+ *
+ * The segment count grows with the radius so that no chord strays more than
+ * a quarter pixel from the true circle.
+ *
  * @param graphics_context Graphics context containing renderer
  * @param centreX Circle center x coordinate
  * @param centreY Circle center y coordinate
@@ -92,7 +128,52 @@ void draw_circle(const graphics_context_ptr graphics_context, int32_t centreX,
                  int32_t centreY, int32_t radius, color_t color);
 
 /**
- * @brief Draw a filled polygon using triangle fan approach
+ * @brief Draw a filled circle as a batched triangle fan
+ * @param graphics_context Graphics context containing renderer
+ * @param centre_x Circle center x coordinate
+ * @param centre_y Circle center y coordinate
+ * @param radius Circle radius
+ * @param color Fill color
+ */
+void draw_filled_circle(const graphics_context_ptr graphics_context,
+                        float centre_x, float centre_y, float radius,
+                        color_t color);
+
+/**
+ * @brief Draw a filled ring (annulus) as batched geometry
+ * @param graphics_context Graphics context containing renderer
+ * @param centre_x Ring center x coordinate
+ * @param centre_y Ring center y coordinate
+ * @param inner_radius Radius of the hole
+ * @param outer_radius Outer radius
+ * @param color Fill color
+ */
+void draw_ring(const graphics_context_ptr graphics_context, float centre_x,
+               float centre_y, float inner_radius, float outer_radius,
+               color_t color);
+
+/**
+ * @brief Draw a circular arc of given thickness as batched geometry
+ * @param graphics_context Graphics context containing renderer
+ * @param centre_x Arc center x coordinate
+ * @param centre_y Arc center y coordinate
+ * @param radius Radius of the arc centerline
+ * @param start_angle Start angle in radians
+ * @param end_angle End angle in radians
+ * @param thickness Arc width in pixels
+ * @param color Arc color
+ */
+void draw_arc(const graphics_context_ptr graphics_context, float centre_x,
+              float centre_y, float radius, float start_angle, float end_angle,
+              float thickness, color_t color);
+
+/**
+ * @brief Draw a filled convex or concave polygon in one submission
+ *
+ * The polygon is ear-clip triangulated (cached per shape, see
+ * polygon_mesh.h) and queued as indexed geometry, so every filled polygon
+ * of a frame reaches the renderer in a single SDL_RenderGeometry call.
+ *
  * @param graphics_context Graphics context containing renderer
  * @param points Array of polygon vertices
  * @param num_points Number of vertices in polygon
@@ -102,11 +183,24 @@ void draw_filled_polygon(const graphics_context_ptr graphics_context,
                          const SDL_Point* points, int num_points,
                          color_t fill_color);
 
+/**
+ * @brief Draw a pre-triangulated polygon mesh
+ * @param graphics_context Graphics context containing renderer
+ * @param mesh Mesh created with create_polygon_mesh()
+ * @param points Current vertices of the shape (mesh->vertex_count of them),
+ *        e.g. the local shape rotated and moved into place
+ * @param fill_color Fill color for polygon
+ */
+void draw_polygon_mesh(const graphics_context_ptr graphics_context,
+                       const polygon_mesh_ptr mesh, const SDL_FPoint* points,
+                       color_t fill_color);
+
 /**
  * @brief Initialize circle drawing lookup tables for performance
  *
- * Must be called before using draw_circle() function. Creates pre-calculated
- * sin/cos lookup table for smooth circle rendering.
+ * Precomputes the unit circle for every supported segment count so that
+ * circle drawing never computes sin/cos during a frame. Tables are also
+ * built on first use if this is not called.
  */
 void init_circle_lookup(void);
 
@@ -154,6 +248,10 @@ void clear_screen(const graphics_context_ptr graphics_context, color_t color);
 
 /**
  * @brief Present the rendered frame to the screen
+ *
+ * Also advances graphics_context->frame_count, which caches use to tell
+ * which resources the current frame may still reference.
+ *
  * @param graphics_context Graphics context containing renderer
  */
 void present_frame(const graphics_context_ptr graphics_context);
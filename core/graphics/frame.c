@@ -1,14 +1,95 @@
 #include "frame.h"
 
 #include <SDL.h>
+#include <string.h>
 
+#include "cpu_renderer.h"
+#include "drawing_primitives.h"
 #include "inline.h"
+#include "logger.h"
+#include "primitive_batch.h"
+#include "render_state.h"
 
 ALWAYS_INLINE void clear_frame(const graphics_context_ptr graphics_context) {
-  SDL_SetRenderDrawColor(graphics_context->renderer, 0, 0, 0, 255);
+  flush_primitive_batch(graphics_context);
+  if (graphics_context->cpu_renderer) {
+    cpu_clear(graphics_context->cpu_renderer, CPU_COLOR(0, 255));
+    return;
+  }
+  apply_draw_color(graphics_context, 0, 0, 0, 255);
   SDL_RenderClear(graphics_context->renderer);
 }
 
 ALWAYS_INLINE void render_frame(const graphics_context_ptr graphics_context) {
-  SDL_RenderPresent(graphics_context->renderer);
+  present_frame(graphics_context);
+}
+
+SDL_Surface* read_frame(const graphics_context_ptr graphics_context) {
+  flush_primitive_batch(graphics_context);
+  cpu_renderer_ptr cpu = graphics_context->cpu_renderer;
+
+  int width, height;
+  if (cpu) {
+    width = cpu->width;
+    height = cpu->height;
+  } else if (SDL_GetRendererOutputSize(graphics_context->renderer, &width,
+                                       &height) != 0) {
+    LOG_SDL_ERROR("SDL_GetRendererOutputSize");
+    return NULL;
+  }
+
+  SDL_Surface* frame = SDL_CreateRGBSurfaceWithFormat(
+      0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+  if (!frame) {
+    LOG_SDL_ERROR("SDL_CreateRGBSurfaceWithFormat");
+    return NULL;
+  }
+
+  if (cpu) {
+    flush_cpu_renderer(cpu);
+    for (int y = 0; y < height; y++) {
+      memcpy((Uint8*)frame->pixels + (size_t)y * frame->pitch,
+             cpu->pixels + (size_t)y * cpu->pitch,
+             sizeof(uint32_t) * (size_t)width);
+    }
+  } else if (SDL_RenderReadPixels(graphics_context->renderer, NULL,
+                                  SDL_PIXELFORMAT_ARGB8888, frame->pixels,
+                                  frame->pitch) != 0) {
+    LOG_SDL_ERROR("SDL_RenderReadPixels");
+    SDL_FreeSurface(frame);
+    return NULL;
+  }
+  return frame;
+}
+
+void set_dirty_rect_tracking(const graphics_context_ptr graphics_context,
+                             bool enabled) {
+  if (!graphics_context->cpu_renderer) {
+    if (enabled) {
+      LOG_WARN("Dirty-rect tracking needs the CPU backend; ignoring");
+    }
+    return;
+  }
+  flush_primitive_batch(graphics_context);
+  set_cpu_dirty_tracking(graphics_context->cpu_renderer, enabled);
+}
+
+void set_dirty_rect_debug_view(const graphics_context_ptr graphics_context,
+                               bool enabled) {
+  set_cpu_dirty_debug_view(graphics_context->cpu_renderer, enabled);
+}
+
+void invalidate_dirty_rects(const graphics_context_ptr graphics_context) {
+  invalidate_cpu_frame(graphics_context->cpu_renderer);
+}
+
+const SDL_Rect* get_dirty_rects(const graphics_context_ptr graphics_context,
+                                int* count) {
+  cpu_renderer_ptr cpu = graphics_context->cpu_renderer;
+  if (!cpu || !cpu->dirty_tracking) {
+    *count = 0;
+    return NULL;
+  }
+  *count = cpu->dirty_rect_count;
+  return cpu->dirty_rects;
 }
@@ -5,6 +5,12 @@
  * Provides functions for clearing the frame buffer and presenting
  * rendered frames to the display. Handles double-buffering operations
  * and screen refresh.
+ *
+ * With the CPU backend, dirty-rectangle tracking can limit each frame to the
+ * screen tiles whose draw calls changed since the previous frame: only
+ * those are cleared, rasterized and uploaded. The SDL backend always
+ * presents whole frames, since SDL leaves the back buffer undefined after
+ * SDL_RenderPresent().
  */
 
 #ifndef CORE_GRAPHICS_FRAME_H_
@@ -16,4 +22,51 @@
 void clear_frame(const graphics_context_ptr graphics_context);
 void render_frame(const graphics_context_ptr graphics_context);
 
+/**
+ * @brief Copy the current frame into a new surface
+ *
+ * Flushes pending draw calls first. Call after drawing and before
+ * render_frame(); headless contexts can also be read after presenting,
+ * since their canvas survives SDL_RenderPresent().
+ *
+ * @param graphics_context Graphics context
+ * @return ARGB8888 surface (free with SDL_FreeSurface), or NULL on failure
+ */
+SDL_Surface* read_frame(const graphics_context_ptr graphics_context);
+
+/**
+ * @brief Enable or disable dirty-rectangle tracking (CPU backend only)
+ * @param graphics_context Graphics context
+ * @param enabled true to redraw only the regions that changed
+ */
+void set_dirty_rect_tracking(const graphics_context_ptr graphics_context,
+                             bool enabled);
+
+/**
+ * @brief Outline the regions redrawn by each frame
+ * @param graphics_context Graphics context
+ * @param enabled true to draw the debug outlines
+ */
+void set_dirty_rect_debug_view(const graphics_context_ptr graphics_context,
+                               bool enabled);
+
+/**
+ * @brief Force the next frame to be redrawn completely
+ *
+ * Needed after changing the pixels of a loaded texture in place, which
+ * dirty tracking cannot see.
+ *
+ * @param graphics_context Graphics context
+ */
+void invalidate_dirty_rects(const graphics_context_ptr graphics_context);
+
+/**
+ * @brief Get the regions redrawn by the last presented frame
+ * @param graphics_context Graphics context
+ * @param count Output number of rectangles (0 when tracking is off)
+ * @return Rectangles in framebuffer pixels, valid until the next frame
+ */
+const SDL_Rect* get_dirty_rects(const graphics_context_ptr graphics_context,
+                                int* count);
+
 #endif  // CORE_GRAPHICS_FRAME_H_
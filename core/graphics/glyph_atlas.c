@@ -0,0 +1,625 @@
+/**
+ * @file glyph_atlas.c
+ * @brief Implementation of the shared TTF glyph atlas
+ */
+
+#include "glyph_atlas.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu_renderer.h"
+#include "dynamic_array.h"
+#include "logger.h"
+
+// Transparent border right of and below each glyph, so filtering at scaled
+// sizes never picks up a neighbour
+#define GLYPH_PADDING 1
+#define TRANSPARENT_WHITE 0x00FFFFFFu
+#define KERNING_UNKNOWN SCHAR_MIN
+
+static void push_back(glyph_font_ptr* head, glyph_font_ptr* tail,
+                      glyph_font_ptr font) {
+  font->next = NULL;
+  if (*tail) {
+    (*tail)->next = font;
+  } else {
+    *head = font;
+  }
+  *tail = font;
+}
+
+static glyph_font_ptr pop_front(glyph_font_ptr* head, glyph_font_ptr* tail) {
+  glyph_font_ptr font = *head;
+  if (font) {
+    *head = font->next;
+    if (!*head) {
+      *tail = NULL;
+    }
+    font->next = NULL;
+  }
+  return font;
+}
+
+static bool remove_item(glyph_font_ptr* head, glyph_font_ptr* tail,
+                        glyph_font_ptr font) {
+  glyph_font_ptr previous = NULL;
+  for (glyph_font_ptr it = *head; it; previous = it, it = it->next) {
+    if (it != font) {
+      continue;
+    }
+    if (previous) {
+      previous->next = font->next;
+    } else {
+      *head = font->next;
+    }
+    if (*tail == font) {
+      *tail = previous;
+    }
+    font->next = NULL;
+    return true;
+  }
+  return false;
+}
+
+// Closes the private TTF font, so it only runs on the calling thread, never
+// on the worker
+static void free_glyph_font(glyph_font_ptr font) {
+  free_ttf_font(font->font);
+  if (font->pending) {
+    for (int i = 0; i < GLYPH_ATLAS_GLYPH_COUNT; i++) {
+      SDL_FreeSurface(font->pending[i]);
+    }
+    free(font->pending);
+  }
+  free(font);
+}
+
+static inline int glyph_index(unsigned char c) {
+  if (c < GLYPH_ATLAS_FIRST_CHAR ||
+      c >= GLYPH_ATLAS_FIRST_CHAR + GLYPH_ATLAS_GLYPH_COUNT) {
+    c = '?';
+  }
+  return c - GLYPH_ATLAS_FIRST_CHAR;
+}
+
+// Render one glyph in white and crop it to its ink. Fills in the glyph's
+// advance and offsets; returns NULL for blank or unrenderable glyphs. Runs
+// on the worker thread for asynchronous loads, so it touches only `font`,
+// whose TTF font no other code holds.
+static SDL_Surface* rasterize_glyph(const glyph_font_t* font, int index,
+                                    atlas_glyph_t* glyph) {
+  Uint16 c = (Uint16)(GLYPH_ATLAS_FIRST_CHAR + index);
+  int min_x, max_x, min_y, max_y, advance;
+  if (TTF_GlyphMetrics(font->font, c, &min_x, &max_x, &min_y, &max_y,
+                       &advance) != 0) {
+    return NULL;
+  }
+  glyph->advance = (short)advance;
+
+  SDL_Color white = {255, 255, 255, 255};
+  SDL_Surface* rendered = TTF_RenderGlyph_Blended(font->font, c, white);
+  if (!rendered) {
+    return NULL;
+  }
+  SDL_Surface* surface = rendered;
+  if (rendered->format->format != SDL_PIXELFORMAT_ARGB8888) {
+    surface = SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(rendered);
+    if (!surface) {
+      return NULL;
+    }
+  }
+
+  int left = surface->w, right = -1, top = surface->h, bottom = -1;
+  for (int y = 0; y < surface->h; y++) {
+    const uint32_t* row =
+        (const uint32_t*)((const uint8_t*)surface->pixels +
+                          (size_t)y * surface->pitch);
+    for (int x = 0; x < surface->w; x++) {
+      if (row[x] >> 24) {
+        left = x < left ? x : left;
+        right = x > right ? x : right;
+        top = y < top ? y : top;
+        bottom = y;
+      }
+    }
+  }
+  if (right < 0) {
+    SDL_FreeSurface(surface);
+    return NULL;
+  }
+
+  // Newer SDL_ttf renders a glyph like a one-letter string, a full line tall
+  // with the pen at -min(0, min_x); older versions return just the bitmap
+  if (surface->h == font->height) {
+    glyph->offset_x = (short)(left + (min_x < 0 ? min_x : 0));
+    glyph->offset_y = (short)top;
+  } else {
+    glyph->offset_x = (short)(min_x + left);
+    glyph->offset_y = (short)(font->ascent - max_y + top);
+  }
+
+  int width = right - left + 1;
+  int height = bottom - top + 1;
+  SDL_Surface* ink = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32,
+                                                    SDL_PIXELFORMAT_ARGB8888);
+  if (ink) {
+    for (int y = 0; y < height; y++) {
+      memcpy((uint8_t*)ink->pixels + (size_t)y * ink->pitch,
+             (const uint8_t*)surface->pixels +
+                 (size_t)(top + y) * surface->pitch + (size_t)left * 4,
+             (size_t)width * 4);
+    }
+  }
+  SDL_FreeSurface(surface);
+  return ink;
+}
+
+// Kerning of a glyph pair, clamped clear of KERNING_UNKNOWN
+static signed char query_kerning(ttf_font_t font, int previous, int current) {
+  int kerning = TTF_GetFontKerningSizeGlyphs(
+      font, (Uint16)(GLYPH_ATLAS_FIRST_CHAR + previous),
+      (Uint16)(GLYPH_ATLAS_FIRST_CHAR + current));
+  kerning = kerning < SCHAR_MIN + 1 ? SCHAR_MIN + 1 : kerning;
+  return (signed char)(kerning > SCHAR_MAX ? SCHAR_MAX : kerning);
+}
+
+static int rasterize_thread(void* data) {
+  glyph_atlas_ptr atlas = data;
+  SDL_LockMutex(atlas->mutex);
+  while (true) {
+    while (!atlas->load_head && !atlas->shutting_down) {
+      SDL_CondWait(atlas->work_ready, atlas->mutex);
+    }
+    if (atlas->shutting_down) {
+      break;
+    }
+
+    glyph_font_ptr font = pop_front(&atlas->load_head, &atlas->load_tail);
+    SDL_UnlockMutex(atlas->mutex);
+
+    for (int i = 0; i < GLYPH_ATLAS_GLYPH_COUNT; i++) {
+      font->pending[i] = rasterize_glyph(font, i, &font->glyphs[i]);
+    }
+    if (font->kerning_enabled) {
+      for (int i = 0; i < GLYPH_ATLAS_GLYPH_COUNT; i++) {
+        for (int j = 0; j < GLYPH_ATLAS_GLYPH_COUNT; j++) {
+          font->kerning[i * GLYPH_ATLAS_GLYPH_COUNT + j] =
+              query_kerning(font->font, i, j);
+        }
+      }
+    }
+
+    // Released fonts are queued too; update_glyph_atlas() frees them
+    SDL_LockMutex(atlas->mutex);
+    font->state = GLYPH_FONT_LOADED;
+    push_back(&atlas->upload_head, &atlas->upload_tail, font);
+  }
+  SDL_UnlockMutex(atlas->mutex);
+  return 0;
+}
+
+// Reserve space on the shelf wasting the least height, opening a new shelf
+// when none fits or the best one is over twice as tall as the glyph
+static bool allocate_glyph_rect(glyph_atlas_ptr atlas, int width, int height,
+                                SDL_Rect* placed) {
+  int best = -1;
+  for (int i = 0; i < atlas->shelf_count; i++) {
+    const glyph_shelf_t* shelf = &atlas->shelves[i];
+    if (shelf->height >= height &&
+        shelf->used_width + width <= atlas->texture.width &&
+        (best < 0 || shelf->height < atlas->shelves[best].height)) {
+      best = i;
+    }
+  }
+
+  int bottom = atlas->stats.used_height;
+  bool can_open = width <= atlas->texture.width &&
+                  bottom + height <= atlas->texture.height;
+  if (can_open && (best < 0 || atlas->shelves[best].height > 2 * height)) {
+    glyph_shelf_t* shelves =
+        grow_array(atlas->shelves, &atlas->shelf_capacity,
+                   atlas->shelf_count + 1, sizeof(glyph_shelf_t));
+    if (shelves) {
+      atlas->shelves = shelves;
+      best = atlas->shelf_count++;
+      atlas->shelves[best].y = bottom;
+      atlas->shelves[best].height = height;
+      atlas->shelves[best].used_width = 0;
+      atlas->stats.shelves = atlas->shelf_count;
+      atlas->stats.used_height = bottom + height;
+    }
+  }
+  if (best < 0) {
+    return false;
+  }
+
+  glyph_shelf_t* shelf = &atlas->shelves[best];
+  placed->x = shelf->used_width;
+  placed->y = shelf->y;
+  placed->w = width;
+  placed->h = height;
+  shelf->used_width += width;
+  return true;
+}
+
+// Copy a padded glyph into the CPU backend's mirror of the atlas
+static void update_cpu_mirror(glyph_atlas_ptr atlas, const SDL_Rect* rect) {
+  SDL_Surface* mirror = atlas->texture.surface;
+  for (int y = 0; y < rect->h; y++) {
+    memcpy((uint8_t*)mirror->pixels + (size_t)(rect->y + y) * mirror->pitch +
+               (size_t)rect->x * 4,
+           atlas->upload_pixels + (size_t)y * rect->w, (size_t)rect->w * 4);
+  }
+}
+
+// Blank ARGB8888 mirror on the CPU backend's blending path, which the
+// antialiased glyph edges need. create_cpu_surface() only picks that path
+// for surfaces it sees translucent pixels in, so it is shown one.
+static SDL_Surface* create_cpu_mirror(int width, int height) {
+  SDL_Surface* blank = SDL_CreateRGBSurfaceWithFormat(
+      0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+  if (!blank) {
+    return NULL;
+  }
+  *(uint32_t*)blank->pixels = 0x80FFFFFFu;
+  SDL_Surface* mirror = create_cpu_surface(blank);
+  SDL_FreeSurface(blank);
+  if (mirror) {
+    *(uint32_t*)mirror->pixels = 0;
+  }
+  return mirror;
+}
+
+// Upload a rasterized glyph and mark it ready; `ink` is consumed
+static void place_glyph(glyph_atlas_ptr atlas, atlas_glyph_t* glyph,
+                        SDL_Surface* ink) {
+  glyph->ready = true;
+  SDL_Rect empty = {0, 0, 0, 0};
+  glyph->rect = empty;
+  if (!ink) {
+    return;
+  }
+
+  SDL_Rect padded;
+  if (!allocate_glyph_rect(atlas, ink->w + GLYPH_PADDING,
+                           ink->h + GLYPH_PADDING, &padded)) {
+    if (atlas->stats.dropped++ == 0) {
+      LOG_WARN_FMT("Glyph atlas is full (%dx%d), skipping new glyphs",
+                   atlas->texture.width, atlas->texture.height);
+    }
+    SDL_FreeSurface(ink);
+    return;
+  }
+
+  uint32_t* pixels = grow_array(atlas->upload_pixels, &atlas->upload_capacity,
+                                padded.w * padded.h, sizeof(uint32_t));
+  if (!pixels) {
+    LOG_ERROR("Failed to allocate glyph upload buffer");
+    SDL_FreeSurface(ink);
+    return;
+  }
+  atlas->upload_pixels = pixels;
+  for (int i = 0; i < padded.w * padded.h; i++) {
+    pixels[i] = TRANSPARENT_WHITE;
+  }
+  for (int y = 0; y < ink->h; y++) {
+    memcpy(pixels + (size_t)y * padded.w,
+           (const uint8_t*)ink->pixels + (size_t)y * ink->pitch,
+           (size_t)ink->w * 4);
+  }
+
+  if (SDL_UpdateTexture(atlas->texture.texture, &padded, pixels,
+                        padded.w * 4) != 0) {
+    LOG_SDL_ERROR("SDL_UpdateTexture");
+  } else {
+    if (atlas->texture.surface) {
+      update_cpu_mirror(atlas, &padded);
+    }
+    glyph->rect.x = padded.x;
+    glyph->rect.y = padded.y;
+    glyph->rect.w = ink->w;
+    glyph->rect.h = ink->h;
+    atlas->stats.glyphs++;
+  }
+  SDL_FreeSurface(ink);
+}
+
+static const atlas_glyph_t* ensure_glyph(glyph_font_ptr font, int index) {
+  atlas_glyph_t* glyph = &font->glyphs[index];
+  if (!glyph->ready) {
+    place_glyph(font->atlas, glyph, rasterize_glyph(font, index, glyph));
+  }
+  return glyph;
+}
+
+static int kerning_between(glyph_font_ptr font, int previous, int current) {
+  if (!font->kerning_enabled || previous < 0) {
+    return 0;
+  }
+  signed char* kerning =
+      &font->kerning[previous * GLYPH_ATLAS_GLYPH_COUNT + current];
+  if (*kerning == KERNING_UNKNOWN) {
+    *kerning = query_kerning(font->font, previous, current);
+  }
+  return *kerning;
+}
+
+glyph_atlas_ptr create_glyph_atlas(SDL_Renderer* renderer, int width,
+                                   int height) {
+  if (!renderer || width <= 0 || height <= 0) {
+    return NULL;
+  }
+
+  glyph_atlas_ptr atlas = calloc(1, sizeof(glyph_atlas_t));
+  if (!atlas) {
+    LOG_ERROR("Failed to allocate glyph atlas");
+    return NULL;
+  }
+  atlas->renderer = renderer;
+  atlas->mutex = SDL_CreateMutex();
+  atlas->work_ready = SDL_CreateCond();
+  atlas->texture.texture =
+      SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                        SDL_TEXTUREACCESS_STATIC, width, height);
+  if (!atlas->mutex || !atlas->work_ready || !atlas->texture.texture) {
+    LOG_ERROR_FMT("Failed to create glyph atlas: %s", SDL_GetError());
+    destroy_glyph_atlas(atlas);
+    return NULL;
+  }
+  SDL_SetTextureBlendMode(atlas->texture.texture, SDL_BLENDMODE_BLEND);
+  atlas->texture.width = width;
+  atlas->texture.height = height;
+  if (cpu_rendering_active()) {
+    atlas->texture.surface = create_cpu_mirror(width, height);
+    if (!atlas->texture.surface) {
+      LOG_ERROR("Failed to create glyph atlas surface");
+      destroy_glyph_atlas(atlas);
+      return NULL;
+    }
+  }
+  return atlas;
+}
+
+void destroy_glyph_atlas(glyph_atlas_ptr atlas) {
+  if (!atlas) {
+    return;
+  }
+
+  if (atlas->thread) {
+    SDL_LockMutex(atlas->mutex);
+    atlas->shutting_down = true;
+    SDL_CondSignal(atlas->work_ready);
+    SDL_UnlockMutex(atlas->mutex);
+    SDL_WaitThread(atlas->thread, NULL);
+  }
+
+  // The thread is gone, so every remaining font is on the font list or, once
+  // removed, still waiting for upload
+  while (atlas->upload_head) {
+    glyph_font_ptr font = pop_front(&atlas->upload_head, &atlas->upload_tail);
+    if (font->released) {
+      free_glyph_font(font);
+    }
+  }
+  while (atlas->fonts) {
+    glyph_font_ptr font = atlas->fonts;
+    atlas->fonts = font->next_font;
+    free_glyph_font(font);
+  }
+  if (atlas->texture.texture) {
+    free_texture(&atlas->texture);
+  } else {
+    SDL_FreeSurface(atlas->texture.surface);
+  }
+  free(atlas->shelves);
+  free(atlas->upload_pixels);
+  SDL_DestroyCond(atlas->work_ready);
+  SDL_DestroyMutex(atlas->mutex);
+  free(atlas);
+}
+
+glyph_font_ptr add_glyph_font(glyph_atlas_ptr atlas, const char* path,
+                              int point_size, bool rasterize_async) {
+  if (!atlas || !path) {
+    return NULL;
+  }
+
+  // A private font, so the worker never races other users of SDL_ttf
+  ttf_font_t font = load_ttf_font(path, point_size);
+  if (!font) {
+    return NULL;
+  }
+  glyph_font_ptr glyph_font = calloc(1, sizeof(glyph_font_t));
+  if (!glyph_font) {
+    LOG_ERROR("Failed to allocate glyph font");
+    free_ttf_font(font);
+    return NULL;
+  }
+  glyph_font->atlas = atlas;
+  glyph_font->font = font;
+  glyph_font->ascent = TTF_FontAscent(font);
+  glyph_font->height = TTF_FontHeight(font);
+  glyph_font->line_skip = TTF_FontLineSkip(font);
+  glyph_font->kerning_enabled = TTF_GetFontKerning(font) != 0;
+  memset(glyph_font->kerning, (unsigned char)KERNING_UNKNOWN,
+         sizeof(glyph_font->kerning));
+
+  if (rasterize_async && !atlas->thread) {
+    atlas->thread = SDL_CreateThread(rasterize_thread, "glyph_atlas", atlas);
+    if (!atlas->thread) {
+      LOG_SDL_ERROR("SDL_CreateThread");
+    }
+  }
+  if (rasterize_async && atlas->thread) {
+    glyph_font->pending =
+        calloc(GLYPH_ATLAS_GLYPH_COUNT, sizeof(SDL_Surface*));
+  }
+
+  glyph_font->next_font = atlas->fonts;
+  if (atlas->fonts) {
+    atlas->fonts->prev_font = glyph_font;
+  }
+  atlas->fonts = glyph_font;
+  atlas->stats.fonts++;
+
+  // Without a worker, glyphs are simply rasterized on demand
+  if (!glyph_font->pending) {
+    glyph_font->state = GLYPH_FONT_READY;
+    glyph_font->ready = true;
+    return glyph_font;
+  }
+  SDL_LockMutex(atlas->mutex);
+  glyph_font->state = GLYPH_FONT_LOADING;
+  push_back(&atlas->load_head, &atlas->load_tail, glyph_font);
+  SDL_CondSignal(atlas->work_ready);
+  SDL_UnlockMutex(atlas->mutex);
+  return glyph_font;
+}
+
+void remove_glyph_font(glyph_atlas_ptr atlas, glyph_font_ptr font) {
+  if (!atlas || !font) {
+    return;
+  }
+
+  if (font->prev_font) {
+    font->prev_font->next_font = font->next_font;
+  } else {
+    atlas->fonts = font->next_font;
+  }
+  if (font->next_font) {
+    font->next_font->prev_font = font->prev_font;
+  }
+  atlas->stats.fonts--;
+
+  SDL_LockMutex(atlas->mutex);
+  switch (font->state) {
+    case GLYPH_FONT_LOADING:
+      if (remove_item(&atlas->load_head, &atlas->load_tail, font)) {
+        free_glyph_font(font);
+      } else {
+        // Freed by update_glyph_atlas() once the worker is done
+        font->released = true;
+      }
+      break;
+    case GLYPH_FONT_LOADED:
+      remove_item(&atlas->upload_head, &atlas->upload_tail, font);
+      free_glyph_font(font);
+      break;
+    case GLYPH_FONT_READY:
+      free_glyph_font(font);
+      break;
+  }
+  SDL_UnlockMutex(atlas->mutex);
+}
+
+void update_glyph_atlas(glyph_atlas_ptr atlas) {
+  if (!atlas) {
+    return;
+  }
+
+  while (true) {
+    SDL_LockMutex(atlas->mutex);
+    glyph_font_ptr font = pop_front(&atlas->upload_head, &atlas->upload_tail);
+    if (font) {
+      font->state = GLYPH_FONT_READY;
+    }
+    SDL_UnlockMutex(atlas->mutex);
+    if (!font) {
+      break;
+    }
+    if (font->released) {
+      free_glyph_font(font);
+      continue;
+    }
+
+    for (int i = 0; i < GLYPH_ATLAS_GLYPH_COUNT; i++) {
+      place_glyph(atlas, &font->glyphs[i], font->pending[i]);
+    }
+    free(font->pending);
+    font->pending = NULL;
+    font->ready = true;
+  }
+}
+
+bool is_glyph_font_ready(const glyph_font_t* font) {
+  return font && font->ready;
+}
+
+bool measure_glyph_text(glyph_font_ptr font, const char* text, int* width,
+                        int* height) {
+  if (!is_glyph_font_ready(font) || !text) {
+    return false;
+  }
+
+  int widest = 0;
+  int line_width = 0;
+  int lines = 1;
+  int previous = -1;
+  for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+    if (*c == '\n') {
+      widest = line_width > widest ? line_width : widest;
+      line_width = 0;
+      lines++;
+      previous = -1;
+      continue;
+    }
+    int index = glyph_index(*c);
+    line_width += kerning_between(font, previous, index) +
+                  ensure_glyph(font, index)->advance;
+    previous = index;
+  }
+  widest = line_width > widest ? line_width : widest;
+
+  if (width) {
+    *width = widest;
+  }
+  if (height) {
+    *height = font->height + (lines - 1) * font->line_skip;
+  }
+  return true;
+}
+
+bool draw_glyph_text(const graphics_context_ptr graphics_context,
+                     glyph_font_ptr font, const char* text, int x, int y,
+                     SDL_Color color) {
+  if (!graphics_context || !is_glyph_font_ready(font) || !text) {
+    return false;
+  }
+
+  // Consecutive tinted quads of one texture are drawn as a single batch, or
+  // recorded in the render queue with their color
+  texture_ptr atlas_texture = &font->atlas->texture;
+  int pen_x = x;
+  int pen_y = y;
+  int previous = -1;
+  for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+    if (*c == '\n') {
+      pen_x = x;
+      pen_y += font->line_skip;
+      previous = -1;
+      continue;
+    }
+    int index = glyph_index(*c);
+    const atlas_glyph_t* glyph = ensure_glyph(font, index);
+    pen_x += kerning_between(font, previous, index);
+    if (glyph->rect.w > 0) {
+      rect_t src = {glyph->rect.x, glyph->rect.y, glyph->rect.w,
+                    glyph->rect.h};
+      frect_t dst = {(float)(pen_x + glyph->offset_x),
+                     (float)(pen_y + glyph->offset_y), (float)glyph->rect.w,
+                     (float)glyph->rect.h};
+      render_sprite_tinted(graphics_context, atlas_texture, &src, &dst, color);
+    }
+    pen_x += glyph->advance;
+    previous = index;
+  }
+  return true;
+}
+
+glyph_atlas_stats_t get_glyph_atlas_stats(const glyph_atlas_t* atlas) {
+  glyph_atlas_stats_t empty = {0};
+  return atlas ? atlas->stats : empty;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file glyph_atlas.h
+ * @brief Shared glyph atlas for TTF fonts with batched string drawing
+ *
+ * Instead of rasterizing whole strings, TTF fonts are rasterized one
+ * printable ASCII glyph at a time into a single atlas texture shared by
+ * every font. Glyphs are packed on shelves: rows as tall as the
+ * first glyph placed in them, filled left to right, which suits glyphs of a
+ * handful of heights better than a general rectangle packer. Glyphs are
+ * stored in white and colored per vertex, so one copy serves every color.
+ *
+ * draw_glyph_text() lays a string out with the cached advances and kerning
+ * of its font and draws it as consecutive quads of the atlas texture, which
+ * the primitive batch submits as one geometry call. With the CPU backend,
+ * glyphs are blitted one by one, tinted by the color as for
+ * render_sprite_tinted().
+ *
+ * Glyphs are rasterized on demand the first time they are drawn. A font of
+ * a new size can instead be rasterized up front on the atlas worker thread
+ * until update_glyph_atlas() uploads its glyphs. SDL_ttf does not lock
+ * fonts, so each glyph font opens a private TTF_Font that no other code
+ * can reach, and fonts are only ever opened and closed on the calling
+ * thread.
+ *
+ * Atlas space is never reclaimed; glyphs that no longer fit are skipped.
+ */
+
+#ifndef CORE_GRAPHICS_GLYPH_ATLAS_H_
+#define CORE_GRAPHICS_GLYPH_ATLAS_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "graphics_context.h"
+#include "texture.h"
+#include "ttf_text.h"
+
+// Printable ASCII; other bytes are drawn as '?'
+#define GLYPH_ATLAS_FIRST_CHAR 32
+#define GLYPH_ATLAS_GLYPH_COUNT 95
+
+#define GLYPH_ATLAS_DEFAULT_SIZE 1024
+
+typedef enum {
+  GLYPH_FONT_LOADING,  // Rasterizing on the worker thread
+  GLYPH_FONT_LOADED,   // Rasterized, waiting for update_glyph_atlas()
+  GLYPH_FONT_READY     // Drawable; missing glyphs are added on demand
+} glyph_font_state_t;
+
+typedef struct {
+  SDL_Rect rect;  // Atlas pixels, empty for blank glyphs such as space
+  short offset_x;  // Top-left corner relative to the pen at the line top
+  short offset_y;
+  short advance;
+  bool ready;
+} atlas_glyph_t;
+
+typedef struct glyph_font {
+  struct glyph_atlas* atlas;
+  ttf_font_t font;  // Private copy, closed with the glyph font
+  int ascent;
+  int height;
+  int line_skip;
+  bool kerning_enabled;
+  atlas_glyph_t glyphs[GLYPH_ATLAS_GLYPH_COUNT];
+  // Pair adjustments indexed [previous][current], SCHAR_MIN until queried
+  signed char kerning[GLYPH_ATLAS_GLYPH_COUNT * GLYPH_ATLAS_GLYPH_COUNT];
+  glyph_font_state_t state;  // Guarded by the atlas mutex
+  bool ready;                // Main thread copy of state == READY
+  bool released;             // Removed while the worker had it
+  SDL_Surface** pending;     // Worker output, one trimmed glyph each
+  struct glyph_font* next;   // Load or upload queue
+  struct glyph_font* prev_font;  // All fonts of the atlas, main thread
+  struct glyph_font* next_font;
+} glyph_font_t, *glyph_font_ptr;
+
+typedef struct {
+  int y;
+  int height;
+  int used_width;
+} glyph_shelf_t;
+
+typedef struct {
+  int fonts;
+  int glyphs;       // Glyphs rasterized into the atlas
+  int shelves;
+  int used_height;  // Bottom edge of the lowest shelf
+  int dropped;      // Glyphs that did not fit
+} glyph_atlas_stats_t;
+
+typedef struct glyph_atlas {
+  SDL_Renderer* renderer;
+  texture_t texture;  // surface mirrors the atlas for the CPU backend
+  glyph_shelf_t* shelves;
+  int shelf_count;
+  int shelf_capacity;
+  uint32_t* upload_pixels;  // One padded glyph on its way to the texture
+  int upload_capacity;
+  glyph_font_ptr fonts;
+  SDL_Thread* thread;  // Started by the first asynchronous load
+  SDL_mutex* mutex;
+  SDL_cond* work_ready;
+  glyph_font_ptr load_head;  // FIFO of fonts to rasterize
+  glyph_font_ptr load_tail;
+  glyph_font_ptr upload_head;  // FIFO of rasterized fonts
+  glyph_font_ptr upload_tail;
+  bool shutting_down;
+  glyph_atlas_stats_t stats;
+} glyph_atlas_t, *glyph_atlas_ptr;
+
+/**
+ * @brief Create an empty atlas
+ * @param renderer Renderer that owns the atlas texture
+ * @param width Atlas width in pixels
+ * @param height Atlas height in pixels
+ * @return Atlas, or NULL on failure
+ */
+glyph_atlas_ptr create_glyph_atlas(SDL_Renderer* renderer, int width,
+                                   int height);
+
+/**
+ * @brief Stop the worker thread and free the atlas with all its fonts
+ * @param atlas Atlas to destroy (may be NULL)
+ */
+void destroy_glyph_atlas(glyph_atlas_ptr atlas);
+
+/**
+ * @brief Open a TTF font for the atlas
+ *
+ * The atlas opens its own copy of the font, so the caller's fonts stay free
+ * to use while this one loads on the worker thread.
+ *
+ * @param atlas Atlas
+ * @param path Path to the .ttf font file
+ * @param point_size Font size in points
+ * @param rasterize_async true to rasterize every glyph on the worker thread,
+ *        false to rasterize glyphs on demand
+ * @return Font handle, valid until remove_glyph_font(), or NULL on failure
+ */
+glyph_font_ptr add_glyph_font(glyph_atlas_ptr atlas, const char* path,
+                              int point_size, bool rasterize_async);
+
+/**
+ * @brief Forget a font, cancelling its load if still pending
+ *
+ * Its glyphs keep their atlas space. A font still loading is closed by a
+ * later update_glyph_atlas() or destroy_glyph_atlas().
+ *
+ * @param atlas Atlas
+ * @param font Handle to remove (may be NULL)
+ */
+void remove_glyph_font(glyph_atlas_ptr atlas, glyph_font_ptr font);
+
+/**
+ * @brief Upload glyphs rasterized by the worker thread
+ *
+ * Call once per frame on the thread owning the renderer.
+ *
+ * @param atlas Atlas
+ */
+void update_glyph_atlas(glyph_atlas_ptr atlas);
+
+/**
+ * @brief Check whether a font can be drawn
+ * @param font Handle from add_glyph_font()
+ * @return true once the font is ready
+ */
+bool is_glyph_font_ready(const glyph_font_t* font);
+
+/**
+ * @brief Measure a string as draw_glyph_text() lays it out
+ * @param font Ready font
+ * @param text String; '\n' starts a new line
+ * @param width Output width of the widest line (may be NULL)
+ * @param height Output height of all lines (may be NULL)
+ * @return false if the font is not ready
+ */
+bool measure_glyph_text(glyph_font_ptr font, const char* text, int* width,
+                        int* height);
+
+/**
+ * @brief Draw a string from the atlas in one batch
+ * @param graphics_context Graphics context to draw to
+ * @param font Ready font
+ * @param text String; '\n' starts a new line
+ * @param x Left edge
+ * @param y Top edge of the first line
+ * @param color Text color
+ * @return false if the font is not ready
+ */
+bool draw_glyph_text(const graphics_context_ptr graphics_context,
+                     glyph_font_ptr font, const char* text, int x, int y,
+                     SDL_Color color);
+
+/**
+ * @brief Get atlas usage counters
+ * @param atlas Atlas
+ * @return Statistics
+ */
+glyph_atlas_stats_t get_glyph_atlas_stats(const glyph_atlas_t* atlas);
+
+#endif  // CORE_GRAPHICS_GLYPH_ATLAS_H_
@@ -9,8 +9,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "cpu_renderer.h"
 #include "geometry.h"
 #include "graphics.h"
+#include "polygon_mesh.h"
+#include "primitive_batch.h"
+#include "render_queue.h"
 
 // Logging macros - simplified for context module
 #define LOG_INFO(msg) printf("INFO: %s\n", msg)
@@ -216,6 +220,13 @@ SDL_Renderer* create_application_renderer(SDL_Window* window, bool vsync) {
 graphics_context_t initialize_graphics_context(int display, int display_mode,
                                                window_mode_t window_mode,
                                                bool vsync) {
+  return initialize_graphics_context_with_backend(
+      display, display_mode, window_mode, vsync, RENDER_BACKEND_SDL);
+}
+
+graphics_context_t initialize_graphics_context_with_backend(
+    int display, int display_mode, window_mode_t window_mode, bool vsync,
+    render_backend_t backend) {
   graphics_context_t context = {0};
 
   if (!initialize_graphics_subsystems()) {
@@ -251,10 +262,80 @@ graphics_context_t initialize_graphics_context(int display, int display_mode,
   SDL_GL_GetDrawableSize(context.window, &drawable_w, &drawable_h);
   LOG_INFO_FMT("Drawable Size: w=%d h=%d", drawable_w, drawable_h);
 
+  if (backend == RENDER_BACKEND_CPU) {
+    context.cpu_renderer = create_cpu_renderer(
+        context.renderer, context.screen_width, context.screen_height);
+    if (!context.cpu_renderer) {
+      LOG_WARN("CPU renderer unavailable, drawing through SDL");
+    }
+  }
+
+  return context;
+}
+
+// SDL_HINT_VIDEODRIVER was only added in SDL 2.0.22; the hint has always
+// been read from the environment variable of the same name
+#ifndef SDL_HINT_VIDEODRIVER
+#define SDL_HINT_VIDEODRIVER "SDL_VIDEODRIVER"
+#endif
+
+graphics_context_t initialize_headless_graphics_context(
+    int width, int height, render_backend_t backend) {
+  graphics_context_t context = {0};
+  if (width <= 0 || height <= 0) {
+    LOG_ERROR("Invalid headless resolution");
+    return context;
+  }
+
+  // Default priority, so the environment can still pick e.g. "offscreen"
+  SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_TIMER) != 0) {
+    LOG_SDL_ERROR("SDL_Init (headless)");
+    return context;
+  }
+  init_circle_lookup();
+  SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
+
+  context.headless_target = SDL_CreateRGBSurfaceWithFormat(
+      0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+  if (!context.headless_target) {
+    LOG_SDL_ERROR("SDL_CreateRGBSurfaceWithFormat");
+    return context;
+  }
+
+  context.renderer = SDL_CreateSoftwareRenderer(context.headless_target);
+  if (!context.renderer) {
+    LOG_SDL_ERROR("SDL_CreateSoftwareRenderer");
+    SDL_FreeSurface(context.headless_target);
+    context.headless_target = NULL;
+    return context;
+  }
+
+  context.screen_width = width;
+  context.screen_height = height;
+  context.screen_center = point(width / 2, height / 2);
+  LOG_INFO_FMT("Headless context: %dx%d on video driver %s", width, height,
+               SDL_GetCurrentVideoDriver() ? SDL_GetCurrentVideoDriver()
+                                           : "none");
+
+  if (backend == RENDER_BACKEND_CPU) {
+    context.cpu_renderer =
+        create_cpu_renderer(context.renderer, width, height);
+    if (!context.cpu_renderer) {
+      LOG_WARN("CPU renderer unavailable, drawing through SDL");
+    }
+  }
+
   return context;
 }
 
 void terminate_graphics_context(graphics_context_t* context) {
+  destroy_render_queue(context);
+  destroy_primitive_batch(context);
+  clear_polygon_cache();
+  destroy_cpu_renderer(context->cpu_renderer);
+  context->cpu_renderer = NULL;
+
   if (context->renderer) {
     SDL_DestroyRenderer(context->renderer);
     context->renderer = NULL;
@@ -265,6 +346,11 @@ void terminate_graphics_context(graphics_context_t* context) {
     context->window = NULL;
   }
 
+  if (context->headless_target) {
+    SDL_FreeSurface(context->headless_target);
+    context->headless_target = NULL;
+  }
+
   SDL_Quit();
 }
 
@@ -12,10 +12,36 @@
 
 #include <SDL.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "geometry.h"
 #include "window_mode.h"
 
+struct cpu_renderer;
+struct primitive_batch;
+struct render_queue;
+
+// Rasterizer used for the engine's drawing calls
+typedef enum {
+  RENDER_BACKEND_SDL,  // SDL renderer (GPU, or SDL's software fallback)
+  RENDER_BACKEND_CPU   // Vectorized CPU rasterizer, see cpu_renderer.h
+} render_backend_t;
+
+// Renderer state calls issued to SDL and skipped as redundant
+typedef struct {
+  uint64_t issued;
+  uint64_t elided;
+} render_state_stats_t;
+
+// Last renderer state set through render_state.h; zeroed means unknown
+typedef struct {
+  SDL_Color draw_color;
+  SDL_BlendMode blend_mode;
+  bool draw_color_known;
+  bool blend_mode_known;
+  render_state_stats_t stats;
+} render_state_t;
+
 // Graphics context structure definition
 typedef struct graphics_context {
   SDL_Window* window;
@@ -23,6 +49,12 @@ typedef struct graphics_context {
   int screen_width;
   int screen_height;
   point_t screen_center;
+  struct primitive_batch* primitive_batch;  // Created on first draw call
+  struct render_queue* render_queue;        // Created on first use
+  render_state_t render_state;
+  struct cpu_renderer* cpu_renderer;  // NULL unless RENDER_BACKEND_CPU
+  SDL_Surface* headless_target;       // Offscreen canvas, NULL when windowed
+  unsigned frame_count;               // Frames presented so far
 } graphics_context_t;
 
 typedef graphics_context_t* graphics_context_ptr;
@@ -78,6 +110,35 @@ graphics_context_t initialize_graphics_context(int display, int display_mode,
                                                window_mode_t window_mode,
                                                bool vsync);
 
+/**
+ * @brief Initialize complete graphics context with a chosen rasterizer
+ * @param display Display index
+ * @param display_mode Display mode index
+ * @param window_mode Window mode configuration
+ * @param vsync Enable vertical synchronization
+ * @param backend Rasterizer for drawing primitives and sprites
+ * @return Initialized graphics context
+ */
+graphics_context_t initialize_graphics_context_with_backend(
+    int display, int display_mode, window_mode_t window_mode, bool vsync,
+    render_backend_t backend);
+
+/**
+ * @brief Initialize a graphics context without a window or display
+ *
+ * Selects SDL's dummy video driver (unless SDL_VIDEODRIVER says otherwise)
+ * and draws with a software renderer into an ARGB8888 surface of the given
+ * virtual resolution, so every primitive, sprite and font path runs on
+ * hosts without a display. Read frames back with read_frame().
+ *
+ * @param width Virtual screen width
+ * @param height Virtual screen height
+ * @param backend Rasterizer for drawing primitives and sprites
+ * @return Initialized graphics context; renderer is NULL on failure
+ */
+graphics_context_t initialize_headless_graphics_context(
+    int width, int height, render_backend_t backend);
+
 /**
  * @brief Cleanup and shutdown graphics context
  * @param context Graphics context to cleanup
@@ -0,0 +1,392 @@
+/**
+ * @file particle_system.c
+ * @brief Implementation of the particle system
+ */
+
+#include "particle_system.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "dynamic_array.h"
+#include "logger.h"
+#include "primitive_batch.h"
+#include "render_state.h"
+
+particle_system_ptr create_particle_system(int max_particles,
+                                           int max_emitters,
+                                           int particle_size) {
+  if (max_particles <= 0 || max_emitters <= 0 || particle_size <= 0) {
+    return NULL;
+  }
+
+  particle_system_ptr system = calloc(1, sizeof(particle_system_t));
+  if (!system) {
+    LOG_ERROR("Failed to allocate particle system");
+    return NULL;
+  }
+  size_t count = (size_t)max_particles;
+  system->x = malloc(sizeof(float) * count);
+  system->y = malloc(sizeof(float) * count);
+  system->vx = malloc(sizeof(float) * count);
+  system->vy = malloc(sizeof(float) * count);
+  system->life = malloc(sizeof(float) * count);
+  system->inverse_lifetime = malloc(sizeof(float) * count);
+  system->start_color = malloc(sizeof(uint32_t) * count);
+  system->end_color = malloc(sizeof(uint32_t) * count);
+  system->emitters =
+      create_object_pool(sizeof(particle_emitter_t), (size_t)max_emitters);
+  if (!system->x || !system->y || !system->vx || !system->vy ||
+      !system->life || !system->inverse_lifetime || !system->start_color ||
+      !system->end_color || !system->emitters.objects ||
+      !system->emitters.free_indices || !system->emitters.active_flags) {
+    LOG_ERROR_FMT("Failed to allocate %d particles", max_particles);
+    destroy_particle_system(system);
+    return NULL;
+  }
+  system->capacity = max_particles;
+  system->size = particle_size;
+  system->random_state = 0x9E3779B9u;
+  return system;
+}
+
+void destroy_particle_system(particle_system_ptr system) {
+  if (!system) {
+    return;
+  }
+  free(system->x);
+  free(system->y);
+  free(system->vx);
+  free(system->vy);
+  free(system->life);
+  free(system->inverse_lifetime);
+  free(system->start_color);
+  free(system->end_color);
+  pool_destroy(&system->emitters);
+  free(system->cpu_particles);
+  free(system->vertices);
+  free(system->indices);
+  free(system);
+}
+
+void set_particle_gravity(particle_system_ptr system, float gravity_x,
+                          float gravity_y) {
+  if (system) {
+    system->gravity_x = gravity_x;
+    system->gravity_y = gravity_y;
+  }
+}
+
+// xorshift32 mapped to [0, 1)
+static float next_random(particle_system_ptr system) {
+  uint32_t state = system->random_state;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  system->random_state = state;
+  return (float)(state >> 8) * (1.0f / 16777216.0f);
+}
+
+static inline float random_between(particle_system_ptr system, float low,
+                                   float high) {
+  return low + (high - low) * next_random(system);
+}
+
+static inline uint32_t pack_color(SDL_Color color) {
+  return ((uint32_t)color.a << 24) | ((uint32_t)color.r << 16) |
+         ((uint32_t)color.g << 8) | color.b;
+}
+
+int emit_particles(particle_system_ptr system, const particle_config_t* config,
+                   int count) {
+  if (!system || !config || count <= 0) {
+    return 0;
+  }
+  if (count > system->capacity - system->count) {
+    count = system->capacity - system->count;
+  }
+
+  uint32_t start_color = pack_color(config->start_color);
+  uint32_t end_color = pack_color(config->end_color);
+  for (int i = system->count; i < system->count + count; i++) {
+    float angle = config->angle +
+                  random_between(system, -config->spread, config->spread);
+    float speed = random_between(system, config->speed_min, config->speed_max);
+    float lifetime = random_between(system, config->life_min, config->life_max);
+    lifetime = lifetime > 0.001f ? lifetime : 0.001f;
+    system->x[i] = config->x;
+    system->y[i] = config->y;
+    system->vx[i] = cosf(angle) * speed;
+    system->vy[i] = sinf(angle) * speed;
+    system->life[i] = lifetime;
+    system->inverse_lifetime[i] = 1.0f / lifetime;
+    system->start_color[i] = start_color;
+    system->end_color[i] = end_color;
+  }
+  system->count += count;
+  return count;
+}
+
+int add_particle_emitter(particle_system_ptr system,
+                         const particle_config_t* config, float rate) {
+  if (!system || !config) {
+    return -1;
+  }
+  size_t index;
+  particle_emitter_t* emitter = pool_acquire(&system->emitters, &index);
+  if (!emitter) {
+    LOG_WARN_FMT("All %d particle emitters are in use",
+                 (int)system->emitters.capacity);
+    return -1;
+  }
+  emitter->config = *config;
+  emitter->rate = rate;
+  return (int)index;
+}
+
+void remove_particle_emitter(particle_system_ptr system, int emitter) {
+  if (system && emitter >= 0) {
+    pool_release(&system->emitters, (size_t)emitter);
+  }
+}
+
+particle_emitter_t* get_particle_emitter(particle_system_ptr system,
+                                         int emitter) {
+  if (!system || emitter < 0 ||
+      !pool_is_active(&system->emitters, (size_t)emitter)) {
+    return NULL;
+  }
+  return pool_get_at(&system->emitters, (size_t)emitter);
+}
+
+// Semi-implicit Euler: velocity first, then position with the new velocity
+static void integrate(particle_system_ptr system, float delta_time) {
+  float* x = system->x;
+  float* y = system->y;
+  float* vx = system->vx;
+  float* vy = system->vy;
+  float* life = system->life;
+  float ax = system->gravity_x * delta_time;
+  float ay = system->gravity_y * delta_time;
+  int count = system->count;
+  int i = 0;
+#if defined(__AVX2__)
+  {
+    __m256 ax8 = _mm256_set1_ps(ax);
+    __m256 ay8 = _mm256_set1_ps(ay);
+    __m256 dt8 = _mm256_set1_ps(delta_time);
+    for (; i + 8 <= count; i += 8) {
+      __m256 vx8 = _mm256_add_ps(_mm256_loadu_ps(vx + i), ax8);
+      __m256 vy8 = _mm256_add_ps(_mm256_loadu_ps(vy + i), ay8);
+      _mm256_storeu_ps(vx + i, vx8);
+      _mm256_storeu_ps(vy + i, vy8);
+      _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i),
+                                            _mm256_mul_ps(vx8, dt8)));
+      _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i),
+                                            _mm256_mul_ps(vy8, dt8)));
+      _mm256_storeu_ps(life + i,
+                       _mm256_sub_ps(_mm256_loadu_ps(life + i), dt8));
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    __m128 ax4 = _mm_set1_ps(ax);
+    __m128 ay4 = _mm_set1_ps(ay);
+    __m128 dt4 = _mm_set1_ps(delta_time);
+    for (; i + 4 <= count; i += 4) {
+      __m128 vx4 = _mm_add_ps(_mm_loadu_ps(vx + i), ax4);
+      __m128 vy4 = _mm_add_ps(_mm_loadu_ps(vy + i), ay4);
+      _mm_storeu_ps(vx + i, vx4);
+      _mm_storeu_ps(vy + i, vy4);
+      _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i),
+                                      _mm_mul_ps(vx4, dt4)));
+      _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i),
+                                      _mm_mul_ps(vy4, dt4)));
+      _mm_storeu_ps(life + i, _mm_sub_ps(_mm_loadu_ps(life + i), dt4));
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    vx[i] += ax;
+    vy[i] += ay;
+    x[i] += vx[i] * delta_time;
+    y[i] += vy[i] * delta_time;
+    life[i] -= delta_time;
+  }
+}
+
+// Swap-remove dead particles. Walking backwards means the particle moved
+// into a slot has already been checked and is alive.
+static void remove_dead(particle_system_ptr system) {
+  int count = system->count;
+  for (int i = count - 1; i >= 0; i--) {
+    if (system->life[i] > 0.0f) {
+      continue;
+    }
+    int last = --count;
+    system->x[i] = system->x[last];
+    system->y[i] = system->y[last];
+    system->vx[i] = system->vx[last];
+    system->vy[i] = system->vy[last];
+    system->life[i] = system->life[last];
+    system->inverse_lifetime[i] = system->inverse_lifetime[last];
+    system->start_color[i] = system->start_color[last];
+    system->end_color[i] = system->end_color[last];
+  }
+  system->count = count;
+}
+
+typedef struct {
+  particle_system_ptr system;
+  float delta_time;
+} emitter_update_t;
+
+static void run_emitter(void* object, size_t index, void* user_data) {
+  (void)index;
+  particle_emitter_t* emitter = object;
+  emitter_update_t* update = user_data;
+  emitter->accumulator += emitter->rate * update->delta_time;
+  int count = (int)emitter->accumulator;
+  if (count > 0) {
+    emitter->accumulator -= (float)count;
+    emit_particles(update->system, &emitter->config, count);
+  }
+}
+
+void update_particle_system(particle_system_ptr system, float delta_time) {
+  if (!system || delta_time <= 0.0f) {
+    return;
+  }
+  integrate(system, delta_time);
+  remove_dead(system);
+
+  emitter_update_t update = {system, delta_time};
+  pool_foreach_active(&system->emitters, run_emitter, &update);
+}
+
+// Fade from the end color at death (t = 0) to the start color at birth
+// (t = 1)
+static inline uint32_t particle_color(uint32_t start, uint32_t end, float t) {
+  uint32_t color = 0;
+  for (int shift = 0; shift < 32; shift += 8) {
+    float from = (float)((end >> shift) & 0xFF);
+    float to = (float)((start >> shift) & 0xFF);
+    color |= (uint32_t)(from + (to - from) * t + 0.5f) << shift;
+  }
+  return color;
+}
+
+static inline float remaining_life(const particle_system_t* system, int i) {
+  float t = system->life[i] * system->inverse_lifetime[i];
+  return t < 1.0f ? t : 1.0f;
+}
+
+static void draw_cpu(cpu_renderer_ptr cpu, particle_system_ptr system) {
+  cpu_particle_t* particles =
+      grow_array(system->cpu_particles, &system->cpu_particle_capacity,
+                 system->count, sizeof(cpu_particle_t));
+  if (!particles) {
+    LOG_ERROR("Failed to grow particle draw buffer");
+    return;
+  }
+  system->cpu_particles = particles;
+
+  float half = (float)system->size * 0.5f;
+  for (int i = 0; i < system->count; i++) {
+    particles[i].x = (int)floorf(system->x[i] - half);
+    particles[i].y = (int)floorf(system->y[i] - half);
+    particles[i].argb =
+        particle_color(system->start_color[i], system->end_color[i],
+                       remaining_life(system, i));
+  }
+  cpu_draw_particles(cpu, particles, system->count, system->size);
+}
+
+// Four vertices per particle and a fixed index pattern for all quads
+static bool reserve_quads(particle_system_ptr system) {
+  SDL_Vertex* vertices =
+      grow_array(system->vertices, &system->vertex_capacity,
+                 system->count * 4, sizeof(SDL_Vertex));
+  if (!vertices) {
+    return false;
+  }
+  system->vertices = vertices;
+
+  if (system->indexed_quads >= system->count) {
+    return true;
+  }
+  int* indices = grow_array(system->indices, &system->index_capacity,
+                            system->count * 6, sizeof(int));
+  if (!indices) {
+    return false;
+  }
+  system->indices = indices;
+
+  int quads = system->index_capacity / 6;
+  for (int i = system->indexed_quads; i < quads; i++) {
+    int* quad = &system->indices[i * 6];
+    int base = i * 4;
+    quad[0] = base;
+    quad[1] = base + 1;
+    quad[2] = base + 2;
+    quad[3] = base + 2;
+    quad[4] = base + 3;
+    quad[5] = base;
+  }
+  system->indexed_quads = quads;
+  return true;
+}
+
+static void draw_geometry(const graphics_context_ptr graphics_context,
+                          particle_system_ptr system) {
+  if (!reserve_quads(system)) {
+    LOG_ERROR("Failed to grow particle draw buffer");
+    return;
+  }
+
+  float half = (float)system->size * 0.5f;
+  for (int i = 0; i < system->count; i++) {
+    uint32_t argb = particle_color(system->start_color[i],
+                                   system->end_color[i],
+                                   remaining_life(system, i));
+    SDL_Color color = {(Uint8)(argb >> 16), (Uint8)(argb >> 8), (Uint8)argb,
+                       (Uint8)(argb >> 24)};
+    float x0 = system->x[i] - half, x1 = system->x[i] + half;
+    float y0 = system->y[i] - half, y1 = system->y[i] + half;
+    SDL_Vertex* quad = &system->vertices[i * 4];
+    quad[0] = (SDL_Vertex){{x0, y0}, color, {0.0f, 0.0f}};
+    quad[1] = (SDL_Vertex){{x1, y0}, color, {0.0f, 0.0f}};
+    quad[2] = (SDL_Vertex){{x1, y1}, color, {0.0f, 0.0f}};
+    quad[3] = (SDL_Vertex){{x0, y1}, color, {0.0f, 0.0f}};
+  }
+
+  // Untextured geometry uses the draw blend mode; the engine draws with
+  // BLEND everywhere else
+  apply_draw_blend_mode(graphics_context, SDL_BLENDMODE_ADD);
+  SDL_RenderGeometry(graphics_context->renderer, NULL, system->vertices,
+                     system->count * 4, system->indices, system->count * 6);
+  apply_draw_blend_mode(graphics_context, SDL_BLENDMODE_BLEND);
+}
+
+void draw_particle_system(const graphics_context_ptr graphics_context,
+                          particle_system_ptr system) {
+  if (!graphics_context || !graphics_context->renderer || !system ||
+      system->count == 0) {
+    return;
+  }
+
+  // Whatever was batched before belongs underneath the particles
+  flush_primitive_batch(graphics_context);
+  if (graphics_context->cpu_renderer) {
+    draw_cpu(graphics_context->cpu_renderer, system);
+  } else {
+    draw_geometry(graphics_context, system);
+  }
+}
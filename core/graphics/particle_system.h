@@ -0,0 +1,156 @@
+/**
+ * @file particle_system.h
+ * @brief Emitter-driven particle system with additive rendering
+ *
+ * Particles are stored as a structure of arrays (position, velocity, life
+ * and colors) so update_particle_system() integrates all of them with AVX2
+ * or SSE2 kernels, then removes dead ones by moving the last live particle
+ * into their slot. The arrays are sized once at creation and never grow.
+ *
+ * Continuous effects such as engine thrust come from emitters, kept in an
+ * object pool and addressed by their pool index; one-off effects such as
+ * explosions are emitted directly with emit_particles().
+ *
+ * draw_particle_system() submits every live particle at once with additive
+ * blending: one SDL_RenderGeometry() call of colored quads, or one tiled
+ * particle command with the CPU backend.
+ */
+
+#ifndef CORE_GRAPHICS_PARTICLE_SYSTEM_H_
+#define CORE_GRAPHICS_PARTICLE_SYSTEM_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cpu_renderer.h"
+#include "graphics_context.h"
+#include "object_pool.h"
+
+// How new particles are spawned
+typedef struct {
+  float x;  // Spawn point
+  float y;
+  float angle;   // Direction of travel in radians
+  float spread;  // Directions are picked within angle +/- spread
+  float speed_min;  // Pixels per second
+  float speed_max;
+  float life_min;  // Seconds
+  float life_max;
+  SDL_Color start_color;  // Color at birth; alpha scales the added light
+  SDL_Color end_color;    // Color reached at death
+} particle_config_t;
+
+typedef struct {
+  particle_config_t config;
+  float rate;         // Particles per second
+  float accumulator;  // Fraction of a particle owed from earlier updates
+} particle_emitter_t;
+
+typedef struct {
+  // Live particles, one array per field, indices [0, count)
+  float* x;  // Center
+  float* y;
+  float* vx;
+  float* vy;
+  float* life;  // Seconds left
+  float* inverse_lifetime;
+  uint32_t* start_color;  // 0xAARRGGBB
+  uint32_t* end_color;
+  int count;
+  int capacity;
+
+  object_pool_t emitters;  // particle_emitter_t
+  float gravity_x;  // Acceleration applied to every particle
+  float gravity_y;
+  int size;  // Side of each particle in pixels
+  uint32_t random_state;
+
+  // Draw buffers, grown on the first draw
+  cpu_particle_t* cpu_particles;
+  int cpu_particle_capacity;
+  SDL_Vertex* vertices;
+  int vertex_capacity;
+  int* indices;
+  int index_capacity;
+  int indexed_quads;
+} particle_system_t, *particle_system_ptr;
+
+/**
+ * @brief Create a particle system
+ * @param max_particles Live particles it can hold; spawns beyond are dropped
+ * @param max_emitters Emitters it can hold
+ * @param particle_size Side of each particle in pixels
+ * @return System, or NULL on failure
+ */
+particle_system_ptr create_particle_system(int max_particles,
+                                           int max_emitters,
+                                           int particle_size);
+
+/**
+ * @brief Free a particle system with its particles and emitters
+ * @param system System to destroy (may be NULL)
+ */
+void destroy_particle_system(particle_system_ptr system);
+
+/**
+ * @brief Set the acceleration applied to every particle
+ * @param system System to change
+ * @param gravity_x Horizontal acceleration in pixels per second squared
+ * @param gravity_y Vertical acceleration in pixels per second squared
+ */
+void set_particle_gravity(particle_system_ptr system, float gravity_x,
+                          float gravity_y);
+
+/**
+ * @brief Spawn a burst of particles
+ * @param system System to spawn into
+ * @param config Spawn point and particle properties
+ * @param count Number of particles
+ * @return Particles spawned, fewer than count when the system is full
+ */
+int emit_particles(particle_system_ptr system, const particle_config_t* config,
+                   int count);
+
+/**
+ * @brief Add an emitter that spawns particles continuously
+ * @param system System to spawn into
+ * @param config Spawn point and particle properties
+ * @param rate Particles per second
+ * @return Emitter handle, or -1 if every emitter is in use
+ */
+int add_particle_emitter(particle_system_ptr system,
+                         const particle_config_t* config, float rate);
+
+/**
+ * @brief Remove an emitter; particles it spawned live on
+ * @param system System owning the emitter
+ * @param emitter Emitter handle
+ */
+void remove_particle_emitter(particle_system_ptr system, int emitter);
+
+/**
+ * @brief Get an emitter to move it or change its properties
+ * @param system System owning the emitter
+ * @param emitter Emitter handle
+ * @return Emitter, or NULL for an invalid handle
+ */
+particle_emitter_t* get_particle_emitter(particle_system_ptr system,
+                                         int emitter);
+
+/**
+ * @brief Advance every particle, remove dead ones and run the emitters
+ * @param system System to update
+ * @param delta_time Elapsed seconds
+ */
+void update_particle_system(particle_system_ptr system, float delta_time);
+
+/**
+ * @brief Draw every live particle with additive blending
+ * @param graphics_context Graphics context to draw to
+ * @param system System to draw
+ */
+void draw_particle_system(const graphics_context_ptr graphics_context,
+                          particle_system_ptr system);
+
+#endif  // CORE_GRAPHICS_PARTICLE_SYSTEM_H_
@@ -0,0 +1,476 @@
+/**
+ * @file pixel_pipeline.c
+ * @brief Implementation of the load-time pixel pipeline
+ */
+
+#include "pixel_pipeline.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "logger.h"
+
+#define ALPHA_MASK 0xFF000000u
+#define RGB_MASK 0x00FFFFFFu
+
+// Exact x / 255 with rounding, for x <= 255 * 255
+static inline uint32_t div255(uint32_t x) {
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+#if defined(__SSE2__)
+static inline __m128i div255_epu16(__m128i x) {
+  x = _mm_add_epi16(x, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// Lanes with alpha other than 0 and 255 set to all ones
+static inline __m128i partial_alpha_mask(__m128i pixels) {
+  __m128i alpha = _mm_srli_epi32(pixels, 24);
+  __m128i extreme = _mm_or_si128(_mm_cmpeq_epi32(alpha, _mm_setzero_si128()),
+                                 _mm_cmpeq_epi32(alpha, _mm_set1_epi32(255)));
+  return _mm_xor_si128(extreme, _mm_set1_epi32(-1));
+}
+#endif
+
+#if defined(__AVX2__)
+static inline __m256i div255_epu16_256(__m256i x) {
+  x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+static inline __m256i partial_alpha_mask_256(__m256i pixels) {
+  __m256i alpha = _mm256_srli_epi32(pixels, 24);
+  __m256i extreme =
+      _mm256_or_si256(_mm256_cmpeq_epi32(alpha, _mm256_setzero_si256()),
+                      _mm256_cmpeq_epi32(alpha, _mm256_set1_epi32(255)));
+  return _mm256_xor_si256(extreme, _mm256_set1_epi32(-1));
+}
+#endif
+
+static inline bool is_partial(uint32_t pixel) {
+  uint32_t alpha = pixel >> 24;
+  return alpha != 0 && alpha != 255;
+}
+
+void convert_abgr_span(uint32_t* dst, const uint32_t* src, int count) {
+  int i = 0;
+#if defined(__AVX2__)
+  {
+    __m256i keep = _mm256_set1_epi32((int)0xFF00FF00u);
+    __m256i low = _mm256_set1_epi32(0xFF);
+    __m256i high = _mm256_set1_epi32(0xFF0000);
+    for (; i + 8 <= count; i += 8) {
+      __m256i p = _mm256_loadu_si256((const __m256i*)(src + i));
+      __m256i swapped = _mm256_or_si256(
+          _mm256_and_si256(_mm256_srli_epi32(p, 16), low),
+          _mm256_and_si256(_mm256_slli_epi32(p, 16), high));
+      _mm256_storeu_si256((__m256i*)(dst + i),
+                          _mm256_or_si256(_mm256_and_si256(p, keep), swapped));
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    __m128i keep = _mm_set1_epi32((int)0xFF00FF00u);
+    __m128i low = _mm_set1_epi32(0xFF);
+    __m128i high = _mm_set1_epi32(0xFF0000);
+    for (; i + 4 <= count; i += 4) {
+      __m128i p = _mm_loadu_si128((const __m128i*)(src + i));
+      __m128i swapped =
+          _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), low),
+                       _mm_and_si128(_mm_slli_epi32(p, 16), high));
+      _mm_storeu_si128((__m128i*)(dst + i),
+                       _mm_or_si128(_mm_and_si128(p, keep), swapped));
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    uint32_t p = src[i];
+    dst[i] = (p & 0xFF00FF00u) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+  }
+}
+
+void colorkey_to_alpha_span(uint32_t* pixels, int count, uint32_t key_rgb) {
+  int i = 0;
+#if defined(__AVX2__)
+  {
+    __m256i rgb_mask = _mm256_set1_epi32((int)RGB_MASK);
+    __m256i key = _mm256_set1_epi32((int)key_rgb);
+    for (; i + 8 <= count; i += 8) {
+      __m256i p = _mm256_loadu_si256((const __m256i*)(pixels + i));
+      __m256i keyed =
+          _mm256_cmpeq_epi32(_mm256_and_si256(p, rgb_mask), key);
+      _mm256_storeu_si256((__m256i*)(pixels + i),
+                          _mm256_andnot_si256(keyed, p));
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    __m128i rgb_mask = _mm_set1_epi32((int)RGB_MASK);
+    __m128i key = _mm_set1_epi32((int)key_rgb);
+    for (; i + 4 <= count; i += 4) {
+      __m128i p = _mm_loadu_si128((const __m128i*)(pixels + i));
+      __m128i keyed = _mm_cmpeq_epi32(_mm_and_si128(p, rgb_mask), key);
+      _mm_storeu_si128((__m128i*)(pixels + i), _mm_andnot_si128(keyed, p));
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    if ((pixels[i] & RGB_MASK) == key_rgb) {
+      pixels[i] = 0;
+    }
+  }
+}
+
+bool premultiply_span(uint32_t* pixels, int count) {
+  int i = 0;
+  bool partial = false;
+#if defined(__AVX2__)
+  {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i alpha_mask = _mm256_set1_epi32((int)ALPHA_MASK);
+    __m256i found = zero;
+    for (; i + 8 <= count; i += 8) {
+      __m256i p = _mm256_loadu_si256((const __m256i*)(pixels + i));
+      __m256i lo = _mm256_unpacklo_epi8(p, zero);
+      __m256i hi = _mm256_unpackhi_epi8(p, zero);
+      // Broadcast each pixel's alpha (lane 3) to its four channels
+      __m256i alpha_lo =
+          _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, 0xFF), 0xFF);
+      __m256i alpha_hi =
+          _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, 0xFF), 0xFF);
+      lo = div255_epu16_256(_mm256_mullo_epi16(lo, alpha_lo));
+      hi = div255_epu16_256(_mm256_mullo_epi16(hi, alpha_hi));
+      __m256i scaled = _mm256_packus_epi16(lo, hi);
+      _mm256_storeu_si256(
+          (__m256i*)(pixels + i),
+          _mm256_or_si256(_mm256_andnot_si256(alpha_mask, scaled),
+                          _mm256_and_si256(p, alpha_mask)));
+      found = _mm256_or_si256(found, partial_alpha_mask_256(p));
+    }
+    partial = _mm256_movemask_epi8(found) != 0;
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    __m128i zero = _mm_setzero_si128();
+    __m128i alpha_mask = _mm_set1_epi32((int)ALPHA_MASK);
+    __m128i found = zero;
+    for (; i + 4 <= count; i += 4) {
+      __m128i p = _mm_loadu_si128((const __m128i*)(pixels + i));
+      __m128i lo = _mm_unpacklo_epi8(p, zero);
+      __m128i hi = _mm_unpackhi_epi8(p, zero);
+      __m128i alpha_lo =
+          _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xFF), 0xFF);
+      __m128i alpha_hi =
+          _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xFF), 0xFF);
+      lo = div255_epu16(_mm_mullo_epi16(lo, alpha_lo));
+      hi = div255_epu16(_mm_mullo_epi16(hi, alpha_hi));
+      __m128i scaled = _mm_packus_epi16(lo, hi);
+      _mm_storeu_si128((__m128i*)(pixels + i),
+                       _mm_or_si128(_mm_andnot_si128(alpha_mask, scaled),
+                                    _mm_and_si128(p, alpha_mask)));
+      found = _mm_or_si128(found, partial_alpha_mask(p));
+    }
+    partial = partial || _mm_movemask_epi8(found) != 0;
+  }
+#endif
+  for (; i < count; i++) {
+    uint32_t p = pixels[i];
+    uint32_t alpha = p >> 24;
+    partial = partial || is_partial(p);
+    pixels[i] = (p & ALPHA_MASK) | (div255(((p >> 16) & 0xFF) * alpha) << 16) |
+                (div255(((p >> 8) & 0xFF) * alpha) << 8) |
+                div255((p & 0xFF) * alpha);
+  }
+  return partial;
+}
+
+bool has_partial_alpha(const uint32_t* pixels, int count) {
+  int i = 0;
+#if defined(__AVX2__)
+  {
+    __m256i found = _mm256_setzero_si256();
+    for (; i + 8 <= count; i += 8) {
+      found = _mm256_or_si256(
+          found, partial_alpha_mask_256(
+                     _mm256_loadu_si256((const __m256i*)(pixels + i))));
+    }
+    if (_mm256_movemask_epi8(found)) {
+      return true;
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    __m128i found = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+      found = _mm_or_si128(found, partial_alpha_mask(_mm_loadu_si128(
+                                      (const __m128i*)(pixels + i))));
+    }
+    if (_mm_movemask_epi8(found)) {
+      return true;
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    if (is_partial(pixels[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// True if any pixel of the span is not fully transparent
+static bool span_visible(const uint32_t* pixels, int count) {
+  int i = 0;
+#if defined(__AVX2__)
+  {
+    __m256i found = _mm256_setzero_si256();
+    for (; i + 8 <= count; i += 8) {
+      found = _mm256_or_si256(
+          found, _mm256_loadu_si256((const __m256i*)(pixels + i)));
+    }
+    __m256i alpha =
+        _mm256_and_si256(found, _mm256_set1_epi32((int)ALPHA_MASK));
+    if (_mm256_movemask_epi8(
+            _mm256_cmpeq_epi32(alpha, _mm256_setzero_si256())) != -1) {
+      return true;
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    __m128i found = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+      found =
+          _mm_or_si128(found, _mm_loadu_si128((const __m128i*)(pixels + i)));
+    }
+    __m128i alpha = _mm_and_si128(found, _mm_set1_epi32((int)ALPHA_MASK));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, _mm_setzero_si128())) !=
+        0xFFFF) {
+      return true;
+    }
+  }
+#endif
+  uint32_t found = 0;
+  for (; i < count; i++) {
+    found |= pixels[i];
+  }
+  return (found & ALPHA_MASK) != 0;
+}
+
+static inline uint32_t* surface_row(SDL_Surface* surface, int y) {
+  return (uint32_t*)((uint8_t*)surface->pixels + (size_t)y * surface->pitch);
+}
+
+// Convert one source row to ARGB8888; false if the format is not handled
+static bool convert_row(uint32_t* dst, const uint8_t* src, int width,
+                        Uint32 format) {
+  switch (format) {
+    case SDL_PIXELFORMAT_ARGB8888:
+      memcpy(dst, src, sizeof(uint32_t) * (size_t)width);
+      return true;
+    case SDL_PIXELFORMAT_RGB888:
+      for (int x = 0; x < width; x++) {
+        uint32_t p;
+        memcpy(&p, src + (size_t)x * 4, sizeof(p));
+        dst[x] = p | ALPHA_MASK;
+      }
+      return true;
+    case SDL_PIXELFORMAT_ABGR8888:
+      memcpy(dst, src, sizeof(uint32_t) * (size_t)width);
+      convert_abgr_span(dst, dst, width);
+      return true;
+    case SDL_PIXELFORMAT_BGR888:
+      memcpy(dst, src, sizeof(uint32_t) * (size_t)width);
+      convert_abgr_span(dst, dst, width);
+      for (int x = 0; x < width; x++) {
+        dst[x] |= ALPHA_MASK;
+      }
+      return true;
+    case SDL_PIXELFORMAT_RGB24:
+      for (int x = 0; x < width; x++, src += 3) {
+        dst[x] = ALPHA_MASK | ((uint32_t)src[0] << 16) |
+                 ((uint32_t)src[1] << 8) | src[2];
+      }
+      return true;
+    case SDL_PIXELFORMAT_BGR24:
+      for (int x = 0; x < width; x++, src += 3) {
+        dst[x] = ALPHA_MASK | ((uint32_t)src[2] << 16) |
+                 ((uint32_t)src[1] << 8) | src[0];
+      }
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool handled_format(Uint32 format) {
+  return format == SDL_PIXELFORMAT_ARGB8888 ||
+         format == SDL_PIXELFORMAT_RGB888 ||
+         format == SDL_PIXELFORMAT_ABGR8888 ||
+         format == SDL_PIXELFORMAT_BGR888 ||
+         format == SDL_PIXELFORMAT_RGB24 || format == SDL_PIXELFORMAT_BGR24;
+}
+
+// Generic conversion through SDL with the source's own color key disabled
+static SDL_Surface* convert_with_sdl(SDL_Surface* source) {
+  Uint32 key;
+  bool keyed = SDL_GetColorKey(source, &key) == 0;
+  if (keyed) {
+    SDL_SetColorKey(source, SDL_FALSE, 0);
+  }
+  SDL_Surface* surface =
+      SDL_ConvertSurfaceFormat(source, SDL_PIXELFORMAT_ARGB8888, 0);
+  if (keyed) {
+    SDL_SetColorKey(source, SDL_TRUE, key);
+  }
+  return surface;
+}
+
+// Key color as it appears after conversion; indexed images match the
+// palette entry SDL_MapRGB() picks, as SDL_SetColorKey() would
+static uint32_t converted_key(const SDL_Surface* source,
+                              const pixel_pipeline_options_t* options) {
+  const SDL_PixelFormat* format = source->format;
+  if (SDL_ISPIXELFORMAT_INDEXED(format->format) && format->palette) {
+    Uint32 index =
+        SDL_MapRGB(format, options->key_r, options->key_g, options->key_b);
+    if (index < (Uint32)format->palette->ncolors) {
+      const SDL_Color* color = &format->palette->colors[index];
+      return ((uint32_t)color->r << 16) | ((uint32_t)color->g << 8) |
+             color->b;
+    }
+  }
+  return ((uint32_t)options->key_r << 16) | ((uint32_t)options->key_g << 8) |
+         options->key_b;
+}
+
+// Bounds of the non-transparent pixels; false if there are none
+static bool find_visible_bounds(SDL_Surface* surface, SDL_Rect* bounds) {
+  int top = 0;
+  while (top < surface->h && !span_visible(surface_row(surface, top),
+                                           surface->w)) {
+    top++;
+  }
+  if (top == surface->h) {
+    return false;
+  }
+  int bottom = surface->h - 1;
+  while (!span_visible(surface_row(surface, bottom), surface->w)) {
+    bottom--;
+  }
+
+  int left = surface->w - 1;
+  int right = 0;
+  for (int y = top; y <= bottom; y++) {
+    const uint32_t* row = surface_row(surface, y);
+    for (int x = 0; x < left; x++) {
+      if (row[x] & ALPHA_MASK) {
+        left = x;
+        break;
+      }
+    }
+    for (int x = surface->w - 1; x > right; x--) {
+      if (row[x] & ALPHA_MASK) {
+        right = x;
+        break;
+      }
+    }
+  }
+  *bounds = (SDL_Rect){left, top, right - left + 1, bottom - top + 1};
+  return true;
+}
+
+static SDL_Surface* crop_surface(SDL_Surface* surface, const SDL_Rect* rect) {
+  SDL_Surface* cropped = SDL_CreateRGBSurfaceWithFormat(
+      0, rect->w, rect->h, 32, SDL_PIXELFORMAT_ARGB8888);
+  if (!cropped) {
+    LOG_SDL_ERROR("SDL_CreateRGBSurfaceWithFormat");
+    return NULL;
+  }
+  for (int y = 0; y < rect->h; y++) {
+    memcpy(surface_row(cropped, y), surface_row(surface, rect->y + y) + rect->x,
+           sizeof(uint32_t) * (size_t)rect->w);
+  }
+  return cropped;
+}
+
+SDL_Surface* preprocess_surface(SDL_Surface* source,
+                                const pixel_pipeline_options_t* options,
+                                pixel_pipeline_result_t* result) {
+  if (!source || !options) {
+    return NULL;
+  }
+
+  Uint32 format = source->format->format;
+  SDL_Surface* converted = NULL;
+  SDL_Surface* surface;
+  if (handled_format(format)) {
+    surface = SDL_CreateRGBSurfaceWithFormat(0, source->w, source->h, 32,
+                                             SDL_PIXELFORMAT_ARGB8888);
+  } else {
+    surface = converted = convert_with_sdl(source);
+  }
+  if (!surface) {
+    LOG_ERROR_FMT("Failed to convert image to ARGB8888: %s", SDL_GetError());
+    return NULL;
+  }
+
+  bool locked = !converted && SDL_MUSTLOCK(source);
+  if (locked && SDL_LockSurface(source) != 0) {
+    LOG_SDL_ERROR("SDL_LockSurface");
+    SDL_FreeSurface(surface);
+    return NULL;
+  }
+
+  uint32_t key = converted_key(source, options);
+  bool translucent = false;
+  for (int y = 0; y < surface->h; y++) {
+    uint32_t* row = surface_row(surface, y);
+    if (!converted) {
+      convert_row(row,
+                  (const uint8_t*)source->pixels + (size_t)y * source->pitch,
+                  surface->w, format);
+    }
+    if (options->colorkey) {
+      colorkey_to_alpha_span(row, surface->w, key);
+    }
+    if (options->premultiply) {
+      translucent = premultiply_span(row, surface->w) || translucent;
+    } else if (result && !translucent) {
+      translucent = has_partial_alpha(row, surface->w);
+    }
+  }
+  if (locked) {
+    SDL_UnlockSurface(source);
+  }
+
+  SDL_Rect kept = {0, 0, surface->w, surface->h};
+  if (options->trim && find_visible_bounds(surface, &kept) &&
+      (kept.w != surface->w || kept.h != surface->h)) {
+    SDL_Surface* cropped = crop_surface(surface, &kept);
+    SDL_FreeSurface(surface);
+    if (!cropped) {
+      return NULL;
+    }
+    surface = cropped;
+  } else {
+    kept = (SDL_Rect){0, 0, surface->w, surface->h};
+  }
+
+  if (result) {
+    result->kept = kept;
+    result->translucent = translucent;
+  }
+  return surface;
+}
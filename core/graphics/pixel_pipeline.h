@@ -0,0 +1,83 @@
+/**
+ * @file pixel_pipeline.h
+ * @brief Load-time pixel preprocessing with SIMD kernels
+ *
+ * Converts decoded images to ARGB8888, turns color keyed pixels into real
+ * transparent ones, optionally premultiplies alpha and trims transparent
+ * borders. Images are processed row by row so each row stays in cache
+ * through every step. RGBA, RGB and XRGB sources are converted by the
+ * pipeline itself; other formats go through SDL_ConvertSurfaceFormat().
+ *
+ * Like the CPU renderer, the span kernels use AVX2 when compiled with
+ * -mavx2, SSE2 on any other x86-64 build and scalar code elsewhere.
+ */
+
+#ifndef CORE_GRAPHICS_PIXEL_PIPELINE_H_
+#define CORE_GRAPHICS_PIXEL_PIPELINE_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+  bool colorkey;     // Make pixels of the key color transparent
+  Uint8 key_r;
+  Uint8 key_g;
+  Uint8 key_b;
+  bool premultiply;  // Scale color channels by alpha
+  bool trim;         // Crop fully transparent rows and columns
+} pixel_pipeline_options_t;
+
+typedef struct {
+  SDL_Rect kept;     // Area of the source the output covers
+  bool translucent;  // Some alpha other than 0 and 255
+} pixel_pipeline_result_t;
+
+/**
+ * @brief Run the pipeline on a surface
+ *
+ * The source is not modified; its own color key, if any, is ignored in
+ * favor of the options. A fully transparent image is never trimmed.
+ *
+ * @param source Decoded image
+ * @param options Steps to run
+ * @param result Receives the kept area and translucency (may be NULL)
+ * @return New ARGB8888 surface, or NULL on failure
+ */
+SDL_Surface* preprocess_surface(SDL_Surface* source,
+                                const pixel_pipeline_options_t* options,
+                                pixel_pipeline_result_t* result);
+
+/**
+ * @brief Convert 0xAABBGGRR pixels (RGBA bytes) to 0xAARRGGBB
+ * @param dst Destination pixels
+ * @param src Source pixels (may equal dst)
+ * @param count Number of pixels
+ */
+void convert_abgr_span(uint32_t* dst, const uint32_t* src, int count);
+
+/**
+ * @brief Make every pixel whose color is key_rgb fully transparent
+ * @param pixels ARGB8888 pixels, modified in place
+ * @param count Number of pixels
+ * @param key_rgb Key color as 0xRRGGBB
+ */
+void colorkey_to_alpha_span(uint32_t* pixels, int count, uint32_t key_rgb);
+
+/**
+ * @brief Premultiply ARGB8888 pixels in place
+ * @param pixels Pixels to premultiply
+ * @param count Number of pixels
+ * @return true if any pixel has alpha other than 0 and 255
+ */
+bool premultiply_span(uint32_t* pixels, int count);
+
+/**
+ * @brief Check pixels for alpha other than 0 and 255
+ * @param pixels ARGB8888 pixels
+ * @param count Number of pixels
+ * @return true if any pixel is partially transparent
+ */
+bool has_partial_alpha(const uint32_t* pixels, int count);
+
+#endif  // CORE_GRAPHICS_PIXEL_PIPELINE_H_
@@ -0,0 +1,315 @@
+/**
+ * @file polygon_mesh.c
+ * @brief Implementation of polygon triangulation and its cache
+ */
+
+#include "polygon_mesh.h"
+
+#include <SDL.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dynamic_array.h"
+#include "inline.h"
+#include "logger.h"
+
+typedef struct {
+  int vertex_count;
+  uint32_t signature;
+  int* indices;
+  int index_count;
+} polygon_cache_slot_t;
+
+static polygon_cache_slot_t polygon_cache[POLYGON_CACHE_SLOTS];
+
+// Fan indices handed out for convex polygons. The fan is kept at the
+// largest vertex count seen; its prefix is the fan of any smaller count.
+static int* fan_indices = NULL;
+static int fan_capacity = 0;
+static int fan_vertex_count = 0;
+
+// Corners not yet clipped, reused by every triangulation
+static int* remaining_scratch = NULL;
+static int remaining_capacity = 0;
+
+// Twice the signed area of triangle abc; positive for counter-clockwise
+// winding in a y-up frame
+static ALWAYS_INLINE float triangle_cross(SDL_FPoint a, SDL_FPoint b,
+                                          SDL_FPoint c) {
+  return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+static float polygon_orientation(const SDL_FPoint* points, int num_points) {
+  float area = 0.0f;
+  for (int i = 0; i < num_points; i++) {
+    const SDL_FPoint* a = &points[i];
+    const SDL_FPoint* b = &points[(i + 1) % num_points];
+    area += a->x * b->y - b->x * a->y;
+  }
+  return area >= 0.0f ? 1.0f : -1.0f;
+}
+
+static bool point_in_triangle(SDL_FPoint p, SDL_FPoint a, SDL_FPoint b,
+                              SDL_FPoint c, float orientation) {
+  return triangle_cross(a, b, p) * orientation >= 0.0f &&
+         triangle_cross(b, c, p) * orientation >= 0.0f &&
+         triangle_cross(c, a, p) * orientation >= 0.0f;
+}
+
+static bool is_ear(const SDL_FPoint* points, const int* remaining, int count,
+                   int k, float orientation) {
+  int prev = remaining[(k + count - 1) % count];
+  int cur = remaining[k];
+  int next = remaining[(k + 1) % count];
+  SDL_FPoint a = points[prev];
+  SDL_FPoint b = points[cur];
+  SDL_FPoint c = points[next];
+
+  float cross = triangle_cross(a, b, c) * orientation;
+  if (cross < 0.0f) {
+    return false;  // Reflex corner
+  }
+  if (cross == 0.0f) {
+    return true;  // Collinear corner, clipping it removes a zero-area sliver
+  }
+
+  for (int i = 0; i < count; i++) {
+    int v = remaining[i];
+    if (v == prev || v == cur || v == next) {
+      continue;
+    }
+    SDL_FPoint p = points[v];
+    if ((p.x == a.x && p.y == a.y) || (p.x == b.x && p.y == b.y) ||
+        (p.x == c.x && p.y == c.y)) {
+      continue;  // Duplicate vertex shared with the ear
+    }
+    if (point_in_triangle(p, a, b, c, orientation)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static int* reserve_remaining(int num_points) {
+  int* remaining = grow_array(remaining_scratch, &remaining_capacity,
+                              num_points, sizeof(int));
+  if (!remaining) {
+    LOG_ERROR("Failed to allocate polygon triangulation buffer");
+    return NULL;
+  }
+  remaining_scratch = remaining;
+  return remaining;
+}
+
+int triangulate_polygon(const SDL_FPoint* points, int num_points,
+                        int* out_indices) {
+  if (num_points < 3) {
+    return 0;
+  }
+
+  int* remaining = reserve_remaining(num_points);
+  if (!remaining) {
+    return 0;
+  }
+  for (int i = 0; i < num_points; i++) {
+    remaining[i] = i;
+  }
+
+  float orientation = polygon_orientation(points, num_points);
+  int count = num_points;
+  int written = 0;
+  int k = 0;
+  int attempts = 0;
+
+  while (count > 3 && attempts < count) {
+    if (!is_ear(points, remaining, count, k, orientation)) {
+      k = (k + 1) % count;
+      attempts++;
+      continue;
+    }
+
+    out_indices[written++] = remaining[(k + count - 1) % count];
+    out_indices[written++] = remaining[k];
+    out_indices[written++] = remaining[(k + 1) % count];
+
+    memmove(&remaining[k], &remaining[k + 1],
+            sizeof(int) * (size_t)(count - k - 1));
+    count--;
+    if (k >= count) {
+      k = 0;
+    }
+    attempts = 0;
+  }
+
+  // Fan whatever is left: the last triangle, or the rest of a polygon that
+  // is not simple and has no ear left
+  for (int i = 1; i + 1 < count; i++) {
+    out_indices[written++] = remaining[0];
+    out_indices[written++] = remaining[i];
+    out_indices[written++] = remaining[i + 1];
+  }
+
+  return written;
+}
+
+// A cached triangulation is valid for new vertex positions when replaying
+// its ears in order passes the same tests triangulate_polygon() made:
+// every clipped corner is still convex and its triangle still holds none
+// of the remaining vertices. This survives translation, rotation and
+// uniform scaling, and rejects any other shape sharing the signature.
+static bool triangulation_matches(const SDL_FPoint* points, int num_points,
+                                  const int* indices, int index_count) {
+  if (index_count != 3 * (num_points - 2)) {
+    return false;
+  }
+
+  int* remaining = reserve_remaining(num_points);
+  if (!remaining) {
+    return false;
+  }
+  for (int i = 0; i < num_points; i++) {
+    remaining[i] = i;
+  }
+
+  float orientation = polygon_orientation(points, num_points);
+  int count = num_points;
+  bool matches = true;
+  for (int i = 0; matches && count > 3; i += 3) {
+    int k = 0;
+    while (k < count && remaining[k] != indices[i + 1]) {
+      k++;
+    }
+    matches = k < count &&
+              remaining[(k + count - 1) % count] == indices[i] &&
+              remaining[(k + 1) % count] == indices[i + 2] &&
+              is_ear(points, remaining, count, k, orientation);
+    if (matches) {
+      memmove(&remaining[k], &remaining[k + 1],
+              sizeof(int) * (size_t)(count - k - 1));
+      count--;
+    }
+  }
+
+  // The last triangle is whatever three corners are left
+  if (matches) {
+    const int* last = &indices[index_count - 3];
+    matches = last[0] == remaining[0] && last[1] == remaining[1] &&
+              last[2] == remaining[2];
+  }
+
+  return matches;
+}
+
+static const int* convex_fan(int num_points, int* out_index_count) {
+  if (num_points > fan_vertex_count) {
+    int* indices = grow_array(fan_indices, &fan_capacity, 3 * (num_points - 2),
+                              sizeof(int));
+    if (!indices) {
+      LOG_ERROR("Failed to allocate polygon fan indices");
+      return NULL;
+    }
+    fan_indices = indices;
+    for (int i = fan_vertex_count > 2 ? fan_vertex_count - 1 : 1;
+         i + 1 < num_points; i++) {
+      fan_indices[(i - 1) * 3] = 0;
+      fan_indices[(i - 1) * 3 + 1] = i;
+      fan_indices[(i - 1) * 3 + 2] = i + 1;
+    }
+    fan_vertex_count = num_points;
+  }
+  *out_index_count = 3 * (num_points - 2);
+  return fan_indices;
+}
+
+const int* cached_polygon_triangulation(const SDL_FPoint* points,
+                                        int num_points, int* out_index_count) {
+  *out_index_count = 0;
+  if (num_points < 3) {
+    return NULL;
+  }
+
+  // The pattern of reflex corners identifies a shape under rigid motion
+  float orientation = polygon_orientation(points, num_points);
+  uint32_t signature = 2166136261u;
+  bool convex = true;
+  for (int i = 0; i < num_points; i++) {
+    float cross = triangle_cross(points[(i + num_points - 1) % num_points],
+                                 points[i], points[(i + 1) % num_points]);
+    bool reflex = cross * orientation < 0.0f;
+    convex = convex && !reflex;
+    signature = (signature ^ (uint32_t)reflex) * 16777619u;
+  }
+  signature = (signature ^ (uint32_t)num_points) * 16777619u;
+
+  if (convex) {
+    return convex_fan(num_points, out_index_count);
+  }
+
+  polygon_cache_slot_t* slot = &polygon_cache[signature % POLYGON_CACHE_SLOTS];
+  if (slot->indices && slot->vertex_count == num_points &&
+      slot->signature == signature &&
+      triangulation_matches(points, num_points, slot->indices,
+                            slot->index_count)) {
+    *out_index_count = slot->index_count;
+    return slot->indices;
+  }
+
+  if (slot->vertex_count != num_points || !slot->indices) {
+    int* indices =
+        realloc(slot->indices, sizeof(int) * 3 * (size_t)(num_points - 2));
+    if (!indices) {
+      LOG_ERROR("Failed to allocate polygon cache entry");
+      return NULL;
+    }
+    slot->indices = indices;
+  }
+
+  slot->vertex_count = num_points;
+  slot->signature = signature;
+  slot->index_count = triangulate_polygon(points, num_points, slot->indices);
+  *out_index_count = slot->index_count;
+  return slot->index_count > 0 ? slot->indices : NULL;
+}
+
+void clear_polygon_cache(void) {
+  for (int i = 0; i < POLYGON_CACHE_SLOTS; i++) {
+    free(polygon_cache[i].indices);
+    polygon_cache[i].indices = NULL;
+    polygon_cache[i].vertex_count = 0;
+    polygon_cache[i].index_count = 0;
+  }
+  free(fan_indices);
+  fan_indices = NULL;
+  fan_capacity = 0;
+  fan_vertex_count = 0;
+  free(remaining_scratch);
+  remaining_scratch = NULL;
+  remaining_capacity = 0;
+}
+
+polygon_mesh_t create_polygon_mesh(const SDL_FPoint* points, int num_points) {
+  polygon_mesh_t mesh = {NULL, 0, 0};
+  if (num_points < 3) {
+    return mesh;
+  }
+
+  mesh.indices = malloc(sizeof(int) * 3 * (size_t)(num_points - 2));
+  if (!mesh.indices) {
+    LOG_ERROR("Failed to allocate polygon mesh");
+    return mesh;
+  }
+
+  mesh.index_count = triangulate_polygon(points, num_points, mesh.indices);
+  mesh.vertex_count = num_points;
+  return mesh;
+}
+
+void free_polygon_mesh(polygon_mesh_ptr mesh) {
+  if (mesh && mesh->indices) {
+    free(mesh->indices);
+    mesh->indices = NULL;
+    mesh->index_count = 0;
+    mesh->vertex_count = 0;
+  }
+}
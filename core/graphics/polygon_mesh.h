@@ -0,0 +1,77 @@
+/**
+ * @file polygon_mesh.h
+ * @brief Ear-clipping triangulation of simple polygons with caching
+ *
+ * Triangulates convex and concave polygons into index buffers that refer
+ * directly to the polygon vertices, so a filled N-gon is N vertices and
+ * N - 2 triangles in a single indexed SDL_RenderGeometry submission.
+ * Triangulations are reused across frames: a rigidly moved, rotated or
+ * uniformly scaled shape keeps its triangulation, which is revalidated by
+ * replaying its ear tests in order instead of searching for ears again.
+ */
+
+#ifndef CORE_GRAPHICS_POLYGON_MESH_H_
+#define CORE_GRAPHICS_POLYGON_MESH_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+
+// Number of distinct concave shapes remembered by the triangulation cache
+#define POLYGON_CACHE_SLOTS 64
+
+/**
+ * Triangulated polygon shape. Indices refer to the shape's vertices, so the
+ * mesh can be drawn with any rigidly transformed copy of those vertices.
+ */
+typedef struct {
+  int* indices;
+  int index_count;
+  int vertex_count;
+} polygon_mesh_t, *polygon_mesh_ptr;
+
+/**
+ * @brief Triangulate a simple polygon by ear clipping
+ * @param points Polygon vertices in either winding order
+ * @param num_points Number of vertices (at least 3)
+ * @param out_indices Output buffer of at least 3 * (num_points - 2) indices
+ * @return Number of indices written, or 0 for fewer than 3 vertices
+ */
+int triangulate_polygon(const SDL_FPoint* points, int num_points,
+                        int* out_indices);
+
+/**
+ * @brief Triangulate a polygon, reusing a cached triangulation when valid
+ *
+ * Convex polygons are fanned from their first vertex without touching the
+ * cache. The returned buffer is owned by the cache and stays valid until
+ * the next call.
+ *
+ * @param points Polygon vertices in either winding order
+ * @param num_points Number of vertices (at least 3)
+ * @param out_index_count Output number of indices
+ * @return Index buffer, or NULL on failure
+ */
+const int* cached_polygon_triangulation(const SDL_FPoint* points,
+                                        int num_points, int* out_index_count);
+
+/**
+ * @brief Clear the triangulation cache and release its memory, including
+ *        the scratch buffers shared by triangulate_polygon()
+ */
+void clear_polygon_cache(void);
+
+/**
+ * @brief Triangulate a shape once for repeated drawing
+ * @param points Shape vertices in local coordinates
+ * @param num_points Number of vertices
+ * @return Mesh (caller must call free_polygon_mesh); empty on failure
+ */
+polygon_mesh_t create_polygon_mesh(const SDL_FPoint* points, int num_points);
+
+/**
+ * @brief Release a polygon mesh
+ * @param mesh Mesh to free
+ */
+void free_polygon_mesh(polygon_mesh_ptr mesh);
+
+#endif  // CORE_GRAPHICS_POLYGON_MESH_H_
@@ -0,0 +1,465 @@
+/**
+ * @file primitive_batch.c
+ * @brief Implementation of per-color primitive batching
+ */
+
+#include "primitive_batch.h"
+
+#include <SDL.h>
+#include <stdlib.h>
+
+#include "cpu_renderer.h"
+#include "dynamic_array.h"
+#include "logger.h"
+#include "render_queue.h"
+#include "render_state.h"
+
+static primitive_batch_ptr get_primitive_batch(
+    const graphics_context_ptr graphics_context) {
+  if (!graphics_context || !graphics_context->renderer) {
+    return NULL;
+  }
+
+  if (!graphics_context->primitive_batch) {
+    graphics_context->primitive_batch = calloc(1, sizeof(primitive_batch_t));
+    if (!graphics_context->primitive_batch) {
+      LOG_ERROR("Failed to allocate primitive batch");
+      return NULL;
+    }
+  }
+
+  // The CPU backend rasterizes at flush time, so it always batches
+  primitive_batch_ptr batch = graphics_context->primitive_batch;
+  return batch->disabled && !graphics_context->cpu_renderer ? NULL : batch;
+}
+
+static void flush_bucket_cpu(cpu_renderer_ptr cpu,
+                             primitive_bucket_t* bucket) {
+  uint32_t argb = CPU_COLOR(bucket->color, 255);
+  cpu_fill_rects(cpu, bucket->rects, bucket->rect_count, argb);
+
+  int offset = 0;
+  for (int i = 0; i < bucket->line_run_count; i++) {
+    cpu_draw_lines(cpu, bucket->line_points + offset, bucket->line_runs[i],
+                   argb);
+    offset += bucket->line_runs[i];
+  }
+
+  cpu_draw_points(cpu, bucket->points, bucket->point_count, argb);
+}
+
+static void flush_bucket_sdl(const graphics_context_ptr graphics_context,
+                             primitive_bucket_t* bucket) {
+  SDL_Renderer* renderer = graphics_context->renderer;
+  apply_draw_color(graphics_context, R(bucket->color), G(bucket->color),
+                   B(bucket->color), 255);
+
+  if (bucket->rect_count > 0) {
+    SDL_RenderFillRects(renderer, bucket->rects, bucket->rect_count);
+  }
+
+  int offset = 0;
+  for (int i = 0; i < bucket->line_run_count; i++) {
+    SDL_RenderDrawLines(renderer, bucket->line_points + offset,
+                        bucket->line_runs[i]);
+    offset += bucket->line_runs[i];
+  }
+
+  if (bucket->point_count > 0) {
+    SDL_RenderDrawPoints(renderer, bucket->points, bucket->point_count);
+  }
+}
+
+static void flush_bucket(const graphics_context_ptr graphics_context,
+                         primitive_bucket_t* bucket) {
+  if (graphics_context->cpu_renderer) {
+    flush_bucket_cpu(graphics_context->cpu_renderer, bucket);
+  } else {
+    flush_bucket_sdl(graphics_context, bucket);
+  }
+
+  bucket->rect_count = 0;
+  bucket->line_point_count = 0;
+  bucket->line_run_count = 0;
+  bucket->point_count = 0;
+}
+
+static void flush_buckets(const graphics_context_ptr graphics_context,
+                          primitive_batch_ptr batch) {
+  for (int i = 0; i < batch->bucket_count; i++) {
+    flush_bucket(graphics_context, &batch->buckets[i]);
+  }
+  batch->bucket_count = 0;
+  batch->last_bucket = 0;
+
+  if (batch->index_count > 0 && graphics_context->cpu_renderer) {
+    cpu_draw_geometry(graphics_context->cpu_renderer, batch->vertices,
+                      batch->vertex_count, batch->indices, batch->index_count);
+  } else if (batch->index_count > 0) {
+    SDL_RenderGeometry(graphics_context->renderer, NULL, batch->vertices,
+                       batch->vertex_count, batch->indices, batch->index_count);
+  }
+  batch->vertex_count = 0;
+  batch->index_count = 0;
+}
+
+static void flush_quads(const graphics_context_ptr graphics_context,
+                        primitive_batch_ptr batch) {
+  if (batch->quad_count == 0) {
+    return;
+  }
+  SDL_RenderGeometry(graphics_context->renderer, batch->quad_texture,
+                     batch->quad_vertices, batch->quad_count * 4,
+                     batch->quad_indices, batch->quad_count * 6);
+  batch->quad_count = 0;
+  batch->quad_texture = NULL;
+}
+
+// Batch for a primitive; pending sprite quads are drawn first so a
+// primitive issued after a sprite still lands on top of it
+static primitive_batch_ptr get_untextured_batch(
+    const graphics_context_ptr graphics_context) {
+  primitive_batch_ptr batch = get_primitive_batch(graphics_context);
+  if (batch) {
+    flush_quads(graphics_context, batch);
+  }
+  return batch;
+}
+
+// Find the bucket collecting `color`, claiming a new one if needed. Buckets
+// keep their buffers across flushes so steady-state frames never allocate.
+static primitive_bucket_t* bucket_for_color(
+    const graphics_context_ptr graphics_context, primitive_batch_ptr batch,
+    color_t color) {
+  // Buckets are drawn before the triangles, so triangles queued earlier
+  // must go out first to stay underneath
+  if (batch->index_count > 0) {
+    flush_buckets(graphics_context, batch);
+  }
+
+  if (batch->bucket_count > 0 &&
+      batch->buckets[batch->last_bucket].color == color) {
+    return &batch->buckets[batch->last_bucket];
+  }
+
+  for (int i = 0; i < batch->bucket_count; i++) {
+    if (batch->buckets[i].color == color) {
+      batch->last_bucket = i;
+      return &batch->buckets[i];
+    }
+  }
+
+  if (batch->bucket_count == PRIMITIVE_BATCH_MAX_COLORS) {
+    flush_buckets(graphics_context, batch);
+  }
+
+  batch->last_bucket = batch->bucket_count++;
+  primitive_bucket_t* bucket = &batch->buckets[batch->last_bucket];
+  bucket->color = color;
+  return bucket;
+}
+
+void set_primitive_batching(const graphics_context_ptr graphics_context,
+                            bool enabled) {
+  if (!graphics_context) {
+    return;
+  }
+
+  if (!enabled) {
+    flush_primitive_batch(graphics_context);
+  }
+
+  // Allocates the batch if needed so the setting holds before the first draw
+  get_primitive_batch(graphics_context);
+  if (graphics_context->primitive_batch) {
+    graphics_context->primitive_batch->disabled = !enabled;
+  }
+}
+
+bool batch_line(const graphics_context_ptr graphics_context, int x1, int y1,
+                int x2, int y2, color_t color) {
+  SDL_Point segment[2] = {{x1, y1}, {x2, y2}};
+  if (queue_polyline(graphics_context, segment, 2, color)) {
+    return true;
+  }
+
+  primitive_batch_ptr batch = get_untextured_batch(graphics_context);
+  if (!batch) {
+    return false;
+  }
+
+  primitive_bucket_t* bucket = bucket_for_color(graphics_context, batch, color);
+
+  // Extend the open polyline when this segment starts where the last ended
+  if (bucket->line_run_count > 0) {
+    SDL_Point* last = &bucket->line_points[bucket->line_point_count - 1];
+    if (last->x == x1 && last->y == y1) {
+      SDL_Point* points =
+          grow_array(bucket->line_points, &bucket->line_point_capacity,
+                     bucket->line_point_count + 1, sizeof(SDL_Point));
+      if (!points) {
+        return false;
+      }
+      bucket->line_points = points;
+      bucket->line_points[bucket->line_point_count++] = (SDL_Point){x2, y2};
+      bucket->line_runs[bucket->line_run_count - 1]++;
+      return true;
+    }
+  }
+
+  SDL_Point* points =
+      grow_array(bucket->line_points, &bucket->line_point_capacity,
+                 bucket->line_point_count + 2, sizeof(SDL_Point));
+  if (!points) {
+    return false;
+  }
+  bucket->line_points = points;
+
+  int* runs = grow_array(bucket->line_runs, &bucket->line_run_capacity,
+                         bucket->line_run_count + 1, sizeof(int));
+  if (!runs) {
+    return false;
+  }
+  bucket->line_runs = runs;
+
+  bucket->line_points[bucket->line_point_count++] = (SDL_Point){x1, y1};
+  bucket->line_points[bucket->line_point_count++] = (SDL_Point){x2, y2};
+  bucket->line_runs[bucket->line_run_count++] = 2;
+  return true;
+}
+
+bool batch_polyline(const graphics_context_ptr graphics_context,
+                    const SDL_Point* points, int count, color_t color) {
+  if (queue_polyline(graphics_context, points, count, color)) {
+    return true;
+  }
+
+  primitive_batch_ptr batch = get_untextured_batch(graphics_context);
+  if (!batch || count < 2) {
+    return false;
+  }
+
+  primitive_bucket_t* bucket = bucket_for_color(graphics_context, batch, color);
+  SDL_Point* grown =
+      grow_array(bucket->line_points, &bucket->line_point_capacity,
+                 bucket->line_point_count + count, sizeof(SDL_Point));
+  if (!grown) {
+    return false;
+  }
+  bucket->line_points = grown;
+
+  int* runs = grow_array(bucket->line_runs, &bucket->line_run_capacity,
+                         bucket->line_run_count + 1, sizeof(int));
+  if (!runs) {
+    return false;
+  }
+  bucket->line_runs = runs;
+
+  for (int i = 0; i < count; i++) {
+    bucket->line_points[bucket->line_point_count++] = points[i];
+  }
+  bucket->line_runs[bucket->line_run_count++] = count;
+  return true;
+}
+
+bool batch_point(const graphics_context_ptr graphics_context, int x, int y,
+                 color_t color) {
+  SDL_Point point = {x, y};
+  return batch_points(graphics_context, &point, 1, color);
+}
+
+bool batch_points(const graphics_context_ptr graphics_context,
+                  const SDL_Point* points, int count, color_t color) {
+  if (queue_points(graphics_context, points, count, color)) {
+    return true;
+  }
+
+  primitive_batch_ptr batch = get_untextured_batch(graphics_context);
+  if (!batch) {
+    return false;
+  }
+
+  primitive_bucket_t* bucket = bucket_for_color(graphics_context, batch, color);
+  SDL_Point* grown = grow_array(bucket->points, &bucket->point_capacity,
+                                bucket->point_count + count, sizeof(SDL_Point));
+  if (!grown) {
+    return false;
+  }
+  bucket->points = grown;
+
+  for (int i = 0; i < count; i++) {
+    bucket->points[bucket->point_count++] = points[i];
+  }
+  return true;
+}
+
+bool batch_filled_rect(const graphics_context_ptr graphics_context, int x,
+                       int y, int width, int height, color_t color) {
+  SDL_Rect rect = {x, y, width, height};
+  if (queue_filled_rect(graphics_context, &rect, color)) {
+    return true;
+  }
+
+  primitive_batch_ptr batch = get_untextured_batch(graphics_context);
+  if (!batch) {
+    return false;
+  }
+
+  primitive_bucket_t* bucket = bucket_for_color(graphics_context, batch, color);
+  SDL_Rect* rects = grow_array(bucket->rects, &bucket->rect_capacity,
+                               bucket->rect_count + 1, sizeof(SDL_Rect));
+  if (!rects) {
+    return false;
+  }
+  bucket->rects = rects;
+  bucket->rects[bucket->rect_count++] = (SDL_Rect){x, y, width, height};
+  return true;
+}
+
+bool batch_geometry(const graphics_context_ptr graphics_context,
+                    const SDL_Vertex* vertices, int vertex_count,
+                    const int* indices, int index_count) {
+  if (queue_geometry(graphics_context, vertices, vertex_count, indices,
+                     index_count)) {
+    return true;
+  }
+
+  primitive_batch_ptr batch = get_untextured_batch(graphics_context);
+  if (!batch) {
+    return false;
+  }
+
+  SDL_Vertex* grown_vertices =
+      grow_array(batch->vertices, &batch->vertex_capacity,
+                 batch->vertex_count + vertex_count, sizeof(SDL_Vertex));
+  if (!grown_vertices) {
+    return false;
+  }
+  batch->vertices = grown_vertices;
+
+  int* grown_indices = grow_array(batch->indices, &batch->index_capacity,
+                                  batch->index_count + index_count, sizeof(int));
+  if (!grown_indices) {
+    return false;
+  }
+  batch->indices = grown_indices;
+
+  // Rebase indices onto the vertices already queued
+  int base = batch->vertex_count;
+  for (int i = 0; i < index_count; i++) {
+    batch->indices[batch->index_count++] = base + indices[i];
+  }
+  for (int i = 0; i < vertex_count; i++) {
+    batch->vertices[batch->vertex_count++] = vertices[i];
+  }
+  return true;
+}
+
+// Grow the quad buffers to `count` quads, extending the 0-1-2, 2-3-0
+// index pattern over any new capacity
+static bool reserve_quads(primitive_batch_ptr batch, int count) {
+  SDL_Vertex* vertices =
+      grow_array(batch->quad_vertices, &batch->quad_vertex_capacity,
+                 count * 4, sizeof(SDL_Vertex));
+  if (!vertices) {
+    return false;
+  }
+  batch->quad_vertices = vertices;
+
+  if (batch->indexed_quads >= count) {
+    return true;
+  }
+  int* indices = grow_array(batch->quad_indices, &batch->quad_index_capacity,
+                            count * 6, sizeof(int));
+  if (!indices) {
+    return false;
+  }
+  batch->quad_indices = indices;
+
+  int quads = batch->quad_index_capacity / 6;
+  for (int i = batch->indexed_quads; i < quads; i++) {
+    int* quad = &batch->quad_indices[i * 6];
+    int base = i * 4;
+    quad[0] = base;
+    quad[1] = base + 1;
+    quad[2] = base + 2;
+    quad[3] = base + 2;
+    quad[4] = base + 3;
+    quad[5] = base;
+  }
+  batch->indexed_quads = quads;
+  return true;
+}
+
+bool batch_textured_quad(const graphics_context_ptr graphics_context,
+                         SDL_Texture* texture, int texture_width,
+                         int texture_height, const SDL_Rect* src,
+                         const SDL_FRect* dst, SDL_Color color) {
+  // The CPU backend blits sprites itself
+  if (!graphics_context || graphics_context->cpu_renderer || !texture ||
+      texture_width <= 0 || texture_height <= 0) {
+    return false;
+  }
+  primitive_batch_ptr batch = get_primitive_batch(graphics_context);
+  if (!batch) {
+    return false;
+  }
+
+  if (batch->bucket_count > 0 || batch->index_count > 0) {
+    flush_buckets(graphics_context, batch);
+  }
+  if (batch->quad_texture != texture) {
+    flush_quads(graphics_context, batch);
+  }
+  if (!reserve_quads(batch, batch->quad_count + 1)) {
+    return false;
+  }
+  batch->quad_texture = texture;
+  SDL_BlendMode blend_mode;
+  SDL_GetTextureBlendMode(texture, &blend_mode);
+  color = texture_modulation(blend_mode, color);
+
+  float u0 = (float)src->x / (float)texture_width;
+  float v0 = (float)src->y / (float)texture_height;
+  float u1 = (float)(src->x + src->w) / (float)texture_width;
+  float v1 = (float)(src->y + src->h) / (float)texture_height;
+  SDL_Vertex* quad = &batch->quad_vertices[batch->quad_count * 4];
+  quad[0] = (SDL_Vertex){{dst->x, dst->y}, color, {u0, v0}};
+  quad[1] = (SDL_Vertex){{dst->x + dst->w, dst->y}, color, {u1, v0}};
+  quad[2] = (SDL_Vertex){{dst->x + dst->w, dst->y + dst->h}, color, {u1, v1}};
+  quad[3] = (SDL_Vertex){{dst->x, dst->y + dst->h}, color, {u0, v1}};
+  batch->quad_count++;
+  return true;
+}
+
+void flush_primitive_batch(const graphics_context_ptr graphics_context) {
+  // Replaying the queue feeds this batch and flushes it again per layer
+  flush_render_queue(graphics_context);
+
+  if (!graphics_context || !graphics_context->primitive_batch ||
+      !graphics_context->renderer) {
+    return;
+  }
+  flush_buckets(graphics_context, graphics_context->primitive_batch);
+  flush_quads(graphics_context, graphics_context->primitive_batch);
+}
+
+void destroy_primitive_batch(const graphics_context_ptr graphics_context) {
+  if (!graphics_context || !graphics_context->primitive_batch) {
+    return;
+  }
+
+  primitive_batch_ptr batch = graphics_context->primitive_batch;
+  for (int i = 0; i < PRIMITIVE_BATCH_MAX_COLORS; i++) {
+    free(batch->buckets[i].line_points);
+    free(batch->buckets[i].line_runs);
+    free(batch->buckets[i].points);
+    free(batch->buckets[i].rects);
+  }
+  free(batch->vertices);
+  free(batch->indices);
+  free(batch->quad_vertices);
+  free(batch->quad_indices);
+  free(batch);
+  graphics_context->primitive_batch = NULL;
+}
@@ -0,0 +1,189 @@
+/**
+ * @file primitive_batch.h
+ * @brief Per-color batching of lines, points and filled rectangles
+ *
+ * Collects the primitives issued through drawing_primitives.h into per-color
+ * arrays and submits each color with one SDL_RenderDrawLines run per connected
+ * polyline, one SDL_RenderDrawPoints call and one SDL_RenderFillRects call.
+ * Untextured triangles (thick lines, filled shapes) carry their color per
+ * vertex and are submitted together in one SDL_RenderGeometry call after
+ * the color buckets; a line, point or rectangle queued after triangles
+ * flushes the batch first, so triangles never cover later primitives.
+ * Consecutive faded or tinted sprites from one texture are collected as
+ * vertex-colored quads and drawn with one SDL_RenderGeometry call as well,
+ * instead of changing the texture's modulation around every copy; sprites
+ * and primitives flush each other, so their relative order is kept.
+ * The batch is flushed automatically before any other engine rendering call
+ * (textures, geometry, clear, present), so draw order is only relaxed between
+ * primitives of different colors issued back to back. While the render queue
+ * is enabled, primitives are recorded there first (see render_queue.h).
+ */
+
+#ifndef CORE_GRAPHICS_PRIMITIVE_BATCH_H_
+#define CORE_GRAPHICS_PRIMITIVE_BATCH_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+
+#include "color.h"
+#include "graphics_context.h"
+
+// Number of distinct colors held at once before the batch flushes itself
+#define PRIMITIVE_BATCH_MAX_COLORS 32
+
+// Primitives queued for a single opaque color
+typedef struct {
+  color_t color;
+  SDL_Point* line_points;  // Polyline runs stored back to back
+  int line_point_count;
+  int line_point_capacity;
+  int* line_runs;  // Number of points in each polyline run
+  int line_run_count;
+  int line_run_capacity;
+  SDL_Point* points;
+  int point_count;
+  int point_capacity;
+  SDL_Rect* rects;
+  int rect_count;
+  int rect_capacity;
+} primitive_bucket_t;
+
+typedef struct primitive_batch {
+  primitive_bucket_t buckets[PRIMITIVE_BATCH_MAX_COLORS];
+  int bucket_count;
+  int last_bucket;  // Bucket hit by the previous call, checked first
+  SDL_Vertex* vertices;  // Untextured triangles of every color
+  int vertex_count;
+  int vertex_capacity;
+  int* indices;
+  int index_count;
+  int index_capacity;
+  SDL_Texture* quad_texture;  // Texture of the pending sprite quads
+  SDL_Vertex* quad_vertices;  // Four per quad
+  int quad_count;
+  int quad_vertex_capacity;
+  int* quad_indices;  // Six per quad, built once per capacity change
+  int quad_index_capacity;
+  int indexed_quads;  // Quads covered by the index pattern
+  bool disabled;
+} primitive_batch_t, *primitive_batch_ptr;
+
+/**
+ * @brief Enable or disable primitive batching (enabled by default)
+ * @param graphics_context Graphics context owning the batch
+ * @param enabled false flushes pending primitives and draws immediately
+ */
+void set_primitive_batching(const graphics_context_ptr graphics_context,
+                            bool enabled);
+
+/**
+ * @brief Queue a line segment, extending the current polyline if connected
+ * @param graphics_context Graphics context owning the batch
+ * @param x1 Starting x coordinate
+ * @param y1 Starting y coordinate
+ * @param x2 Ending x coordinate
+ * @param y2 Ending y coordinate
+ * @param color Line color
+ * @return false if batching is disabled and the caller must draw directly
+ */
+bool batch_line(const graphics_context_ptr graphics_context, int x1, int y1,
+                int x2, int y2, color_t color);
+
+/**
+ * @brief Queue a connected polyline as one line run
+ * @param graphics_context Graphics context owning the batch
+ * @param points Polyline vertices; repeat the first one to close a loop
+ * @param count Number of vertices (at least 2)
+ * @param color Line color
+ * @return false if batching is disabled and the caller must draw directly
+ */
+bool batch_polyline(const graphics_context_ptr graphics_context,
+                    const SDL_Point* points, int count, color_t color);
+
+/**
+ * @brief Queue a single point
+ * @param graphics_context Graphics context owning the batch
+ * @param x X coordinate
+ * @param y Y coordinate
+ * @param color Point color
+ * @return false if batching is disabled and the caller must draw directly
+ */
+bool batch_point(const graphics_context_ptr graphics_context, int x, int y,
+                 color_t color);
+
+/**
+ * @brief Queue a list of points sharing one color
+ * @param graphics_context Graphics context owning the batch
+ * @param points Points to queue
+ * @param count Number of points
+ * @param color Point color
+ * @return false if batching is disabled and the caller must draw directly
+ */
+bool batch_points(const graphics_context_ptr graphics_context,
+                  const SDL_Point* points, int count, color_t color);
+
+/**
+ * @brief Queue a filled rectangle
+ * @param graphics_context Graphics context owning the batch
+ * @param x X coordinate of top-left corner
+ * @param y Y coordinate of top-left corner
+ * @param width Rectangle width
+ * @param height Rectangle height
+ * @param color Fill color
+ * @return false if batching is disabled and the caller must draw directly
+ */
+bool batch_filled_rect(const graphics_context_ptr graphics_context, int x,
+                       int y, int width, int height, color_t color);
+
+/**
+ * @brief Queue indexed untextured triangles
+ * @param graphics_context Graphics context owning the batch
+ * @param vertices Triangle vertices, colored per vertex
+ * @param vertex_count Number of vertices
+ * @param indices Vertex indices, three per triangle, relative to vertices
+ * @param index_count Number of indices
+ * @return false if batching is disabled and the caller must draw directly
+ */
+bool batch_geometry(const graphics_context_ptr graphics_context,
+                    const SDL_Vertex* vertices, int vertex_count,
+                    const int* indices, int index_count);
+
+/**
+ * @brief Queue a textured quad colored per vertex
+ *
+ * The texture must stay alive until the batch is flushed, i.e. until the
+ * next non-batched rendering call or the end of the frame.
+ *
+ * @param graphics_context Graphics context owning the batch
+ * @param texture Texture sampled by the quad
+ * @param texture_width Texture width in pixels
+ * @param texture_height Texture height in pixels
+ * @param src Source rectangle in texture pixels
+ * @param dst Destination rectangle
+ * @param color Color and alpha multiplied with the texture
+ * @return false if batching is disabled and the caller must draw directly
+ */
+bool batch_textured_quad(const graphics_context_ptr graphics_context,
+                         SDL_Texture* texture, int texture_width,
+                         int texture_height, const SDL_Rect* src,
+                         const SDL_FRect* dst, SDL_Color color);
+
+/**
+ * @brief Submit all queued primitives to the renderer
+ *
+ * Called by the engine before any non-batched rendering call. Games that
+ * mix raw SDL rendering calls with drawing primitives must call it before
+ * their own SDL calls to keep the intended order. Also flushes the render
+ * queue when it is enabled.
+ *
+ * @param graphics_context Graphics context owning the batch
+ */
+void flush_primitive_batch(const graphics_context_ptr graphics_context);
+
+/**
+ * @brief Release the batch buffers owned by a graphics context
+ * @param graphics_context Graphics context owning the batch
+ */
+void destroy_primitive_batch(const graphics_context_ptr graphics_context);
+
+#endif  // CORE_GRAPHICS_PRIMITIVE_BATCH_H_
@@ -0,0 +1,178 @@
+/**
+ * @file rect_packer.c
+ * @brief Implementation of the MaxRects rectangle packer
+ */
+
+#include "rect_packer.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+#include "dynamic_array.h"
+#include "logger.h"
+
+static bool push_free_rect(rect_packer_ptr packer, SDL_Rect rect) {
+  SDL_Rect* rects = grow_array(packer->free_rects, &packer->free_capacity,
+                               packer->free_count + 1, sizeof(SDL_Rect));
+  if (!rects) {
+    return false;
+  }
+  packer->free_rects = rects;
+  packer->free_rects[packer->free_count++] = rect;
+  return true;
+}
+
+rect_packer_ptr create_rect_packer(int width, int height) {
+  if (width <= 0 || height <= 0) {
+    return NULL;
+  }
+
+  rect_packer_ptr packer = calloc(1, sizeof(rect_packer_t));
+  if (!packer) {
+    LOG_ERROR("Failed to allocate rect packer");
+    return NULL;
+  }
+  packer->width = width;
+  packer->height = height;
+  if (!push_free_rect(packer, (SDL_Rect){0, 0, width, height})) {
+    LOG_ERROR("Failed to allocate rect packer");
+    free(packer);
+    return NULL;
+  }
+  return packer;
+}
+
+void destroy_rect_packer(rect_packer_ptr packer) {
+  if (!packer) {
+    return;
+  }
+  free(packer->free_rects);
+  free(packer);
+}
+
+static inline bool contains(const SDL_Rect* outer, const SDL_Rect* inner) {
+  return inner->x >= outer->x && inner->y >= outer->y &&
+         inner->x + inner->w <= outer->x + outer->w &&
+         inner->y + inner->h <= outer->y + outer->h;
+}
+
+// Replace every free rectangle overlapping `used` by the up to four maximal
+// rectangles left around it
+static bool split_free_rects(rect_packer_ptr packer, const SDL_Rect* used) {
+  int count = packer->free_count;
+  for (int i = 0; i < count;) {
+    SDL_Rect free_rect = packer->free_rects[i];
+    if (!SDL_HasIntersection(&free_rect, used)) {
+      i++;
+      continue;
+    }
+
+    int free_right = free_rect.x + free_rect.w;
+    int free_bottom = free_rect.y + free_rect.h;
+    int used_right = used->x + used->w;
+    int used_bottom = used->y + used->h;
+    bool ok = true;
+    if (used->x > free_rect.x) {
+      ok = ok && push_free_rect(packer, (SDL_Rect){free_rect.x, free_rect.y,
+                                                   used->x - free_rect.x,
+                                                   free_rect.h});
+    }
+    if (used_right < free_right) {
+      ok = ok && push_free_rect(packer, (SDL_Rect){used_right, free_rect.y,
+                                                   free_right - used_right,
+                                                   free_rect.h});
+    }
+    if (used->y > free_rect.y) {
+      ok = ok && push_free_rect(packer, (SDL_Rect){free_rect.x, free_rect.y,
+                                                   free_rect.w,
+                                                   used->y - free_rect.y});
+    }
+    if (used_bottom < free_bottom) {
+      ok = ok && push_free_rect(packer, (SDL_Rect){free_rect.x, used_bottom,
+                                                   free_rect.w,
+                                                   free_bottom - used_bottom});
+    }
+    if (!ok) {
+      return false;
+    }
+
+    // Swap-remove the split rectangle; the last unchecked one moves here
+    packer->free_rects[i] = packer->free_rects[count - 1];
+    packer->free_rects[count - 1] =
+        packer->free_rects[packer->free_count - 1];
+    packer->free_count--;
+    count--;
+  }
+  return true;
+}
+
+// Drop free rectangles contained in another one
+static void prune_free_rects(rect_packer_ptr packer) {
+  for (int i = 0; i < packer->free_count; i++) {
+    for (int j = i + 1; j < packer->free_count; j++) {
+      if (contains(&packer->free_rects[j], &packer->free_rects[i])) {
+        packer->free_rects[i--] =
+            packer->free_rects[--packer->free_count];
+        break;
+      }
+      if (contains(&packer->free_rects[i], &packer->free_rects[j])) {
+        packer->free_rects[j--] =
+            packer->free_rects[--packer->free_count];
+      }
+    }
+  }
+}
+
+bool pack_rect(rect_packer_ptr packer, int width, int height,
+               SDL_Rect* placed) {
+  if (!packer || width <= 0 || height <= 0) {
+    return false;
+  }
+
+  // Best short side fit, ties broken by the long side
+  int best = -1;
+  int best_short = INT_MAX;
+  int best_long = INT_MAX;
+  for (int i = 0; i < packer->free_count; i++) {
+    const SDL_Rect* free_rect = &packer->free_rects[i];
+    if (free_rect->w < width || free_rect->h < height) {
+      continue;
+    }
+    int leftover_w = free_rect->w - width;
+    int leftover_h = free_rect->h - height;
+    int short_side = leftover_w < leftover_h ? leftover_w : leftover_h;
+    int long_side = leftover_w < leftover_h ? leftover_h : leftover_w;
+    if (short_side < best_short ||
+        (short_side == best_short && long_side < best_long)) {
+      best = i;
+      best_short = short_side;
+      best_long = long_side;
+    }
+  }
+  if (best < 0) {
+    return false;
+  }
+
+  SDL_Rect used = {packer->free_rects[best].x, packer->free_rects[best].y,
+                   width, height};
+  if (!split_free_rects(packer, &used)) {
+    LOG_ERROR("Failed to grow rect packer free list");
+    return false;
+  }
+  prune_free_rects(packer);
+
+  packer->used_area += (long long)width * height;
+  if (used.x + width > packer->used_width) {
+    packer->used_width = used.x + width;
+  }
+  if (used.y + height > packer->used_height) {
+    packer->used_height = used.y + height;
+  }
+  *placed = used;
+  return true;
+}
+
+double rect_packer_occupancy(const rect_packer_t* packer) {
+  long long area = (long long)packer->used_width * packer->used_height;
+  return area > 0 ? (double)packer->used_area / (double)area : 0.0;
+}
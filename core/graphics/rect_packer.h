@@ -0,0 +1,59 @@
+/**
+ * @file rect_packer.h
+ * @brief MaxRects rectangle packer for texture atlases
+ *
+ * Keeps the maximal free rectangles of a fixed-size bin and places each new
+ * rectangle with the best-short-side-fit heuristic, which wastes less space
+ * than shelf or skyline packing for sprites of mixed sizes.
+ */
+
+#ifndef CORE_GRAPHICS_RECT_PACKER_H_
+#define CORE_GRAPHICS_RECT_PACKER_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+
+typedef struct {
+  int width;
+  int height;
+  SDL_Rect* free_rects;
+  int free_count;
+  int free_capacity;
+  long long used_area;
+  int used_width;   // Right edge of the rightmost placed rectangle
+  int used_height;  // Bottom edge of the lowest placed rectangle
+} rect_packer_t, *rect_packer_ptr;
+
+/**
+ * @brief Create a packer for an empty bin
+ * @param width Bin width
+ * @param height Bin height
+ * @return Packer, or NULL on failure
+ */
+rect_packer_ptr create_rect_packer(int width, int height);
+
+/**
+ * @brief Free a packer
+ * @param packer Packer to destroy (may be NULL)
+ */
+void destroy_rect_packer(rect_packer_ptr packer);
+
+/**
+ * @brief Place a rectangle in the bin
+ * @param packer Packer
+ * @param width Rectangle width
+ * @param height Rectangle height
+ * @param placed Output position and size
+ * @return false if the rectangle does not fit anywhere
+ */
+bool pack_rect(rect_packer_ptr packer, int width, int height,
+               SDL_Rect* placed);
+
+/**
+ * @brief Fraction of the used bin area covered by placed rectangles
+ * @param packer Packer
+ * @return Ratio in [0, 1] relative to used_width x used_height
+ */
+double rect_packer_occupancy(const rect_packer_t* packer);
+
+#endif  // CORE_GRAPHICS_RECT_PACKER_H_
@@ -0,0 +1,716 @@
+/**
+ * @file render_queue.c
+ * @brief Implementation of the sorted render queue
+ */
+
+#include "render_queue.h"
+
+#include <SDL.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu_renderer.h"
+#include "dynamic_array.h"
+#include "logger.h"
+#include "primitive_batch.h"
+#include "render_state.h"
+
+#define KEY_LAYER_SHIFT 56
+#define KEY_DEPTH_SHIFT 40
+#define KEY_BLEND_SHIFT 36
+#define KEY_TEXTURE_SHIFT 24
+#define KEY_SEQUENCE_SHIFT 0
+// Lowest key byte above the sequence number
+#define FIRST_SORT_PASS (KEY_TEXTURE_SHIFT / 8)
+
+#define DEGREES_TO_RADIANS 0.017453292519943295
+
+static render_queue_ptr get_render_queue(
+    const graphics_context_ptr graphics_context) {
+  if (!graphics_context || !graphics_context->renderer) {
+    return NULL;
+  }
+
+  if (!graphics_context->render_queue) {
+    graphics_context->render_queue = calloc(1, sizeof(render_queue_t));
+    if (!graphics_context->render_queue) {
+      LOG_ERROR("Failed to allocate render queue");
+      return NULL;
+    }
+  }
+  return graphics_context->render_queue;
+}
+
+static render_queue_ptr recording_queue(
+    const graphics_context_ptr graphics_context) {
+  if (!graphics_context || !graphics_context->render_queue) {
+    return NULL;
+  }
+  render_queue_ptr queue = graphics_context->render_queue;
+  return queue->enabled && !queue->replaying ? queue : NULL;
+}
+
+// Recording queue with room for one more command, flushing a full one
+static render_queue_ptr queue_for_command(
+    const graphics_context_ptr graphics_context) {
+  render_queue_ptr queue = recording_queue(graphics_context);
+  if (queue && queue->command_count == RENDER_QUEUE_MAX_COMMANDS) {
+    flush_render_queue(graphics_context);
+  }
+  return queue;
+}
+
+// Blend modes ordered from cheapest to most expensive state change
+static uint64_t blend_rank(SDL_BlendMode blend_mode) {
+  switch (blend_mode) {
+    case SDL_BLENDMODE_NONE:
+      return 0;
+    case SDL_BLENDMODE_BLEND:
+      return 1;
+    case SDL_BLENDMODE_ADD:
+      return 2;
+    case SDL_BLENDMODE_MOD:
+      return 3;
+    case SDL_BLENDMODE_MUL:
+      return 4;
+    default:
+      return 5;
+  }
+}
+
+// Key of the next command; copies recorded with state sorting add their
+// blend mode and texture id
+static uint64_t make_key(const render_queue_ptr queue) {
+  return ((uint64_t)queue->layer << KEY_LAYER_SHIFT) |
+         ((uint64_t)queue->depth << KEY_DEPTH_SHIFT) |
+         ((uint64_t)queue->command_count << KEY_SEQUENCE_SHIFT);
+}
+
+static render_command_t* push_command(render_queue_ptr queue,
+                                      render_command_kind_t kind) {
+  render_command_t* commands =
+      grow_array(queue->commands, &queue->command_capacity,
+                 queue->command_count + 1, sizeof(render_command_t));
+  if (!commands) {
+    return NULL;
+  }
+  queue->commands = commands;
+
+  render_command_t* command = &queue->commands[queue->command_count];
+  memset(command, 0, sizeof(*command));
+  command->kind = kind;
+  command->key = make_key(queue);
+  queue->command_count++;
+  return command;
+}
+
+static bool push_points(render_queue_ptr queue, render_command_kind_t kind,
+                        const SDL_Point* points, int count, color_t color) {
+  SDL_Point* grown = grow_array(queue->points, &queue->point_capacity,
+                                queue->point_count + count, sizeof(SDL_Point));
+  if (!grown) {
+    return false;
+  }
+  queue->points = grown;
+
+  render_command_t* command = push_command(queue, kind);
+  if (!command) {
+    return false;
+  }
+  command->color = color;
+  command->first = queue->point_count;
+  command->count = count;
+  memcpy(&queue->points[queue->point_count], points,
+         sizeof(SDL_Point) * (size_t)count);
+  queue->point_count += count;
+  return true;
+}
+
+// Texture slot for `texture`, registering it (and the blend mode and color
+// modulation it will be drawn with) on first use since the last flush
+static int texture_slot(const graphics_context_ptr graphics_context,
+                        render_queue_ptr queue, const texture_ptr tex) {
+  SDL_Texture* texture = tex->texture;
+  uintptr_t hash = ((uintptr_t)texture >> 4) * 2654435761u;
+  int bucket = (int)(hash & (RENDER_QUEUE_TEXTURE_BUCKETS - 1));
+  while (queue->texture_buckets[bucket] != 0) {
+    int slot = queue->texture_buckets[bucket] - 1;
+    if (queue->textures[slot].texture == texture) {
+      return slot;
+    }
+    bucket = (bucket + 1) & (RENDER_QUEUE_TEXTURE_BUCKETS - 1);
+  }
+
+  if (queue->texture_count == RENDER_QUEUE_MAX_TEXTURES) {
+    flush_render_queue(graphics_context);
+    return texture_slot(graphics_context, queue, tex);
+  }
+
+  int slot = queue->texture_count++;
+  render_queue_texture_t* entry = &queue->textures[slot];
+  entry->texture = texture;
+  entry->surface = tex->surface;
+  entry->width = tex->width;
+  entry->height = tex->height;
+  SDL_GetTextureBlendMode(texture, &entry->blend_mode);
+  SDL_GetTextureColorMod(texture, &entry->modulation.r, &entry->modulation.g,
+                         &entry->modulation.b);
+  SDL_GetTextureAlphaMod(texture, &entry->modulation.a);
+  queue->texture_buckets[bucket] = slot + 1;
+  return slot;
+}
+
+static void clear_textures(render_queue_ptr queue) {
+  for (int i = 0; i < queue->texture_count; i++) {
+    uintptr_t hash = ((uintptr_t)queue->textures[i].texture >> 4) * 2654435761u;
+    int bucket = (int)(hash & (RENDER_QUEUE_TEXTURE_BUCKETS - 1));
+    while (queue->texture_buckets[bucket] != 0) {
+      queue->texture_buckets[bucket] = 0;
+      bucket = (bucket + 1) & (RENDER_QUEUE_TEXTURE_BUCKETS - 1);
+    }
+  }
+  queue->texture_count = 0;
+}
+
+void set_render_queue_enabled(const graphics_context_ptr graphics_context,
+                              bool enabled) {
+  if (!enabled) {
+    flush_render_queue(graphics_context);
+    if (graphics_context && graphics_context->render_queue) {
+      graphics_context->render_queue->enabled = false;
+    }
+    return;
+  }
+
+  render_queue_ptr queue = get_render_queue(graphics_context);
+  if (queue) {
+    // Primitives batched so far belong before anything recorded from now on
+    flush_primitive_batch(graphics_context);
+    queue->enabled = true;
+  }
+}
+
+void set_render_layer(const graphics_context_ptr graphics_context,
+                      uint8_t layer) {
+  render_queue_ptr queue = get_render_queue(graphics_context);
+  if (queue) {
+    queue->layer = layer;
+  }
+}
+
+void set_render_depth(const graphics_context_ptr graphics_context,
+                      uint16_t depth) {
+  render_queue_ptr queue = get_render_queue(graphics_context);
+  if (queue) {
+    queue->depth = depth;
+  }
+}
+
+void set_render_state_sorting(const graphics_context_ptr graphics_context,
+                              bool enabled) {
+  render_queue_ptr queue = get_render_queue(graphics_context);
+  if (queue) {
+    queue->state_sorted = enabled;
+  }
+}
+
+bool suspend_render_queue(const graphics_context_ptr graphics_context) {
+  render_queue_ptr queue = recording_queue(graphics_context);
+  if (!queue) {
+    return false;
+  }
+  queue->enabled = false;
+  return true;
+}
+
+void resume_render_queue(const graphics_context_ptr graphics_context) {
+  if (graphics_context && graphics_context->render_queue) {
+    // Primitives batched while suspended go out now, before anything the
+    // queue replays
+    flush_primitive_batch(graphics_context);
+    graphics_context->render_queue->enabled = true;
+  }
+}
+
+bool render_queue_recording(const graphics_context_ptr graphics_context) {
+  return recording_queue(graphics_context) != NULL;
+}
+
+bool queue_polyline(const graphics_context_ptr graphics_context,
+                    const SDL_Point* points, int count, color_t color) {
+  render_queue_ptr queue = queue_for_command(graphics_context);
+  if (!queue || count < 2) {
+    return false;
+  }
+  return push_points(queue, RENDER_COMMAND_LINES, points, count, color);
+}
+
+bool queue_points(const graphics_context_ptr graphics_context,
+                  const SDL_Point* points, int count, color_t color) {
+  render_queue_ptr queue = queue_for_command(graphics_context);
+  if (!queue) {
+    return false;
+  }
+  return push_points(queue, RENDER_COMMAND_POINTS, points, count, color);
+}
+
+bool queue_filled_rect(const graphics_context_ptr graphics_context,
+                       const SDL_Rect* rect, color_t color) {
+  render_queue_ptr queue = queue_for_command(graphics_context);
+  if (!queue) {
+    return false;
+  }
+
+  render_command_t* command = push_command(queue, RENDER_COMMAND_RECT);
+  if (!command) {
+    return false;
+  }
+  command->color = color;
+  command->rect = *rect;
+  return true;
+}
+
+bool queue_geometry(const graphics_context_ptr graphics_context,
+                    const SDL_Vertex* vertices, int vertex_count,
+                    const int* indices, int index_count) {
+  render_queue_ptr queue = queue_for_command(graphics_context);
+  if (!queue) {
+    return false;
+  }
+
+  SDL_Vertex* grown_vertices =
+      grow_array(queue->vertices, &queue->vertex_capacity,
+                 queue->vertex_count + vertex_count, sizeof(SDL_Vertex));
+  if (!grown_vertices) {
+    return false;
+  }
+  queue->vertices = grown_vertices;
+
+  int* grown_indices = grow_array(queue->indices, &queue->index_capacity,
+                                  queue->index_count + index_count, sizeof(int));
+  if (!grown_indices) {
+    return false;
+  }
+  queue->indices = grown_indices;
+
+  render_command_t* command = push_command(queue, RENDER_COMMAND_GEOMETRY);
+  if (!command) {
+    return false;
+  }
+  command->first = queue->vertex_count;
+  command->count = vertex_count;
+  command->index_first = queue->index_count;
+  command->index_count = index_count;
+  memcpy(&queue->vertices[queue->vertex_count], vertices,
+         sizeof(SDL_Vertex) * (size_t)vertex_count);
+  memcpy(&queue->indices[queue->index_count], indices,
+         sizeof(int) * (size_t)index_count);
+  queue->vertex_count += vertex_count;
+  queue->index_count += index_count;
+  return true;
+}
+
+// Record a copy with its full state; queue_texture_copy() and
+// queue_tinted_texture_copy() each expose part of it
+static bool push_copy(const graphics_context_ptr graphics_context,
+                      const texture_ptr tex, const SDL_Rect* src,
+                      const SDL_FRect* dst, double angle,
+                      SDL_RendererFlip flip, SDL_Color tint) {
+  render_queue_ptr queue = queue_for_command(graphics_context);
+  if (!queue || !tex || !tex->texture) {
+    return false;
+  }
+
+  int slot = texture_slot(graphics_context, queue, tex);
+  render_command_t* command = push_command(queue, RENDER_COMMAND_COPY);
+  if (!command) {
+    return false;
+  }
+
+  // Texture id 0 marks untextured primitives and ordered copies
+  if (queue->state_sorted) {
+    command->key |=
+        (blend_rank(queue->textures[slot].blend_mode) << KEY_BLEND_SHIFT) |
+        (((uint64_t)slot + 1) << KEY_TEXTURE_SHIFT);
+  }
+  command->texture_slot = slot;
+  command->rect = src ? *src : (SDL_Rect){0, 0, tex->width, tex->height};
+  command->dst = *dst;
+  command->angle = (float)angle;
+  command->flip = flip;
+  command->tint = tint;
+  return true;
+}
+
+bool queue_texture_copy(const graphics_context_ptr graphics_context,
+                        const texture_ptr tex, const SDL_Rect* src,
+                        const SDL_FRect* dst, double angle,
+                        SDL_RendererFlip flip, Uint8 alpha) {
+  SDL_Color tint = {255, 255, 255, alpha};
+  return push_copy(graphics_context, tex, src, dst, angle, flip, tint);
+}
+
+bool queue_tinted_texture_copy(const graphics_context_ptr graphics_context,
+                               const texture_ptr tex, const SDL_Rect* src,
+                               const SDL_FRect* dst, double angle,
+                               SDL_RendererFlip flip, SDL_Color tint) {
+  return push_copy(graphics_context, tex, src, dst, angle, flip, tint);
+}
+
+static bool reserve_sort_buffers(render_queue_ptr queue, int count) {
+  if (count <= queue->sort_capacity) {
+    return true;
+  }
+
+  int capacity = queue->sort_capacity;
+  uint64_t* keys = grow_array(queue->sort_keys, &capacity, count,
+                              sizeof(uint64_t));
+  if (!keys) {
+    return false;
+  }
+  queue->sort_keys = keys;
+
+  uint64_t* keys_scratch = realloc(queue->sort_keys_scratch,
+                                   sizeof(uint64_t) * (size_t)capacity);
+  if (!keys_scratch) {
+    return false;
+  }
+  queue->sort_keys_scratch = keys_scratch;
+
+  int* order = realloc(queue->sort_order, sizeof(int) * (size_t)capacity);
+  if (!order) {
+    return false;
+  }
+  queue->sort_order = order;
+
+  int* order_scratch =
+      realloc(queue->sort_order_scratch, sizeof(int) * (size_t)capacity);
+  if (!order_scratch) {
+    return false;
+  }
+  queue->sort_order_scratch = order_scratch;
+
+  queue->sort_capacity = capacity;
+  return true;
+}
+
+// Stable least-significant-digit radix sort of the command keys, one byte
+// per pass. Commands are recorded in sequence order, so the sequence bytes
+// would not change the result and are never sorted on. Bytes that are equal
+// across all keys (unused layers, or state bits without state sorting) are
+// skipped.
+static void sort_commands(render_queue_ptr queue) {
+  int count = queue->command_count;
+  uint64_t* keys = queue->sort_keys;
+  uint64_t* keys_out = queue->sort_keys_scratch;
+  int* order = queue->sort_order;
+  int* order_out = queue->sort_order_scratch;
+
+  int histograms[8][256];
+  memset(histograms, 0, sizeof(histograms));
+  for (int i = 0; i < count; i++) {
+    uint64_t key = queue->commands[i].key;
+    keys[i] = key;
+    order[i] = i;
+    for (int pass = FIRST_SORT_PASS; pass < 8; pass++) {
+      histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+    }
+  }
+
+  for (int pass = FIRST_SORT_PASS; pass < 8; pass++) {
+    int* histogram = histograms[pass];
+    if (histogram[(keys[0] >> (pass * 8)) & 0xFF] == count) {
+      continue;
+    }
+
+    int offset = 0;
+    for (int digit = 0; digit < 256; digit++) {
+      int digit_count = histogram[digit];
+      histogram[digit] = offset;
+      offset += digit_count;
+    }
+
+    for (int i = 0; i < count; i++) {
+      int position = histogram[(keys[i] >> (pass * 8)) & 0xFF]++;
+      keys_out[position] = keys[i];
+      order_out[position] = order[i];
+    }
+
+    uint64_t* swap_keys = keys;
+    keys = keys_out;
+    keys_out = swap_keys;
+    int* swap_order = order;
+    order = order_out;
+    order_out = swap_order;
+  }
+
+  // Keep the sorted order in sort_order regardless of the pass count parity
+  if (order != queue->sort_order) {
+    memcpy(queue->sort_order, order, sizeof(int) * (size_t)count);
+  }
+}
+
+static void submit_sprites(SDL_Renderer* renderer, render_queue_ptr queue) {
+  if (queue->sprite_count == 0) {
+    return;
+  }
+  SDL_RenderGeometry(renderer, queue->textures[queue->sprite_slot].texture,
+                     queue->sprite_vertices, queue->sprite_count * 4,
+                     queue->sprite_indices, queue->sprite_count * 6);
+  queue->sprite_count = 0;
+  queue->stats.batch_count++;
+}
+
+// Texture modulation combined with the tint of one copy
+static SDL_Color copy_color(const render_queue_texture_t* texture,
+                            const render_command_t* command) {
+  SDL_Color color = texture->modulation;
+  color.r = (Uint8)((color.r * command->tint.r + 127) / 255);
+  color.g = (Uint8)((color.g * command->tint.g + 127) / 255);
+  color.b = (Uint8)((color.b * command->tint.b + 127) / 255);
+  color.a = (Uint8)((color.a * command->tint.a + 127) / 255);
+  return color;
+}
+
+// Append a copy as a quad with the same mapping SDL_RenderCopyEx applies:
+// rotation about the destination center, flips applied to the source
+static void append_sprite(render_queue_ptr queue,
+                          const render_command_t* command) {
+  int vertex_count = (queue->sprite_count + 1) * 4;
+  int index_count = (queue->sprite_count + 1) * 6;
+  SDL_Vertex* vertices =
+      grow_array(queue->sprite_vertices, &queue->sprite_vertex_capacity,
+                 vertex_count, sizeof(SDL_Vertex));
+  if (!vertices) {
+    return;
+  }
+  queue->sprite_vertices = vertices;
+  int* indices = grow_array(queue->sprite_indices,
+                            &queue->sprite_index_capacity, index_count,
+                            sizeof(int));
+  if (!indices) {
+    return;
+  }
+  queue->sprite_indices = indices;
+
+  const render_queue_texture_t* texture = &queue->textures[command->texture_slot];
+  float u0 = (float)command->rect.x / (float)texture->width;
+  float v0 = (float)command->rect.y / (float)texture->height;
+  float u1 = (float)(command->rect.x + command->rect.w) / (float)texture->width;
+  float v1 =
+      (float)(command->rect.y + command->rect.h) / (float)texture->height;
+  if (command->flip & SDL_FLIP_HORIZONTAL) {
+    float swap = u0;
+    u0 = u1;
+    u1 = swap;
+  }
+  if (command->flip & SDL_FLIP_VERTICAL) {
+    float swap = v0;
+    v0 = v1;
+    v1 = swap;
+  }
+
+  SDL_Color color =
+      texture_modulation(texture->blend_mode, copy_color(texture, command));
+
+  float half_w = command->dst.w * 0.5f;
+  float half_h = command->dst.h * 0.5f;
+  float cx = command->dst.x + half_w;
+  float cy = command->dst.y + half_h;
+  float corners[4][2] = {
+      {-half_w, -half_h}, {half_w, -half_h}, {half_w, half_h}, {-half_w, half_h}};
+  float uvs[4][2] = {{u0, v0}, {u1, v0}, {u1, v1}, {u0, v1}};
+  float cos_a = 1.0f;
+  float sin_a = 0.0f;
+  if (command->angle != 0.0f) {
+    double radians = command->angle * DEGREES_TO_RADIANS;
+    cos_a = (float)cos(radians);
+    sin_a = (float)sin(radians);
+  }
+
+  int base = queue->sprite_count * 4;
+  for (int i = 0; i < 4; i++) {
+    SDL_Vertex* vertex = &queue->sprite_vertices[base + i];
+    vertex->position.x = cx + corners[i][0] * cos_a - corners[i][1] * sin_a;
+    vertex->position.y = cy + corners[i][0] * sin_a + corners[i][1] * cos_a;
+    vertex->color = color;
+    vertex->tex_coord.x = uvs[i][0];
+    vertex->tex_coord.y = uvs[i][1];
+  }
+
+  int* quad = &queue->sprite_indices[queue->sprite_count * 6];
+  quad[0] = base;
+  quad[1] = base + 1;
+  quad[2] = base + 2;
+  quad[3] = base;
+  quad[4] = base + 2;
+  quad[5] = base + 3;
+  queue->sprite_count++;
+}
+
+static void blit_command(cpu_renderer_ptr cpu, render_queue_ptr queue,
+                         const render_command_t* command) {
+  const render_queue_texture_t* texture = &queue->textures[command->texture_slot];
+  cpu_blit(cpu, texture->surface, &command->rect, &command->dst,
+           command->angle, command->flip, copy_color(texture, command));
+}
+
+// Hand an untextured command to the primitive batch, drawing it directly if
+// primitive batching has been disabled
+static void replay_primitive(const graphics_context_ptr graphics_context,
+                             render_queue_ptr queue,
+                             const render_command_t* command) {
+  SDL_Renderer* renderer = graphics_context->renderer;
+  const SDL_Point* points = &queue->points[command->first];
+  color_t color = command->color;
+
+  switch (command->kind) {
+    case RENDER_COMMAND_LINES:
+      if (command->count == 2
+              ? batch_line(graphics_context, points[0].x, points[0].y,
+                           points[1].x, points[1].y, color)
+              : batch_polyline(graphics_context, points, command->count,
+                               color)) {
+        return;
+      }
+      apply_draw_color(graphics_context, R(color), G(color), B(color), 255);
+      SDL_RenderDrawLines(renderer, points, command->count);
+      break;
+    case RENDER_COMMAND_POINTS:
+      if (batch_points(graphics_context, points, command->count, color)) {
+        return;
+      }
+      apply_draw_color(graphics_context, R(color), G(color), B(color), 255);
+      SDL_RenderDrawPoints(renderer, points, command->count);
+      break;
+    case RENDER_COMMAND_RECT:
+      if (batch_filled_rect(graphics_context, command->rect.x, command->rect.y,
+                            command->rect.w, command->rect.h, color)) {
+        return;
+      }
+      apply_draw_color(graphics_context, R(color), G(color), B(color), 255);
+      SDL_RenderFillRect(renderer, &command->rect);
+      break;
+    case RENDER_COMMAND_GEOMETRY:
+      if (batch_geometry(graphics_context, &queue->vertices[command->first],
+                         command->count, &queue->indices[command->index_first],
+                         command->index_count)) {
+        return;
+      }
+      SDL_RenderGeometry(renderer, NULL, &queue->vertices[command->first],
+                         command->count, &queue->indices[command->index_first],
+                         command->index_count);
+      break;
+    case RENDER_COMMAND_COPY:
+      break;
+  }
+}
+
+void flush_render_queue(const graphics_context_ptr graphics_context) {
+  render_queue_ptr queue = recording_queue(graphics_context);
+  if (!queue) {
+    return;
+  }
+
+  if (queue->command_count == 0) {
+    clear_textures(queue);
+    return;
+  }
+
+  SDL_Renderer* renderer = graphics_context->renderer;
+  queue->replaying = true;
+  queue->stats.command_count = queue->command_count;
+  queue->stats.batch_count = 0;
+
+  bool sorted = reserve_sort_buffers(queue, queue->command_count);
+  if (sorted) {
+    sort_commands(queue);
+  } else {
+    LOG_ERROR("Failed to allocate render queue sort buffers");
+  }
+
+  // Primitives of one layer and depth share the primitive batch; it is
+  // flushed whenever the layer or depth changes and before textured quads
+  uint64_t scope = 0;
+  bool primitives_pending = false;
+  queue->sprite_count = 0;
+  for (int i = 0; i < queue->command_count; i++) {
+    const render_command_t* command =
+        &queue->commands[sorted ? queue->sort_order[i] : i];
+    uint64_t command_scope = command->key >> KEY_DEPTH_SHIFT;
+    if (i == 0 || command_scope != scope) {
+      submit_sprites(renderer, queue);
+      if (primitives_pending) {
+        flush_primitive_batch(graphics_context);
+        queue->stats.batch_count++;
+        primitives_pending = false;
+      }
+      scope = command_scope;
+    }
+
+    if (command->kind == RENDER_COMMAND_COPY) {
+      if (primitives_pending) {
+        flush_primitive_batch(graphics_context);
+        queue->stats.batch_count++;
+        primitives_pending = false;
+      }
+      if (graphics_context->cpu_renderer) {
+        blit_command(graphics_context->cpu_renderer, queue, command);
+        continue;
+      }
+      if (command->texture_slot != queue->sprite_slot) {
+        submit_sprites(renderer, queue);
+        queue->sprite_slot = command->texture_slot;
+      }
+      append_sprite(queue, command);
+    } else {
+      submit_sprites(renderer, queue);
+      replay_primitive(graphics_context, queue, command);
+      primitives_pending = true;
+    }
+  }
+
+  submit_sprites(renderer, queue);
+  if (primitives_pending) {
+    flush_primitive_batch(graphics_context);
+    queue->stats.batch_count++;
+  }
+
+  queue->command_count = 0;
+  queue->point_count = 0;
+  queue->vertex_count = 0;
+  queue->index_count = 0;
+  clear_textures(queue);
+  queue->replaying = false;
+}
+
+render_queue_stats_t get_render_queue_stats(
+    const graphics_context_ptr graphics_context) {
+  render_queue_stats_t stats = {0, 0};
+  if (graphics_context && graphics_context->render_queue) {
+    stats = graphics_context->render_queue->stats;
+  }
+  return stats;
+}
+
+void destroy_render_queue(const graphics_context_ptr graphics_context) {
+  if (!graphics_context || !graphics_context->render_queue) {
+    return;
+  }
+
+  render_queue_ptr queue = graphics_context->render_queue;
+  free(queue->commands);
+  free(queue->points);
+  free(queue->vertices);
+  free(queue->indices);
+  free(queue->sort_keys);
+  free(queue->sort_keys_scratch);
+  free(queue->sort_order);
+  free(queue->sort_order_scratch);
+  free(queue->sprite_vertices);
+  free(queue->sprite_indices);
+  free(queue);
+  graphics_context->render_queue = NULL;
+}
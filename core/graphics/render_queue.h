@@ -0,0 +1,275 @@
+/**
+ * @file render_queue.h
+ * @brief Deferred render queue sorted by layer, depth and optionally state,
+ *        with 64-bit sort keys
+ *
+ * When enabled, drawing primitives and sprite calls are recorded as commands
+ * instead of being drawn. Each command carries a packed sort key:
+ *
+ *   bits 56-63  layer       (set_render_layer)
+ *   bits 40-55  depth       (set_render_depth)
+ *   bits 36-39  blend mode  (state-sorted copies only, else 0)
+ *   bits 24-35  texture id  (state-sorted copies only, else 0)
+ *   bits  0-23  sequence    (submission order since the last flush)
+ *
+ * At flush the keys are radix-sorted. By default the state bits are zero,
+ * so commands within one layer and depth keep their submission order and
+ * existing games look the same. Copies recorded after
+ * set_render_state_sorting() carry their blend mode and texture, so within
+ * their layer and depth they are grouped by state and only keep submission
+ * order among copies of the same texture. Runs of adjacent copies sharing a
+ * texture are merged into one SDL_RenderGeometry call, and adjacent
+ * primitives go through the per-color primitive batch. With the CPU
+ * backend, copies are blitted in sorted order instead. The queue is off by
+ * default so existing games render exactly as before.
+ */
+
+#ifndef CORE_GRAPHICS_RENDER_QUEUE_H_
+#define CORE_GRAPHICS_RENDER_QUEUE_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "color.h"
+#include "graphics_context.h"
+#include "texture.h"
+
+// Distinct textures recorded between two flushes (ids are 12 bits wide)
+#define RENDER_QUEUE_MAX_TEXTURES 1024
+// Commands recorded between two flushes (sequence numbers are 24 bits wide)
+#define RENDER_QUEUE_MAX_COMMANDS (1 << 24)
+// Open-addressing table mapping SDL textures to ids, twice the above
+#define RENDER_QUEUE_TEXTURE_BUCKETS 2048
+
+typedef enum {
+  RENDER_COMMAND_LINES,     // Polyline of `count` points
+  RENDER_COMMAND_POINTS,    // `count` points
+  RENDER_COMMAND_RECT,      // One filled rect
+  RENDER_COMMAND_GEOMETRY,  // Indexed untextured triangles
+  RENDER_COMMAND_COPY       // Textured quad, optionally rotated and flipped
+} render_command_kind_t;
+
+typedef struct {
+  uint64_t key;
+  render_command_kind_t kind;
+  color_t color;
+  int first;        // First point or vertex in the queue arrays
+  int count;        // Number of points or vertices
+  int index_first;  // First index of a geometry command
+  int index_count;
+  SDL_Rect rect;    // Filled rect, or source rect of a copy
+  SDL_FRect dst;    // Destination of a copy
+  float angle;      // Clockwise rotation of a copy in degrees
+  SDL_RendererFlip flip;
+  SDL_Color tint;  // Color and alpha multiplied into a copy
+  int texture_slot;
+} render_command_t;
+
+// Texture referenced by the queue, with the state it is drawn with
+typedef struct {
+  SDL_Texture* texture;
+  SDL_Surface* surface;  // Pixels blitted by the CPU backend
+  int width;
+  int height;
+  SDL_BlendMode blend_mode;
+  SDL_Color modulation;  // Color and alpha mod at first use
+} render_queue_texture_t;
+
+typedef struct {
+  int command_count;  // Commands submitted by the last flush
+  int batch_count;    // Batches they were merged into
+} render_queue_stats_t;
+
+typedef struct render_queue {
+  render_command_t* commands;
+  int command_count;
+  int command_capacity;
+  SDL_Point* points;
+  int point_count;
+  int point_capacity;
+  SDL_Vertex* vertices;
+  int vertex_count;
+  int vertex_capacity;
+  int* indices;
+  int index_count;
+  int index_capacity;
+
+  render_queue_texture_t textures[RENDER_QUEUE_MAX_TEXTURES];
+  int texture_count;
+  int texture_buckets[RENDER_QUEUE_TEXTURE_BUCKETS];  // Slot + 1, 0 if empty
+
+  // Radix sort buffers
+  uint64_t* sort_keys;
+  uint64_t* sort_keys_scratch;
+  int* sort_order;
+  int* sort_order_scratch;
+  int sort_capacity;
+
+  // Quads merged for the texture currently being replayed
+  SDL_Vertex* sprite_vertices;
+  int sprite_vertex_capacity;
+  int* sprite_indices;
+  int sprite_index_capacity;
+  int sprite_count;
+  int sprite_slot;
+
+  uint8_t layer;
+  uint16_t depth;
+  bool state_sorted;  // Copies carry blend and texture in their keys
+  bool enabled;
+  bool replaying;
+  render_queue_stats_t stats;
+} render_queue_t, *render_queue_ptr;
+
+/**
+ * @brief Enable or disable deferred rendering through the queue
+ * @param graphics_context Graphics context owning the queue
+ * @param enabled false flushes pending commands and returns to immediate mode
+ */
+void set_render_queue_enabled(const graphics_context_ptr graphics_context,
+                              bool enabled);
+
+/**
+ * @brief Set the layer of subsequently recorded commands
+ * @param graphics_context Graphics context owning the queue
+ * @param layer Layer; higher layers are drawn later (on top)
+ */
+void set_render_layer(const graphics_context_ptr graphics_context,
+                      uint8_t layer);
+
+/**
+ * @brief Set the depth of subsequently recorded commands within their layer
+ * @param graphics_context Graphics context owning the queue
+ * @param depth Depth; higher depths are drawn later (on top)
+ */
+void set_render_depth(const graphics_context_ptr graphics_context,
+                      uint16_t depth);
+
+/**
+ * @brief Let subsequently recorded copies be reordered by blend mode and
+ *        texture within their layer and depth
+ *
+ * Meant for depths whose sprites do not overlap, or whose overlap order
+ * does not matter, such as particles or tiles. Commands recorded without
+ * state sorting in the same layer and depth are drawn before them, so give
+ * such sprites a depth of their own.
+ *
+ * @param graphics_context Graphics context owning the queue
+ * @param enabled true to sort by state, false to keep submission order
+ */
+void set_render_state_sorting(const graphics_context_ptr graphics_context,
+                              bool enabled);
+
+/**
+ * @brief Stop recording without flushing, e.g. to draw into a target texture
+ *        in the middle of a recorded frame
+ *
+ * Draw calls go to the renderer until resume_render_queue(); commands
+ * recorded so far stay queued.
+ *
+ * @param graphics_context Graphics context owning the queue
+ * @return true if the queue was recording and must be resumed
+ */
+bool suspend_render_queue(const graphics_context_ptr graphics_context);
+
+/**
+ * @brief Record draw calls again after suspend_render_queue()
+ * @param graphics_context Graphics context owning the queue
+ */
+void resume_render_queue(const graphics_context_ptr graphics_context);
+
+/**
+ * @brief Check whether draw calls are currently being recorded
+ * @param graphics_context Graphics context owning the queue
+ * @return true if the queue is enabled and not replaying
+ */
+bool render_queue_recording(const graphics_context_ptr graphics_context);
+
+/**
+ * @brief Record a polyline (two points for a single line)
+ * @return false if the queue is not recording
+ */
+bool queue_polyline(const graphics_context_ptr graphics_context,
+                    const SDL_Point* points, int count, color_t color);
+
+/**
+ * @brief Record a list of points
+ * @return false if the queue is not recording
+ */
+bool queue_points(const graphics_context_ptr graphics_context,
+                  const SDL_Point* points, int count, color_t color);
+
+/**
+ * @brief Record a filled rectangle
+ * @return false if the queue is not recording
+ */
+bool queue_filled_rect(const graphics_context_ptr graphics_context,
+                       const SDL_Rect* rect, color_t color);
+
+/**
+ * @brief Record indexed untextured triangles
+ * @return false if the queue is not recording
+ */
+bool queue_geometry(const graphics_context_ptr graphics_context,
+                    const SDL_Vertex* vertices, int vertex_count,
+                    const int* indices, int index_count);
+
+/**
+ * @brief Record a textured quad
+ * @param graphics_context Graphics context owning the queue
+ * @param tex Texture to sample
+ * @param src Source rectangle in texture pixels
+ * @param dst Destination rectangle in screen pixels
+ * @param angle Clockwise rotation around the destination center, in degrees
+ * @param flip Flip flags
+ * @param alpha Alpha multiplier (255 = opaque)
+ * @return false if the queue is not recording
+ */
+bool queue_texture_copy(const graphics_context_ptr graphics_context,
+                        const texture_ptr tex, const SDL_Rect* src,
+                        const SDL_FRect* dst, double angle,
+                        SDL_RendererFlip flip, Uint8 alpha);
+
+/**
+ * @brief Record a textured quad whose color and alpha are multiplied by a
+ *        tint, as drawn by render_sprite_tinted() and sprite batches
+ * @param graphics_context Graphics context owning the queue
+ * @param tex Texture to sample
+ * @param src Source rectangle in texture pixels
+ * @param dst Destination rectangle in screen pixels
+ * @param angle Clockwise rotation around the destination center, in degrees
+ * @param flip Flip flags
+ * @param tint Color and alpha multiplier
+ * @return false if the queue is not recording
+ */
+bool queue_tinted_texture_copy(const graphics_context_ptr graphics_context,
+                               const texture_ptr tex, const SDL_Rect* src,
+                               const SDL_FRect* dst, double angle,
+                               SDL_RendererFlip flip, SDL_Color tint);
+
+/**
+ * @brief Sort, merge and submit all recorded commands
+ *
+ * Called automatically before any rendering call that is not recorded
+ * (clear, present, raw SDL copies) through flush_primitive_batch().
+ *
+ * @param graphics_context Graphics context owning the queue
+ */
+void flush_render_queue(const graphics_context_ptr graphics_context);
+
+/**
+ * @brief Get command and batch counts of the last flush
+ * @param graphics_context Graphics context owning the queue
+ * @return Statistics, zeroed if the queue was never used
+ */
+render_queue_stats_t get_render_queue_stats(
+    const graphics_context_ptr graphics_context);
+
+/**
+ * @brief Release the queue owned by a graphics context
+ * @param graphics_context Graphics context owning the queue
+ */
+void destroy_render_queue(const graphics_context_ptr graphics_context);
+
+#endif  // CORE_GRAPHICS_RENDER_QUEUE_H_
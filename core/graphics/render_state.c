@@ -0,0 +1,93 @@
+/**
+ * @file render_state.c
+ * @brief Implementation of redundant renderer state elimination
+ */
+
+#include "render_state.h"
+
+#include <SDL.h>
+
+void apply_draw_color(const graphics_context_ptr graphics_context, Uint8 r,
+                      Uint8 g, Uint8 b, Uint8 a) {
+  render_state_t* state = &graphics_context->render_state;
+  if (state->draw_color_known && state->draw_color.r == r &&
+      state->draw_color.g == g && state->draw_color.b == b &&
+      state->draw_color.a == a) {
+    state->stats.elided++;
+    return;
+  }
+
+  SDL_SetRenderDrawColor(graphics_context->renderer, r, g, b, a);
+  state->draw_color = (SDL_Color){r, g, b, a};
+  state->draw_color_known = true;
+  state->stats.issued++;
+}
+
+void apply_draw_blend_mode(const graphics_context_ptr graphics_context,
+                           SDL_BlendMode blend_mode) {
+  render_state_t* state = &graphics_context->render_state;
+  if (state->blend_mode_known && state->blend_mode == blend_mode) {
+    state->stats.elided++;
+    return;
+  }
+
+  SDL_SetRenderDrawBlendMode(graphics_context->renderer, blend_mode);
+  state->blend_mode = blend_mode;
+  state->blend_mode_known = true;
+  state->stats.issued++;
+}
+
+void apply_texture_alpha_mod(const graphics_context_ptr graphics_context,
+                             SDL_Texture* texture, Uint8 alpha) {
+  // Texture state lives in the texture, and reading it is a field access
+  render_state_t* state = &graphics_context->render_state;
+  Uint8 current;
+  if (SDL_GetTextureAlphaMod(texture, &current) == 0 && current == alpha) {
+    state->stats.elided++;
+    return;
+  }
+
+  SDL_SetTextureAlphaMod(texture, alpha);
+  state->stats.issued++;
+}
+
+SDL_BlendMode premultiplied_blend_mode(void) {
+  return SDL_ComposeCustomBlendMode(
+      SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+      SDL_BLENDOPERATION_ADD, SDL_BLENDFACTOR_ONE,
+      SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+}
+
+SDL_Color texture_modulation(SDL_BlendMode blend_mode, SDL_Color color) {
+  if (color.a == 255 || blend_mode != premultiplied_blend_mode()) {
+    return color;
+  }
+  color.r = (Uint8)((color.r * color.a + 127) / 255);
+  color.g = (Uint8)((color.g * color.a + 127) / 255);
+  color.b = (Uint8)((color.b * color.a + 127) / 255);
+  return color;
+}
+
+void invalidate_render_state(const graphics_context_ptr graphics_context) {
+  if (!graphics_context) {
+    return;
+  }
+  graphics_context->render_state.draw_color_known = false;
+  graphics_context->render_state.blend_mode_known = false;
+}
+
+render_state_stats_t get_render_state_stats(
+    const graphics_context_ptr graphics_context) {
+  render_state_stats_t stats = {0, 0};
+  if (graphics_context) {
+    stats = graphics_context->render_state.stats;
+  }
+  return stats;
+}
+
+void reset_render_state_stats(const graphics_context_ptr graphics_context) {
+  if (graphics_context) {
+    graphics_context->render_state.stats.issued = 0;
+    graphics_context->render_state.stats.elided = 0;
+  }
+}
@@ -0,0 +1,86 @@
+/**
+ * @file render_state.h
+ * @brief Redundant renderer state elimination
+ *
+ * The graphics context shadows the renderer's draw color and draw blend mode.
+ * Engine code changes them through these functions, which skip the SDL call
+ * when the requested state is already current and count issued and elided
+ * calls. Games that change renderer state with raw SDL calls must call
+ * invalidate_render_state() afterwards.
+ */
+
+#ifndef CORE_GRAPHICS_RENDER_STATE_H_
+#define CORE_GRAPHICS_RENDER_STATE_H_
+
+#include <SDL.h>
+
+#include "graphics_context.h"
+
+/**
+ * @brief Set the renderer draw color unless it is already current
+ * @param graphics_context Graphics context owning the renderer
+ * @param r Red component
+ * @param g Green component
+ * @param b Blue component
+ * @param a Alpha component
+ */
+void apply_draw_color(const graphics_context_ptr graphics_context, Uint8 r,
+                      Uint8 g, Uint8 b, Uint8 a);
+
+/**
+ * @brief Set the renderer draw blend mode unless it is already current
+ * @param graphics_context Graphics context owning the renderer
+ * @param blend_mode Blend mode for draw calls
+ */
+void apply_draw_blend_mode(const graphics_context_ptr graphics_context,
+                           SDL_BlendMode blend_mode);
+
+/**
+ * @brief Set a texture's alpha modulation unless it already has that value
+ * @param graphics_context Graphics context collecting the statistics
+ * @param texture Texture to modulate
+ * @param alpha Alpha modulation
+ */
+void apply_texture_alpha_mod(const graphics_context_ptr graphics_context,
+                             SDL_Texture* texture, Uint8 alpha);
+
+/**
+ * @brief Get the blend mode of premultiplied textures (translucent packed
+ *        images and render targets)
+ * @return Custom blend mode ONE, ONE_MINUS_SRC_ALPHA
+ */
+SDL_BlendMode premultiplied_blend_mode(void);
+
+/**
+ * @brief Adjust a texture modulation color for the texture's blend mode
+ *
+ * Premultiplied textures must have their color scaled along with their
+ * alpha, or fading them brightens them instead.
+ *
+ * @param blend_mode Blend mode of the texture
+ * @param color Color and alpha modulation as for straight alpha
+ * @return Modulation to draw the texture with
+ */
+SDL_Color texture_modulation(SDL_BlendMode blend_mode, SDL_Color color);
+
+/**
+ * @brief Forget the shadowed state so the next calls are always issued
+ * @param graphics_context Graphics context owning the renderer
+ */
+void invalidate_render_state(const graphics_context_ptr graphics_context);
+
+/**
+ * @brief Get the number of state calls issued and elided so far
+ * @param graphics_context Graphics context owning the renderer
+ * @return Counters since creation or the last reset
+ */
+render_state_stats_t get_render_state_stats(
+    const graphics_context_ptr graphics_context);
+
+/**
+ * @brief Reset the issued and elided counters
+ * @param graphics_context Graphics context owning the renderer
+ */
+void reset_render_state_stats(const graphics_context_ptr graphics_context);
+
+#endif  // CORE_GRAPHICS_RENDER_STATE_H_
@@ -0,0 +1,406 @@
+/**
+ * @file sprite_animation.c
+ * @brief Implementation of data-oriented sprite animation
+ */
+
+#include "sprite_animation.h"
+
+#include <stdlib.h>
+
+#include "dynamic_array.h"
+#include "logger.h"
+
+animation_set_ptr create_animation_set(void) {
+  animation_set_ptr set = calloc(1, sizeof(animation_set_t));
+  if (!set) {
+    LOG_ERROR("Failed to allocate animation set");
+  }
+  return set;
+}
+
+void destroy_animation_set(animation_set_ptr set) {
+  if (!set) {
+    return;
+  }
+  free(set->frame_rects);
+  free(set->frame_ends);
+  free(set->clips);
+  free(set->clip);
+  free(set->time);
+  free(set->speed);
+  free(set->duration);
+  free(set->inverse_duration);
+  free(set->frame_rate);
+  free(set->loop);
+  free(set->first_frame);
+  free(set->last_frame);
+  free(set->frame);
+  free(set->x);
+  free(set->y);
+  free(set->flip);
+  free(set->handle);
+  free(set->slot);
+  free(set->free_handles);
+  free(set);
+}
+
+int add_animation_clip(animation_set_ptr set, const rect_t* frames,
+                       const float* durations, int frame_count, bool loop) {
+  if (!set || !frames || !durations || frame_count <= 0) {
+    return -1;
+  }
+
+  float duration = 0.0f;
+  bool even = true;
+  for (int i = 0; i < frame_count; i++) {
+    if (durations[i] <= 0.0f) {
+      LOG_ERROR("Animation frame durations must be positive");
+      return -1;
+    }
+    duration += durations[i];
+    even = even && durations[i] == durations[0];
+  }
+
+  int needed = set->frame_count + frame_count;
+  SDL_Rect* rects = grow_array(set->frame_rects, &set->frame_capacity, needed,
+                               sizeof(SDL_Rect));
+  if (!rects) {
+    LOG_ERROR("Failed to grow animation frames");
+    return -1;
+  }
+  set->frame_rects = rects;
+  float* ends = grow_array(set->frame_ends, &set->frame_end_capacity, needed,
+                           sizeof(float));
+  if (!ends) {
+    LOG_ERROR("Failed to grow animation frames");
+    return -1;
+  }
+  set->frame_ends = ends;
+  animation_clip_t* clips = grow_array(set->clips, &set->clip_capacity,
+                                       set->clip_count + 1,
+                                       sizeof(animation_clip_t));
+  if (!clips) {
+    LOG_ERROR("Failed to grow animation clips");
+    return -1;
+  }
+  set->clips = clips;
+
+  float end = 0.0f;
+  for (int i = 0; i < frame_count; i++) {
+    end += durations[i];
+    set->frame_rects[set->frame_count + i] =
+        (SDL_Rect){frames[i].x, frames[i].y, frames[i].w, frames[i].h};
+    set->frame_ends[set->frame_count + i] = end;
+  }
+  set->clips[set->clip_count] = (animation_clip_t){
+      set->frame_count, frame_count, duration,
+      even ? (float)frame_count / duration : 0.0f, loop};
+  set->frame_count = needed;
+  return set->clip_count++;
+}
+
+int add_animation_strip(animation_set_ptr set, const rect_t* first_frame,
+                        int frame_count, float frame_duration, bool loop) {
+  if (!set || !first_frame || frame_count <= 0) {
+    return -1;
+  }
+
+  rect_t* frames = malloc(sizeof(rect_t) * (size_t)frame_count);
+  float* durations = malloc(sizeof(float) * (size_t)frame_count);
+  int clip = -1;
+  if (frames && durations) {
+    for (int i = 0; i < frame_count; i++) {
+      frames[i] = *first_frame;
+      frames[i].x += i * first_frame->w;
+      durations[i] = frame_duration;
+    }
+    clip = add_animation_clip(set, frames, durations, frame_count, loop);
+  } else {
+    LOG_ERROR("Failed to allocate animation strip");
+  }
+  free(frames);
+  free(durations);
+  return clip;
+}
+
+// Grow every per-instance array together; they share one capacity
+static bool reserve_instances(animation_set_ptr set, int needed) {
+  if (needed <= set->instance_capacity) {
+    return true;
+  }
+
+  struct {
+    void** data;
+    size_t element_size;
+  } fields[] = {
+      {(void**)&set->clip, sizeof(int)},
+      {(void**)&set->time, sizeof(float)},
+      {(void**)&set->speed, sizeof(float)},
+      {(void**)&set->duration, sizeof(float)},
+      {(void**)&set->inverse_duration, sizeof(float)},
+      {(void**)&set->frame_rate, sizeof(float)},
+      {(void**)&set->loop, sizeof(int)},
+      {(void**)&set->first_frame, sizeof(int)},
+      {(void**)&set->last_frame, sizeof(int)},
+      {(void**)&set->frame, sizeof(int)},
+      {(void**)&set->x, sizeof(float)},
+      {(void**)&set->y, sizeof(float)},
+      {(void**)&set->flip, sizeof(int)},
+      {(void**)&set->handle, sizeof(int)},
+  };
+  int capacity = set->instance_capacity;
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+    int field_capacity = set->instance_capacity;
+    void* grown = grow_array(*fields[i].data, &field_capacity, needed,
+                             fields[i].element_size);
+    if (!grown) {
+      return false;
+    }
+    *fields[i].data = grown;
+    capacity = field_capacity;
+  }
+  set->instance_capacity = capacity;
+  return true;
+}
+
+static int new_handle(animation_set_ptr set) {
+  if (set->free_handle_count > 0) {
+    return set->free_handles[--set->free_handle_count];
+  }
+  int* slots = grow_array(set->slot, &set->handle_capacity,
+                          set->handle_count + 1, sizeof(int));
+  if (!slots) {
+    return -1;
+  }
+  set->slot = slots;
+  return set->handle_count++;
+}
+
+static int slot_of(const animation_set_t* set, int handle) {
+  if (!set || handle < 0 || handle >= set->handle_count) {
+    return -1;
+  }
+  return set->slot[handle];
+}
+
+// Copy a clip's timing into a slot and restart it
+static void start_clip(animation_set_ptr set, int slot, int clip) {
+  const animation_clip_t* data = &set->clips[clip];
+  if (set->clip[slot] >= 0 && set->frame_rate[slot] == 0.0f) {
+    set->variable_instances--;
+  }
+  set->clip[slot] = clip;
+  set->time[slot] = 0.0f;
+  set->duration[slot] = data->duration;
+  set->inverse_duration[slot] = 1.0f / data->duration;
+  set->frame_rate[slot] = data->frame_rate;
+  set->loop[slot] = data->loop;
+  set->first_frame[slot] = data->first_frame;
+  set->last_frame[slot] = data->frame_count - 1;
+  set->frame[slot] = data->first_frame;
+  if (data->frame_rate == 0.0f) {
+    set->variable_instances++;
+  }
+}
+
+int play_animation(animation_set_ptr set, int clip, float x, float y) {
+  if (!set || clip < 0 || clip >= set->clip_count) {
+    return -1;
+  }
+  if (!reserve_instances(set, set->instance_count + 1)) {
+    LOG_ERROR("Failed to grow animation instances");
+    return -1;
+  }
+  int handle = new_handle(set);
+  if (handle < 0) {
+    LOG_ERROR("Failed to grow animation handles");
+    return -1;
+  }
+
+  int slot = set->instance_count++;
+  set->slot[handle] = slot;
+  set->handle[slot] = handle;
+  set->clip[slot] = -1;
+  start_clip(set, slot, clip);
+  set->speed[slot] = 1.0f;
+  set->x[slot] = x;
+  set->y[slot] = y;
+  set->flip[slot] = SDL_FLIP_NONE;
+  return handle;
+}
+
+void stop_animation(animation_set_ptr set, int handle) {
+  int slot = slot_of(set, handle);
+  if (slot < 0) {
+    return;
+  }
+  int* free_handles =
+      grow_array(set->free_handles, &set->free_handle_capacity,
+                 set->free_handle_count + 1, sizeof(int));
+  if (!free_handles) {
+    LOG_ERROR("Failed to grow animation handles");
+    return;
+  }
+  set->free_handles = free_handles;
+  set->free_handles[set->free_handle_count++] = handle;
+  if (set->frame_rate[slot] == 0.0f) {
+    set->variable_instances--;
+  }
+
+  // Move the last instance into the hole
+  int last = --set->instance_count;
+  if (slot != last) {
+    set->clip[slot] = set->clip[last];
+    set->time[slot] = set->time[last];
+    set->speed[slot] = set->speed[last];
+    set->duration[slot] = set->duration[last];
+    set->inverse_duration[slot] = set->inverse_duration[last];
+    set->frame_rate[slot] = set->frame_rate[last];
+    set->loop[slot] = set->loop[last];
+    set->first_frame[slot] = set->first_frame[last];
+    set->last_frame[slot] = set->last_frame[last];
+    set->frame[slot] = set->frame[last];
+    set->x[slot] = set->x[last];
+    set->y[slot] = set->y[last];
+    set->flip[slot] = set->flip[last];
+    set->handle[slot] = set->handle[last];
+    set->slot[set->handle[slot]] = slot;
+  }
+  set->slot[handle] = -1;
+}
+
+void set_animation_clip(animation_set_ptr set, int handle, int clip) {
+  int slot = slot_of(set, handle);
+  if (slot >= 0 && clip >= 0 && clip < set->clip_count) {
+    start_clip(set, slot, clip);
+  }
+}
+
+void set_animation_position(animation_set_ptr set, int handle, float x,
+                            float y) {
+  int slot = slot_of(set, handle);
+  if (slot >= 0) {
+    set->x[slot] = x;
+    set->y[slot] = y;
+  }
+}
+
+void set_animation_speed(animation_set_ptr set, int handle, float speed) {
+  int slot = slot_of(set, handle);
+  if (slot >= 0) {
+    set->speed[slot] = speed;
+  }
+}
+
+void set_animation_flip(animation_set_ptr set, int handle, flip_t flip) {
+  int slot = slot_of(set, handle);
+  if (slot < 0) {
+    return;
+  }
+  set->flip[slot] = SDL_FLIP_NONE;
+  if (flip & FLIP_HORIZONTAL) {
+    set->flip[slot] |= SDL_FLIP_HORIZONTAL;
+  }
+  if (flip & FLIP_VERTICAL) {
+    set->flip[slot] |= SDL_FLIP_VERTICAL;
+  }
+}
+
+bool animation_finished(const animation_set_t* set, int handle) {
+  int slot = slot_of(set, handle);
+  if (slot < 0 || set->loop[slot]) {
+    return false;
+  }
+  return set->speed[slot] >= 0.0f ? set->time[slot] >= set->duration[slot]
+                                  : set->time[slot] <= 0.0f;
+}
+
+rect_t get_animation_frame(const animation_set_t* set, int handle) {
+  int slot = slot_of(set, handle);
+  if (slot < 0) {
+    return (rect_t){0, 0, 0, 0};
+  }
+  SDL_Rect frame = set->frame_rects[set->frame[slot]];
+  return (rect_t){frame.x, frame.y, frame.w, frame.h};
+}
+
+// Frames of clips with uneven frame lengths, found in the shared end times
+static void resolve_variable_frames(animation_set_ptr set) {
+  for (int i = 0; i < set->instance_count; i++) {
+    if (set->frame_rate[i] != 0.0f) {
+      continue;
+    }
+    int frame = set->first_frame[i];
+    int last = frame + set->last_frame[i];
+    while (frame < last && set->time[i] >= set->frame_ends[frame]) {
+      frame++;
+    }
+    set->frame[i] = frame;
+  }
+}
+
+void update_animations(animation_set_ptr set, float delta_time) {
+  if (!set) {
+    return;
+  }
+
+  int count = set->instance_count;
+  float* restrict time = set->time;
+  const float* restrict speed = set->speed;
+  const float* restrict duration = set->duration;
+  const float* restrict inverse_duration = set->inverse_duration;
+  const float* restrict frame_rate = set->frame_rate;
+  const int* restrict loop = set->loop;
+  const int* restrict first_frame = set->first_frame;
+  const int* restrict last_frame = set->last_frame;
+  int* restrict frame = set->frame;
+
+  // Branch-free so the loop vectorizes: looping clips wrap with a truncating
+  // conversion (times stay within a few clip lengths), others clamp
+  for (int i = 0; i < count; i++) {
+    float t = time[i] + delta_time * speed[i];
+    float wrapped = t - duration[i] * (float)(int)(t * inverse_duration[i]);
+    wrapped = wrapped < 0.0f ? wrapped + duration[i] : wrapped;
+    float clamped = t < 0.0f ? 0.0f : t;
+    clamped = clamped > duration[i] ? duration[i] : clamped;
+    t = loop[i] ? wrapped : clamped;
+    time[i] = t;
+
+    int local = (int)(t * frame_rate[i]);
+    frame[i] = first_frame[i] + (local < last_frame[i] ? local : last_frame[i]);
+  }
+
+  if (set->variable_instances > 0) {
+    resolve_variable_frames(set);
+  }
+}
+
+bool add_animation_sprites(const animation_set_t* set, sprite_batch_ptr batch,
+                           float scale, SDL_Color tint) {
+  if (!set || !batch || !batch->texture) {
+    return false;
+  }
+
+  int needed = batch->count + set->instance_count;
+  sprite_batch_entry_t* entries = grow_array(
+      batch->entries, &batch->capacity, needed, sizeof(sprite_batch_entry_t));
+  if (!entries) {
+    LOG_ERROR("Failed to grow sprite batch");
+    return false;
+  }
+  batch->entries = entries;
+
+  sprite_batch_entry_t* out = &batch->entries[batch->count];
+  for (int i = 0; i < set->instance_count; i++) {
+    out[i] = (sprite_batch_entry_t){set->frame_rects[set->frame[i]],
+                                    set->x[i],
+                                    set->y[i],
+                                    scale,
+                                    scale,
+                                    0.0f,
+                                    (SDL_RendererFlip)set->flip[i],
+                                    tint};
+  }
+  batch->count = needed;
+  return true;
+}
@@ -0,0 +1,193 @@
+/**
+ * @file sprite_animation.h
+ * @brief Data-oriented sprite animation
+ *
+ * Clips (frame rectangles and durations) live in tables shared by every
+ * instance. Per-instance state is kept as a structure of arrays, packed so
+ * that update_animations() advances all instances in one branch-free loop
+ * the compiler vectorizes; clips whose frames differ in length get a short
+ * second pass. Each clip's timing is copied into the instance arrays when
+ * it starts playing, so the main loop reads no shared tables.
+ *
+ * Instances are addressed by stable handles. Stopping one moves the last
+ * instance into its slot, so the arrays stay dense.
+ */
+
+#ifndef CORE_GRAPHICS_SPRITE_ANIMATION_H_
+#define CORE_GRAPHICS_SPRITE_ANIMATION_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+
+#include "sprite_batch.h"
+#include "texture.h"
+
+typedef struct {
+  int first_frame;  // Index of the first frame in the shared tables
+  int frame_count;
+  float duration;    // Seconds for one pass through the clip
+  float frame_rate;  // Frames per second, 0 if frame lengths differ
+  bool loop;
+} animation_clip_t;
+
+typedef struct {
+  // Shared clip tables
+  SDL_Rect* frame_rects;
+  float* frame_ends;  // End of each frame in seconds from the clip start
+  int frame_count;
+  int frame_capacity;
+  int frame_end_capacity;
+  animation_clip_t* clips;
+  int clip_count;
+  int clip_capacity;
+
+  // Per-instance state, one array per field, indexed by slot
+  int* clip;
+  float* time;  // Seconds into the clip
+  float* speed;  // Playback rate, negative plays backwards
+  float* duration;
+  float* inverse_duration;
+  float* frame_rate;
+  int* loop;
+  int* first_frame;
+  int* last_frame;  // frame_count - 1
+  int* frame;  // Current frame in the shared tables
+  float* x;
+  float* y;
+  int* flip;  // SDL_RendererFlip
+  int* handle;  // Handle owning each slot
+  int instance_count;
+  int instance_capacity;
+  int variable_instances;  // Instances of clips with uneven frames
+
+  // Handle to slot mapping, -1 for free handles
+  int* slot;
+  int handle_count;
+  int handle_capacity;
+  int* free_handles;
+  int free_handle_count;
+  int free_handle_capacity;
+} animation_set_t, *animation_set_ptr;
+
+/**
+ * @brief Create an empty animation set
+ * @return Set, or NULL on allocation failure
+ */
+animation_set_ptr create_animation_set(void);
+
+/**
+ * @brief Free an animation set with its clips and instances
+ * @param set Set to destroy (may be NULL)
+ */
+void destroy_animation_set(animation_set_ptr set);
+
+/**
+ * @brief Add a clip from explicit frames
+ * @param set Set to add the clip to
+ * @param frames Source rectangle of each frame
+ * @param durations Seconds each frame is shown
+ * @param frame_count Number of frames
+ * @param loop Restart after the last frame instead of holding it
+ * @return Clip id, or -1 on failure
+ */
+int add_animation_clip(animation_set_ptr set, const rect_t* frames,
+                       const float* durations, int frame_count, bool loop);
+
+/**
+ * @brief Add a clip of equally long frames laid out left to right
+ * @param set Set to add the clip to
+ * @param first_frame Source rectangle of the first frame
+ * @param frame_count Number of frames
+ * @param frame_duration Seconds each frame is shown
+ * @param loop Restart after the last frame instead of holding it
+ * @return Clip id, or -1 on failure
+ */
+int add_animation_strip(animation_set_ptr set, const rect_t* first_frame,
+                        int frame_count, float frame_duration, bool loop);
+
+/**
+ * @brief Start an instance playing a clip from its first frame
+ * @param set Set owning the clip
+ * @param clip Clip id
+ * @param x Destination left edge
+ * @param y Destination top edge
+ * @return Instance handle, or -1 on failure
+ */
+int play_animation(animation_set_ptr set, int clip, float x, float y);
+
+/**
+ * @brief Remove an instance; its handle may be reused afterwards
+ * @param set Set owning the instance
+ * @param handle Instance handle
+ */
+void stop_animation(animation_set_ptr set, int handle);
+
+/**
+ * @brief Switch an instance to another clip, restarting it
+ * @param set Set owning the instance
+ * @param handle Instance handle
+ * @param clip Clip id
+ */
+void set_animation_clip(animation_set_ptr set, int handle, int clip);
+
+/**
+ * @brief Move an instance
+ * @param set Set owning the instance
+ * @param handle Instance handle
+ * @param x Destination left edge
+ * @param y Destination top edge
+ */
+void set_animation_position(animation_set_ptr set, int handle, float x,
+                            float y);
+
+/**
+ * @brief Change an instance's playback rate
+ * @param set Set owning the instance
+ * @param handle Instance handle
+ * @param speed Rate multiplier (1 = normal, negative plays backwards)
+ */
+void set_animation_speed(animation_set_ptr set, int handle, float speed);
+
+/**
+ * @brief Flip an instance when drawn
+ * @param set Set owning the instance
+ * @param handle Instance handle
+ * @param flip Flip flags
+ */
+void set_animation_flip(animation_set_ptr set, int handle, flip_t flip);
+
+/**
+ * @brief Check whether a non-looping instance has reached its end
+ * @param set Set owning the instance
+ * @param handle Instance handle
+ * @return true if the clip does not loop and has played through
+ */
+bool animation_finished(const animation_set_t* set, int handle);
+
+/**
+ * @brief Get the source rectangle an instance currently shows
+ * @param set Set owning the instance
+ * @param handle Instance handle
+ * @return Frame rectangle, empty for an invalid handle
+ */
+rect_t get_animation_frame(const animation_set_t* set, int handle);
+
+/**
+ * @brief Advance every instance
+ * @param set Set to update
+ * @param delta_time Elapsed seconds
+ */
+void update_animations(animation_set_ptr set, float delta_time);
+
+/**
+ * @brief Append every instance's current frame to a sprite batch
+ * @param set Set to draw
+ * @param batch Batch started with the clips' texture
+ * @param scale Uniform scale of every frame
+ * @param tint Color and alpha multiplied with the texture
+ * @return false if the batch could not grow
+ */
+bool add_animation_sprites(const animation_set_t* set, sprite_batch_ptr batch,
+                           float scale, SDL_Color tint);
+
+#endif  // CORE_GRAPHICS_SPRITE_ANIMATION_H_
@@ -0,0 +1,244 @@
+/**
+ * @file sprite_batch.c
+ * @brief Implementation of single-submission sprite batches
+ */
+
+#include "sprite_batch.h"
+
+#include <SDL.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "cpu_renderer.h"
+#include "dynamic_array.h"
+#include "logger.h"
+#include "primitive_batch.h"
+#include "render_queue.h"
+#include "render_state.h"
+
+#define DEGREES_TO_RADIANS (3.14159265358979323846 / 180.0)
+
+sprite_batch_ptr create_sprite_batch(void) {
+  sprite_batch_ptr batch = calloc(1, sizeof(sprite_batch_t));
+  if (!batch) {
+    LOG_ERROR("Failed to allocate sprite batch");
+  }
+  return batch;
+}
+
+void destroy_sprite_batch(sprite_batch_ptr batch) {
+  if (!batch) {
+    return;
+  }
+  free(batch->entries);
+  free(batch->vertices);
+  free(batch->indices);
+  free(batch);
+}
+
+void begin_sprite_batch(sprite_batch_ptr batch, const texture_t* tex) {
+  if (!batch) {
+    return;
+  }
+  batch->texture = tex;
+  batch->count = 0;
+}
+
+bool add_sprite_entry(sprite_batch_ptr batch,
+                      const sprite_batch_entry_t* entry) {
+  if (!batch || !batch->texture) {
+    return false;
+  }
+
+  sprite_batch_entry_t* entries =
+      grow_array(batch->entries, &batch->capacity, batch->count + 1,
+                 sizeof(sprite_batch_entry_t));
+  if (!entries) {
+    LOG_ERROR("Failed to grow sprite batch");
+    return false;
+  }
+  batch->entries = entries;
+  batch->entries[batch->count++] = *entry;
+  return true;
+}
+
+bool add_sprite(sprite_batch_ptr batch, const rect_t* src_rect, float x,
+                float y, float scale, float angle, flip_t flip,
+                SDL_Color tint) {
+  if (!batch || !batch->texture) {
+    return false;
+  }
+
+  sprite_batch_entry_t entry = {
+      {0, 0, batch->texture->width, batch->texture->height},
+      x,
+      y,
+      scale,
+      scale,
+      angle,
+      SDL_FLIP_NONE,
+      tint};
+  if (src_rect) {
+    entry.src = (SDL_Rect){src_rect->x, src_rect->y, src_rect->w, src_rect->h};
+  }
+  if (flip & FLIP_HORIZONTAL) {
+    entry.flip |= SDL_FLIP_HORIZONTAL;
+  }
+  if (flip & FLIP_VERTICAL) {
+    entry.flip |= SDL_FLIP_VERTICAL;
+  }
+  return add_sprite_entry(batch, &entry);
+}
+
+// Make sure the vertex buffer holds four vertices per sprite and the index
+// buffer the 0-1-2, 2-3-0 pattern for every sprite
+static bool reserve_geometry(sprite_batch_ptr batch) {
+  SDL_Vertex* vertices =
+      grow_array(batch->vertices, &batch->vertex_capacity, batch->count * 4,
+                 sizeof(SDL_Vertex));
+  if (!vertices) {
+    return false;
+  }
+  batch->vertices = vertices;
+
+  if (batch->indexed_sprites >= batch->count) {
+    return true;
+  }
+  int* indices = grow_array(batch->indices, &batch->index_capacity,
+                            batch->count * 6, sizeof(int));
+  if (!indices) {
+    return false;
+  }
+  batch->indices = indices;
+
+  int sprites = batch->index_capacity / 6;
+  for (int i = batch->indexed_sprites; i < sprites; i++) {
+    int* quad = &batch->indices[i * 6];
+    int base = i * 4;
+    quad[0] = base;
+    quad[1] = base + 1;
+    quad[2] = base + 2;
+    quad[3] = base + 2;
+    quad[4] = base + 3;
+    quad[5] = base;
+  }
+  batch->indexed_sprites = sprites;
+  return true;
+}
+
+// Write the quads of all entries: top-left, top-right, bottom-right,
+// bottom-left, rotated around each destination center
+static void build_vertices(sprite_batch_ptr batch) {
+  float inverse_w = 1.0f / (float)batch->texture->width;
+  float inverse_h = 1.0f / (float)batch->texture->height;
+  SDL_BlendMode blend_mode;
+  SDL_GetTextureBlendMode(batch->texture->texture, &blend_mode);
+
+  for (int i = 0; i < batch->count; i++) {
+    const sprite_batch_entry_t* entry = &batch->entries[i];
+    SDL_Vertex* quad = &batch->vertices[i * 4];
+
+    float u0 = (float)entry->src.x * inverse_w;
+    float v0 = (float)entry->src.y * inverse_h;
+    float u1 = (float)(entry->src.x + entry->src.w) * inverse_w;
+    float v1 = (float)(entry->src.y + entry->src.h) * inverse_h;
+    if (entry->flip & SDL_FLIP_HORIZONTAL) {
+      float swap = u0;
+      u0 = u1;
+      u1 = swap;
+    }
+    if (entry->flip & SDL_FLIP_VERTICAL) {
+      float swap = v0;
+      v0 = v1;
+      v1 = swap;
+    }
+
+    float w = (float)entry->src.w * entry->scale_x;
+    float h = (float)entry->src.h * entry->scale_y;
+    if (entry->angle == 0.0f) {
+      quad[0].position = (SDL_FPoint){entry->x, entry->y};
+      quad[1].position = (SDL_FPoint){entry->x + w, entry->y};
+      quad[2].position = (SDL_FPoint){entry->x + w, entry->y + h};
+      quad[3].position = (SDL_FPoint){entry->x, entry->y + h};
+    } else {
+      float radians = (float)(entry->angle * DEGREES_TO_RADIANS);
+      float cos_a = cosf(radians);
+      float sin_a = sinf(radians);
+      float half_w = w * 0.5f;
+      float half_h = h * 0.5f;
+      float cx = entry->x + half_w;
+      float cy = entry->y + half_h;
+      // Corner offsets (-hw,-hh), (hw,-hh), (hw,hh), (-hw,hh) rotated
+      float ax = half_w * cos_a;
+      float ay = half_w * sin_a;
+      float bx = half_h * sin_a;
+      float by = half_h * cos_a;
+      quad[0].position = (SDL_FPoint){cx - ax + bx, cy - ay - by};
+      quad[1].position = (SDL_FPoint){cx + ax + bx, cy + ay - by};
+      quad[2].position = (SDL_FPoint){cx + ax - bx, cy + ay + by};
+      quad[3].position = (SDL_FPoint){cx - ax - bx, cy - ay + by};
+    }
+
+    quad[0].tex_coord = (SDL_FPoint){u0, v0};
+    quad[1].tex_coord = (SDL_FPoint){u1, v0};
+    quad[2].tex_coord = (SDL_FPoint){u1, v1};
+    quad[3].tex_coord = (SDL_FPoint){u0, v1};
+    SDL_Color color = texture_modulation(blend_mode, entry->tint);
+    quad[0].color = color;
+    quad[1].color = color;
+    quad[2].color = color;
+    quad[3].color = color;
+  }
+}
+
+// Route every entry through the render queue or the CPU backend, which
+// work on individual copies
+static void draw_entries_deferred(const graphics_context_ptr graphics_context,
+                                  const sprite_batch_ptr batch) {
+  texture_ptr tex = (texture_ptr)batch->texture;
+  bool recording = render_queue_recording(graphics_context);
+  if (!recording) {
+    flush_primitive_batch(graphics_context);
+  }
+
+  for (int i = 0; i < batch->count; i++) {
+    const sprite_batch_entry_t* entry = &batch->entries[i];
+    SDL_FRect dst = {entry->x, entry->y,
+                     (float)entry->src.w * entry->scale_x,
+                     (float)entry->src.h * entry->scale_y};
+    if (recording) {
+      queue_tinted_texture_copy(graphics_context, tex, &entry->src, &dst,
+                                entry->angle, entry->flip, entry->tint);
+    } else {
+      cpu_blit(graphics_context->cpu_renderer, tex->surface, &entry->src,
+               &dst, entry->angle, entry->flip, entry->tint);
+    }
+  }
+}
+
+void draw_sprite_batch(const graphics_context_ptr graphics_context,
+                       sprite_batch_ptr batch) {
+  if (!graphics_context || !batch || !batch->texture ||
+      !batch->texture->texture || batch->count == 0) {
+    return;
+  }
+
+  if (graphics_context->cpu_renderer ||
+      render_queue_recording(graphics_context)) {
+    draw_entries_deferred(graphics_context, batch);
+    return;
+  }
+
+  if (!reserve_geometry(batch)) {
+    LOG_ERROR("Failed to allocate sprite batch geometry");
+    return;
+  }
+  build_vertices(batch);
+
+  flush_primitive_batch(graphics_context);
+  if (SDL_RenderGeometry(graphics_context->renderer, batch->texture->texture,
+                         batch->vertices, batch->count * 4, batch->indices,
+                         batch->count * 6) != 0) {
+    LOG_SDL_ERROR("SDL_RenderGeometry");
+  }
+}
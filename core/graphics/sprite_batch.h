@@ -0,0 +1,103 @@
+/**
+ * @file sprite_batch.h
+ * @brief Single-submission sprite batches for one texture
+ *
+ * Collects sprites that share a texture (source rect, position, scale,
+ * rotation, flip and tint), transforms all quad corners in one pass and
+ * draws them with a single SDL_RenderGeometry call. The vertex and index
+ * buffers persist across frames, so a batch reused every frame does not
+ * allocate once it has reached its working size.
+ *
+ * With the CPU backend or while the render queue is recording, each sprite
+ * goes through the regular deferred copy path instead, with the same tint.
+ */
+
+#ifndef CORE_GRAPHICS_SPRITE_BATCH_H_
+#define CORE_GRAPHICS_SPRITE_BATCH_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+
+#include "graphics_context.h"
+#include "texture.h"
+
+// One sprite; the destination is src scaled around its top-left corner
+typedef struct {
+  SDL_Rect src;
+  float x;
+  float y;
+  float scale_x;
+  float scale_y;
+  float angle;  // Clockwise degrees around the destination center
+  SDL_RendererFlip flip;
+  SDL_Color tint;
+} sprite_batch_entry_t;
+
+typedef struct {
+  const texture_t* texture;
+  sprite_batch_entry_t* entries;
+  int count;
+  int capacity;
+  SDL_Vertex* vertices;  // Four per sprite
+  int vertex_capacity;
+  int* indices;  // Six per sprite, built once per capacity change
+  int index_capacity;
+  int indexed_sprites;  // Sprites covered by the index pattern
+} sprite_batch_t, *sprite_batch_ptr;
+
+/**
+ * @brief Create an empty sprite batch
+ * @return Batch, or NULL on allocation failure
+ */
+sprite_batch_ptr create_sprite_batch(void);
+
+/**
+ * @brief Free a sprite batch and its buffers
+ * @param batch Batch to destroy (may be NULL)
+ */
+void destroy_sprite_batch(sprite_batch_ptr batch);
+
+/**
+ * @brief Start collecting sprites for a texture, dropping previous entries
+ * @param batch Batch to reset
+ * @param tex Texture every sprite is taken from; must outlive the draw
+ */
+void begin_sprite_batch(sprite_batch_ptr batch, const texture_t* tex);
+
+/**
+ * @brief Add a sprite to the batch
+ * @param batch Batch started with begin_sprite_batch()
+ * @param src_rect Source rectangle (NULL for the whole texture)
+ * @param x Destination left edge
+ * @param y Destination top edge
+ * @param scale Uniform scale of the source rectangle
+ * @param angle Clockwise rotation around the destination center, in degrees
+ * @param flip Flip flags
+ * @param tint Color and alpha multiplied with the texture
+ * @return false if the entry could not be stored
+ */
+bool add_sprite(sprite_batch_ptr batch, const rect_t* src_rect, float x,
+                float y, float scale, float angle, flip_t flip,
+                SDL_Color tint);
+
+/**
+ * @brief Add a prepared sprite entry to the batch
+ * @param batch Batch started with begin_sprite_batch()
+ * @param entry Sprite to copy into the batch
+ * @return false if the entry could not be stored
+ */
+bool add_sprite_entry(sprite_batch_ptr batch,
+                      const sprite_batch_entry_t* entry);
+
+/**
+ * @brief Draw every sprite in the batch with one submission
+ *
+ * Entries are kept, so a static batch can be drawn again next frame.
+ *
+ * @param graphics_context Graphics context to draw to
+ * @param batch Batch to draw
+ */
+void draw_sprite_batch(const graphics_context_ptr graphics_context,
+                       sprite_batch_ptr batch);
+
+#endif  // CORE_GRAPHICS_SPRITE_BATCH_H_
@@ -0,0 +1,150 @@
+/**
+ * @file static_layer.c
+ * @brief Implementation of cached static layers
+ */
+
+#include "static_layer.h"
+
+#include <stdlib.h>
+
+#include "logger.h"
+#include "primitive_batch.h"
+#include "render_queue.h"
+#include "texture.h"
+
+// Runs on the thread pushing the event, so only the atomics are touched
+static int SDLCALL watch_render_events(void* user_data, SDL_Event* event) {
+  static_layer_ptr layer = user_data;
+  if (event->type == SDL_RENDER_TARGETS_RESET) {
+    SDL_AtomicSet(&layer->targets_lost, 1);
+  } else if (event->type == SDL_RENDER_DEVICE_RESET) {
+    SDL_AtomicSet(&layer->device_lost, 1);
+  }
+  return 0;
+}
+
+static_layer_ptr create_static_layer(static_layer_draw_fn draw,
+                                     void* user_data) {
+  if (!draw) {
+    return NULL;
+  }
+
+  static_layer_ptr layer = calloc(1, sizeof(static_layer_t));
+  if (!layer) {
+    LOG_ERROR("Failed to allocate static layer");
+    return NULL;
+  }
+  layer->draw = draw;
+  layer->user_data = user_data;
+  layer->dirty = true;
+  SDL_AddEventWatch(watch_render_events, layer);
+  return layer;
+}
+
+static void release_texture(static_layer_ptr layer) {
+  if (layer->texture) {
+    SDL_DestroyTexture(layer->texture);
+    layer->texture = NULL;
+  }
+  layer->width = 0;
+  layer->height = 0;
+}
+
+void destroy_static_layer(static_layer_ptr layer) {
+  if (!layer) {
+    return;
+  }
+  SDL_DelEventWatch(watch_render_events, layer);
+  release_texture(layer);
+  free(layer);
+}
+
+void invalidate_static_layer(static_layer_ptr layer) {
+  if (layer) {
+    layer->dirty = true;
+  }
+}
+
+// Size of the area the layer covers: the logical size if one is set,
+// otherwise the renderer output
+static bool get_layer_size(const graphics_context_ptr graphics_context,
+                           int* width, int* height) {
+  SDL_RenderGetLogicalSize(graphics_context->renderer, width, height);
+  if (*width > 0 && *height > 0) {
+    return true;
+  }
+  if (SDL_GetRendererOutputSize(graphics_context->renderer, width, height) !=
+      0) {
+    LOG_SDL_ERROR("SDL_GetRendererOutputSize");
+    return false;
+  }
+  return *width > 0 && *height > 0;
+}
+
+static bool create_layer_texture(const graphics_context_ptr graphics_context,
+                                 static_layer_ptr layer, int width,
+                                 int height) {
+  layer->texture =
+      create_target_texture(graphics_context->renderer, width, height);
+  if (!layer->texture) {
+    return false;
+  }
+  layer->width = width;
+  layer->height = height;
+  layer->dirty = true;
+  return true;
+}
+
+// Run the callback with the layer texture as the render target
+static bool render_layer(const graphics_context_ptr graphics_context,
+                         static_layer_ptr layer) {
+  if (!render_into_texture(graphics_context, layer->texture, layer->draw,
+                           layer->user_data)) {
+    return false;
+  }
+  layer->dirty = false;
+  layer->rebuild_count++;
+  return true;
+}
+
+void draw_static_layer(const graphics_context_ptr graphics_context,
+                       static_layer_ptr layer) {
+  if (!graphics_context || !graphics_context->renderer || !layer) {
+    return;
+  }
+
+  int width, height;
+  if (graphics_context->cpu_renderer ||
+      !SDL_RenderTargetSupported(graphics_context->renderer) ||
+      !get_layer_size(graphics_context, &width, &height)) {
+    layer->draw(graphics_context, layer->user_data);
+    return;
+  }
+
+  // A device reset destroys textures; a targets reset only their contents
+  if (SDL_AtomicSet(&layer->device_lost, 0) || width != layer->width ||
+      height != layer->height) {
+    release_texture(layer);
+  }
+  if (SDL_AtomicSet(&layer->targets_lost, 0)) {
+    layer->dirty = true;
+  }
+
+  if ((!layer->texture &&
+       !create_layer_texture(graphics_context, layer, width, height)) ||
+      (layer->dirty && !render_layer(graphics_context, layer))) {
+    layer->draw(graphics_context, layer->user_data);
+    return;
+  }
+
+  texture_t tex = {layer->texture, layer->width, layer->height, NULL};
+  SDL_Rect src = {0, 0, layer->width, layer->height};
+  SDL_FRect dst = {0.0f, 0.0f, (float)layer->width, (float)layer->height};
+  if (queue_texture_copy(graphics_context, &tex, &src, &dst, 0.0,
+                         SDL_FLIP_NONE, 255)) {
+    return;
+  }
+
+  flush_primitive_batch(graphics_context);
+  SDL_RenderCopy(graphics_context->renderer, layer->texture, NULL, NULL);
+}
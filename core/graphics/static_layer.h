@@ -0,0 +1,73 @@
+/**
+ * @file static_layer.h
+ * @brief Cached layers for content that rarely changes
+ *
+ * A static layer renders its draw callback once into a target texture
+ * (SDL_TEXTUREACCESS_TARGET) covering the logical screen and composites
+ * that texture with a single copy every frame. The callback runs again only
+ * after invalidate_static_layer(), after the renderer reports lost render
+ * targets or a device reset, or when the logical size changes. Suited to
+ * starfields, playfield borders and HUD chrome.
+ *
+ * With the CPU backend, or a renderer without target textures, the
+ * callback simply runs every frame.
+ */
+
+#ifndef CORE_GRAPHICS_STATIC_LAYER_H_
+#define CORE_GRAPHICS_STATIC_LAYER_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+
+#include "graphics_context.h"
+
+// Draws the layer's content with the regular engine calls
+typedef void (*static_layer_draw_fn)(const graphics_context_ptr graphics_context,
+                                     void* user_data);
+
+typedef struct {
+  SDL_Texture* texture;  // Created on first draw
+  int width;             // Logical size the texture was rendered at
+  int height;
+  static_layer_draw_fn draw;
+  void* user_data;
+  bool dirty;
+  SDL_atomic_t targets_lost;  // Set from the SDL event watch
+  SDL_atomic_t device_lost;
+  int rebuild_count;  // Times the content has been rendered
+} static_layer_t, *static_layer_ptr;
+
+/**
+ * @brief Create a layer; nothing is rendered until it is first drawn
+ * @param draw Callback drawing the layer's content
+ * @param user_data Passed to the callback
+ * @return Layer, or NULL on failure
+ */
+static_layer_ptr create_static_layer(static_layer_draw_fn draw,
+                                     void* user_data);
+
+/**
+ * @brief Free a layer and its texture
+ * @param layer Layer to destroy (may be NULL)
+ */
+void destroy_static_layer(static_layer_ptr layer);
+
+/**
+ * @brief Mark the layer's content as changed
+ * @param layer Layer to re-render on its next draw
+ */
+void invalidate_static_layer(static_layer_ptr layer);
+
+/**
+ * @brief Composite the layer, re-rendering it first if needed
+ *
+ * The texture covers the whole logical screen and is blended over what has
+ * been drawn so far, so call this where the content belongs in draw order.
+ *
+ * @param graphics_context Graphics context to draw to
+ * @param layer Layer to draw
+ */
+void draw_static_layer(const graphics_context_ptr graphics_context,
+                       static_layer_ptr layer);
+
+#endif  // CORE_GRAPHICS_STATIC_LAYER_H_
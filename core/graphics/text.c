@@ -1,11 +1,19 @@
 #include "text.h"
 
 #include <assert.h>
+#include <math.h>
+#include <stdbool.h>
 #include <stdio.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "coords.h"
+#include "dynamic_array.h"
 #include "graphics.h"
 #include "inline.h"
+#include "primitive_batch.h"
 
 const coords_t FONT_COORDS[] = {
     // "A"
@@ -336,50 +344,358 @@ ALWAYS_INLINE bounds_t bounds_for_char(char c) {
   return bounds;
 }
 
+// Stroke width of the vector font, in pixels at every scale
+#define TEXT_STROKE_WIDTH 3.0f
+// Longest miter allowed, in half widths, before a join is beveled
+#define TEXT_MITER_LIMIT 4.0f
+
+#define FONT_COORD_COUNT (sizeof(FONT_COORDS) / sizeof(FONT_COORDS[0]))
+// Each pen-down move becomes a quad plus at most a four-vertex join
+#define GLYPH_MESH_VERTICES (FONT_COORD_COUNT * 8)
+#define GLYPH_MESH_INDICES (FONT_COORD_COUNT * 12)
+
+// A glyph compiled from FONT_COORDS. Vertex positions are split into a
+// point on the pen path in font units, which scales with the text, and an
+// outline offset in pixels, which does not, so one mesh serves every scale.
+typedef struct {
+  bool defined;
+  int first_vertex;
+  int vertex_count;
+  int first_index;  // Indices are relative to first_vertex
+  int index_count;
+  float advance_x;  // Pen movement in font units, y pointing down
+  float advance_y;
+  float max_x;  // Furthest right and up the pen goes, from the glyph origin
+  float min_y;
+} vector_glyph_t;
+
+static vector_glyph_t vector_glyphs[128];
+static float glyph_unit_x[GLYPH_MESH_VERTICES];
+static float glyph_unit_y[GLYPH_MESH_VERTICES];
+static float glyph_offset_x[GLYPH_MESH_VERTICES];
+static float glyph_offset_y[GLYPH_MESH_VERTICES];
+static int glyph_indices[GLYPH_MESH_INDICES];
+static int glyph_vertex_total = 0;
+static int glyph_index_total = 0;
+static bool vector_font_compiled = false;
+
+// Per-string buffers, reused across calls
+static float* text_unit_x = NULL;
+static float* text_unit_y = NULL;
+static float* text_offset_x = NULL;
+static float* text_offset_y = NULL;
+static int text_unit_x_capacity = 0;
+static int text_unit_y_capacity = 0;
+static int text_offset_x_capacity = 0;
+static int text_offset_y_capacity = 0;
+static SDL_Vertex* text_vertices = NULL;
+static int text_vertex_capacity = 0;
+static int* text_indices = NULL;
+static int text_index_capacity = 0;
+
+static int push_glyph_vertex(const vector_glyph_t* glyph, SDL_FPoint unit,
+                             float offset_x, float offset_y) {
+  int v = glyph_vertex_total++;
+  glyph_unit_x[v] = unit.x;
+  glyph_unit_y[v] = unit.y;
+  glyph_offset_x[v] = offset_x;
+  glyph_offset_y[v] = offset_y;
+  return v - glyph->first_vertex;
+}
+
+static void push_glyph_triangle(int a, int b, int c) {
+  glyph_indices[glyph_index_total++] = a;
+  glyph_indices[glyph_index_total++] = b;
+  glyph_indices[glyph_index_total++] = c;
+}
+
+// Outer wedge between two segments meeting at `corner`, mitered unless the
+// miter is longer than TEXT_MITER_LIMIT half widths. Directions do not
+// change with scale, so the join is all pixel offsets.
+static void compile_join(const vector_glyph_t* glyph, SDL_FPoint corner,
+                         SDL_FPoint d0, SDL_FPoint d1, float half_width) {
+  float cross = d0.x * d1.y - d0.y * d1.x;
+  if (fabsf(cross) < 1e-6f) {
+    return;
+  }
+
+  float side = cross > 0.0f ? -1.0f : 1.0f;
+  SDL_FPoint n0 = {-d0.y * side, d0.x * side};
+  SDL_FPoint n1 = {-d1.y * side, d1.x * side};
+
+  int center = push_glyph_vertex(glyph, corner, 0.0f, 0.0f);
+  int a = push_glyph_vertex(glyph, corner, n0.x * half_width,
+                            n0.y * half_width);
+  int b = push_glyph_vertex(glyph, corner, n1.x * half_width,
+                            n1.y * half_width);
+
+  SDL_FPoint miter = {n0.x + n1.x, n0.y + n1.y};
+  float miter_length = sqrtf(miter.x * miter.x + miter.y * miter.y);
+  float cos_half_angle = miter_length * 0.5f;
+  if (cos_half_angle > 1.0f / TEXT_MITER_LIMIT) {
+    float scale = half_width / (cos_half_angle * miter_length);
+    int tip = push_glyph_vertex(glyph, corner, miter.x * scale,
+                                miter.y * scale);
+    push_glyph_triangle(center, a, tip);
+    push_glyph_triangle(center, tip, b);
+  } else {
+    push_glyph_triangle(center, a, b);
+  }
+}
+
+// One pen-down polyline with square caps, as draw_thick_polyline() would
+// outline it
+static void compile_stroke(const vector_glyph_t* glyph,
+                           const SDL_FPoint* points, int count) {
+  float half_width = TEXT_STROKE_WIDTH * 0.5f;
+  int segment_count = count - 1;
+  bool has_previous = false;
+  SDL_FPoint previous_direction = {0.0f, 0.0f};
+
+  for (int i = 0; i < segment_count; i++) {
+    SDL_FPoint p0 = points[i];
+    SDL_FPoint p1 = points[i + 1];
+    float dx = p1.x - p0.x;
+    float dy = p1.y - p0.y;
+    float length = sqrtf(dx * dx + dy * dy);
+    if (length < 1e-6f) {
+      continue;
+    }
+
+    SDL_FPoint direction = {dx / length, dy / length};
+    SDL_FPoint normal = {-direction.y * half_width, direction.x * half_width};
+    SDL_FPoint cap0 = {0.0f, 0.0f};
+    SDL_FPoint cap1 = {0.0f, 0.0f};
+    if (i == 0) {
+      cap0 = (SDL_FPoint){-direction.x * half_width, -direction.y * half_width};
+    }
+    if (i == segment_count - 1) {
+      cap1 = (SDL_FPoint){direction.x * half_width, direction.y * half_width};
+    }
+
+    if (has_previous) {
+      compile_join(glyph, p0, previous_direction, direction, half_width);
+    }
+
+    int a = push_glyph_vertex(glyph, p0, cap0.x + normal.x, cap0.y + normal.y);
+    int b = push_glyph_vertex(glyph, p1, cap1.x + normal.x, cap1.y + normal.y);
+    int c = push_glyph_vertex(glyph, p1, cap1.x - normal.x, cap1.y - normal.y);
+    int d = push_glyph_vertex(glyph, p0, cap0.x - normal.x, cap0.y - normal.y);
+    push_glyph_triangle(a, b, c);
+    push_glyph_triangle(a, c, d);
+
+    previous_direction = direction;
+    has_previous = true;
+  }
+}
+
+static void compile_glyph(char c) {
+  bounds_t bounds = bounds_for_char(c);
+  if (bounds.upper == 0) {
+    return;
+  }
+
+  vector_glyph_t* glyph = &vector_glyphs[(unsigned char)c];
+  glyph->defined = true;
+  glyph->first_vertex = glyph_vertex_total;
+  glyph->first_index = glyph_index_total;
+  glyph->min_y = 999999.0f;
+
+  // Every glyph ends with a pen-up move, so strokes never span glyphs
+  SDL_FPoint stroke[FONT_COORD_COUNT + 1];
+  int stroke_length = 0;
+  SDL_FPoint pen = {0.0f, 0.0f};
+  for (int j = bounds.lower; j < bounds.upper; j++) {
+    SDL_FPoint next = {pen.x + (float)FONT_COORDS[j].x_delta,
+                       pen.y - (float)FONT_COORDS[j].y_delta};
+    if (FONT_COORDS[j].brightness > 0) {
+      if (stroke_length == 0) {
+        stroke[stroke_length++] = pen;
+      }
+      stroke[stroke_length++] = next;
+    } else if (stroke_length > 0) {
+      compile_stroke(glyph, stroke, stroke_length);
+      stroke_length = 0;
+    }
+    pen = next;
+    glyph->max_x = pen.x > glyph->max_x ? pen.x : glyph->max_x;
+    glyph->min_y = pen.y < glyph->min_y ? pen.y : glyph->min_y;
+  }
+  if (stroke_length > 0) {
+    compile_stroke(glyph, stroke, stroke_length);
+  }
+
+  glyph->vertex_count = glyph_vertex_total - glyph->first_vertex;
+  glyph->index_count = glyph_index_total - glyph->first_index;
+  glyph->advance_x = pen.x;
+  glyph->advance_y = pen.y;
+}
+
+static void compile_vector_font(void) {
+  if (vector_font_compiled) {
+    return;
+  }
+  for (int c = 1; c < 128; c++) {
+    compile_glyph((char)c);
+  }
+  vector_font_compiled = true;
+}
+
+static ALWAYS_INLINE const vector_glyph_t* glyph_for_char(char c) {
+  unsigned char code = (unsigned char)c;
+  return code < 128 && vector_glyphs[code].defined ? &vector_glyphs[code]
+                                                   : NULL;
+}
+
 ALWAYS_INLINE text_dimensions_t calculate_text_dimensions(const char* s,
                                                           int scale) {
+  compile_vector_font();
   double min_y = 999999;
   double max_x = 0;
   double cx = 0;
   double cy = 0;
   for (size_t i = 0; s[i]; i++) {
-    bounds_t bounds = bounds_for_char(s[i]);
-    if (bounds.upper != 0) {
-      for (int j = bounds.lower; j < bounds.upper; j++) {
-        cx += FONT_COORDS[j].x_delta * scale;
-        cy -= FONT_COORDS[j].y_delta * scale;
-        if (cy <= min_y) {
-          min_y = cy;
-        }
-        if (cx > max_x) {
-          max_x = cx;
-        }
-      }
+    const vector_glyph_t* glyph = glyph_for_char(s[i]);
+    if (!glyph) {
+      continue;
     }
+    double right = cx + glyph->max_x * scale;
+    double top = cy + glyph->min_y * scale;
+    max_x = right > max_x ? right : max_x;
+    min_y = top < min_y ? top : min_y;
+    cx += glyph->advance_x * scale;
+    cy += glyph->advance_y * scale;
   }
   return text_dimensions(max_x, -min_y);
 }
 
+static bool reserve_text_buffers(int vertex_count, int index_count) {
+  float* unit_x = grow_array(text_unit_x, &text_unit_x_capacity, vertex_count,
+                             sizeof(float));
+  if (unit_x) {
+    text_unit_x = unit_x;
+  }
+  float* unit_y = grow_array(text_unit_y, &text_unit_y_capacity, vertex_count,
+                             sizeof(float));
+  if (unit_y) {
+    text_unit_y = unit_y;
+  }
+  float* offset_x = grow_array(text_offset_x, &text_offset_x_capacity,
+                               vertex_count, sizeof(float));
+  if (offset_x) {
+    text_offset_x = offset_x;
+  }
+  float* offset_y = grow_array(text_offset_y, &text_offset_y_capacity,
+                               vertex_count, sizeof(float));
+  if (offset_y) {
+    text_offset_y = offset_y;
+  }
+  SDL_Vertex* vertices = grow_array(text_vertices, &text_vertex_capacity,
+                                    vertex_count, sizeof(SDL_Vertex));
+  if (vertices) {
+    text_vertices = vertices;
+  }
+  int* indices = grow_array(text_indices, &text_index_capacity, index_count,
+                            sizeof(int));
+  if (indices) {
+    text_indices = indices;
+  }
+  return unit_x && unit_y && offset_x && offset_y && vertices && indices;
+}
+
+// Place every vertex of the string in one pass: pen path points are scaled
+// and moved to the text position, then the stroke outline offsets added
+static void transform_text_vertices(int count, float x, float y,
+                                    float scale) {
+  int i = 0;
+#if defined(__SSE2__)
+  __m128 x4 = _mm_set1_ps(x);
+  __m128 y4 = _mm_set1_ps(y);
+  __m128 scale4 = _mm_set1_ps(scale);
+  for (; i + 4 <= count; i += 4) {
+    __m128 px = _mm_add_ps(
+        _mm_add_ps(x4, _mm_mul_ps(_mm_loadu_ps(text_unit_x + i), scale4)),
+        _mm_loadu_ps(text_offset_x + i));
+    __m128 py = _mm_add_ps(
+        _mm_add_ps(y4, _mm_mul_ps(_mm_loadu_ps(text_unit_y + i), scale4)),
+        _mm_loadu_ps(text_offset_y + i));
+    // Interleave into x, y pairs and store one position per vertex
+    __m128 lo = _mm_unpacklo_ps(px, py);
+    __m128 hi = _mm_unpackhi_ps(px, py);
+    _mm_storel_pi((__m64*)&text_vertices[i].position, lo);
+    _mm_storeh_pi((__m64*)&text_vertices[i + 1].position, lo);
+    _mm_storel_pi((__m64*)&text_vertices[i + 2].position, hi);
+    _mm_storeh_pi((__m64*)&text_vertices[i + 3].position, hi);
+  }
+#endif
+  for (; i < count; i++) {
+    text_vertices[i].position.x = x + text_unit_x[i] * scale + text_offset_x[i];
+    text_vertices[i].position.y = y + text_unit_y[i] * scale + text_offset_y[i];
+  }
+}
+
 ALWAYS_INLINE point_t write_text(const graphics_context_ptr graphics_context,
                                  const char* s, const point_t position,
                                  int scale, color_t color) {
-  double cx = position.x;
-  double cy = position.y;
+  compile_vector_font();
+  int vertex_count = 0;
+  int index_count = 0;
+  float pen_x = 0.0f;
+  float pen_y = 0.0f;
   for (size_t i = 0; s[i]; i++) {
-    bounds_t bounds = bounds_for_char(s[i]);
-    if (bounds.upper != 0) {
-      for (int j = bounds.lower; j < bounds.upper; j++) {
-        double nx = cx + (FONT_COORDS[j].x_delta * scale);
-        double ny = cy - (FONT_COORDS[j].y_delta * scale);
-        if (FONT_COORDS[j].brightness > 0) {
-          draw_thick_line(graphics_context, cx, cy, nx, ny, color);
-        }
-        cx = nx;
-        cy = ny;
-      }
+    const vector_glyph_t* glyph = glyph_for_char(s[i]);
+    if (glyph) {
+      vertex_count += glyph->vertex_count;
+      index_count += glyph->index_count;
+      pen_x += glyph->advance_x;
+      pen_y += glyph->advance_y;
+    }
+  }
+  point_t end = point(position.x + pen_x * scale, position.y + pen_y * scale);
+  if (index_count == 0 || scale == 0 ||
+      !reserve_text_buffers(vertex_count, index_count)) {
+    return end;
+  }
+
+  // Lay the glyph meshes out along the pen path in font units
+  SDL_Color vertex_color = {R(color), G(color), B(color), 255};
+  int vertex_base = 0;
+  int index_base = 0;
+  pen_x = 0.0f;
+  pen_y = 0.0f;
+  for (size_t i = 0; s[i]; i++) {
+    const vector_glyph_t* glyph = glyph_for_char(s[i]);
+    if (!glyph) {
+      continue;
+    }
+    for (int v = 0; v < glyph->vertex_count; v++) {
+      int source = glyph->first_vertex + v;
+      int target = vertex_base + v;
+      text_unit_x[target] = pen_x + glyph_unit_x[source];
+      text_unit_y[target] = pen_y + glyph_unit_y[source];
+      text_offset_x[target] = glyph_offset_x[source];
+      text_offset_y[target] = glyph_offset_y[source];
+      text_vertices[target].color = vertex_color;
+      text_vertices[target].tex_coord = (SDL_FPoint){0.0f, 0.0f};
     }
+    for (int j = 0; j < glyph->index_count; j++) {
+      text_indices[index_base + j] =
+          vertex_base + glyph_indices[glyph->first_index + j];
+    }
+    vertex_base += glyph->vertex_count;
+    index_base += glyph->index_count;
+    pen_x += glyph->advance_x;
+    pen_y += glyph->advance_y;
+  }
+
+  transform_text_vertices(vertex_count, (float)position.x, (float)position.y,
+                          (float)scale);
+  if (!batch_geometry(graphics_context, text_vertices, vertex_count,
+                      text_indices, index_count)) {
+    SDL_RenderGeometry(graphics_context->renderer, NULL, text_vertices,
+                       vertex_count, text_indices, index_count);
   }
-  return point(cx, cy);
+  return end;
 }
 
 ALWAYS_INLINE point_t write_number(const graphics_context_ptr graphics_context,
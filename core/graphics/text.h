@@ -5,6 +5,12 @@
  * Provides functions for rendering text and numbers using a custom
  * bitmap font. Supports scalable text rendering and calculates text
  * dimensions for layout purposes.
+ *
+ * Glyph strokes are compiled once into triangle meshes whose vertices are a
+ * pen path point in font units plus a stroke outline offset in pixels, so
+ * the same mesh serves every scale. write_text() places a whole string in
+ * one vectorized pass and submits it as a single geometry batch;
+ * calculate_text_dimensions() sums precomputed glyph advances and extents.
  */
 
 #ifndef CORE_GRAPHICS_TEXT_H_
@@ -16,6 +22,10 @@
 #include "graphics.h"
 #include "graphics_context.h"
 
+// Pixels the stroke outline may reach past the pen path: half the 3 px
+// stroke width times the miter limit of 4
+#define TEXT_STROKE_MARGIN 6
+
 typedef struct {
   int width;
   int height;
@@ -0,0 +1,461 @@
+/**
+ * @file text_cache.c
+ * @brief Implementation of the rendered string cache
+ */
+
+#include "text_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu_renderer.h"
+#include "dynamic_array.h"
+#include "logger.h"
+#include "text.h"
+
+#define INITIAL_BUCKET_COUNT 64
+#define NO_ENTRY (-1)
+
+typedef struct {
+  text_source_t source;
+  const void* font;
+  const char* text;
+  uint32_t color;
+  int scale;
+  uint64_t hash;
+} text_key_t;
+
+static text_key_t make_key(text_source_t source, const void* font,
+                           const char* text, uint32_t color, int scale) {
+  text_key_t key = {source, font, text, color, scale, 1469598103934665603ull};
+  for (const char* c = text; *c; c++) {
+    key.hash = (key.hash ^ (uint8_t)*c) * 1099511628211ull;
+  }
+  key.hash = (key.hash ^ (uint64_t)(uintptr_t)font) * 1099511628211ull;
+  key.hash = (key.hash ^ (uint64_t)source) * 1099511628211ull;
+  key.hash = (key.hash ^ color) * 1099511628211ull;
+  key.hash = (key.hash ^ (uint64_t)(uint32_t)scale) * 1099511628211ull;
+  return key;
+}
+
+static bool rebuild_buckets(text_cache_ptr cache, int bucket_count) {
+  int* buckets = malloc(sizeof(int) * (size_t)bucket_count);
+  if (!buckets) {
+    return false;
+  }
+  for (int i = 0; i < bucket_count; i++) {
+    buckets[i] = NO_ENTRY;
+  }
+  for (int i = 0; i < cache->entry_count; i++) {
+    text_cache_entry_t* entry = &cache->entries[i];
+    if (entry->text) {
+      int bucket = (int)(entry->hash & (uint64_t)(bucket_count - 1));
+      entry->chain_next = buckets[bucket];
+      buckets[bucket] = i;
+    }
+  }
+  free(cache->buckets);
+  cache->buckets = buckets;
+  cache->bucket_count = bucket_count;
+  return true;
+}
+
+static inline int bucket_for(const text_cache_ptr cache, uint64_t hash) {
+  return (int)(hash & (uint64_t)(cache->bucket_count - 1));
+}
+
+static int find_entry(const text_cache_ptr cache, const text_key_t* key) {
+  for (int i = cache->buckets[bucket_for(cache, key->hash)]; i != NO_ENTRY;
+       i = cache->entries[i].chain_next) {
+    const text_cache_entry_t* entry = &cache->entries[i];
+    if (entry->hash == key->hash && entry->source == key->source &&
+        entry->font == key->font && entry->color == key->color &&
+        entry->scale == key->scale && !strcmp(entry->text, key->text)) {
+      return i;
+    }
+  }
+  return NO_ENTRY;
+}
+
+static void lru_unlink(text_cache_ptr cache, int index) {
+  text_cache_entry_t* entry = &cache->entries[index];
+  if (entry->lru_prev != NO_ENTRY) {
+    cache->entries[entry->lru_prev].lru_next = entry->lru_next;
+  } else {
+    cache->lru_head = entry->lru_next;
+  }
+  if (entry->lru_next != NO_ENTRY) {
+    cache->entries[entry->lru_next].lru_prev = entry->lru_prev;
+  } else {
+    cache->lru_tail = entry->lru_prev;
+  }
+  entry->lru_prev = NO_ENTRY;
+  entry->lru_next = NO_ENTRY;
+}
+
+static void lru_append(text_cache_ptr cache, int index) {
+  text_cache_entry_t* entry = &cache->entries[index];
+  entry->lru_prev = cache->lru_tail;
+  entry->lru_next = NO_ENTRY;
+  if (cache->lru_tail != NO_ENTRY) {
+    cache->entries[cache->lru_tail].lru_next = index;
+  } else {
+    cache->lru_head = index;
+  }
+  cache->lru_tail = index;
+}
+
+// Store a rendered texture under `key`; the texture is destroyed on failure
+static int add_entry(text_cache_ptr cache, const text_key_t* key,
+                     texture_t texture, int origin_x, int origin_y) {
+  // Keep chains short: at most one entry per bucket on average
+  if (cache->stats.entries + 1 > cache->bucket_count &&
+      !rebuild_buckets(cache, cache->bucket_count * 2)) {
+    free_texture(&texture);
+    return NO_ENTRY;
+  }
+
+  char* text = malloc(strlen(key->text) + 1);
+  int index = cache->free_entry;
+  if (text && index == NO_ENTRY) {
+    text_cache_entry_t* entries =
+        grow_array(cache->entries, &cache->entry_capacity,
+                   cache->entry_count + 1, sizeof(text_cache_entry_t));
+    if (entries) {
+      cache->entries = entries;
+      index = cache->entry_count++;
+    }
+  } else if (text) {
+    cache->free_entry = cache->entries[index].chain_next;
+  }
+  if (!text || index == NO_ENTRY) {
+    free(text);
+    free_texture(&texture);
+    return NO_ENTRY;
+  }
+  strcpy(text, key->text);
+
+  text_cache_entry_t* entry = &cache->entries[index];
+  entry->text = text;
+  entry->font = key->font;
+  entry->source = key->source;
+  entry->color = key->color;
+  entry->scale = key->scale;
+  entry->hash = key->hash;
+  entry->texture = texture;
+  entry->origin_x = origin_x;
+  entry->origin_y = origin_y;
+  entry->last_frame = cache->frame;
+  // GPU copy plus the CPU backend's surface, if any
+  entry->bytes = (size_t)texture.width * texture.height *
+                 (texture.surface ? 8 : 4);
+
+  int bucket = bucket_for(cache, key->hash);
+  entry->chain_next = cache->buckets[bucket];
+  cache->buckets[bucket] = index;
+  lru_append(cache, index);
+  cache->stats.entries++;
+  cache->stats.bytes += entry->bytes;
+  return index;
+}
+
+static void remove_entry(text_cache_ptr cache, int index) {
+  text_cache_entry_t* entry = &cache->entries[index];
+  int* link = &cache->buckets[bucket_for(cache, entry->hash)];
+  while (*link != index) {
+    link = &cache->entries[*link].chain_next;
+  }
+  *link = entry->chain_next;
+  lru_unlink(cache, index);
+
+  free_texture(&entry->texture);
+  free(entry->text);
+  entry->text = NULL;
+  cache->stats.entries--;
+  cache->stats.bytes -= entry->bytes;
+  entry->bytes = 0;
+  entry->chain_next = cache->free_entry;
+  cache->free_entry = index;
+}
+
+// Evict least recently used entries until the budget is met. Entries handed
+// out this frame, which sit at the recent end of the list, may still be
+// drawn by deferred commands and are kept.
+static void enforce_budget(text_cache_ptr cache) {
+  while (cache->budget > 0 && cache->stats.bytes > cache->budget &&
+         cache->lru_head != NO_ENTRY &&
+         cache->entries[cache->lru_head].last_frame != cache->frame) {
+    remove_entry(cache, cache->lru_head);
+    cache->stats.evictions++;
+  }
+}
+
+text_cache_ptr create_text_cache(size_t budget_bytes) {
+  text_cache_ptr cache = calloc(1, sizeof(text_cache_t));
+  if (!cache) {
+    LOG_ERROR("Failed to allocate text cache");
+    return NULL;
+  }
+  cache->budget = budget_bytes;
+  cache->free_entry = NO_ENTRY;
+  cache->lru_head = NO_ENTRY;
+  cache->lru_tail = NO_ENTRY;
+  if (!rebuild_buckets(cache, INITIAL_BUCKET_COUNT)) {
+    LOG_ERROR("Failed to allocate text cache");
+    free(cache);
+    return NULL;
+  }
+  return cache;
+}
+
+void clear_text_cache(text_cache_ptr cache) {
+  if (!cache) {
+    return;
+  }
+  while (cache->lru_head != NO_ENTRY) {
+    remove_entry(cache, cache->lru_head);
+  }
+}
+
+void destroy_text_cache(text_cache_ptr cache) {
+  if (!cache) {
+    return;
+  }
+  clear_text_cache(cache);
+  free(cache->entries);
+  free(cache->buckets);
+  free(cache);
+}
+
+void set_text_cache_budget(text_cache_ptr cache, size_t budget_bytes) {
+  if (!cache) {
+    return;
+  }
+  cache->budget = budget_bytes;
+  enforce_budget(cache);
+}
+
+// Return a hit as the most recently used entry, counting the lookup
+static int lookup(text_cache_ptr cache,
+                  const graphics_context_ptr graphics_context,
+                  const text_key_t* key) {
+  cache->frame = graphics_context->frame_count;
+  int index = find_entry(cache, key);
+  if (index == NO_ENTRY) {
+    cache->stats.misses++;
+    return NO_ENTRY;
+  }
+  cache->stats.hits++;
+  cache->entries[index].last_frame = cache->frame;
+  lru_unlink(cache, index);
+  lru_append(cache, index);
+  return index;
+}
+
+static texture_ptr insert(text_cache_ptr cache, const text_key_t* key,
+                          texture_t texture, int origin_x, int origin_y) {
+  int index = add_entry(cache, key, texture, origin_x, origin_y);
+  if (index == NO_ENTRY) {
+    LOG_ERROR("Failed to grow text cache");
+    return NULL;
+  }
+  enforce_budget(cache);
+  return &cache->entries[index].texture;
+}
+
+static inline uint32_t pack_color(SDL_Color color) {
+  return ((uint32_t)color.a << 24) | ((uint32_t)color.r << 16) |
+         ((uint32_t)color.g << 8) | color.b;
+}
+
+texture_ptr get_ttf_text_texture(text_cache_ptr cache,
+                                 const graphics_context_ptr graphics_context,
+                                 ttf_font_t font, const char* text,
+                                 SDL_Color color) {
+  if (!cache || !graphics_context || !font || !text || !text[0]) {
+    return NULL;
+  }
+  text_key_t key = make_key(TEXT_SOURCE_TTF, font, text, pack_color(color), 1);
+  int index = lookup(cache, graphics_context, &key);
+  if (index != NO_ENTRY) {
+    return &cache->entries[index].texture;
+  }
+
+  SDL_Surface* surface = TTF_RenderText_Blended(font, text, color);
+  if (!surface) {
+    LOG_ERROR_FMT("Failed to render text surface: %s", TTF_GetError());
+    return NULL;
+  }
+  texture_t texture = {NULL, surface->w, surface->h, NULL};
+  texture.texture =
+      SDL_CreateTextureFromSurface(graphics_context->renderer, surface);
+  if (!texture.texture) {
+    LOG_SDL_ERROR("SDL_CreateTextureFromSurface");
+    SDL_FreeSurface(surface);
+    return NULL;
+  }
+  SDL_SetTextureBlendMode(texture.texture, SDL_BLENDMODE_BLEND);
+  if (cpu_rendering_active()) {
+    texture.surface = create_cpu_surface(surface);
+  }
+  SDL_FreeSurface(surface);
+  return insert(cache, &key, texture, 0, 0);
+}
+
+// Target texture holding what `draw` renders, or an empty texture when the
+// backend has no render targets
+static texture_t render_to_texture(const graphics_context_ptr graphics_context,
+                                   int width, int height, texture_draw_fn draw,
+                                   void* data) {
+  texture_t texture = {NULL, width, height, NULL};
+  SDL_Renderer* renderer = graphics_context->renderer;
+  if (graphics_context->cpu_renderer || !SDL_RenderTargetSupported(renderer) ||
+      width <= 0 || height <= 0) {
+    return texture;
+  }
+
+  texture.texture = create_target_texture(renderer, width, height);
+  if (texture.texture &&
+      !render_into_texture(graphics_context, texture.texture, draw, data)) {
+    SDL_DestroyTexture(texture.texture);
+    texture.texture = NULL;
+  }
+  return texture;
+}
+
+typedef struct {
+  bitmap_font_ptr font;
+  const char* text;
+  font_color_t color;
+  int scale;
+} bitmap_text_t;
+
+static void draw_bitmap_text(const graphics_context_ptr graphics_context,
+                             void* data) {
+  const bitmap_text_t* text = data;
+  render_bitmap_text_scaled(text->font, graphics_context, text->text, 0, 0,
+                            text->color, text->scale);
+}
+
+texture_ptr get_bitmap_text_texture(text_cache_ptr cache,
+                                    const graphics_context_ptr graphics_context,
+                                    const bitmap_font_ptr font,
+                                    const char* text, font_color_t color,
+                                    int scale) {
+  if (!cache || !graphics_context || !font || !text || !text[0] ||
+      scale <= 0) {
+    return NULL;
+  }
+  text_key_t key =
+      make_key(TEXT_SOURCE_BITMAP, font, text, (uint32_t)color, scale);
+  int index = lookup(cache, graphics_context, &key);
+  if (index != NO_ENTRY) {
+    return &cache->entries[index].texture;
+  }
+
+  bitmap_text_t data = {font, text, color, scale};
+  texture_t texture = render_to_texture(
+      graphics_context, get_bitmap_text_width_scaled(font, text, scale),
+      font->char_height * scale, draw_bitmap_text, &data);
+  return texture.texture ? insert(cache, &key, texture, 0, 0) : NULL;
+}
+
+typedef struct {
+  const char* text;
+  int scale;
+  color_t color;
+  int baseline;  // Baseline height in the texture
+} vector_text_t;
+
+static void draw_vector_text(const graphics_context_ptr graphics_context,
+                             void* data) {
+  const vector_text_t* text = data;
+  write_text(graphics_context, text->text,
+             point(TEXT_STROKE_MARGIN, text->baseline), text->scale,
+             text->color);
+}
+
+// Vector text hangs above its baseline; the texture adds the stroke margin
+// on every side
+static int vector_text_entry(text_cache_ptr cache,
+                             const graphics_context_ptr graphics_context,
+                             const char* text, int scale, color_t color) {
+  if (!cache || !graphics_context || !text || !text[0] || scale <= 0) {
+    return NO_ENTRY;
+  }
+  text_key_t key = make_key(TEXT_SOURCE_VECTOR, NULL, text, color, scale);
+  int index = lookup(cache, graphics_context, &key);
+  if (index != NO_ENTRY) {
+    return index;
+  }
+
+  text_dimensions_t size = calculate_text_dimensions(text, scale);
+  int baseline = size.height + TEXT_STROKE_MARGIN;
+  vector_text_t data = {text, scale, color, baseline};
+  texture_t texture = render_to_texture(
+      graphics_context, size.width + 2 * TEXT_STROKE_MARGIN,
+      size.height + 2 * TEXT_STROKE_MARGIN, draw_vector_text, &data);
+  if (!texture.texture ||
+      !insert(cache, &key, texture, -TEXT_STROKE_MARGIN, -baseline)) {
+    return NO_ENTRY;
+  }
+  return find_entry(cache, &key);
+}
+
+texture_ptr get_vector_text_texture(text_cache_ptr cache,
+                                    const graphics_context_ptr graphics_context,
+                                    const char* text, int scale,
+                                    color_t color) {
+  int index = vector_text_entry(cache, graphics_context, text, scale, color);
+  return index != NO_ENTRY ? &cache->entries[index].texture : NULL;
+}
+
+bool draw_cached_ttf_text(text_cache_ptr cache,
+                          const graphics_context_ptr graphics_context,
+                          ttf_font_t font, const char* text, SDL_Color color,
+                          int x, int y) {
+  texture_ptr texture =
+      get_ttf_text_texture(cache, graphics_context, font, text, color);
+  if (!texture) {
+    return false;
+  }
+  render_sprite_scaled(graphics_context, texture, NULL, x, y, 1);
+  return true;
+}
+
+void draw_cached_bitmap_text(text_cache_ptr cache,
+                             const graphics_context_ptr graphics_context,
+                             const bitmap_font_ptr font, const char* text,
+                             int x, int y, font_color_t color, int scale) {
+  texture_ptr texture =
+      get_bitmap_text_texture(cache, graphics_context, font, text, color,
+                              scale);
+  if (texture) {
+    render_sprite_scaled(graphics_context, texture, NULL, x, y, 1);
+  } else if (font && text) {
+    render_bitmap_text_scaled(font, graphics_context, text, x, y, color,
+                              scale);
+  }
+}
+
+void draw_cached_vector_text(text_cache_ptr cache,
+                             const graphics_context_ptr graphics_context,
+                             const char* text, point_t position, int scale,
+                             color_t color) {
+  int index = vector_text_entry(cache, graphics_context, text, scale, color);
+  if (index == NO_ENTRY) {
+    if (graphics_context && text) {
+      write_text(graphics_context, text, position, scale, color);
+    }
+    return;
+  }
+  text_cache_entry_t* entry = &cache->entries[index];
+  render_sprite_scaled(graphics_context, &entry->texture, NULL,
+                       (int)position.x + entry->origin_x,
+                       (int)position.y + entry->origin_y, 1);
+}
+
+text_cache_stats_t get_text_cache_stats(const text_cache_ptr cache) {
+  text_cache_stats_t empty = {0};
+  return cache ? cache->stats : empty;
+}
@@ -0,0 +1,225 @@
+/**
+ * @file text_cache.h
+ * @brief LRU cache of rendered strings as textures
+ *
+ * HUD labels and other strings that rarely change are rendered once into a
+ * texture and drawn with a single copy afterwards. Entries are keyed by
+ * font, string, color and scale; when the textures exceed the byte budget,
+ * the least recently used ones are destroyed. Entries handed out since the
+ * last present_frame() are never evicted, because the render queue and the
+ * CPU backend draw them only when the frame is flushed; the budget may be
+ * exceeded by the strings of a single frame.
+ *
+ * TTF text is rasterized with TTF_RenderText_Blended. Bitmap and vector
+ * font text is drawn into a target texture, so it is only cached where
+ * render targets are available; with the CPU backend, the draw_cached_*
+ * functions draw it directly instead. Strings that change every frame, such
+ * as a running score, should bypass the cache.
+ */
+
+#ifndef CORE_GRAPHICS_TEXT_CACHE_H_
+#define CORE_GRAPHICS_TEXT_CACHE_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bitmap_font.h"
+#include "geometry.h"
+#include "graphics_context.h"
+#include "texture.h"
+#include "ttf_text.h"
+
+typedef enum {
+  TEXT_SOURCE_TTF,
+  TEXT_SOURCE_BITMAP,
+  TEXT_SOURCE_VECTOR
+} text_source_t;
+
+typedef struct {
+  char* text;  // NULL for a free entry
+  const void* font;  // TTF_Font or bitmap_font_t, NULL for the vector font
+  text_source_t source;
+  uint32_t color;  // 0xAARRGGBB, or the bitmap font_color_t
+  int scale;
+  uint64_t hash;
+  texture_t texture;
+  int origin_x;  // Texture top-left relative to the text position
+  int origin_y;
+  size_t bytes;
+  int chain_next;  // Next entry in the hash bucket, or the next free entry
+  int lru_prev;    // Neighbours in use order, most recent last
+  int lru_next;
+  unsigned last_frame;  // graphics_context_t.frame_count when last handed out
+} text_cache_entry_t;
+
+typedef struct {
+  uint64_t hits;
+  uint64_t misses;  // Strings rendered into a new texture
+  uint64_t evictions;
+  size_t bytes;  // Memory held by cached textures
+  int entries;
+} text_cache_stats_t;
+
+typedef struct text_cache {
+  text_cache_entry_t* entries;
+  int entry_count;  // Entries ever used, free ones included
+  int entry_capacity;
+  int free_entry;  // Head of the free entry list
+  int* buckets;    // First entry of each hash chain
+  int bucket_count;
+  int lru_head;  // Least recently used entry
+  int lru_tail;
+  size_t budget;  // 0 means unlimited
+  unsigned frame;  // Frame of the latest lookup
+  text_cache_stats_t stats;
+} text_cache_t, *text_cache_ptr;
+
+/**
+ * @brief Create an empty text cache
+ * @param budget_bytes Texture memory budget, 0 for unlimited
+ * @return Cache, or NULL on failure
+ */
+text_cache_ptr create_text_cache(size_t budget_bytes);
+
+/**
+ * @brief Destroy every cached texture and free the cache
+ * @param cache Cache to destroy (may be NULL)
+ */
+void destroy_text_cache(text_cache_ptr cache);
+
+/**
+ * @brief Destroy every cached texture, e.g. after a font is freed
+ *
+ * Call it between frames: textures drawn in the current frame may still be
+ * referenced by the render queue or the CPU backend.
+ *
+ * @param cache Cache to empty
+ */
+void clear_text_cache(text_cache_ptr cache);
+
+/**
+ * @brief Change the byte budget, evicting entries if needed
+ * @param cache Cache
+ * @param budget_bytes New budget, 0 for unlimited
+ */
+void set_text_cache_budget(text_cache_ptr cache, size_t budget_bytes);
+
+/**
+ * @brief Get TTF text as a texture, rendering it on a miss
+ *
+ * The texture's top-left corner goes at the text position. The pointer is
+ * valid until the next call on the cache; the SDL texture it holds stays
+ * alive at least until the frame is presented, so deferred draws are safe.
+ *
+ * @param cache Cache
+ * @param graphics_context Graphics context creating the texture
+ * @param font Font to render with
+ * @param text String to render
+ * @param color Text color
+ * @return Texture, or NULL on failure
+ */
+texture_ptr get_ttf_text_texture(text_cache_ptr cache,
+                                 const graphics_context_ptr graphics_context,
+                                 ttf_font_t font, const char* text,
+                                 SDL_Color color);
+
+/**
+ * @brief Get bitmap font text as a texture, rendering it on a miss
+ *
+ * The texture's top-left corner goes at the text position. The pointer is
+ * valid until the next call on the cache; the SDL texture it holds stays
+ * alive at least until the frame is presented, so deferred draws are safe.
+ *
+ * @param cache Cache
+ * @param graphics_context Graphics context creating the texture
+ * @param font Bitmap font to render with
+ * @param text String to render
+ * @param color Font color row
+ * @param scale Scale factor
+ * @return Texture, or NULL if render targets are unavailable or on failure
+ */
+texture_ptr get_bitmap_text_texture(text_cache_ptr cache,
+                                    const graphics_context_ptr graphics_context,
+                                    const bitmap_font_ptr font,
+                                    const char* text, font_color_t color,
+                                    int scale);
+
+/**
+ * @brief Get vector font text (see text.h) as a texture, rendering it on a
+ *        miss
+ *
+ * The texture includes a margin for the stroke outline; draw it with
+ * draw_cached_vector_text() to place it. The pointer is valid until the
+ * next call on the cache; the SDL texture it holds stays alive at least
+ * until the frame is presented.
+ *
+ * @param cache Cache
+ * @param graphics_context Graphics context creating the texture
+ * @param text String to render
+ * @param scale Scale factor
+ * @param color Stroke color
+ * @return Texture, or NULL if render targets are unavailable or on failure
+ */
+texture_ptr get_vector_text_texture(text_cache_ptr cache,
+                                    const graphics_context_ptr graphics_context,
+                                    const char* text, int scale,
+                                    color_t color);
+
+/**
+ * @brief Draw TTF text through the cache
+ * @param cache Cache
+ * @param graphics_context Graphics context to draw to
+ * @param font Font to render with
+ * @param text String to draw
+ * @param color Text color
+ * @param x Left edge
+ * @param y Top edge
+ * @return false if the text could not be rendered
+ */
+bool draw_cached_ttf_text(text_cache_ptr cache,
+                          const graphics_context_ptr graphics_context,
+                          ttf_font_t font, const char* text, SDL_Color color,
+                          int x, int y);
+
+/**
+ * @brief Draw bitmap font text through the cache, or directly without
+ *        render targets
+ * @param cache Cache
+ * @param graphics_context Graphics context to draw to
+ * @param font Bitmap font to render with
+ * @param text String to draw
+ * @param x Left edge
+ * @param y Top edge
+ * @param color Font color row
+ * @param scale Scale factor
+ */
+void draw_cached_bitmap_text(text_cache_ptr cache,
+                             const graphics_context_ptr graphics_context,
+                             const bitmap_font_ptr font, const char* text,
+                             int x, int y, font_color_t color, int scale);
+
+/**
+ * @brief Draw vector font text through the cache, or directly without
+ *        render targets
+ * @param cache Cache
+ * @param graphics_context Graphics context to draw to
+ * @param text String to draw
+ * @param position Start of the baseline, as for write_text()
+ * @param scale Scale factor
+ * @param color Stroke color
+ */
+void draw_cached_vector_text(text_cache_ptr cache,
+                             const graphics_context_ptr graphics_context,
+                             const char* text, point_t position, int scale,
+                             color_t color);
+
+/**
+ * @brief Get hit, miss and memory counters
+ * @param cache Cache
+ * @return Statistics since creation
+ */
+text_cache_stats_t get_text_cache_stats(const text_cache_ptr cache);
+
+#endif  // CORE_GRAPHICS_TEXT_CACHE_H_
@@ -9,21 +9,56 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "cpu_renderer.h"
 #include "logger.h"
+#include "pixel_pipeline.h"
+#include "primitive_batch.h"
+#include "render_queue.h"
+#include "render_state.h"
+
+// Record a copy in the render queue, or blit it with the CPU backend.
+// Returns false when the caller has to issue the SDL copy itself.
+static bool defer_copy_f(const graphics_context_ptr graphics_context,
+                         const texture_ptr tex, const SDL_Rect* src,
+                         const SDL_FRect* dst, double angle,
+                         SDL_RendererFlip flip, Uint8 alpha) {
+  if (queue_texture_copy(graphics_context, tex, src, dst, angle, flip,
+                         alpha)) {
+    return true;
+  }
+  if (!graphics_context->cpu_renderer) {
+    return false;
+  }
 
-texture_t load_texture(SDL_Renderer* renderer, const char* filepath) {
-  texture_t tex = {NULL, 0, 0};
+  flush_primitive_batch(graphics_context);
+  cpu_blit(graphics_context->cpu_renderer, tex->surface, src, dst, angle, flip,
+           (SDL_Color){255, 255, 255, alpha});
+  return true;
+}
 
-  SDL_Surface* surface = IMG_Load(filepath);
+static bool defer_copy(const graphics_context_ptr graphics_context,
+                       const texture_ptr tex, const SDL_Rect* src,
+                       const SDL_Rect* dst, double angle,
+                       SDL_RendererFlip flip, Uint8 alpha) {
+  SDL_FRect dst_f = {(float)dst->x, (float)dst->y, (float)dst->w,
+                     (float)dst->h};
+  return defer_copy_f(graphics_context, tex, src, &dst_f, angle, flip, alpha);
+}
+
+// Run a decoded image through the pixel pipeline, so the key color becomes
+// real alpha and the upload needs no conversion, then create its texture
+static texture_t create_keyed_texture(SDL_Renderer* renderer,
+                                      SDL_Surface* image, const char* filepath,
+                                      Uint8 r, Uint8 g, Uint8 b) {
+  texture_t tex = {NULL, 0, 0, NULL};
+
+  pixel_pipeline_options_t options = {true, r, g, b, false, false};
+  SDL_Surface* surface = preprocess_surface(image, &options, NULL);
   if (!surface) {
-    LOG_ERROR_FMT("Failed to load image %s: %s", filepath, IMG_GetError());
+    LOG_ERROR_FMT("Failed to convert image %s", filepath);
     return tex;
   }
 
-  // Set black color (RGB 0,0,0) as transparent
-  Uint32 black = SDL_MapRGB(surface->format, 0, 0, 0);
-  SDL_SetColorKey(surface, SDL_TRUE, black);
-
   tex.texture = SDL_CreateTextureFromSurface(renderer, surface);
   if (!tex.texture) {
     LOG_ERROR_FMT("Failed to create texture from %s: %s", filepath,
@@ -31,11 +66,33 @@ texture_t load_texture(SDL_Renderer* renderer, const char* filepath) {
     SDL_FreeSurface(surface);
     return tex;
   }
+  SDL_SetTextureBlendMode(tex.texture, SDL_BLENDMODE_BLEND);
 
   tex.width = surface->w;
   tex.height = surface->h;
+  if (cpu_rendering_active()) {
+    tex.surface = create_cpu_surface(surface);
+  }
 
   SDL_FreeSurface(surface);
+  return tex;
+}
+
+texture_t load_texture(SDL_Renderer* renderer, const char* filepath) {
+  texture_t tex = {NULL, 0, 0, NULL};
+
+  SDL_Surface* surface = IMG_Load(filepath);
+  if (!surface) {
+    LOG_ERROR_FMT("Failed to load image %s: %s", filepath, IMG_GetError());
+    return tex;
+  }
+
+  // Black (RGB 0,0,0) is transparent
+  tex = create_keyed_texture(renderer, surface, filepath, 0, 0, 0);
+  SDL_FreeSurface(surface);
+  if (!tex.texture) {
+    return tex;
+  }
 
   LOG_INFO_FMT("Loaded texture: %s (%dx%d)", filepath, tex.width, tex.height);
 
@@ -45,7 +102,9 @@ texture_t load_texture(SDL_Renderer* renderer, const char* filepath) {
 void free_texture(texture_ptr tex) {
   if (tex && tex->texture) {
     SDL_DestroyTexture(tex->texture);
+    SDL_FreeSurface(tex->surface);
     tex->texture = NULL;
+    tex->surface = NULL;
     tex->width = 0;
     tex->height = 0;
   }
@@ -64,7 +123,7 @@ void render_texture(SDL_Renderer* renderer, const texture_ptr tex, int x,
 texture_t load_texture_with_colorkey(SDL_Renderer* renderer,
                                      const char* filepath, int r, int g,
                                      int b) {
-  texture_t tex = {NULL, 0, 0};
+  texture_t tex = {NULL, 0, 0, NULL};
 
   SDL_Surface* surface = IMG_Load(filepath);
   if (!surface) {
@@ -72,23 +131,14 @@ texture_t load_texture_with_colorkey(SDL_Renderer* renderer,
     return tex;
   }
 
-  // Set specified color as transparent
-  Uint32 colorkey = SDL_MapRGB(surface->format, r, g, b);
-  SDL_SetColorKey(surface, SDL_TRUE, colorkey);
-
-  tex.texture = SDL_CreateTextureFromSurface(renderer, surface);
+  // Specified color is transparent
+  tex = create_keyed_texture(renderer, surface, filepath, (Uint8)r, (Uint8)g,
+                             (Uint8)b);
+  SDL_FreeSurface(surface);
   if (!tex.texture) {
-    LOG_ERROR_FMT("Failed to create texture from %s: %s", filepath,
-                  SDL_GetError());
-    SDL_FreeSurface(surface);
     return tex;
   }
 
-  tex.width = surface->w;
-  tex.height = surface->h;
-
-  SDL_FreeSurface(surface);
-
   LOG_INFO_FMT("Loaded texture with colorkey: %s (%dx%d)", filepath, tex.width,
                tex.height);
 
@@ -119,6 +169,11 @@ void render_sprite(const graphics_context_ptr graphics_context,
     dst.h = dst_rect->h;
   }
 
+  if (defer_copy(graphics_context, tex, &src, &dst, 0.0, SDL_FLIP_NONE, 255)) {
+    return;
+  }
+
+  flush_primitive_batch(graphics_context);
   SDL_RenderCopy(graphics_context->renderer, tex->texture, &src, &dst);
 }
 
@@ -139,6 +194,11 @@ void render_sprite_scaled(const graphics_context_ptr graphics_context,
 
   SDL_Rect dst = {x, y, src.w * scale, src.h * scale};
 
+  if (defer_copy(graphics_context, tex, &src, &dst, 0.0, SDL_FLIP_NONE, 255)) {
+    return;
+  }
+
+  flush_primitive_batch(graphics_context);
   SDL_RenderCopy(graphics_context->renderer, tex->texture, &src, &dst);
 }
 
@@ -149,13 +209,8 @@ void render_sprite_scaled_alpha(const graphics_context_ptr graphics_context,
     return;
   }
 
-  // Save current alpha mod
-  Uint8 current_alpha;
-  SDL_GetTextureAlphaMod(tex->texture, &current_alpha);
-  
-  // Set desired alpha (clamp to 0-255 range)
+  // Clamp desired alpha to 0-255 range
   Uint8 target_alpha = (alpha < 0) ? 0 : ((alpha > 255) ? 255 : (Uint8)alpha);
-  SDL_SetTextureAlphaMod(tex->texture, target_alpha);
 
   SDL_Rect src = {0, 0, tex->width, tex->height};
   if (src_rect) {
@@ -167,10 +222,93 @@ void render_sprite_scaled_alpha(const graphics_context_ptr graphics_context,
 
   SDL_Rect dst = {x, y, src.w * scale, src.h * scale};
 
+  // Deferred copies carry their alpha instead of setting it on the texture
+  if (defer_copy(graphics_context, tex, &src, &dst, 0.0, SDL_FLIP_NONE,
+                 target_alpha)) {
+    return;
+  }
+
+  // Faded copies become vertex-colored quads drawn in one batch with the
+  // neighbouring copies of the same texture, leaving its alpha mod alone
+  SDL_FRect dst_f = {(float)dst.x, (float)dst.y, (float)dst.w, (float)dst.h};
+  SDL_Color color = {255, 255, 255, target_alpha};
+  SDL_GetTextureColorMod(tex->texture, &color.r, &color.g, &color.b);
+  if (batch_textured_quad(graphics_context, tex->texture, tex->width,
+                          tex->height, &src, &dst_f, color)) {
+    return;
+  }
+
+  // Save current alpha mod
+  Uint8 current_alpha;
+  SDL_GetTextureAlphaMod(tex->texture, &current_alpha);
+  SDL_BlendMode blend_mode;
+  SDL_GetTextureBlendMode(tex->texture, &blend_mode);
+  SDL_Color modulation = texture_modulation(blend_mode, color);
+  SDL_SetTextureColorMod(tex->texture, modulation.r, modulation.g,
+                         modulation.b);
+  apply_texture_alpha_mod(graphics_context, tex->texture, target_alpha);
+
+  flush_primitive_batch(graphics_context);
   SDL_RenderCopy(graphics_context->renderer, tex->texture, &src, &dst);
-  
-  // Restore original alpha mod
-  SDL_SetTextureAlphaMod(tex->texture, current_alpha);
+
+  // Restore original color and alpha mod
+  SDL_SetTextureColorMod(tex->texture, color.r, color.g, color.b);
+  apply_texture_alpha_mod(graphics_context, tex->texture, current_alpha);
+}
+
+void render_sprite_tinted(const graphics_context_ptr graphics_context,
+                          const texture_ptr tex, const rect_t* src_rect,
+                          const frect_t* dst_rect, SDL_Color tint) {
+  if (!graphics_context || !tex || !tex->texture) {
+    return;
+  }
+
+  SDL_Rect src = {0, 0, tex->width, tex->height};
+  if (src_rect) {
+    src.x = src_rect->x;
+    src.y = src_rect->y;
+    src.w = src_rect->w;
+    src.h = src_rect->h;
+  }
+
+  SDL_FRect dst = {0.0f, 0.0f, (float)src.w, (float)src.h};
+  if (dst_rect) {
+    dst.x = dst_rect->x;
+    dst.y = dst_rect->y;
+    dst.w = dst_rect->w;
+    dst.h = dst_rect->h;
+  }
+
+  if (queue_tinted_texture_copy(graphics_context, tex, &src, &dst, 0.0,
+                                SDL_FLIP_NONE, tint)) {
+    return;
+  }
+  if (graphics_context->cpu_renderer) {
+    flush_primitive_batch(graphics_context);
+    cpu_blit(graphics_context->cpu_renderer, tex->surface, &src, &dst, 0.0,
+             SDL_FLIP_NONE, tint);
+    return;
+  }
+  if (batch_textured_quad(graphics_context, tex->texture, tex->width,
+                          tex->height, &src, &dst, tint)) {
+    return;
+  }
+
+  Uint8 current_r, current_g, current_b, current_alpha;
+  SDL_GetTextureColorMod(tex->texture, &current_r, &current_g, &current_b);
+  SDL_GetTextureAlphaMod(tex->texture, &current_alpha);
+  SDL_BlendMode blend_mode;
+  SDL_GetTextureBlendMode(tex->texture, &blend_mode);
+  SDL_Color modulation = texture_modulation(blend_mode, tint);
+  SDL_SetTextureColorMod(tex->texture, modulation.r, modulation.g,
+                         modulation.b);
+  apply_texture_alpha_mod(graphics_context, tex->texture, tint.a);
+
+  flush_primitive_batch(graphics_context);
+  SDL_RenderCopyF(graphics_context->renderer, tex->texture, &src, &dst);
+
+  SDL_SetTextureColorMod(tex->texture, current_r, current_g, current_b);
+  apply_texture_alpha_mod(graphics_context, tex->texture, current_alpha);
 }
 
 void render_sprite_flipped(const graphics_context_ptr graphics_context,
@@ -205,6 +343,11 @@ void render_sprite_flipped(const graphics_context_ptr graphics_context,
     sdl_flip |= SDL_FLIP_VERTICAL;
   }
 
+  if (defer_copy(graphics_context, tex, &src, &dst, 0.0, sdl_flip, 255)) {
+    return;
+  }
+
+  flush_primitive_batch(graphics_context);
   SDL_RenderCopyEx(graphics_context->renderer, tex->texture, &src, &dst, 0.0,
                    NULL, sdl_flip);
 }
@@ -241,6 +384,11 @@ void render_sprite_rotated(const graphics_context_ptr graphics_context,
     sdl_flip |= SDL_FLIP_VERTICAL;
   }
 
+  if (defer_copy(graphics_context, tex, &src, &dst, angle, sdl_flip, 255)) {
+    return;
+  }
+
+  flush_primitive_batch(graphics_context);
   SDL_RenderCopyEx(graphics_context->renderer, tex->texture, &src, &dst, angle,
                    NULL, sdl_flip);
 }
@@ -279,14 +427,72 @@ void render_sprite_f(const graphics_context_ptr graphics_context,
     dst.h = dst_rect->h;
   }
 
+  if (defer_copy_f(graphics_context, tex, &src, &dst, 0.0, SDL_FLIP_NONE,
+                   255)) {
+    return;
+  }
+
+  flush_primitive_batch(graphics_context);
   // Use SDL_RenderCopyF for sub-pixel precision rendering (smoother movement)
   SDL_RenderCopyF(graphics_context->renderer, tex->texture, &src, &dst);
 }
 
+SDL_Texture* create_target_texture(SDL_Renderer* renderer, int width,
+                                   int height) {
+  SDL_Texture* texture = SDL_CreateTexture(
+      renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width,
+      height);
+  if (!texture) {
+    LOG_SDL_ERROR("SDL_CreateTexture");
+    return NULL;
+  }
+  // Blending into the cleared texture leaves premultiplied colors behind
+  if (SDL_SetTextureBlendMode(texture, premultiplied_blend_mode()) != 0) {
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+  }
+  return texture;
+}
+
+bool render_into_texture(const graphics_context_ptr graphics_context,
+                         SDL_Texture* target, texture_draw_fn draw,
+                         void* data) {
+  if (!graphics_context || !target || !draw) {
+    return false;
+  }
+
+  // Commands recorded for this frame stay queued instead of being replayed
+  // into the target
+  SDL_Renderer* renderer = graphics_context->renderer;
+  bool suspended = suspend_render_queue(graphics_context);
+
+  // Anything batched so far belongs to the previous target
+  flush_primitive_batch(graphics_context);
+  SDL_Texture* previous = SDL_GetRenderTarget(renderer);
+  bool rendered = SDL_SetRenderTarget(renderer, target) == 0;
+  if (rendered) {
+    apply_draw_color(graphics_context, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    draw(graphics_context, data);
+    flush_primitive_batch(graphics_context);
+    SDL_SetRenderTarget(renderer, previous);
+  } else {
+    LOG_SDL_ERROR("SDL_SetRenderTarget");
+  }
+
+  if (suspended) {
+    resume_render_queue(graphics_context);
+  }
+  return rendered;
+}
+
 void set_logical_size(const graphics_context_ptr graphics_context, int width,
                       int height) {
   if (!graphics_context) {
     return;
   }
+  flush_primitive_batch(graphics_context);
   SDL_RenderSetLogicalSize(graphics_context->renderer, width, height);
+  if (graphics_context->cpu_renderer) {
+    resize_cpu_renderer(graphics_context->cpu_renderer, width, height);
+  }
 }
@@ -16,6 +16,7 @@ typedef struct {
   SDL_Texture* texture;
   int width;
   int height;
+  SDL_Surface* surface;  // ARGB8888 copy, kept only for the CPU backend
 } texture_t, *texture_ptr;
 
 // Rectangle structure for sprite rendering (integer coordinates)
@@ -49,6 +50,11 @@ void render_sprite_scaled(const graphics_context_ptr graphics_context,
 void render_sprite_scaled_alpha(const graphics_context_ptr graphics_context,
                                 const texture_ptr tex, const rect_t* src_rect, int x,
                                 int y, int scale, int alpha);
+// Color and alpha multiplied with the texture; consecutive tinted or faded
+// sprites of one texture are drawn with a single geometry submission.
+void render_sprite_tinted(const graphics_context_ptr graphics_context,
+                          const texture_ptr tex, const rect_t* src_rect,
+                          const frect_t* dst_rect, SDL_Color tint);
 void render_sprite_flipped(const graphics_context_ptr graphics_context,
                            const texture_ptr tex, const rect_t* src_rect,
                            const rect_t* dst_rect, flip_t flip);
@@ -61,6 +67,17 @@ void render_sprite_f(const graphics_context_ptr graphics_context,
                      const texture_ptr tex, const rect_t* src_rect,
                      const frect_t* dst_rect);
 
+// Render targets. A target texture is transparent ARGB8888 composited with
+// premultiplied blending; render_into_texture() clears it and runs `draw`
+// with it as the render target, suspending the render queue meanwhile.
+typedef void (*texture_draw_fn)(const graphics_context_ptr graphics_context,
+                                void* data);
+SDL_Texture* create_target_texture(SDL_Renderer* renderer, int width,
+                                   int height);
+bool render_into_texture(const graphics_context_ptr graphics_context,
+                         SDL_Texture* target, texture_draw_fn draw,
+                         void* data);
+
 // Utility functions
 rect_t make_rect(int x, int y, int w, int h);
 frect_t make_frect(float x, float y, float w, float h);
@@ -0,0 +1,294 @@
+/**
+ * @file texture_atlas.c
+ * @brief Implementation of the load-time texture atlas builder
+ */
+
+#include "texture_atlas.h"
+
+#include <SDL_image.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu_renderer.h"
+#include "logger.h"
+#include "rect_packer.h"
+
+typedef struct {
+  int index;
+  int cell_w;  // Image plus extrusion and padding
+  int cell_h;
+} atlas_item_t;
+
+// Largest cells first, which keeps MaxRects from fragmenting early
+static int compare_items(const void* a, const void* b) {
+  const atlas_item_t* item_a = a;
+  const atlas_item_t* item_b = b;
+  int side_a = item_a->cell_w > item_a->cell_h ? item_a->cell_w
+                                                : item_a->cell_h;
+  int side_b = item_b->cell_w > item_b->cell_h ? item_b->cell_w
+                                                : item_b->cell_h;
+  if (side_a != side_b) {
+    return side_b - side_a;
+  }
+  return item_a->index - item_b->index;
+}
+
+static inline Uint32* page_pixel(SDL_Surface* page, int x, int y) {
+  return (Uint32*)((Uint8*)page->pixels + (size_t)y * page->pitch) + x;
+}
+
+// Repeat the outermost rows and columns of `rect` outward
+static void extrude_edges(SDL_Surface* page, const SDL_Rect* rect,
+                          int extrude) {
+  int right = rect->x + rect->w - 1;
+  int bottom = rect->y + rect->h - 1;
+  for (int e = 1; e <= extrude; e++) {
+    memcpy(page_pixel(page, rect->x, rect->y - e),
+           page_pixel(page, rect->x, rect->y), sizeof(Uint32) * rect->w);
+    memcpy(page_pixel(page, rect->x, bottom + e),
+           page_pixel(page, rect->x, bottom), sizeof(Uint32) * rect->w);
+  }
+  for (int y = rect->y - extrude; y <= bottom + extrude; y++) {
+    Uint32 left_pixel = *page_pixel(page, rect->x, y);
+    Uint32 right_pixel = *page_pixel(page, right, y);
+    for (int e = 1; e <= extrude; e++) {
+      *page_pixel(page, rect->x - e, y) = left_pixel;
+      *page_pixel(page, right + e, y) = right_pixel;
+    }
+  }
+}
+
+static bool copy_image(SDL_Surface* page, SDL_Surface* image,
+                       const SDL_Rect* rect, int extrude) {
+  // Copy alpha as is instead of blending onto the transparent page; the
+  // color key still skips keyed pixels
+  SDL_BlendMode blend_mode;
+  SDL_GetSurfaceBlendMode(image, &blend_mode);
+  SDL_SetSurfaceBlendMode(image, SDL_BLENDMODE_NONE);
+  SDL_Rect dst = *rect;
+  int result = SDL_BlitSurface(image, NULL, page, &dst);
+  SDL_SetSurfaceBlendMode(image, blend_mode);
+  if (result != 0) {
+    LOG_SDL_ERROR("SDL_BlitSurface");
+    return false;
+  }
+  extrude_edges(page, rect, extrude);
+  return true;
+}
+
+static bool create_page_texture(SDL_Renderer* renderer, SDL_Surface* page,
+                                texture_ptr texture) {
+  texture->texture = SDL_CreateTextureFromSurface(renderer, page);
+  if (!texture->texture) {
+    LOG_SDL_ERROR("SDL_CreateTextureFromSurface");
+    return false;
+  }
+  SDL_SetTextureBlendMode(texture->texture, SDL_BLENDMODE_BLEND);
+  texture->width = page->w;
+  texture->height = page->h;
+  if (cpu_rendering_active()) {
+    texture->surface = create_cpu_surface(page);
+  }
+  return true;
+}
+
+// Texture changes when drawing every image once in input order
+static int count_texture_switches(const texture_atlas_ptr atlas) {
+  int switches = 0;
+  const texture_t* current = NULL;
+  for (int i = 0; i < atlas->region_count; i++) {
+    const texture_t* texture = atlas->regions[i].texture;
+    if (texture && texture != current) {
+      switches++;
+      current = texture;
+    }
+  }
+  return switches;
+}
+
+static void log_atlas_stats(const texture_atlas_ptr atlas,
+                            rect_packer_ptr* packers, int packed) {
+  long long used = 0;
+  long long total = 0;
+  for (int i = 0; i < atlas->page_count; i++) {
+    used += packers[i]->used_area;
+    total += (long long)atlas->pages[i].width * atlas->pages[i].height;
+  }
+  LOG_INFO_FMT(
+      "Texture atlas: %d images on %d page(s), %.1f%% of page area used, "
+      "texture switches per pass %d -> %d",
+      atlas->region_count, atlas->page_count,
+      total > 0 ? 100.0 * (double)used / (double)total : 0.0, packed,
+      count_texture_switches(atlas));
+}
+
+texture_atlas_ptr create_texture_atlas(
+    SDL_Renderer* renderer, SDL_Surface* const* images, int count,
+    const texture_atlas_options_t* options) {
+  texture_atlas_options_t settings = {TEXTURE_ATLAS_DEFAULT_PAGE_SIZE,
+                                      TEXTURE_ATLAS_DEFAULT_PADDING,
+                                      TEXTURE_ATLAS_DEFAULT_EXTRUDE};
+  if (options) {
+    settings = *options;
+  }
+  if (!renderer || count <= 0 || settings.page_size <= 0 ||
+      settings.padding < 0 || settings.extrude < 0) {
+    return NULL;
+  }
+
+  texture_atlas_ptr atlas = calloc(1, sizeof(texture_atlas_t));
+  atlas_item_t* items = calloc((size_t)count, sizeof(atlas_item_t));
+  SDL_Rect* placements = calloc((size_t)count, sizeof(SDL_Rect));
+  int* page_of = calloc((size_t)count, sizeof(int));
+  rect_packer_ptr* packers = calloc((size_t)count, sizeof(rect_packer_ptr));
+  if (atlas) {
+    // At most one page per image, so region pointers into pages stay valid
+    atlas->pages = calloc((size_t)count, sizeof(texture_t));
+    atlas->regions = calloc((size_t)count, sizeof(atlas_region_t));
+    atlas->region_count = count;
+  }
+  if (!atlas || !items || !placements || !page_of || !packers ||
+      !atlas->pages || !atlas->regions) {
+    LOG_ERROR("Failed to allocate texture atlas");
+    destroy_texture_atlas(atlas);
+    free(items);
+    free(placements);
+    free(page_of);
+    free(packers);
+    return NULL;
+  }
+
+  int border = settings.extrude * 2 + settings.padding;
+  int item_count = 0;
+  for (int i = 0; i < count; i++) {
+    if (images[i]) {
+      items[item_count++] = (atlas_item_t){i, images[i]->w + border,
+                                           images[i]->h + border};
+    }
+  }
+  qsort(items, (size_t)item_count, sizeof(atlas_item_t), compare_items);
+
+  int packed = 0;
+  for (int i = 0; i < item_count; i++) {
+    const atlas_item_t* item = &items[i];
+    int page = 0;
+    SDL_Rect cell;
+    while (page < atlas->page_count &&
+           !pack_rect(packers[page], item->cell_w, item->cell_h, &cell)) {
+      page++;
+    }
+    if (page == atlas->page_count) {
+      packers[page] = create_rect_packer(settings.page_size,
+                                         settings.page_size);
+      if (!packers[page] ||
+          !pack_rect(packers[page], item->cell_w, item->cell_h, &cell)) {
+        LOG_ERROR_FMT("Atlas image %d (%dx%d) does not fit a %dx%d page",
+                      item->index, images[item->index]->w,
+                      images[item->index]->h, settings.page_size,
+                      settings.page_size);
+        destroy_rect_packer(packers[page]);
+        packers[page] = NULL;
+        page_of[item->index] = -1;
+        continue;
+      }
+      atlas->page_count++;
+    }
+    page_of[item->index] = page;
+    placements[item->index] =
+        (SDL_Rect){cell.x + settings.extrude, cell.y + settings.extrude,
+                   images[item->index]->w, images[item->index]->h};
+    packed++;
+  }
+
+  bool ok = true;
+  for (int page = 0; page < atlas->page_count && ok; page++) {
+    // Pages are cropped to the area actually used
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(
+        0, packers[page]->used_width, packers[page]->used_height, 32,
+        SDL_PIXELFORMAT_ARGB8888);
+    ok = surface != NULL;
+    if (ok) {
+      SDL_FillRect(surface, NULL, 0);
+    }
+    for (int i = 0; i < count && ok; i++) {
+      if (images[i] && page_of[i] == page) {
+        ok = copy_image(surface, images[i], &placements[i], settings.extrude);
+      }
+    }
+    ok = ok && create_page_texture(renderer, surface, &atlas->pages[page]);
+    SDL_FreeSurface(surface);
+  }
+
+  for (int i = 0; i < count && ok; i++) {
+    if (images[i] && page_of[i] >= 0) {
+      const SDL_Rect* rect = &placements[i];
+      atlas->regions[i].texture = &atlas->pages[page_of[i]];
+      atlas->regions[i].rect = make_rect(rect->x, rect->y, rect->w, rect->h);
+    }
+  }
+
+  if (ok) {
+    log_atlas_stats(atlas, packers, packed);
+  } else {
+    LOG_ERROR("Failed to build texture atlas pages");
+  }
+
+  for (int page = 0; page < atlas->page_count; page++) {
+    destroy_rect_packer(packers[page]);
+  }
+  free(items);
+  free(placements);
+  free(page_of);
+  free(packers);
+  if (!ok) {
+    destroy_texture_atlas(atlas);
+    return NULL;
+  }
+  return atlas;
+}
+
+texture_atlas_ptr load_texture_atlas(SDL_Renderer* renderer,
+                                     const char* const* paths, int count,
+                                     const texture_atlas_options_t* options) {
+  if (count <= 0) {
+    return NULL;
+  }
+
+  SDL_Surface** images = calloc((size_t)count, sizeof(SDL_Surface*));
+  if (!images) {
+    LOG_ERROR("Failed to allocate atlas image list");
+    return NULL;
+  }
+
+  for (int i = 0; i < count; i++) {
+    images[i] = IMG_Load(paths[i]);
+    if (!images[i]) {
+      LOG_ERROR_FMT("Failed to load image %s: %s", paths[i], IMG_GetError());
+      continue;
+    }
+    // Same transparency rule as load_texture()
+    SDL_SetColorKey(images[i], SDL_TRUE,
+                    SDL_MapRGB(images[i]->format, 0, 0, 0));
+  }
+
+  texture_atlas_ptr atlas =
+      create_texture_atlas(renderer, images, count, options);
+
+  for (int i = 0; i < count; i++) {
+    SDL_FreeSurface(images[i]);
+  }
+  free(images);
+  return atlas;
+}
+
+void destroy_texture_atlas(texture_atlas_ptr atlas) {
+  if (!atlas) {
+    return;
+  }
+  for (int i = 0; atlas->pages && i < atlas->page_count; i++) {
+    free_texture(&atlas->pages[i]);
+  }
+  free(atlas->pages);
+  free(atlas->regions);
+  free(atlas);
+}
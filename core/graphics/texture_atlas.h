@@ -0,0 +1,83 @@
+/**
+ * @file texture_atlas.h
+ * @brief Load-time texture atlas builder
+ *
+ * Packs many small images into a few large textures with the MaxRects
+ * packer, so sprites drawn one after another usually share a texture and
+ * the render queue and sprite batches can merge them. Each image becomes an
+ * atlas_region_t whose texture and rect plug straight into render_sprite*.
+ *
+ * Every image is surrounded by `extrude` copies of its edge pixels and
+ * `padding` transparent pixels, so scaled or sub-pixel sprites never sample
+ * their neighbours.
+ */
+
+#ifndef CORE_GRAPHICS_TEXTURE_ATLAS_H_
+#define CORE_GRAPHICS_TEXTURE_ATLAS_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+
+#include "texture.h"
+
+#define TEXTURE_ATLAS_DEFAULT_PAGE_SIZE 2048
+#define TEXTURE_ATLAS_DEFAULT_PADDING 2
+#define TEXTURE_ATLAS_DEFAULT_EXTRUDE 1
+
+typedef struct {
+  int page_size;  // Maximum page width and height
+  int padding;    // Transparent pixels between neighbouring images
+  int extrude;    // Edge pixels repeated around each image
+} texture_atlas_options_t;
+
+// Sub-image of an atlas page; texture is NULL if the image was not packed
+typedef struct {
+  texture_ptr texture;
+  rect_t rect;
+} atlas_region_t;
+
+typedef struct texture_atlas {
+  texture_t* pages;
+  int page_count;
+  atlas_region_t* regions;  // One per input image, in input order
+  int region_count;
+} texture_atlas_t, *texture_atlas_ptr;
+
+/**
+ * @brief Pack surfaces into atlas pages
+ *
+ * Color keys of the input surfaces become transparent pixels. The surfaces
+ * are not modified and may be freed afterwards.
+ *
+ * @param renderer Renderer creating the page textures
+ * @param images Surfaces to pack (NULL entries get an empty region)
+ * @param count Number of surfaces
+ * @param options Packing options, or NULL for the defaults
+ * @return Atlas, or NULL on failure
+ */
+texture_atlas_ptr create_texture_atlas(SDL_Renderer* renderer,
+                                       SDL_Surface* const* images, int count,
+                                       const texture_atlas_options_t* options);
+
+/**
+ * @brief Load image files and pack them into atlas pages
+ *
+ * Images are loaded like load_texture(): black is transparent.
+ *
+ * @param renderer Renderer creating the page textures
+ * @param paths Image file paths
+ * @param count Number of paths
+ * @param options Packing options, or NULL for the defaults
+ * @return Atlas, or NULL on failure
+ */
+texture_atlas_ptr load_texture_atlas(SDL_Renderer* renderer,
+                                     const char* const* paths, int count,
+                                     const texture_atlas_options_t* options);
+
+/**
+ * @brief Free an atlas and its page textures
+ * @param atlas Atlas to destroy (may be NULL)
+ */
+void destroy_texture_atlas(texture_atlas_ptr atlas);
+
+#endif  // CORE_GRAPHICS_TEXTURE_ATLAS_H_
@@ -0,0 +1,348 @@
+/**
+ * @file texture_pack.c
+ * @brief Implementation of pre-decoded texture packs
+ */
+
+// mmap() and friends are POSIX, hidden by --std=c99 otherwise
+#define _POSIX_C_SOURCE 200112L
+
+#include "texture_pack.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cpu_renderer.h"
+#include "logger.h"
+#include "pixel_pipeline.h"
+#include "render_state.h"
+
+typedef struct {
+  const char* name;
+  int index;
+} pack_name_t;
+
+static int compare_names(const void* a, const void* b) {
+  return strcmp(((const pack_name_t*)a)->name, ((const pack_name_t*)b)->name);
+}
+
+static uint64_t align_offset(uint64_t offset) {
+  return (offset + TEXTURE_PACK_ALIGNMENT - 1) &
+         ~(uint64_t)(TEXTURE_PACK_ALIGNMENT - 1);
+}
+
+static inline Uint32* pixel_row(SDL_Surface* surface, int y) {
+  return (Uint32*)((Uint8*)surface->pixels + (size_t)y * surface->pitch);
+}
+
+// ARGB8888 copy with black made transparent and colors premultiplied;
+// `translucent` reports alpha other than 0 and 255
+static SDL_Surface* prepare_image(SDL_Surface* image, bool* translucent) {
+  pixel_pipeline_options_t options = {true, 0, 0, 0, true, false};
+  pixel_pipeline_result_t result;
+  SDL_Surface* surface = preprocess_surface(image, &options, &result);
+  if (!surface) {
+    LOG_ERROR("Failed to convert texture pack image");
+    return NULL;
+  }
+  *translucent = result.translucent;
+  return surface;
+}
+
+static bool write_pixels(FILE* file, SDL_Surface* surface, uint64_t offset) {
+  static const Uint8 zeros[TEXTURE_PACK_ALIGNMENT] = {0};
+  long position = ftell(file);
+  if (position < 0 || (uint64_t)position > offset ||
+      fwrite(zeros, 1, (size_t)(offset - (uint64_t)position), file) !=
+          (size_t)(offset - (uint64_t)position)) {
+    return false;
+  }
+  for (int y = 0; y < surface->h; y++) {
+    if (fwrite(pixel_row(surface, y), sizeof(Uint32), (size_t)surface->w,
+               file) != (size_t)surface->w) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool write_texture_pack(const char* path, SDL_Surface* const* images,
+                        const char* const* names, int count) {
+  if (!path || count < 0 || (count > 0 && (!images || !names))) {
+    return false;
+  }
+
+  pack_name_t* order = calloc((size_t)count + 1, sizeof(pack_name_t));
+  texture_pack_entry_t* entries =
+      calloc((size_t)count + 1, sizeof(texture_pack_entry_t));
+  SDL_Surface** prepared = calloc((size_t)count + 1, sizeof(SDL_Surface*));
+  if (!order || !entries || !prepared) {
+    LOG_ERROR("Failed to allocate texture pack directory");
+    free(order);
+    free(entries);
+    free(prepared);
+    return false;
+  }
+
+  bool ok = true;
+  for (int i = 0; i < count && ok; i++) {
+    if (!images[i] || !names[i] ||
+        strlen(names[i]) >= TEXTURE_PACK_NAME_SIZE) {
+      LOG_ERROR_FMT("Invalid texture pack image %d", i);
+      ok = false;
+    }
+    order[i] = (pack_name_t){names[i], i};
+  }
+  if (ok) {
+    qsort(order, (size_t)count, sizeof(pack_name_t), compare_names);
+  }
+  for (int i = 1; i < count && ok; i++) {
+    if (!strcmp(order[i - 1].name, order[i].name)) {
+      LOG_ERROR_FMT("Duplicate texture pack image %s", order[i].name);
+      ok = false;
+    }
+  }
+
+  uint64_t offset = align_offset(sizeof(texture_pack_header_t) +
+                                 sizeof(texture_pack_entry_t) * (size_t)count);
+  for (int i = 0; i < count && ok; i++) {
+    bool translucent;
+    prepared[i] = prepare_image(images[order[i].index], &translucent);
+    ok = prepared[i] != NULL;
+    if (ok) {
+      texture_pack_entry_t* entry = &entries[i];
+      strcpy(entry->name, order[i].name);
+      entry->width = (uint32_t)prepared[i]->w;
+      entry->height = (uint32_t)prepared[i]->h;
+      entry->flags = translucent ? TEXTURE_PACK_TRANSLUCENT : 0;
+      entry->offset = offset;
+      offset = align_offset(offset + (uint64_t)entry->width * entry->height *
+                                         sizeof(Uint32));
+    }
+  }
+
+  FILE* file = ok ? fopen(path, "wb") : NULL;
+  if (ok && !file) {
+    LOG_ERROR_FMT("Failed to create texture pack %s", path);
+    ok = false;
+  }
+  if (ok) {
+    texture_pack_header_t header = {TEXTURE_PACK_MAGIC, TEXTURE_PACK_VERSION,
+                                    (uint32_t)count,
+                                    TEXTURE_PACK_PREMULTIPLIED};
+    ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+         fwrite(entries, sizeof(texture_pack_entry_t), (size_t)count,
+                file) == (size_t)count;
+  }
+  for (int i = 0; i < count && ok; i++) {
+    ok = write_pixels(file, prepared[i], entries[i].offset);
+  }
+  if (file && fclose(file) != 0) {
+    ok = false;
+  }
+  if (file && !ok) {
+    LOG_ERROR_FMT("Failed to write texture pack %s", path);
+    remove(path);
+  }
+
+  for (int i = 0; i < count; i++) {
+    SDL_FreeSurface(prepared[i]);
+  }
+  free(order);
+  free(entries);
+  free(prepared);
+  return ok;
+}
+
+static bool validate_pack(const texture_pack_t* pack) {
+  if (pack->size < sizeof(texture_pack_header_t) ||
+      pack->header->magic != TEXTURE_PACK_MAGIC ||
+      pack->header->version != TEXTURE_PACK_VERSION) {
+    return false;
+  }
+
+  uint64_t count = pack->header->entry_count;
+  if (count > (pack->size - sizeof(texture_pack_header_t)) /
+                  sizeof(texture_pack_entry_t)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < count; i++) {
+    const texture_pack_entry_t* entry = &pack->entries[i];
+    uint64_t bytes = (uint64_t)entry->width * entry->height * sizeof(Uint32);
+    if (!memchr(entry->name, '\0', TEXTURE_PACK_NAME_SIZE) ||
+        entry->width == 0 || entry->height == 0 ||
+        entry->width > INT32_MAX / sizeof(Uint32) ||
+        entry->height > INT32_MAX ||
+        entry->offset % TEXTURE_PACK_ALIGNMENT != 0 ||
+        entry->offset > pack->size || bytes > pack->size - entry->offset) {
+      return false;
+    }
+    if (i > 0 && strcmp(pack->entries[i - 1].name, entry->name) >= 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+texture_pack_ptr open_texture_pack(const char* path) {
+  if (!path) {
+    return NULL;
+  }
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    LOG_ERROR_FMT("Failed to open texture pack %s", path);
+    return NULL;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    LOG_ERROR_FMT("Failed to read texture pack %s", path);
+    close(fd);
+    return NULL;
+  }
+
+  size_t size = (size_t)info.st_size;
+  void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    LOG_ERROR_FMT("Failed to map texture pack %s", path);
+    return NULL;
+  }
+
+  texture_pack_ptr pack = calloc(1, sizeof(texture_pack_t));
+  if (!pack) {
+    LOG_ERROR("Failed to allocate texture pack");
+    munmap(data, size);
+    return NULL;
+  }
+  pack->data = data;
+  pack->size = size;
+  pack->header = data;
+  pack->entries = (const texture_pack_entry_t*)(pack->header + 1);
+  if (!validate_pack(pack)) {
+    LOG_ERROR_FMT("Invalid texture pack %s", path);
+    close_texture_pack(pack);
+    return NULL;
+  }
+
+  LOG_INFO_FMT("Mapped texture pack: %s (%u images)", path,
+               pack->header->entry_count);
+  return pack;
+}
+
+void close_texture_pack(texture_pack_ptr pack) {
+  if (!pack) {
+    return;
+  }
+  munmap(pack->data, pack->size);
+  free(pack);
+}
+
+static int compare_entry(const void* key, const void* element) {
+  return strcmp(key, ((const texture_pack_entry_t*)element)->name);
+}
+
+const texture_pack_entry_t* find_packed_image(const texture_pack_t* pack,
+                                              const char* name) {
+  if (!pack || !name) {
+    return NULL;
+  }
+  return bsearch(name, pack->entries, pack->header->entry_count,
+                 sizeof(texture_pack_entry_t), compare_entry);
+}
+
+// Straight alpha copy of premultiplied pixels
+static SDL_Surface* unpremultiply(SDL_Surface* source) {
+  SDL_Surface* surface =
+      SDL_ConvertSurfaceFormat(source, source->format->format, 0);
+  if (!surface) {
+    LOG_SDL_ERROR("SDL_ConvertSurfaceFormat");
+    return NULL;
+  }
+  for (int y = 0; y < surface->h; y++) {
+    Uint32* row = pixel_row(surface, y);
+    for (int x = 0; x < surface->w; x++) {
+      Uint32 alpha = row[x] >> 24;
+      if (alpha == 0 || alpha == 255) {
+        continue;
+      }
+      Uint32 r = (((row[x] >> 16) & 0xFF) * 255 + alpha / 2) / alpha;
+      Uint32 g = (((row[x] >> 8) & 0xFF) * 255 + alpha / 2) / alpha;
+      Uint32 b = ((row[x] & 0xFF) * 255 + alpha / 2) / alpha;
+      row[x] = (alpha << 24) | ((r > 255 ? 255 : r) << 16) |
+               ((g > 255 ? 255 : g) << 8) | (b > 255 ? 255 : b);
+    }
+  }
+  return surface;
+}
+
+texture_t load_packed_texture(SDL_Renderer* renderer,
+                              const texture_pack_t* pack, const char* name) {
+  texture_t tex = {NULL, 0, 0, NULL};
+
+  const texture_pack_entry_t* entry = find_packed_image(pack, name);
+  if (!entry) {
+    LOG_ERROR_FMT("Texture pack has no image %s", name ? name : "(null)");
+    return tex;
+  }
+
+  // The surface borrows the mapped pixels; nothing is copied until upload
+  SDL_Surface* mapped = SDL_CreateRGBSurfaceWithFormatFrom(
+      (Uint8*)pack->data + entry->offset, (int)entry->width,
+      (int)entry->height, 32, (int)(entry->width * sizeof(Uint32)),
+      SDL_PIXELFORMAT_ARGB8888);
+  if (!mapped) {
+    LOG_SDL_ERROR("SDL_CreateRGBSurfaceWithFormatFrom");
+    return tex;
+  }
+
+  bool premultiplied = (entry->flags & TEXTURE_PACK_TRANSLUCENT) &&
+                       (pack->header->flags & TEXTURE_PACK_PREMULTIPLIED);
+  SDL_Surface* straight = NULL;
+  tex.texture = SDL_CreateTextureFromSurface(renderer, mapped);
+  if (tex.texture && premultiplied) {
+    SDL_BlendMode premultiplied_blend = premultiplied_blend_mode();
+    if (SDL_SetTextureBlendMode(tex.texture, premultiplied_blend) != 0) {
+      // No custom blend modes (e.g. the software renderer)
+      SDL_DestroyTexture(tex.texture);
+      tex.texture = NULL;
+      straight = unpremultiply(mapped);
+      if (straight) {
+        tex.texture = SDL_CreateTextureFromSurface(renderer, straight);
+      }
+      premultiplied = false;
+    }
+  }
+  if (!tex.texture) {
+    LOG_ERROR_FMT("Failed to create texture from %s: %s", name,
+                  SDL_GetError());
+    SDL_FreeSurface(straight);
+    SDL_FreeSurface(mapped);
+    return tex;
+  }
+  if (!premultiplied) {
+    SDL_SetTextureBlendMode(tex.texture, SDL_BLENDMODE_BLEND);
+  }
+
+  tex.width = (int)entry->width;
+  tex.height = (int)entry->height;
+  if (cpu_rendering_active()) {
+    // The CPU backend blends straight alpha
+    if (!straight && (entry->flags & TEXTURE_PACK_TRANSLUCENT) &&
+        (pack->header->flags & TEXTURE_PACK_PREMULTIPLIED)) {
+      straight = unpremultiply(mapped);
+    }
+    tex.surface = create_cpu_surface(straight ? straight : mapped);
+  }
+
+  SDL_FreeSurface(straight);
+  SDL_FreeSurface(mapped);
+
+  LOG_INFO_FMT("Loaded packed texture: %s (%dx%d)", name, tex.width,
+               tex.height);
+  return tex;
+}
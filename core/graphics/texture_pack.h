@@ -0,0 +1,113 @@
+/**
+ * @file texture_pack.h
+ * @brief Pre-decoded texture packs loaded through a memory mapping
+ *
+ * A pack holds images that were decoded, color keyed and premultiplied at
+ * build time (see the texture_packs make target), so loading one is a
+ * texture upload straight from the mapped file with no image decoding.
+ *
+ * Layout, in host byte order: a texture_pack_header_t, entry_count
+ * texture_pack_entry_t records sorted by name, then each image's ARGB8888
+ * pixels (pitch = width * 4) at a TEXTURE_PACK_ALIGNMENT aligned offset.
+ */
+
+#ifndef CORE_GRAPHICS_TEXTURE_PACK_H_
+#define CORE_GRAPHICS_TEXTURE_PACK_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "texture.h"
+
+#define TEXTURE_PACK_MAGIC 0x4B415054u  // "TPAK"
+#define TEXTURE_PACK_VERSION 1
+#define TEXTURE_PACK_NAME_SIZE 64
+#define TEXTURE_PACK_ALIGNMENT 16
+
+// Header flags
+#define TEXTURE_PACK_PREMULTIPLIED 0x1u  // Color channels scaled by alpha
+
+// Entry flags
+#define TEXTURE_PACK_TRANSLUCENT 0x1u  // Has alpha other than 0 and 255
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t entry_count;
+  uint32_t flags;
+} texture_pack_header_t;
+
+typedef struct {
+  char name[TEXTURE_PACK_NAME_SIZE];  // File name, NUL-terminated
+  uint32_t width;
+  uint32_t height;
+  uint32_t flags;
+  uint32_t reserved;
+  uint64_t offset;  // Start of the pixels from the start of the file
+} texture_pack_entry_t;
+
+typedef struct texture_pack {
+  void* data;  // Read-only mapping of the whole file
+  size_t size;
+  const texture_pack_header_t* header;
+  const texture_pack_entry_t* entries;
+} texture_pack_t, *texture_pack_ptr;
+
+/**
+ * @brief Write surfaces to a pack file
+ *
+ * Each surface is converted to ARGB8888 with black made transparent, as
+ * load_texture() does, and premultiplied.
+ *
+ * @param path Output file
+ * @param images Surfaces to store
+ * @param names Lookup name of each surface (at most 63 characters, unique)
+ * @param count Number of surfaces
+ * @return true on success
+ */
+bool write_texture_pack(const char* path, SDL_Surface* const* images,
+                        const char* const* names, int count);
+
+/**
+ * @brief Map a pack file and validate its directory
+ * @param path Pack file
+ * @return Pack, or NULL on failure
+ */
+texture_pack_ptr open_texture_pack(const char* path);
+
+/**
+ * @brief Unmap a pack; textures loaded from it remain valid
+ * @param pack Pack to close (may be NULL)
+ */
+void close_texture_pack(texture_pack_ptr pack);
+
+/**
+ * @brief Find an image by name
+ * @param pack Pack
+ * @param name Name given when the pack was written
+ * @return Entry, or NULL if the pack has no such image
+ */
+const texture_pack_entry_t* find_packed_image(const texture_pack_t* pack,
+                                              const char* name);
+
+/**
+ * @brief Create a texture from a packed image
+ *
+ * Opaque and color keyed images are uploaded straight from the mapping.
+ * Translucent images use a premultiplied blend mode; renderers without
+ * custom blend modes get a straight alpha copy instead. The engine's faded
+ * and tinted sprite paths scale the color of premultiplied textures along
+ * with their alpha; a raw SDL_SetTextureAlphaMod() must be matched by the
+ * same SDL_SetTextureColorMod().
+ *
+ * @param renderer Renderer
+ * @param pack Pack
+ * @param name Image name
+ * @return Texture (texture member NULL on failure)
+ */
+texture_t load_packed_texture(SDL_Renderer* renderer,
+                              const texture_pack_t* pack, const char* name);
+
+#endif  // CORE_GRAPHICS_TEXTURE_PACK_H_
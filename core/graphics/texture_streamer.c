@@ -0,0 +1,427 @@
+/**
+ * @file texture_streamer.c
+ * @brief Implementation of asynchronous texture streaming
+ */
+
+#include "texture_streamer.h"
+
+#include <SDL_image.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu_renderer.h"
+#include "logger.h"
+#include "pixel_pipeline.h"
+
+static void push_back(streamed_texture_ptr* head, streamed_texture_ptr* tail,
+                      streamed_texture_ptr item) {
+  item->next = NULL;
+  if (*tail) {
+    (*tail)->next = item;
+  } else {
+    *head = item;
+  }
+  *tail = item;
+}
+
+static streamed_texture_ptr pop_front(streamed_texture_ptr* head,
+                                      streamed_texture_ptr* tail) {
+  streamed_texture_ptr item = *head;
+  if (item) {
+    *head = item->next;
+    if (!*head) {
+      *tail = NULL;
+    }
+    item->next = NULL;
+  }
+  return item;
+}
+
+static void remove_item(streamed_texture_ptr* head, streamed_texture_ptr* tail,
+                        streamed_texture_ptr item) {
+  streamed_texture_ptr previous = NULL;
+  for (streamed_texture_ptr it = *head; it; previous = it, it = it->next) {
+    if (it != item) {
+      continue;
+    }
+    if (previous) {
+      previous->next = item->next;
+    } else {
+      *head = item->next;
+    }
+    if (*tail == item) {
+      *tail = previous;
+    }
+    item->next = NULL;
+    return;
+  }
+}
+
+static void free_handle(streamed_texture_ptr handle) {
+  free_texture(&handle->texture);
+  SDL_FreeSurface(handle->surface);
+  SDL_FreeSurface(handle->cpu_surface);
+  free(handle->path);
+  free(handle);
+}
+
+// Load an image like load_texture(); the pixel pipeline leaves ARGB8888
+// with black made transparent, so the upload needs no conversion
+static SDL_Surface* decode_image(const char* path, SDL_Surface** cpu_surface) {
+  SDL_Surface* image = IMG_Load(path);
+  if (!image) {
+    LOG_ERROR_FMT("Failed to load image %s: %s", path, IMG_GetError());
+    return NULL;
+  }
+
+  pixel_pipeline_options_t options = {true, 0, 0, 0, false, false};
+  SDL_Surface* surface = preprocess_surface(image, &options, NULL);
+  SDL_FreeSurface(image);
+  if (!surface) {
+    LOG_ERROR_FMT("Failed to convert image %s", path);
+    return NULL;
+  }
+  if (cpu_rendering_active()) {
+    *cpu_surface = create_cpu_surface(surface);
+  }
+  return surface;
+}
+
+static int decode_thread(void* data) {
+  texture_streamer_ptr streamer = data;
+  SDL_LockMutex(streamer->mutex);
+  while (true) {
+    while (!streamer->decode_head && !streamer->shutting_down) {
+      SDL_CondWait(streamer->work_ready, streamer->mutex);
+    }
+    if (streamer->shutting_down) {
+      break;
+    }
+
+    streamed_texture_ptr item =
+        pop_front(&streamer->decode_head, &streamer->decode_tail);
+    item->state = STREAM_DECODING;
+    SDL_UnlockMutex(streamer->mutex);
+
+    SDL_Surface* cpu_surface = NULL;
+    SDL_Surface* surface = decode_image(item->path, &cpu_surface);
+
+    SDL_LockMutex(streamer->mutex);
+    item->surface = surface;
+    item->cpu_surface = cpu_surface;
+    if (item->released) {
+      free_handle(item);
+      continue;
+    }
+    item->state = STREAM_DECODED;
+    push_back(&streamer->upload_head, &streamer->upload_tail, item);
+  }
+  SDL_UnlockMutex(streamer->mutex);
+  return 0;
+}
+
+static bool create_placeholder(SDL_Renderer* renderer, SDL_Color color,
+                               texture_ptr placeholder) {
+  SDL_Surface* surface =
+      SDL_CreateRGBSurfaceWithFormat(0, 1, 1, 32, SDL_PIXELFORMAT_ARGB8888);
+  if (!surface) {
+    LOG_SDL_ERROR("SDL_CreateRGBSurfaceWithFormat");
+    return false;
+  }
+  SDL_FillRect(surface, NULL,
+               SDL_MapRGBA(surface->format, color.r, color.g, color.b,
+                           color.a));
+
+  placeholder->texture = SDL_CreateTextureFromSurface(renderer, surface);
+  if (!placeholder->texture) {
+    LOG_SDL_ERROR("SDL_CreateTextureFromSurface");
+    SDL_FreeSurface(surface);
+    return false;
+  }
+  SDL_SetTextureBlendMode(placeholder->texture, SDL_BLENDMODE_BLEND);
+  placeholder->width = 1;
+  placeholder->height = 1;
+  if (cpu_rendering_active()) {
+    placeholder->surface = create_cpu_surface(surface);
+  }
+  SDL_FreeSurface(surface);
+  return true;
+}
+
+texture_streamer_ptr create_texture_streamer(
+    const graphics_context_ptr graphics_context, SDL_Color placeholder_color) {
+  if (!graphics_context || !graphics_context->renderer) {
+    return NULL;
+  }
+
+  texture_streamer_ptr streamer = calloc(1, sizeof(texture_streamer_t));
+  if (!streamer) {
+    LOG_ERROR("Failed to allocate texture streamer");
+    return NULL;
+  }
+  streamer->graphics_context = graphics_context;
+  streamer->upload_budget_ms = TEXTURE_STREAMER_DEFAULT_UPLOAD_MS;
+  streamer->upload_budget_bytes = TEXTURE_STREAMER_DEFAULT_UPLOAD_BYTES;
+  streamer->mutex = SDL_CreateMutex();
+  streamer->work_ready = SDL_CreateCond();
+  if (!streamer->mutex || !streamer->work_ready ||
+      !create_placeholder(graphics_context->renderer, placeholder_color,
+                          &streamer->placeholder)) {
+    LOG_ERROR("Failed to create texture streamer");
+    destroy_texture_streamer(streamer);
+    return NULL;
+  }
+
+  streamer->thread =
+      SDL_CreateThread(decode_thread, "texture_streamer", streamer);
+  if (!streamer->thread) {
+    LOG_SDL_ERROR("SDL_CreateThread");
+    destroy_texture_streamer(streamer);
+    return NULL;
+  }
+  return streamer;
+}
+
+// Free released handles, keeping those released this frame unless `all`
+static void free_retired(texture_streamer_ptr streamer, bool all) {
+  unsigned frame = streamer->graphics_context->frame_count;
+  streamed_texture_ptr* link = &streamer->retired;
+  while (*link) {
+    streamed_texture_ptr handle = *link;
+    if (all || handle->retired_frame != frame) {
+      *link = handle->next;
+      free_handle(handle);
+    } else {
+      link = &handle->next;
+    }
+  }
+}
+
+void destroy_texture_streamer(texture_streamer_ptr streamer) {
+  if (!streamer) {
+    return;
+  }
+
+  if (streamer->thread) {
+    SDL_LockMutex(streamer->mutex);
+    streamer->shutting_down = true;
+    SDL_CondSignal(streamer->work_ready);
+    SDL_UnlockMutex(streamer->mutex);
+    SDL_WaitThread(streamer->thread, NULL);
+  }
+
+  // The thread is gone, so every remaining handle is on the handle list
+  while (streamer->handles) {
+    streamed_texture_ptr handle = streamer->handles;
+    streamer->handles = handle->next_handle;
+    free_handle(handle);
+  }
+  free_retired(streamer, true);
+  free_texture(&streamer->placeholder);
+  SDL_DestroyCond(streamer->work_ready);
+  SDL_DestroyMutex(streamer->mutex);
+  free(streamer);
+}
+
+void set_texture_upload_budget(texture_streamer_ptr streamer,
+                               double milliseconds, size_t bytes) {
+  if (!streamer) {
+    return;
+  }
+  streamer->upload_budget_ms = milliseconds > 0.0 ? milliseconds : 0.0;
+  streamer->upload_budget_bytes = bytes;
+}
+
+streamed_texture_ptr stream_texture(texture_streamer_ptr streamer,
+                                    const char* path) {
+  if (!streamer || !path) {
+    return NULL;
+  }
+
+  streamed_texture_ptr handle = calloc(1, sizeof(streamed_texture_t));
+  char* path_copy = malloc(strlen(path) + 1);
+  if (!handle || !path_copy) {
+    LOG_ERROR("Failed to allocate streamed texture");
+    free(handle);
+    free(path_copy);
+    return NULL;
+  }
+  strcpy(path_copy, path);
+  handle->path = path_copy;
+  handle->state = STREAM_QUEUED;
+
+  handle->next_handle = streamer->handles;
+  if (streamer->handles) {
+    streamer->handles->prev_handle = handle;
+  }
+  streamer->handles = handle;
+  streamer->stats.pending++;
+
+  SDL_LockMutex(streamer->mutex);
+  push_back(&streamer->decode_head, &streamer->decode_tail, handle);
+  SDL_CondSignal(streamer->work_ready);
+  SDL_UnlockMutex(streamer->mutex);
+  return handle;
+}
+
+// Create the texture of a decoded handle; its surfaces are consumed
+static void upload_handle(texture_streamer_ptr streamer,
+                          streamed_texture_ptr handle) {
+  SDL_Surface* surface = handle->surface;
+  handle->surface = NULL;
+  if (surface) {
+    SDL_Texture* texture =
+        SDL_CreateTexture(streamer->graphics_context->renderer,
+                          SDL_PIXELFORMAT_ARGB8888,
+                          SDL_TEXTUREACCESS_STATIC, surface->w, surface->h);
+    if (texture &&
+        SDL_UpdateTexture(texture, NULL, surface->pixels, surface->pitch) ==
+            0) {
+      SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+      handle->texture.texture = texture;
+      handle->texture.width = surface->w;
+      handle->texture.height = surface->h;
+      handle->texture.surface = handle->cpu_surface;
+      handle->cpu_surface = NULL;
+      LOG_INFO_FMT("Streamed texture: %s (%dx%d)", handle->path, surface->w,
+                   surface->h);
+    } else {
+      LOG_ERROR_FMT("Failed to create texture from %s: %s", handle->path,
+                    SDL_GetError());
+      if (texture) {
+        SDL_DestroyTexture(texture);
+      }
+    }
+    SDL_FreeSurface(surface);
+  }
+
+  SDL_FreeSurface(handle->cpu_surface);
+  handle->cpu_surface = NULL;
+  if (handle->texture.texture) {
+    streamer->stats.uploaded++;
+  } else {
+    handle->failed = true;
+    streamer->stats.failed++;
+  }
+  streamer->stats.pending--;
+}
+
+void update_texture_streamer(texture_streamer_ptr streamer) {
+  if (!streamer) {
+    return;
+  }
+  free_retired(streamer, false);
+
+  Uint64 start = SDL_GetPerformanceCounter();
+  double ticks_per_ms = (double)SDL_GetPerformanceFrequency() / 1000.0;
+  int uploads = 0;
+  size_t bytes = 0;
+  double elapsed_ms = 0.0;
+  while (true) {
+    SDL_LockMutex(streamer->mutex);
+    streamed_texture_ptr handle = streamer->upload_head;
+    size_t handle_bytes =
+        handle && handle->surface
+            ? (size_t)handle->surface->h * (size_t)handle->surface->pitch
+            : 0;
+    bool over_budget =
+        uploads > 0 &&
+        ((streamer->upload_budget_ms > 0.0 &&
+          elapsed_ms >= streamer->upload_budget_ms) ||
+         (streamer->upload_budget_bytes > 0 &&
+          bytes + handle_bytes > streamer->upload_budget_bytes));
+    if (!handle || over_budget) {
+      SDL_UnlockMutex(streamer->mutex);
+      break;
+    }
+    pop_front(&streamer->upload_head, &streamer->upload_tail);
+    handle->state = STREAM_UPLOADED;
+    SDL_UnlockMutex(streamer->mutex);
+
+    upload_handle(streamer, handle);
+    uploads++;
+    bytes += handle_bytes;
+    elapsed_ms = (double)(SDL_GetPerformanceCounter() - start) / ticks_per_ms;
+  }
+
+  streamer->stats.frame_uploads = uploads;
+  streamer->stats.frame_bytes = bytes;
+  streamer->stats.frame_ms = elapsed_ms;
+}
+
+bool is_streamed_texture_ready(const streamed_texture_t* handle) {
+  return handle && handle->texture.texture;
+}
+
+texture_ptr get_streamed_texture(texture_streamer_ptr streamer,
+                                 streamed_texture_ptr handle) {
+  if (!streamer) {
+    return NULL;
+  }
+  return is_streamed_texture_ready(handle) ? &handle->texture
+                                           : &streamer->placeholder;
+}
+
+void render_streamed_texture(const graphics_context_ptr graphics_context,
+                             texture_streamer_ptr streamer,
+                             streamed_texture_ptr handle,
+                             const rect_t* src_rect, const rect_t* dst_rect) {
+  if (!streamer || !handle) {
+    return;
+  }
+  if (is_streamed_texture_ready(handle)) {
+    render_sprite(graphics_context, &handle->texture, src_rect, dst_rect);
+  } else if (dst_rect && !handle->failed) {
+    render_sprite(graphics_context, &streamer->placeholder, NULL, dst_rect);
+  }
+}
+
+void release_streamed_texture(texture_streamer_ptr streamer,
+                              streamed_texture_ptr handle) {
+  if (!streamer || !handle) {
+    return;
+  }
+
+  if (handle->prev_handle) {
+    handle->prev_handle->next_handle = handle->next_handle;
+  } else {
+    streamer->handles = handle->next_handle;
+  }
+  if (handle->next_handle) {
+    handle->next_handle->prev_handle = handle->prev_handle;
+  }
+
+  SDL_LockMutex(streamer->mutex);
+  stream_state_t state = handle->state;
+  switch (state) {
+    case STREAM_QUEUED:
+      remove_item(&streamer->decode_head, &streamer->decode_tail, handle);
+      free_handle(handle);
+      break;
+    case STREAM_DECODING:
+      // The decode thread frees it when done
+      handle->released = true;
+      break;
+    case STREAM_DECODED:
+      remove_item(&streamer->upload_head, &streamer->upload_tail, handle);
+      free_handle(handle);
+      break;
+    case STREAM_UPLOADED:
+      // Copies recorded this frame may still use the texture
+      handle->retired_frame = streamer->graphics_context->frame_count;
+      handle->next = streamer->retired;
+      streamer->retired = handle;
+      break;
+  }
+  SDL_UnlockMutex(streamer->mutex);
+
+  if (state != STREAM_UPLOADED) {
+    streamer->stats.pending--;
+  }
+}
+
+texture_streamer_stats_t get_texture_streamer_stats(
+    const texture_streamer_t* streamer) {
+  texture_streamer_stats_t empty = {0};
+  return streamer ? streamer->stats : empty;
+}
@@ -0,0 +1,181 @@
+/**
+ * @file texture_streamer.h
+ * @brief Asynchronous texture loading with a per-frame upload budget
+ *
+ * stream_texture() returns a handle at once and queues the file for a
+ * background thread, which decodes it and converts it to ARGB8888 so the
+ * upload left for the main thread is a plain copy. update_texture_streamer()
+ * runs once per frame and uploads finished images until the frame's time or
+ * byte budget is spent. Until its upload, a handle draws as a placeholder.
+ *
+ * The render queue and the CPU backend draw textures only when the frame is
+ * flushed, so a handle released after its upload keeps its texture until
+ * the frame is presented; update_texture_streamer() frees it afterwards.
+ */
+
+#ifndef CORE_GRAPHICS_TEXTURE_STREAMER_H_
+#define CORE_GRAPHICS_TEXTURE_STREAMER_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "graphics_context.h"
+#include "texture.h"
+
+#define TEXTURE_STREAMER_DEFAULT_UPLOAD_MS 2.0
+#define TEXTURE_STREAMER_DEFAULT_UPLOAD_BYTES (4 * 1024 * 1024)
+
+typedef enum {
+  STREAM_QUEUED,    // Waiting for the decode thread
+  STREAM_DECODING,
+  STREAM_DECODED,   // Waiting for upload (surface NULL if decoding failed)
+  STREAM_UPLOADED   // Texture ready, or failed for good
+} stream_state_t;
+
+typedef struct streamed_texture {
+  char* path;
+  stream_state_t state;  // Guarded by the streamer mutex
+  bool released;         // Freed by the decode thread once it is done
+  SDL_Surface* surface;  // Decoded ARGB8888 pixels
+  SDL_Surface* cpu_surface;
+  texture_t texture;  // Main thread only; texture is NULL until ready
+  bool failed;        // Main thread only
+  unsigned retired_frame;  // graphics_context_t.frame_count when released
+  struct streamed_texture* next;  // Decode, upload or retired list
+  struct streamed_texture* prev_handle;  // All live handles, main thread
+  struct streamed_texture* next_handle;
+} streamed_texture_t, *streamed_texture_ptr;
+
+typedef struct {
+  int pending;          // Handles not uploaded yet
+  int uploaded;         // Textures uploaded since creation
+  int failed;           // Images that could not be loaded
+  int frame_uploads;    // Uploads in the last update_texture_streamer()
+  size_t frame_bytes;   // Bytes uploaded in the last update
+  double frame_ms;      // Time spent in the last update
+} texture_streamer_stats_t;
+
+typedef struct texture_streamer {
+  graphics_context_ptr graphics_context;
+  SDL_Thread* thread;
+  SDL_mutex* mutex;
+  SDL_cond* work_ready;
+  streamed_texture_ptr decode_head;  // FIFO of queued images
+  streamed_texture_ptr decode_tail;
+  streamed_texture_ptr upload_head;  // FIFO of decoded images
+  streamed_texture_ptr upload_tail;
+  bool shutting_down;
+  streamed_texture_ptr handles;
+  streamed_texture_ptr retired;  // Released after upload, main thread
+  texture_t placeholder;
+  double upload_budget_ms;     // 0 means unlimited
+  size_t upload_budget_bytes;  // 0 means unlimited
+  texture_streamer_stats_t stats;
+} texture_streamer_t, *texture_streamer_ptr;
+
+/**
+ * @brief Create a streamer and start its decode thread
+ * @param graphics_context Graphics context whose renderer receives the
+ *        textures
+ * @param placeholder_color Color drawn for textures still loading
+ * @return Streamer, or NULL on failure
+ */
+texture_streamer_ptr create_texture_streamer(
+    const graphics_context_ptr graphics_context, SDL_Color placeholder_color);
+
+/**
+ * @brief Stop the decode thread and free every handle and texture
+ * @param streamer Streamer to destroy (may be NULL)
+ */
+void destroy_texture_streamer(texture_streamer_ptr streamer);
+
+/**
+ * @brief Set how much uploading update_texture_streamer() may do per frame
+ *
+ * One image is always uploaded per frame when available, so an image
+ * larger than the budget still arrives.
+ *
+ * @param streamer Streamer
+ * @param milliseconds Time budget, 0 for unlimited
+ * @param bytes Byte budget, 0 for unlimited
+ */
+void set_texture_upload_budget(texture_streamer_ptr streamer,
+                               double milliseconds, size_t bytes);
+
+/**
+ * @brief Queue an image for background loading
+ *
+ * Images are loaded like load_texture(): black is transparent.
+ *
+ * @param streamer Streamer
+ * @param path Image path
+ * @return Handle, valid until release_streamed_texture(), or NULL
+ */
+streamed_texture_ptr stream_texture(texture_streamer_ptr streamer,
+                                    const char* path);
+
+/**
+ * @brief Upload decoded images within the per-frame budget
+ *
+ * Call once per frame on the thread owning the renderer. Also frees the
+ * textures of handles released before the last present_frame().
+ *
+ * @param streamer Streamer
+ */
+void update_texture_streamer(texture_streamer_ptr streamer);
+
+/**
+ * @brief Check whether a handle's texture has been uploaded
+ * @param handle Handle from stream_texture()
+ * @return true once the texture can be drawn
+ */
+bool is_streamed_texture_ready(const streamed_texture_t* handle);
+
+/**
+ * @brief Get the texture of a handle
+ * @param streamer Streamer
+ * @param handle Handle from stream_texture()
+ * @return The texture when ready, otherwise the 1x1 placeholder
+ */
+texture_ptr get_streamed_texture(texture_streamer_ptr streamer,
+                                 streamed_texture_ptr handle);
+
+/**
+ * @brief Draw a handle like render_sprite()
+ *
+ * While loading, the placeholder fills dst_rect; nothing is drawn when
+ * dst_rect is NULL, since the texture size is not known yet.
+ *
+ * @param graphics_context Graphics context
+ * @param streamer Streamer
+ * @param handle Handle from stream_texture()
+ * @param src_rect Source rectangle in the loaded texture (NULL for all)
+ * @param dst_rect Destination rectangle (NULL for the texture size)
+ */
+void render_streamed_texture(const graphics_context_ptr graphics_context,
+                             texture_streamer_ptr streamer,
+                             streamed_texture_ptr handle,
+                             const rect_t* src_rect, const rect_t* dst_rect);
+
+/**
+ * @brief Free a handle, cancelling its load if still pending
+ *
+ * An uploaded texture stays alive until the frame is presented, so it may
+ * be released right after being drawn.
+ *
+ * @param streamer Streamer
+ * @param handle Handle to free (may be NULL)
+ */
+void release_streamed_texture(texture_streamer_ptr streamer,
+                              streamed_texture_ptr handle);
+
+/**
+ * @brief Get queue and upload counters
+ * @param streamer Streamer
+ * @return Statistics
+ */
+texture_streamer_stats_t get_texture_streamer_stats(
+    const texture_streamer_t* streamer);
+
+#endif  // CORE_GRAPHICS_TEXTURE_STREAMER_H_
@@ -40,7 +40,9 @@ ttf_font_t load_ttf_font(const char* path, int point_size);
 
 /**
  * Render text to a texture using the specified font and color
- * The caller is responsible for destroying the returned texture
+ * The caller is responsible for destroying the returned texture. Text drawn
+ * every frame should go through text_cache.h instead, or glyph_atlas.h when
+ * it changes often.
  *
  * @param graphics_context Graphics context containing the renderer
  * @param font Font to use for rendering
@@ -0,0 +1,21 @@
+#include "dynamic_array.h"
+
+#include <stdlib.h>
+
+void* grow_array(void* data, int* capacity, int needed, size_t element_size) {
+  if (needed <= *capacity) {
+    return data;
+  }
+
+  int new_capacity = *capacity > 0 ? *capacity : DYNAMIC_ARRAY_INITIAL_CAPACITY;
+  while (new_capacity < needed) {
+    new_capacity *= 2;
+  }
+
+  void* grown = realloc(data, (size_t)new_capacity * element_size);
+  if (!grown) {
+    return NULL;
+  }
+  *capacity = new_capacity;
+  return grown;
+}
@@ -0,0 +1,23 @@
+/**
+ * @file dynamic_array.h
+ * @brief Capacity growth helper for reusable heap buffers
+ *
+ * Rendering code keeps its scratch and batch buffers alive across frames and
+ * only grows them, so steady-state frames never allocate. This helper
+ * implements the shared doubling policy.
+ */
+
+#ifndef CORE_MEMORY_DYNAMIC_ARRAY_H_
+#define CORE_MEMORY_DYNAMIC_ARRAY_H_
+
+#include <stdlib.h>
+
+// Capacity given to an empty array on its first growth
+#define DYNAMIC_ARRAY_INITIAL_CAPACITY 256
+
+// Grow an array to hold at least `needed` elements, doubling its capacity.
+// Returns the (possibly moved) array, or NULL if the allocation failed, in
+// which case the original array and capacity are left untouched.
+void* grow_array(void* data, int* capacity, int needed, size_t element_size);
+
+#endif  // CORE_MEMORY_DYNAMIC_ARRAY_H_
@@ -8,6 +8,7 @@
 #define GRAPHICS_INFO "--graphics-info"
 #define SHOW_FPS "--show-fps"
 #define VSYNC "--vsync"
+#define HEADLESS "--headless"
 #define DISPLAY "--display="
 #define DISPLAY_MODE "--display-mode="
 #define WINDOW_MODE "--window-mode="
@@ -19,6 +20,7 @@ void print_help(void) {
   puts("\t" HELP ": print this help");
   puts("\t" GRAPHICS_INFO ": print info about the graphics system");
   puts("\t" VSYNC ": enable VSync for smoother rendering (default: off)");
+  puts("\t" HEADLESS ": render offscreen without a window (CI, benchmarks)");
   puts("\t" VOLUME
        "X: set audio volume 0-128 (default: 32, 0=silent, 128=max)");
   puts("\t" SHOW_FPS ": show frames-per-second stats during game");
@@ -58,6 +60,9 @@ static bool parse_argument(const char* argument,
   } else if (!strcmp(VSYNC, argument)) {
     options->vsync = true;
 
+  } else if (!strcmp(HEADLESS, argument)) {
+    options->headless = true;
+
   } else if (!strcmp(GRAPHICS_INFO, argument)) {
     options->graphics_info = true;
 
@@ -105,6 +110,7 @@ static void set_defaults(const command_line_options_ptr options) {
   options->graphics_info = false;
   options->show_fps = false;
   options->vsync = false;
+  options->headless = false;
   options->display = 0;
   options->display_mode = 0;
   options->window_mode = FULLSCREEN;  // Default to fullscreen
@@ -19,6 +19,7 @@ typedef struct {
   bool graphics_info;
   bool show_fps;
   bool vsync;
+  bool headless;  // Render offscreen, see initialize_headless_graphics_context
   int display;
   int display_mode;
   window_mode_t window_mode;
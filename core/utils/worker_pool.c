@@ -0,0 +1,159 @@
+/**
+ * @file worker_pool.c
+ * @brief Implementation of the worker thread pool
+ */
+
+#include "worker_pool.h"
+
+#include <SDL.h>
+#include <stdlib.h>
+
+#include "logger.h"
+
+typedef struct {
+  worker_pool_ptr pool;
+  int worker;
+} worker_start_t;
+
+static void run_jobs(worker_pool_ptr pool, int worker) {
+  for (;;) {
+    int index = SDL_AtomicAdd(&pool->next_index, 1);
+    if (index >= pool->job_count) {
+      return;
+    }
+    pool->job(pool->data, index, worker);
+  }
+}
+
+static int worker_main(void* argument) {
+  worker_start_t start = *(worker_start_t*)argument;
+  free(argument);
+  worker_pool_ptr pool = start.pool;
+
+  // Loops are only started after every thread was created, at generation 0
+  int seen_generation = 0;
+  SDL_LockMutex(pool->mutex);
+  for (;;) {
+    while (!pool->shutting_down && pool->generation == seen_generation) {
+      SDL_CondWait(pool->work_ready, pool->mutex);
+    }
+    if (pool->shutting_down) {
+      SDL_UnlockMutex(pool->mutex);
+      return 0;
+    }
+    seen_generation = pool->generation;
+    SDL_UnlockMutex(pool->mutex);
+
+    run_jobs(pool, start.worker);
+
+    SDL_LockMutex(pool->mutex);
+    if (--pool->busy_workers == 0) {
+      SDL_CondSignal(pool->work_done);
+    }
+  }
+}
+
+worker_pool_ptr create_worker_pool(int thread_count) {
+  if (thread_count < 1) {
+    thread_count = SDL_GetCPUCount();
+  }
+
+  worker_pool_ptr pool = calloc(1, sizeof(worker_pool_t));
+  if (!pool) {
+    LOG_ERROR("Failed to allocate worker pool");
+    return NULL;
+  }
+
+  pool->mutex = SDL_CreateMutex();
+  pool->work_ready = SDL_CreateCond();
+  pool->work_done = SDL_CreateCond();
+  pool->threads = calloc((size_t)thread_count, sizeof(SDL_Thread*));
+  if (!pool->mutex || !pool->work_ready || !pool->work_done ||
+      !pool->threads) {
+    LOG_SDL_ERROR("Worker pool creation");
+    destroy_worker_pool(pool);
+    return NULL;
+  }
+
+  // The calling thread is worker 0 and takes part in every loop
+  pool->thread_count = 1;
+  for (int i = 1; i < thread_count; i++) {
+    worker_start_t* start = malloc(sizeof(worker_start_t));
+    if (!start) {
+      break;
+    }
+    start->pool = pool;
+    start->worker = i;
+    pool->threads[i] = SDL_CreateThread(worker_main, "worker", start);
+    if (!pool->threads[i]) {
+      LOG_SDL_ERROR("SDL_CreateThread");
+      free(start);
+      break;
+    }
+    pool->thread_count++;
+  }
+  return pool;
+}
+
+void run_parallel_for(worker_pool_ptr pool, int count, worker_job_fn job,
+                      void* data) {
+  if (count <= 0) {
+    return;
+  }
+
+  if (!pool || pool->thread_count == 1 || count == 1) {
+    for (int i = 0; i < count; i++) {
+      job(data, i, 0);
+    }
+    return;
+  }
+
+  SDL_LockMutex(pool->mutex);
+  pool->job = job;
+  pool->data = data;
+  pool->job_count = count;
+  SDL_AtomicSet(&pool->next_index, 0);
+  pool->busy_workers = pool->thread_count - 1;
+  pool->generation++;
+  SDL_CondBroadcast(pool->work_ready);
+  SDL_UnlockMutex(pool->mutex);
+
+  run_jobs(pool, 0);
+
+  SDL_LockMutex(pool->mutex);
+  while (pool->busy_workers > 0) {
+    SDL_CondWait(pool->work_done, pool->mutex);
+  }
+  SDL_UnlockMutex(pool->mutex);
+}
+
+void destroy_worker_pool(worker_pool_ptr pool) {
+  if (!pool) {
+    return;
+  }
+
+  if (pool->mutex) {
+    SDL_LockMutex(pool->mutex);
+    pool->shutting_down = true;
+    if (pool->work_ready) {
+      SDL_CondBroadcast(pool->work_ready);
+    }
+    SDL_UnlockMutex(pool->mutex);
+  }
+
+  for (int i = 1; pool->threads && i < pool->thread_count; i++) {
+    SDL_WaitThread(pool->threads[i], NULL);
+  }
+
+  if (pool->work_done) {
+    SDL_DestroyCond(pool->work_done);
+  }
+  if (pool->work_ready) {
+    SDL_DestroyCond(pool->work_ready);
+  }
+  if (pool->mutex) {
+    SDL_DestroyMutex(pool->mutex);
+  }
+  free(pool->threads);
+  free(pool);
+}
@@ -0,0 +1,60 @@
+/**
+ * @file worker_pool.h
+ * @brief Fixed pool of SDL worker threads running parallel loops
+ *
+ * run_parallel_for() hands out loop indices to the workers and to the
+ * calling thread through an atomic counter and returns once every index
+ * has been processed, so callers need no synchronization of their own as
+ * long as each index touches disjoint data.
+ */
+
+#ifndef CORE_UTILS_WORKER_POOL_H_
+#define CORE_UTILS_WORKER_POOL_H_
+
+#include <SDL.h>
+#include <stdbool.h>
+
+// Loop body: `index` is the loop index, `worker` identifies the executing
+// thread (0 for the caller, 1..thread_count - 1 for pool threads)
+typedef void (*worker_job_fn)(void* data, int index, int worker);
+
+typedef struct worker_pool {
+  SDL_Thread** threads;
+  int thread_count;  // Including the calling thread
+  SDL_mutex* mutex;
+  SDL_cond* work_ready;
+  SDL_cond* work_done;
+  worker_job_fn job;
+  void* data;
+  int job_count;
+  SDL_atomic_t next_index;
+  int generation;    // Bumped for every parallel loop
+  int busy_workers;  // Pool threads still running the current loop
+  bool shutting_down;
+} worker_pool_t, *worker_pool_ptr;
+
+/**
+ * @brief Create a worker pool
+ * @param thread_count Total threads including the caller; values below 1
+ *        mean one per CPU core
+ * @return Pool, or NULL on failure
+ */
+worker_pool_ptr create_worker_pool(int thread_count);
+
+/**
+ * @brief Run job(data, i, worker) for every i in [0, count) and wait
+ * @param pool Pool to run on (NULL runs the loop on the calling thread)
+ * @param count Number of loop indices
+ * @param job Loop body
+ * @param data Passed to every call
+ */
+void run_parallel_for(worker_pool_ptr pool, int count, worker_job_fn job,
+                      void* data);
+
+/**
+ * @brief Stop and join all workers, then free the pool
+ * @param pool Pool to destroy (may be NULL)
+ */
+void destroy_worker_pool(worker_pool_ptr pool);
+
+#endif  // CORE_UTILS_WORKER_POOL_H_
@@ -0,0 +1,169 @@
+/**
+ * @file particle_benchmark.c
+ * @brief Particle update and CPU rendering timing
+ *
+ * Keeps the given number of particles alive with explosion bursts and a few
+ * thrust emitters on a 1920x1080 CPU framebuffer, then times
+ * update_particle_system(), draw_particle_system(), the rasterization of
+ * the frame and cpu_present(), which uploads the framebuffer to its texture
+ * and copies it to the renderer. A software renderer on a plain surface
+ * stands in for the window, so no display is needed; its upload is a memory
+ * copy, and a GPU driver may be slower.
+ *
+ * Usage: particle_benchmark [particles] [frames]
+ */
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "core/graphics/cpu_renderer.h"
+#include "core/graphics/graphics_context.h"
+#include "core/graphics/particle_system.h"
+#include "core/graphics/primitive_batch.h"
+#include "core/utils/logger.h"
+
+#define FRAME_WIDTH 1920
+#define FRAME_HEIGHT 1080
+#define DEFAULT_PARTICLES 100000
+#define DEFAULT_FRAMES 300
+#define THRUSTERS 8
+#define BURST 400
+#define TARGET_MS (1000.0 / 60.0)
+
+static double elapsed_ms(Uint64 start) {
+  return 1000.0 * (double)(SDL_GetPerformanceCounter() - start) /
+         (double)SDL_GetPerformanceFrequency();
+}
+
+// Explosions at pseudo-random points until the system holds `target`
+static void top_up(particle_system_ptr system, int target,
+                   unsigned int* seed) {
+  particle_config_t explosion = {0.0f, 0.0f, 0.0f, 3.14159265f, 40.0f, 240.0f,
+                                 0.5f, 2.0f, {255, 220, 120, 255},
+                                 {200, 40, 0, 0}};
+  while (system->count < target) {
+    *seed = *seed * 1103515245u + 12345u;
+    explosion.x = (float)(*seed % FRAME_WIDTH);
+    explosion.y = (float)((*seed >> 8) % FRAME_HEIGHT);
+    int burst = target - system->count < BURST ? target - system->count
+                                               : BURST;
+    if (emit_particles(system, &explosion, burst) == 0) {
+      break;
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  int target = argc > 1 ? atoi(argv[1]) : DEFAULT_PARTICLES;
+  int frames = argc > 2 ? atoi(argv[2]) : DEFAULT_FRAMES;
+  if (target < 1) {
+    target = DEFAULT_PARTICLES;
+  }
+  if (frames < 1) {
+    frames = DEFAULT_FRAMES;
+  }
+
+  if (SDL_Init(0) < 0) {
+    LOG_ERROR_FMT("SDL initialization failed: %s", SDL_GetError());
+    return EXIT_FAILURE;
+  }
+
+  SDL_Surface* target_surface = SDL_CreateRGBSurfaceWithFormat(
+      0, FRAME_WIDTH, FRAME_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+  SDL_Renderer* renderer =
+      target_surface ? SDL_CreateSoftwareRenderer(target_surface) : NULL;
+  cpu_renderer_ptr cpu =
+      renderer ? create_cpu_renderer(renderer, FRAME_WIDTH, FRAME_HEIGHT)
+               : NULL;
+  particle_system_ptr system =
+      cpu ? create_particle_system(target + THRUSTERS * 64, THRUSTERS, 2)
+          : NULL;
+  if (!system) {
+    LOG_ERROR_FMT("Benchmark setup failed: %s", SDL_GetError());
+    destroy_cpu_renderer(cpu);
+    if (renderer) {
+      SDL_DestroyRenderer(renderer);
+    }
+    SDL_FreeSurface(target_surface);
+    SDL_Quit();
+    return EXIT_FAILURE;
+  }
+
+  graphics_context_t context = {0};
+  context.renderer = renderer;
+  context.cpu_renderer = cpu;
+  context.screen_width = FRAME_WIDTH;
+  context.screen_height = FRAME_HEIGHT;
+
+  set_particle_gravity(system, 0.0f, 60.0f);
+  for (int i = 0; i < THRUSTERS; i++) {
+    particle_config_t thrust = {
+        (float)(FRAME_WIDTH * (i + 1) / (THRUSTERS + 1)),
+        (float)(FRAME_HEIGHT - 100), -1.5707963f, 0.2f, 200.0f, 400.0f,
+        0.3f, 0.8f, {120, 180, 255, 255}, {40, 0, 120, 0}};
+    add_particle_emitter(system, &thrust, 2000.0f);
+  }
+  unsigned int seed = 1;
+  top_up(system, target, &seed);
+
+  double update_total = 0.0;
+  double draw_total = 0.0;
+  double raster_total = 0.0;
+  double present_total = 0.0;
+  double worst = 0.0;
+  float delta_time = 1.0f / 60.0f;
+  for (int frame = 0; frame < frames; frame++) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    update_particle_system(system, delta_time);
+    top_up(system, target, &seed);
+    double update_ms = elapsed_ms(start);
+
+    start = SDL_GetPerformanceCounter();
+    cpu_clear(cpu, 0xFF000000u);
+    draw_particle_system(&context, system);
+    double draw_ms = elapsed_ms(start);
+
+    start = SDL_GetPerformanceCounter();
+    flush_cpu_renderer(cpu);
+    double raster_ms = elapsed_ms(start);
+
+    // The commands are already drawn, so this is the upload and copy
+    start = SDL_GetPerformanceCounter();
+    cpu_present(cpu);
+    double present_ms = elapsed_ms(start);
+
+    update_total += update_ms;
+    draw_total += draw_ms;
+    raster_total += raster_ms;
+    present_total += present_ms;
+    double frame_ms = update_ms + draw_ms + raster_ms + present_ms;
+    worst = frame_ms > worst ? frame_ms : worst;
+  }
+
+#if defined(__AVX2__)
+  const char* vectors = "AVX2";
+#elif defined(__SSE2__)
+  const char* vectors = "SSE2";
+#else
+  const char* vectors = "scalar";
+#endif
+  double mean =
+      (update_total + draw_total + raster_total + present_total) / frames;
+  printf("%d particles, %d frames, %s build\n", system->count, frames,
+         vectors);
+  printf("update     %7.3f ms mean\n", update_total / frames);
+  printf("draw       %7.3f ms mean\n", draw_total / frames);
+  printf("rasterize  %7.3f ms mean\n", raster_total / frames);
+  printf("present    %7.3f ms mean\n", present_total / frames);
+  printf("frame      %7.3f ms mean  %7.3f ms worst\n", mean, worst);
+  printf("60 FPS: %s\n", mean <= TARGET_MS ? "yes" : "no");
+
+  destroy_particle_system(system);
+  destroy_primitive_batch(&context);
+  destroy_cpu_renderer(cpu);
+  SDL_DestroyRenderer(renderer);
+  SDL_FreeSurface(target_surface);
+  SDL_Quit();
+  return EXIT_SUCCESS;
+}
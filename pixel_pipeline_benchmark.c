@@ -0,0 +1,194 @@
+/**
+ * @file pixel_pipeline_benchmark.c
+ * @brief Load-time pixel pipeline against SDL's color key conversion
+ *
+ * Builds large sprite sheets in the formats IMG_Load returns for PNGs
+ * (RGB24 and RGBA32) and times the current path, SDL_SetColorKey() plus
+ * the conversion to ARGB8888 that SDL_CreateTextureFromSurface() does,
+ * against preprocess_surface() with and without premultiplication. Every
+ * pipeline output is checked against a scalar reference.
+ *
+ * Usage: pixel_pipeline_benchmark [sheet_size] [runs]
+ */
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "core/graphics/pixel_pipeline.h"
+#include "core/utils/logger.h"
+
+#define DEFAULT_SHEET_SIZE 4096
+#define DEFAULT_RUNS 10
+#define CELL_SIZE 64
+
+/**
+ * Sprite sheet of CELL_SIZE cells on a black background; RGBA sheets get
+ * soft alpha edges
+ */
+static SDL_Surface* create_sheet(int size, Uint32 format) {
+  SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(
+      0, size, size, SDL_BITSPERPIXEL(format), format);
+  if (!sheet) {
+    return NULL;
+  }
+  bool has_alpha = SDL_ISPIXELFORMAT_ALPHA(format);
+  int inner = (CELL_SIZE / 2 - 4) * (CELL_SIZE / 2 - 4);
+  int edge = (CELL_SIZE / 2 - 10) * (CELL_SIZE / 2 - 10);
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      int dx = x % CELL_SIZE - CELL_SIZE / 2;
+      int dy = y % CELL_SIZE - CELL_SIZE / 2;
+      int distance = dx * dx + dy * dy;
+      Uint8 r = 0, g = 0, b = 0, a = 255;
+      if (distance < inner) {
+        r = (Uint8)(x * 7);
+        g = (Uint8)(y * 3);
+        b = (Uint8)(x ^ y);
+        if (has_alpha && distance > edge) {
+          a = (Uint8)(distance & 0xFF);
+        }
+      }
+      Uint32 pixel = has_alpha ? SDL_MapRGBA(sheet->format, r, g, b, a)
+                               : SDL_MapRGB(sheet->format, r, g, b);
+      Uint8* target = (Uint8*)sheet->pixels + (size_t)y * sheet->pitch +
+                      (size_t)x * sheet->format->BytesPerPixel;
+      SDL_memcpy(target, &pixel, sheet->format->BytesPerPixel);
+    }
+  }
+  return sheet;
+}
+
+/**
+ * Scalar reference: black keyed out, optional premultiplication
+ */
+static bool matches_reference(SDL_Surface* source, SDL_Surface* output,
+                              bool premultiply) {
+  for (int y = 0; y < source->h; y++) {
+    const Uint32* row = (const Uint32*)((const Uint8*)output->pixels +
+                                        (size_t)y * output->pitch);
+    for (int x = 0; x < source->w; x++) {
+      Uint32 pixel = 0;
+      SDL_memcpy(&pixel,
+                 (const Uint8*)source->pixels + (size_t)y * source->pitch +
+                     (size_t)x * source->format->BytesPerPixel,
+                 source->format->BytesPerPixel);
+      Uint8 r, g, b, a;
+      SDL_GetRGBA(pixel, source->format, &r, &g, &b, &a);
+      Uint32 expected = 0;
+      if (r || g || b) {
+        if (premultiply) {
+          r = (Uint8)((r * a * 2 + 255) / 510);
+          g = (Uint8)((g * a * 2 + 255) / 510);
+          b = (Uint8)((b * a * 2 + 255) / 510);
+        }
+        expected =
+            ((Uint32)a << 24) | ((Uint32)r << 16) | ((Uint32)g << 8) | b;
+      }
+      if (row[x] != expected) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static double elapsed_ms(Uint64 start) {
+  return 1000.0 * (double)(SDL_GetPerformanceCounter() - start) /
+         (double)SDL_GetPerformanceFrequency();
+}
+
+/**
+ * Current path: color key on the decoded surface, then SDL's conversion
+ */
+static double time_sdl_path(SDL_Surface* sheet, int runs) {
+  double best = 0.0;
+  for (int run = 0; run < runs; run++) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    SDL_SetColorKey(sheet, SDL_TRUE, SDL_MapRGB(sheet->format, 0, 0, 0));
+    SDL_Surface* converted =
+        SDL_ConvertSurfaceFormat(sheet, SDL_PIXELFORMAT_ARGB8888, 0);
+    double ms = elapsed_ms(start);
+    SDL_SetColorKey(sheet, SDL_FALSE, 0);
+    SDL_FreeSurface(converted);
+    best = run == 0 || ms < best ? ms : best;
+  }
+  return best;
+}
+
+static double time_pipeline(SDL_Surface* sheet, int runs, bool premultiply,
+                            bool* correct) {
+  pixel_pipeline_options_t options = {true, 0, 0, 0, premultiply, false};
+  double best = 0.0;
+  *correct = true;
+  for (int run = 0; run < runs; run++) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    SDL_Surface* output = preprocess_surface(sheet, &options, NULL);
+    double ms = elapsed_ms(start);
+    if (!output) {
+      *correct = false;
+      return 0.0;
+    }
+    if (run == 0) {
+      *correct = matches_reference(sheet, output, premultiply);
+    }
+    SDL_FreeSurface(output);
+    best = run == 0 || ms < best ? ms : best;
+  }
+  return best;
+}
+
+int main(int argc, char* argv[]) {
+  int size = argc > 1 ? atoi(argv[1]) : DEFAULT_SHEET_SIZE;
+  int runs = argc > 2 ? atoi(argv[2]) : DEFAULT_RUNS;
+  if (size < CELL_SIZE) {
+    size = DEFAULT_SHEET_SIZE;
+  }
+  if (runs < 1) {
+    runs = DEFAULT_RUNS;
+  }
+
+  if (SDL_Init(0) < 0) {
+    LOG_ERROR_FMT("SDL initialization failed: %s", SDL_GetError());
+    return EXIT_FAILURE;
+  }
+
+#if defined(__AVX2__)
+  const char* kernels = "AVX2";
+#elif defined(__SSE2__)
+  const char* kernels = "SSE2";
+#else
+  const char* kernels = "scalar";
+#endif
+  printf("%dx%d sheets, best of %d runs, %s kernels\n", size, size, runs,
+         kernels);
+  printf("format  SDL colorkey  pipeline  speedup  +premultiply  output\n");
+
+  const Uint32 formats[] = {SDL_PIXELFORMAT_RGB24, SDL_PIXELFORMAT_RGBA32};
+  const char* names[] = {"RGB24", "RGBA32"};
+  bool all_correct = true;
+  for (int i = 0; i < 2; i++) {
+    SDL_Surface* sheet = create_sheet(size, formats[i]);
+    if (!sheet) {
+      LOG_ERROR_FMT("Failed to create sprite sheet: %s", SDL_GetError());
+      SDL_Quit();
+      return EXIT_FAILURE;
+    }
+
+    bool keyed_correct;
+    bool premultiplied_correct;
+    double sdl_ms = time_sdl_path(sheet, runs);
+    double pipeline_ms = time_pipeline(sheet, runs, false, &keyed_correct);
+    double premultiply_ms =
+        time_pipeline(sheet, runs, true, &premultiplied_correct);
+    bool correct = keyed_correct && premultiplied_correct;
+    all_correct = all_correct && correct;
+    printf("%-6s  %9.2f ms  %5.2f ms  %6.2fx  %9.2f ms  %s\n", names[i],
+           sdl_ms, pipeline_ms, sdl_ms / pipeline_ms, premultiply_ms,
+           correct ? "correct" : "MISMATCH");
+    SDL_FreeSurface(sheet);
+  }
+
+  SDL_Quit();
+  return all_correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
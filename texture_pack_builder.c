@@ -0,0 +1,66 @@
+/**
+ * @file texture_pack_builder.c
+ * @brief Command-line tool writing pre-decoded texture packs
+ *
+ * Decodes every image once, at build time, and stores the result with
+ * write_texture_pack(). Images are looked up at runtime by file name
+ * without the directory, e.g. "ship.png".
+ *
+ * Usage: texture_pack_builder output.tpak image...
+ */
+
+#include <SDL.h>
+#include <SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/graphics/texture_pack.h"
+#include "core/utils/logger.h"
+
+static const char* base_name(const char* path) {
+  const char* slash = strrchr(path, '/');
+  return slash ? slash + 1 : path;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s output.tpak image...\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const char* output = argv[1];
+  int count = argc - 2;
+  SDL_Surface** images = calloc((size_t)count + 1, sizeof(SDL_Surface*));
+  const char** names = calloc((size_t)count + 1, sizeof(const char*));
+  if (!images || !names) {
+    LOG_ERROR("Failed to allocate image list");
+    free(images);
+    free(names);
+    return EXIT_FAILURE;
+  }
+
+  bool ok = true;
+  for (int i = 0; i < count && ok; i++) {
+    const char* path = argv[i + 2];
+    images[i] = IMG_Load(path);
+    names[i] = base_name(path);
+    if (!images[i]) {
+      LOG_ERROR_FMT("Failed to load image %s: %s", path, IMG_GetError());
+      ok = false;
+    }
+  }
+
+  ok = ok && write_texture_pack(output, images, names, count);
+  if (ok) {
+    printf("Packed %d image(s) into %s\n", count, output);
+  }
+
+  for (int i = 0; i < count; i++) {
+    SDL_FreeSurface(images[i]);
+  }
+  free(images);
+  free(names);
+  IMG_Quit();
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}